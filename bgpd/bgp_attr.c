@@ -549,6 +549,18 @@ bgp_attr_intern (struct attr *attr)
 }
 
 
+/* Interned copy of attr, with a reference held on it, if there is one. */
+struct attr *
+bgp_attr_lookup_intern (struct attr *attr)
+{
+  struct attr *find;
+
+  find = hash_lookup (attrhash, attr);
+  if (find == NULL)
+    return NULL;
+  return bgp_attr_intern (find);
+}
+
 /* Make network statement's attribute. */
 struct attr *
 bgp_attr_default_set (struct attr *attr, u_char origin)
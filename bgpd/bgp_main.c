@@ -260,6 +260,9 @@ bgp_exit (int status)
     }
   list_free (iflist);
 
+  /* drop the route maps' references to attributes */
+  route_map_cache_hook (NULL, NULL);
+
   /* reverse bgp_attr_init */
   bgp_attr_finish ();
 
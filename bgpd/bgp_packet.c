@@ -224,10 +224,10 @@ bgp_update_packet (struct peer *peer, afi_t afi, safi_t safi)
   if (! stream_empty (s))
     {
       bgp_packet_set_size (s);
-      packet = stream_dup (s);
+      /* The packet takes over the work buffer rather than a copy. */
+      packet = stream_detach (s);
       bgp_packet_add (peer, packet);
       BGP_WRITE_ON (peer->t_write, bgp_write, peer->fd);
-      stream_reset (s);
       return packet;
     }
   return NULL;
@@ -270,9 +270,9 @@ bgp_update_packet_eor (struct peer *peer, afi_t afi, safi_t safi)
     }
 
   bgp_packet_set_size (s);
-  packet = stream_dup (s);
+  packet = s;
+  stream_resize (packet, stream_get_endp (packet));
   bgp_packet_add (peer, packet);
-  stream_free (s);
   return packet;
 }
 
@@ -354,9 +354,8 @@ bgp_withdraw_packet (struct peer *peer, afi_t afi, safi_t safi)
 	  stream_putw (s, 0);
 	}
       bgp_packet_set_size (s);
-      packet = stream_dup (s);
+      packet = stream_detach (s);
       bgp_packet_add (peer, packet);
-      stream_reset (s);
       return packet;
     }
 
@@ -419,8 +418,9 @@ bgp_default_update_send (struct peer *peer, struct attr *attr,
   /* Set size. */
   bgp_packet_set_size (s);
 
-  packet = stream_dup (s);
-  stream_free (s);
+  /* Make real packet, trimmed to size. */
+  packet = s;
+  stream_resize (packet, stream_get_endp (packet));
 
   /* Dump packet if debug option is set. */
 #ifdef DEBUG
@@ -500,8 +500,9 @@ bgp_default_withdraw_send (struct peer *peer, afi_t afi, safi_t safi)
 
   bgp_packet_set_size (s);
 
-  packet = stream_dup (s);
-  stream_free (s);
+  /* Make real packet, trimmed to size. */
+  packet = s;
+  stream_resize (packet, stream_get_endp (packet));
 
   /* Add packet to the peer. */
   bgp_packet_add (peer, packet);
@@ -509,7 +510,7 @@ bgp_default_withdraw_send (struct peer *peer, afi_t afi, safi_t safi)
   BGP_WRITE_ON (peer->t_write, bgp_write, peer->fd);
 }
 
-/* Get next packet to be written.  */
+/* Make the next packet to be written and queue it on obuf.  */
 static struct stream *
 bgp_write_packet (struct peer *peer)
 {
@@ -518,10 +519,6 @@ bgp_write_packet (struct peer *peer)
   struct stream *s = NULL;
   struct bgp_advertise *adv;
 
-  s = stream_fifo_head (peer->obuf);
-  if (s)
-    return s;
-
   for (afi = AFI_IP; afi < AFI_MAX; afi++)
     for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++)
       {
@@ -607,7 +604,9 @@ bgp_write (struct thread *thread)
   struct peer *peer;
   u_char type;
   struct stream *s; 
-  int num;
+  struct stream_chain chain;
+  ssize_t num;
+  size_t writenum;
   unsigned int count = 0;
 
   /* Yes first of all get peer pointer. */
@@ -621,42 +620,49 @@ bgp_write (struct thread *thread)
       return 0;
     }
 
-  s = bgp_write_packet (peer);
-  if (!s)
+  while (peer->obuf->count < BGP_WRITE_PACKET_MAX
+	 && bgp_write_packet (peer) != NULL)
+    ;
+
+  if (! stream_fifo_head (peer->obuf))
     return 0;	/* nothing to send */
 
   sockopt_cork (peer->fd, 1);
 
-  /* Nonblocking write until TCP output buffer is full.  */
-  do
-    {
-      int writenum;
-
-      /* Number of bytes to be sent.  */
-      writenum = stream_get_endp (s) - stream_get_getp (s);
+  /* Write the queued packets with a single writev () straight from
+     their own buffers. */
+  memset (&chain, 0, sizeof (struct stream_chain));
+  for (s = stream_fifo_head (peer->obuf); s && count < BGP_WRITE_PACKET_MAX;
+       s = s->next, count++)
+    stream_chain_append (&chain, s);
 
-      /* Call write() system call.  */
-      num = write (peer->fd, STREAM_PNT (s), writenum);
-      if (num < 0)
+  num = stream_chain_writev (&chain, peer->fd);
+  stream_chain_reset (&chain);
+  if (num < 0)
+    {
+      /* write failed either retry needed or error */
+      if (! ERRNO_IO_RETRY(errno))
 	{
-	  /* write failed either retry needed or error */
-	  if (ERRNO_IO_RETRY(errno))
-		break;
-
-          BGP_EVENT_ADD (peer, TCP_fatal_error);
+	  BGP_EVENT_ADD (peer, TCP_fatal_error);
 	  return 0;
 	}
+      num = 0;
+    }
 
-      if (num != writenum)
+  /* Account for the packets written in full, and delete them. */
+  while (num > 0 && (s = stream_fifo_head (peer->obuf)) != NULL)
+    {
+      writenum = STREAM_READABLE (s);
+      if ((size_t) num < writenum)
 	{
 	  /* Partial write */
 	  stream_forward_getp (s, num);
 	  break;
 	}
+      num -= writenum;
 
       /* Retrieve BGP packet type. */
-      stream_set_getp (s, BGP_MARKER_SIZE + 2);
-      type = stream_getc (s);
+      type = stream_getc_from (s, BGP_MARKER_SIZE + 2);
 
       switch (type)
 	{
@@ -694,8 +700,6 @@ bgp_write (struct thread *thread)
       /* OK we send packet so delete it. */
       bgp_packet_delete (peer);
     }
-  while (++count < BGP_WRITE_PACKET_MAX &&
-	 (s = bgp_write_packet (peer)) != NULL);
   
   if (bgp_write_proceed (peer))
     BGP_WRITE_ON (peer->t_write, bgp_write, peer->fd);
@@ -1035,9 +1039,9 @@ bgp_route_refresh_send (struct peer *peer, afi_t afi, safi_t safi,
 		 BGP_MSG_ROUTE_REFRESH_NEW : BGP_MSG_ROUTE_REFRESH_OLD, length);
     }
 
-  /* Make real packet. */
-  packet = stream_dup (s);
-  stream_free (s);
+  /* Make real packet, trimmed to size. */
+  packet = s;
+  stream_resize (packet, stream_get_endp (packet));
 
   /* Add packet to the peer. */
   bgp_packet_add (peer, packet);
@@ -1082,9 +1086,9 @@ bgp_capability_send (struct peer *peer, afi_t afi, safi_t safi,
   /* Set packet size. */
   length = bgp_packet_set_size (s);
 
-  /* Make real packet. */
-  packet = stream_dup (s);
-  stream_free (s);
+  /* Make real packet, trimmed to size. */
+  packet = s;
+  stream_resize (packet, stream_get_endp (packet));
 
   /* Add packet to the peer. */
   bgp_packet_add (peer, packet);
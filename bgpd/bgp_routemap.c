@@ -290,7 +290,8 @@ struct route_map_rule_cmd route_match_ip_next_hop_cmd =
   "ip next-hop",
   route_match_ip_next_hop,
   route_match_ip_next_hop_compile,
-  route_match_ip_next_hop_free
+  route_match_ip_next_hop_free,
+  1
 };
 
 /* `match ip route-source ACCESS-LIST' */
@@ -435,7 +436,8 @@ struct route_map_rule_cmd route_match_ip_next_hop_prefix_list_cmd =
   "ip next-hop prefix-list",
   route_match_ip_next_hop_prefix_list,
   route_match_ip_next_hop_prefix_list_compile,
-  route_match_ip_next_hop_prefix_list_free
+  route_match_ip_next_hop_prefix_list_free,
+  1
 };
 
 /* `match ip route-source prefix-list PREFIX_LIST' */
@@ -553,7 +555,8 @@ struct route_map_rule_cmd route_match_metric_cmd =
   "metric",
   route_match_metric,
   route_match_metric_compile,
-  route_match_metric_free
+  route_match_metric_free,
+  1
 };
 
 /* `match as-path ASPATH' */
@@ -601,7 +604,8 @@ struct route_map_rule_cmd route_match_aspath_cmd =
   "as-path",
   route_match_aspath,
   route_match_aspath_compile,
-  route_match_aspath_free
+  route_match_aspath_free,
+  1
 };
 
 /* `match community COMMUNIY' */
@@ -685,7 +689,8 @@ struct route_map_rule_cmd route_match_community_cmd =
   "community",
   route_match_community,
   route_match_community_compile,
-  route_match_community_free
+  route_match_community_free,
+  1
 };
 
 /* Match function for extcommunity match. */
@@ -734,7 +739,8 @@ struct route_map_rule_cmd route_match_ecommunity_cmd =
   "extcommunity",
   route_match_ecommunity,
   route_match_ecommunity_compile,
-  route_match_ecommunity_free
+  route_match_ecommunity_free,
+  1
 };
 
 /* `match nlri` and `set nlri` are replaced by `address-family ipv4`
@@ -790,7 +796,8 @@ struct route_map_rule_cmd route_match_origin_cmd =
   "origin",
   route_match_origin,
   route_match_origin_compile,
-  route_match_origin_free
+  route_match_origin_free,
+  1
 };
 
 /* match probability  { */
@@ -1915,7 +1922,8 @@ struct route_map_rule_cmd route_match_ipv6_next_hop_cmd =
   "ipv6 next-hop",
   route_match_ipv6_next_hop,
   route_match_ipv6_next_hop_compile,
-  route_match_ipv6_next_hop_free
+  route_match_ipv6_next_hop_free,
+  1
 };
 
 /* `match ipv6 address prefix-list PREFIX_LIST' */
@@ -2409,6 +2417,22 @@ bgp_route_map_update (const char *unused)
     }
 }
 
+/* Every route-map in use is looked up again whatever was added, so do
+   it once for a whole configuration file.  Deletions are handled at
+   once, as the route-maps in use may be gone. */
+static void
+bgp_route_map_batch (void *arg, const char *name)
+{
+  bgp_route_map_update (name);
+}
+
+static void
+bgp_route_map_add (const char *name)
+{
+  if (! cmd_batch_defer (bgp_route_map_batch, NULL, ""))
+    bgp_route_map_update (name);
+}
+
 DEFUN (match_peer,
        match_peer_cmd,
        "match peer (A.B.C.D|X:X::X:X)",
@@ -3834,14 +3858,36 @@ ALIAS (no_match_pathlimit_as,
        "Match Pathlimit ASN\n")
 
 
+/* Matches of cacheable rules are kept by interned attributes, which
+   the route map holds on to. */
+static void *
+bgp_route_map_cache_key (route_map_object_t type, void *object)
+{
+  struct bgp_info *info = object;
+
+  if (type != RMAP_BGP)
+    return NULL;
+  return bgp_attr_lookup_intern (info->attr);
+}
+
+static void
+bgp_route_map_cache_release (void *key)
+{
+  struct attr *attr = key;
+
+  bgp_attr_unintern (&attr);
+}
+
 /* Initialization of route map. */
 void
 bgp_route_map_init (void)
 {
   route_map_init ();
   route_map_init_vty ();
-  route_map_add_hook (bgp_route_map_update);
+  route_map_add_hook (bgp_route_map_add);
   route_map_delete_hook (bgp_route_map_update);
+  route_map_cache_hook (bgp_route_map_cache_key,
+                        bgp_route_map_cache_release);
 
   route_map_install_match (&route_match_peer_cmd);
   route_map_install_match (&route_match_ip_address_cmd);
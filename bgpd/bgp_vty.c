@@ -30,6 +30,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "log.h"
 #include "memory.h"
 #include "hash.h"
+#include "routemap.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_advertise.h"
@@ -10270,6 +10271,7 @@ community_list_set_vty (struct vty *vty, int argc, const char **argv,
   /* When community_list_set() return nevetive value, it means
      malformed community string.  */
   ret = community_list_set (bgp_clist, argv[0], str, direct, style);
+  route_map_cache_flush ();
 
   /* Free temporary community list string allocated by
      argv_concat().  */
@@ -10315,6 +10317,7 @@ community_list_unset_vty (struct vty *vty, int argc, const char **argv,
 
   /* Unset community list.  */
   ret = community_list_unset (bgp_clist, argv[0], str, direct, style);
+  route_map_cache_flush ();
 
   /* Free temporary community list string allocated by
      argv_concat().  */
@@ -10623,6 +10626,7 @@ extcommunity_list_set_vty (struct vty *vty, int argc, const char **argv,
     str = NULL;
 
   ret = extcommunity_list_set (bgp_clist, argv[0], str, direct, style);
+  route_map_cache_flush ();
 
   /* Free temporary community list string allocated by
      argv_concat().  */
@@ -10665,6 +10669,7 @@ extcommunity_list_unset_vty (struct vty *vty, int argc, const char **argv,
 
   /* Unset community list.  */
   ret = extcommunity_list_unset (bgp_clist, argv[0], str, direct, style);
+  route_map_cache_flush ();
 
   /* Free temporary community list string allocated by
      argv_concat().  */
@@ -3755,6 +3755,9 @@ peer_distribute_update (struct access_list *access)
   struct peer_group *group;
   struct bgp_filter *filter;
 
+  /* Route maps may match on the list too. */
+  route_map_cache_flush ();
+
   for (ALL_LIST_ELEMENTS (bm->bgp, mnode, mnnode, bgp))
     {
       for (ALL_LIST_ELEMENTS (bgp->peer, node, nnode, peer))
@@ -3793,6 +3796,24 @@ peer_distribute_update (struct access_list *access)
 	}
     }
 }
+
+/* Every list is looked up again whatever was added to, so do it once
+   for a whole configuration file.  Cached route-map results go at once
+   all the same, and deletions are handled at once, as the lists in use
+   may be gone. */
+static void
+peer_distribute_batch (void *arg, const char *name)
+{
+  peer_distribute_update (NULL);
+}
+
+static void
+peer_distribute_add (struct access_list *access)
+{
+  route_map_cache_flush ();
+  if (! cmd_batch_defer (peer_distribute_batch, NULL, ""))
+    peer_distribute_update (access);
+}
 
 /* Set prefix list to the peer. */
 int
@@ -3914,6 +3935,9 @@ peer_prefix_list_update (struct prefix_list *plist)
   safi_t safi;
   int direct;
 
+  /* Route maps may match on the list too. */
+  route_map_cache_flush ();
+
   for (ALL_LIST_ELEMENTS (bm->bgp, mnode, mnnode, bgp))
     {
       for (ALL_LIST_ELEMENTS (bgp->peer, node, nnode, peer))
@@ -3952,6 +3976,20 @@ peer_prefix_list_update (struct prefix_list *plist)
 	}
     }
 }
+
+static void
+peer_prefix_list_batch (void *arg, const char *name)
+{
+  peer_prefix_list_update (NULL);
+}
+
+static void
+peer_prefix_list_add (struct prefix_list *plist)
+{
+  route_map_cache_flush ();
+  if (! cmd_batch_defer (peer_prefix_list_batch, NULL, ""))
+    peer_prefix_list_update (plist);
+}
 
 int
 peer_aslist_set (struct peer *peer, afi_t afi, safi_t safi, int direct,
@@ -4068,6 +4106,9 @@ peer_aslist_update (void)
   struct peer_group *group;
   struct bgp_filter *filter;
 
+  /* Route maps may match on the list too. */
+  route_map_cache_flush ();
+
   for (ALL_LIST_ELEMENTS (bm->bgp, mnode, mnnode, bgp))
     {
       for (ALL_LIST_ELEMENTS (bgp->peer, node, nnode, peer))
@@ -5388,7 +5429,7 @@ bgp_init (void)
 
   /* Access list initialize. */
   access_list_init ();
-  access_list_add_hook (peer_distribute_update);
+  access_list_add_hook (peer_distribute_add);
   access_list_delete_hook (peer_distribute_update);
 
   /* Filter list initialize. */
@@ -5398,7 +5439,7 @@ bgp_init (void)
 
   /* Prefix list initialize.*/
   prefix_list_init ();
-  prefix_list_add_hook (peer_prefix_list_update);
+  prefix_list_add_hook (peer_prefix_list_add);
   prefix_list_delete_hook (peer_prefix_list_update);
 
   /* Community list initialize. */
@@ -9,6 +9,285 @@
 #include <zebra.h>
 #include "checksum.h"
 
+/*
+ * Both checksums spend their time summing the buffer, which on x86 is
+ * done 16 or 32 bytes at a time with SSE2 or AVX2 when the CPU has it.
+ * The sums are the same integers the scalar loops produce, so the
+ * results are identical whichever is used.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) \
+    && ((defined(__GNUC__) && !defined(__clang__) \
+         && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) \
+        || (defined(__clang__) && __clang_major__ >= 4))
+#define CHECKSUM_X86
+#include <immintrin.h>
+#endif
+
+/* Sum of the 16-bit words in nwords * 2 bytes. */
+typedef u_int64_t (*in_cksum_sum_t) (const u_char *, size_t);
+
+/* Fletcher sums c0 and c1 carried over len more bytes, mod 255. */
+typedef void (*fletcher_sum_t) (const u_char *, size_t, int *, int *);
+
+static u_int64_t
+in_cksum_sum_scalar (const u_char *buf, size_t nwords)
+{
+  const u_short *ptr = (const u_short *) buf;
+  u_int64_t sum = 0;
+
+  while (nwords--)
+    sum += *ptr++;
+  return sum;
+}
+
+/* Fletcher Checksum -- Refer to RFC1008. */
+#define MODX                 4102   /* 5802 should be fine */
+
+static void
+fletcher_sum_scalar (const u_char *p, size_t left, int *pc0, int *pc1)
+{
+  size_t partial_len, i;
+  int c0 = *pc0, c1 = *pc1;
+
+  while (left != 0)
+    {
+      partial_len = MIN(left, MODX);
+
+      for (i = 0; i < partial_len; i++)
+	{
+	  c0 = c0 + *(p++);
+	  c1 += c0;
+	}
+
+      c0 = c0 % 255;
+      c1 = c1 % 255;
+
+      left -= partial_len;
+    }
+
+  *pc0 = c0;
+  *pc1 = c1;
+}
+
+#ifdef CHECKSUM_X86
+
+/* Bytes summed before the 32-bit vector lanes are folded or reduced. */
+#define CHECKSUM_SIMD_BLOCK  32768
+
+__attribute__ ((target ("sse2")))
+static u_int64_t
+in_cksum_sum_sse2 (const u_char *buf, size_t nwords)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  u_int32_t lanes[4];
+  u_int64_t sum = 0;
+  size_t n, i;
+  __m128i acc, v;
+
+  while (nwords >= 8)
+    {
+      /* each lane takes two words per 16 bytes */
+      n = MIN (nwords, CHECKSUM_SIMD_BLOCK) / 8;
+      acc = zero;
+      for (i = 0; i < n; i++, buf += 16)
+	{
+	  v = _mm_loadu_si128 ((const __m128i *) buf);
+	  acc = _mm_add_epi32 (acc, _mm_unpacklo_epi16 (v, zero));
+	  acc = _mm_add_epi32 (acc, _mm_unpackhi_epi16 (v, zero));
+	}
+      _mm_storeu_si128 ((__m128i *) lanes, acc);
+      sum += (u_int64_t) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+      nwords -= n * 8;
+    }
+
+  return sum + in_cksum_sum_scalar (buf, nwords);
+}
+
+__attribute__ ((target ("avx2")))
+static u_int64_t
+in_cksum_sum_avx2 (const u_char *buf, size_t nwords)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  u_int32_t lanes[8];
+  u_int64_t sum = 0;
+  size_t n, i;
+  __m256i acc, v;
+
+  while (nwords >= 16)
+    {
+      n = MIN (nwords, CHECKSUM_SIMD_BLOCK) / 16;
+      acc = zero;
+      for (i = 0; i < n; i++, buf += 32)
+	{
+	  v = _mm256_loadu_si256 ((const __m256i *) buf);
+	  acc = _mm256_add_epi32 (acc, _mm256_unpacklo_epi16 (v, zero));
+	  acc = _mm256_add_epi32 (acc, _mm256_unpackhi_epi16 (v, zero));
+	}
+      _mm256_storeu_si256 ((__m256i *) lanes, acc);
+      for (i = 0; i < 8; i++)
+	sum += lanes[i];
+      nwords -= n * 16;
+    }
+
+  return sum + in_cksum_sum_sse2 (buf, nwords);
+}
+
+/*
+ * Over a run of n bytes b[i], c0 grows by the sum of the bytes and c1 by
+ * n * c0 plus the sum of (n - i) * b[i].  Runs are taken a vector at a
+ * time: the byte sums of the vectors before each one give the n * c0
+ * part, and a multiply-add with descending weights the rest.
+ */
+__attribute__ ((target ("sse2")))
+static void
+fletcher_sum_sse2 (const u_char *p, size_t left, int *pc0, int *pc1)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i weight_lo = _mm_setr_epi16 (16, 15, 14, 13, 12, 11, 10, 9);
+  const __m128i weight_hi = _mm_setr_epi16 (8, 7, 6, 5, 4, 3, 2, 1);
+  u_int64_t c0 = *pc0, c1 = *pc1;
+  u_int64_t before[2], bytes[2];
+  u_int32_t weighted[4];
+  size_t n, i;
+  __m128i vbefore, vbytes, vweighted, v;
+
+  while (left >= 16)
+    {
+      n = MIN (left, CHECKSUM_SIMD_BLOCK) / 16;
+      vbefore = vbytes = vweighted = zero;
+      for (i = 0; i < n; i++, p += 16)
+	{
+	  v = _mm_loadu_si128 ((const __m128i *) p);
+	  vbefore = _mm_add_epi64 (vbefore, vbytes);
+	  vbytes = _mm_add_epi64 (vbytes, _mm_sad_epu8 (v, zero));
+	  vweighted = _mm_add_epi32 (vweighted,
+	    _mm_madd_epi16 (_mm_unpacklo_epi8 (v, zero), weight_lo));
+	  vweighted = _mm_add_epi32 (vweighted,
+	    _mm_madd_epi16 (_mm_unpackhi_epi8 (v, zero), weight_hi));
+	}
+      _mm_storeu_si128 ((__m128i *) before, vbefore);
+      _mm_storeu_si128 ((__m128i *) bytes, vbytes);
+      _mm_storeu_si128 ((__m128i *) weighted, vweighted);
+
+      c1 += n * 16 * c0 + 16 * (before[0] + before[1])
+	    + weighted[0] + weighted[1] + weighted[2] + weighted[3];
+      c0 += bytes[0] + bytes[1];
+      c0 %= 255;
+      c1 %= 255;
+      left -= n * 16;
+    }
+
+  *pc0 = c0;
+  *pc1 = c1;
+  fletcher_sum_scalar (p, left, pc0, pc1);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+fletcher_sum_avx2 (const u_char *p, size_t left, int *pc0, int *pc1)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i ones = _mm256_set1_epi16 (1);
+  const __m256i weight = _mm256_setr_epi8 (32, 31, 30, 29, 28, 27, 26, 25,
+					   24, 23, 22, 21, 20, 19, 18, 17,
+					   16, 15, 14, 13, 12, 11, 10, 9,
+					   8, 7, 6, 5, 4, 3, 2, 1);
+  u_int64_t c0 = *pc0, c1 = *pc1;
+  u_int64_t before[4], bytes[4];
+  u_int32_t weighted[8];
+  size_t n, i;
+  __m256i vbefore, vbytes, vweighted, v;
+
+  while (left >= 32)
+    {
+      n = MIN (left, CHECKSUM_SIMD_BLOCK) / 32;
+      vbefore = vbytes = vweighted = zero;
+      for (i = 0; i < n; i++, p += 32)
+	{
+	  v = _mm256_loadu_si256 ((const __m256i *) p);
+	  vbefore = _mm256_add_epi64 (vbefore, vbytes);
+	  vbytes = _mm256_add_epi64 (vbytes, _mm256_sad_epu8 (v, zero));
+	  /* 255 * (32 + 31) fits the signed 16-bit pairs */
+	  vweighted = _mm256_add_epi32 (vweighted,
+	    _mm256_madd_epi16 (_mm256_maddubs_epi16 (v, weight), ones));
+	}
+      _mm256_storeu_si256 ((__m256i *) before, vbefore);
+      _mm256_storeu_si256 ((__m256i *) bytes, vbytes);
+      _mm256_storeu_si256 ((__m256i *) weighted, vweighted);
+
+      c1 += n * 32 * c0
+	    + 32 * (before[0] + before[1] + before[2] + before[3]);
+      for (i = 0; i < 8; i++)
+	c1 += weighted[i];
+      c0 += bytes[0] + bytes[1] + bytes[2] + bytes[3];
+      c0 %= 255;
+      c1 %= 255;
+      left -= n * 32;
+    }
+
+  *pc0 = c0;
+  *pc1 = c1;
+  fletcher_sum_sse2 (p, left, pc0, pc1);
+}
+
+#endif /* CHECKSUM_X86 */
+
+static const struct checksum_kernel
+{
+  const char *name;
+  in_cksum_sum_t in_cksum_sum;
+  fletcher_sum_t fletcher_sum;
+} checksum_kernels[] =
+{
+#ifdef CHECKSUM_X86
+  { "avx2",	in_cksum_sum_avx2,	fletcher_sum_avx2 },
+  { "sse2",	in_cksum_sum_sse2,	fletcher_sum_sse2 },
+#endif /* CHECKSUM_X86 */
+  { "scalar",	in_cksum_sum_scalar,	fletcher_sum_scalar },
+};
+
+static const struct checksum_kernel *checksum_kernel;
+
+static int
+checksum_kernel_usable (const struct checksum_kernel *kernel)
+{
+#ifdef CHECKSUM_X86
+  __builtin_cpu_init ();
+  if (kernel->fletcher_sum == fletcher_sum_avx2)
+    return __builtin_cpu_supports ("avx2");
+  if (kernel->fletcher_sum == fletcher_sum_sse2)
+    return __builtin_cpu_supports ("sse2");
+#endif /* CHECKSUM_X86 */
+  return 1;
+}
+
+/* Use the named kernel, or the fastest one the CPU runs if name is
+   NULL.  Returns -1 if there is no such kernel or the CPU lacks it. */
+int
+checksum_kernel_select (const char *name)
+{
+  unsigned int i;
+
+  for (i = 0; i < sizeof (checksum_kernels) / sizeof (checksum_kernels[0]);
+       i++)
+    if ((name == NULL || strcmp (name, checksum_kernels[i].name) == 0)
+	&& checksum_kernel_usable (&checksum_kernels[i]))
+      {
+	checksum_kernel = &checksum_kernels[i];
+	return 0;
+      }
+  return -1;
+}
+
+/* Name of the kernel in use. */
+const char *
+checksum_kernel_name (void)
+{
+  if (checksum_kernel == NULL)
+    checksum_kernel_select (NULL);
+  return checksum_kernel->name;
+}
+
 int			/* return checksum in low-order 16 bits */
 in_cksum(void *parg, int nbytes)
 {
@@ -23,11 +302,11 @@ in_cksum(void *parg, int nbytes)
 	 * all the carry bits from the top 16 bits into the lower 16 bits.
 	 */
 
-	sum = 0;
-	while (nbytes > 1)  {
-		sum += *ptr++;
-		nbytes -= 2;
-	}
+	if (checksum_kernel == NULL)
+		checksum_kernel_select (NULL);
+	sum = checksum_kernel->in_cksum_sum (parg, nbytes / 2);
+	ptr += nbytes / 2;
+	nbytes %= 2;
 
 				/* mop up an odd byte, if necessary */
 	if (nbytes == 1) {
@@ -46,22 +325,17 @@ in_cksum(void *parg, int nbytes)
 	return(answer);
 }
 
-/* Fletcher Checksum -- Refer to RFC1008. */
-#define MODX                 4102   /* 5802 should be fine */
-
-/* To be consistent, offset is 0-based index, rather than the 1-based 
+/* To be consistent, offset is 0-based index, rather than the 1-based
    index required in the specification ISO 8473, Annex C.1 */
 /* calling with offset == FLETCHER_CHECKSUM_VALIDATE will validate the checksum
    without modifying the buffer; a valid checksum returns 0 */
 u_int16_t
 fletcher_checksum(u_char * buffer, const size_t len, const uint16_t offset)
 {
-  u_int8_t *p;
   int x, y, c0, c1;
   u_int16_t checksum;
   u_int16_t *csum;
-  size_t partial_len, i, left = len;
-  
+
   checksum = 0;
 
 
@@ -73,25 +347,12 @@ fletcher_checksum(u_char * buffer, const size_t len, const uint16_t offset)
       *(csum) = 0;
     }
 
-  p = buffer;
   c0 = 0;
   c1 = 0;
 
-  while (left != 0)
-    {
-      partial_len = MIN(left, MODX);
-
-      for (i = 0; i < partial_len; i++)
-	{
-	  c0 = c0 + *(p++);
-	  c1 += c0;
-	}
-
-      c0 = c0 % 255;
-      c1 = c1 % 255;
-
-      left -= partial_len;
-    }
+  if (checksum_kernel == NULL)
+    checksum_kernel_select (NULL);
+  checksum_kernel->fletcher_sum (buffer, len, &c0, &c1);
 
   /* The cast is important, to ensure the mod is taken as a signed value. */
   x = (int)((len - offset - 1) * c0 - c1) % 255;
@@ -99,7 +360,7 @@ fletcher_checksum(u_char * buffer, const size_t len, const uint16_t offset)
   if (x <= 0)
     x += 255;
   y = 510 - c0 - x;
-  if (y > 255)  
+  if (y > 255)
     y -= 255;
 
   if (offset == FLETCHER_CHECKSUM_VALIDATE)
@@ -1,3 +1,5 @@
 extern int in_cksum(void *, int);
 #define FLETCHER_CHECKSUM_VALIDATE 0xffff
 extern u_int16_t fletcher_checksum(u_char *, const size_t len, const uint16_t offset);
+extern int checksum_kernel_select (const char *name);
+extern const char *checksum_kernel_name (void);
@@ -30,6 +30,8 @@ Boston, MA 02111-1307, USA.  */
 #include "vty.h"
 #include "command.h"
 #include "workqueue.h"
+#include "hash.h"
+#include "jhash.h"
 
 /* Command vector which includes some level of command lists. Normally
    each daemon maintains each own cmdvec. */
@@ -194,6 +196,147 @@ install_node (struct cmd_node *node,
   vector_set_index (cmdvec, node->node, node);
   node->func = func;
   node->cmd_vector = vector_init (VECTOR_MIN_SIZE);
+  node->trie = NULL;
+}
+
+/* Commands of a node are compiled into a trie with one level for each
+   word, so that a line is matched by walking down it instead of
+   filtering every command of the node at every word.  Commands whose
+   words have the same tokens share a subtrie, and each subtrie keeps
+   the commands below it with their position in the node's command
+   vector, which is the order in which they are listed. */
+struct cmd_trie_entry
+{
+  unsigned int pos;
+  struct cmd_element *cmd;
+};
+
+struct cmd_trie
+{
+  /* Tokens of the word leading here, NULL at the root. */
+  vector descvec;
+
+  /* Subtries for the next word. */
+  vector child;
+
+  /* Commands at and below this subtrie, by position. */
+  unsigned int count;
+  unsigned int size;
+  struct cmd_trie_entry *entry;
+};
+
+static struct cmd_trie *
+cmd_trie_new (vector descvec)
+{
+  struct cmd_trie *trie;
+
+  trie = XCALLOC (MTYPE_CMD_TRIE, sizeof (struct cmd_trie));
+  trie->descvec = descvec;
+  trie->child = vector_init (1);
+  return trie;
+}
+
+static void
+cmd_trie_free (struct cmd_trie *trie)
+{
+  unsigned int i;
+  struct cmd_trie *child;
+
+  for (i = 0; i < vector_active (trie->child); i++)
+    if ((child = vector_slot (trie->child, i)) != NULL)
+      cmd_trie_free (child);
+  vector_free (trie->child);
+  if (trie->entry)
+    XFREE (MTYPE_CMD_TRIE, trie->entry);
+  XFREE (MTYPE_CMD_TRIE, trie);
+}
+
+/* Do two words of commands have the same tokens? */
+static int
+cmd_trie_same (vector a, vector b)
+{
+  unsigned int i;
+  struct desc *da, *db;
+
+  if (vector_active (a) != vector_active (b))
+    return 0;
+  for (i = 0; i < vector_active (a); i++)
+    {
+      da = vector_slot (a, i);
+      db = vector_slot (b, i);
+      if (da == NULL || db == NULL)
+	{
+	  if (da != db)
+	    return 0;
+	}
+      else if (strcmp (da->cmd, db->cmd) != 0)
+	return 0;
+    }
+  return 1;
+}
+
+static void
+cmd_trie_add (struct cmd_trie *trie, struct cmd_element *cmd,
+	      unsigned int pos)
+{
+  if (trie->count == trie->size)
+    {
+      trie->size = trie->size ? trie->size * 2 : 1;
+      trie->entry = XREALLOC (MTYPE_CMD_TRIE, trie->entry,
+			      trie->size * sizeof (struct cmd_trie_entry));
+    }
+  trie->entry[trie->count].pos = pos;
+  trie->entry[trie->count].cmd = cmd;
+  trie->count++;
+}
+
+/* Add a command to the trie of its node. */
+static void
+cmd_trie_insert (struct cmd_node *cnode, struct cmd_element *cmd,
+		 unsigned int pos)
+{
+  struct cmd_trie *trie, *child;
+  vector descvec;
+  unsigned int i, j;
+
+  if (cnode->trie == NULL)
+    cnode->trie = cmd_trie_new (NULL);
+
+  trie = cnode->trie;
+  cmd_trie_add (trie, cmd, pos);
+  for (i = 0; i < vector_active (cmd->strvec); i++)
+    {
+      descvec = vector_slot (cmd->strvec, i);
+
+      for (j = 0; j < vector_active (trie->child); j++)
+	if ((child = vector_slot (trie->child, j)) != NULL
+	    && cmd_trie_same (child->descvec, descvec))
+	  break;
+      if (j == vector_active (trie->child))
+	{
+	  child = cmd_trie_new (descvec);
+	  vector_set (trie->child, child);
+	}
+
+      trie = child;
+      cmd_trie_add (trie, cmd, pos);
+    }
+}
+
+/* Compile the trie of a node again from its command vector. */
+static void
+cmd_trie_rebuild (struct cmd_node *cnode)
+{
+  unsigned int i;
+  struct cmd_element *cmd;
+
+  if (cnode->trie)
+    cmd_trie_free (cnode->trie);
+  cnode->trie = NULL;
+
+  for (i = 0; i < vector_active (cnode->cmd_vector); i++)
+    if ((cmd = vector_slot (cnode->cmd_vector, i)) != NULL)
+      cmd_trie_insert (cnode, cmd, i);
 }
 
 /* Compare two command's string.  Used in sort_node (). */
@@ -240,6 +383,8 @@ sort_node ()
 	      qsort (descvec->index, vector_active (descvec), 
 	             sizeof (void *), cmp_desc);
 	    }
+
+	cmd_trie_rebuild (cnode);
       }
 }
 
@@ -482,6 +627,7 @@ void
 install_element (enum node_type ntype, struct cmd_element *cmd)
 {
   struct cmd_node *cnode;
+  unsigned int pos;
   
   /* cmd_init hasn't been called */
   if (!cmdvec)
@@ -496,12 +642,14 @@ install_element (enum node_type ntype, struct cmd_element *cmd)
       exit (1);
     }
 
-  vector_set (cnode->cmd_vector, cmd);
+  pos = vector_set (cnode->cmd_vector, cmd);
 
   if (cmd->strvec == NULL)
     cmd->strvec = cmd_make_descvec (cmd->string, cmd->doc);
 
   cmd->cmdsize = cmd_cmdsize (cmd->strvec);
+
+  cmd_trie_insert (cnode, cmd, pos);
 }
 
 static const unsigned char itoa64[] =
@@ -617,6 +765,9 @@ config_write_host (struct vty *vty)
     vty_out (vty, "service terminal-length %d%s", host.lines,
 	     VTY_NEWLINE);
 
+  if (thread_cpu_sample != THREAD_CPU_SAMPLE_DEFAULT)
+    vty_out (vty, "thread cpu sample %u%s", thread_cpu_sample, VTY_NEWLINE);
+
   if (host.motdfile)
     vty_out (vty, "banner motd file %s%s", host.motdfile, VTY_NEWLINE);
   else if (! host.motd)
@@ -625,14 +776,6 @@ config_write_host (struct vty *vty)
   return 1;
 }
 
-/* Utility function for getting command vector. */
-static vector
-cmd_node_vector (vector v, enum node_type ntype)
-{
-  struct cmd_node *cnode = vector_slot (v, ntype);
-  return cnode->cmd_vector;
-}
-
 #if 0
 /* Filter command vector by symbol.  This function is not actually used;
  * should it be deleted? */
@@ -1056,131 +1199,88 @@ cmd_range_match (const char *range, const char *str)
   return 1;
 }
 
-/* Make completion match and return match type flag. */
+/* Match a word against the tokens at one position of a command, and
+   return the best match.  Unless strict, a word may be the start of a
+   keyword or an incomplete address. */
 static enum match_type
-cmd_filter_by_completion (char *command, vector v, unsigned int index)
+cmd_desc_match (const char *command, vector descvec, int strict)
 {
-  unsigned int i;
+  unsigned int j;
   const char *str;
-  struct cmd_element *cmd_element;
-  enum match_type match_type;
-  vector descvec;
   struct desc *desc;
+  enum match_type match_type = no_match;
 
-  match_type = no_match;
+#define CMD_DESC_MATCHED(M) \
+  (strict ? (M) == exact_match : (M) != no_match)
+#define CMD_DESC_BEST(T) \
+  do { if (match_type < (T)) match_type = (T); } while (0)
 
-  /* If command and cmd_element string does not match set NULL to vector */
-  for (i = 0; i < vector_active (v); i++)
-    if ((cmd_element = vector_slot (v, i)) != NULL)
+  for (j = 0; j < vector_active (descvec); j++)
+    if ((desc = vector_slot (descvec, j)))
       {
-	if (index >= vector_active (cmd_element->strvec))
-	  vector_slot (v, i) = NULL;
-	else
-	  {
-	    unsigned int j;
-	    int matched = 0;
-
-	    descvec = vector_slot (cmd_element->strvec, index);
-
-	    for (j = 0; j < vector_active (descvec); j++)
-	      if ((desc = vector_slot (descvec, j)))
-		{
-		  str = desc->cmd;
-		  
-		  if (CMD_VARARG (str))
-		    {
-		      if (match_type < vararg_match)
-			match_type = vararg_match;
-		      matched++;
-		    }
-		  else if (CMD_RANGE (str))
-		    {
-		      if (cmd_range_match (str, command))
-			{
-			  if (match_type < range_match)
-			    match_type = range_match;
+	str = desc->cmd;
 
-			  matched++;
-			}
-		    }
+	if (CMD_VARARG (str))
+	  CMD_DESC_BEST (vararg_match);
+	else if (CMD_RANGE (str))
+	  {
+	    if (cmd_range_match (str, command))
+	      CMD_DESC_BEST (range_match);
+	  }
 #ifdef HAVE_IPV6
-		  else if (CMD_IPV6 (str))
-		    {
-		      if (cmd_ipv6_match (command))
-			{
-			  if (match_type < ipv6_match)
-			    match_type = ipv6_match;
-
-			  matched++;
-			}
-		    }
-		  else if (CMD_IPV6_PREFIX (str))
-		    {
-		      if (cmd_ipv6_prefix_match (command))
-			{
-			  if (match_type < ipv6_prefix_match)
-			    match_type = ipv6_prefix_match;
-
-			  matched++;
-			}
-		    }
+	else if (CMD_IPV6 (str))
+	  {
+	    if (CMD_DESC_MATCHED (cmd_ipv6_match (command)))
+	      CMD_DESC_BEST (ipv6_match);
+	  }
+	else if (CMD_IPV6_PREFIX (str))
+	  {
+	    if (CMD_DESC_MATCHED (cmd_ipv6_prefix_match (command)))
+	      CMD_DESC_BEST (ipv6_prefix_match);
+	  }
 #endif /* HAVE_IPV6  */
-		  else if (CMD_IPV4 (str))
-		    {
-		      if (cmd_ipv4_match (command))
-			{
-			  if (match_type < ipv4_match)
-			    match_type = ipv4_match;
-
-			  matched++;
-			}
-		    }
-		  else if (CMD_IPV4_PREFIX (str))
-		    {
-		      if (cmd_ipv4_prefix_match (command))
-			{
-			  if (match_type < ipv4_prefix_match)
-			    match_type = ipv4_prefix_match;
-			  matched++;
-			}
-		    }
-		  else
-		    /* Check is this point's argument optional ? */
-		  if (CMD_OPTION (str) || CMD_VARIABLE (str))
-		    {
-		      if (match_type < extend_match)
-			match_type = extend_match;
-		      matched++;
-		    }
-		  else if (strncmp (command, str, strlen (command)) == 0)
-		    {
-		      if (strcmp (command, str) == 0)
-			match_type = exact_match;
-		      else
-			{
-			  if (match_type < partly_match)
-			    match_type = partly_match;
-			}
-		      matched++;
-		    }
-		}
-	    if (!matched)
-	      vector_slot (v, i) = NULL;
+	else if (CMD_IPV4 (str))
+	  {
+	    if (CMD_DESC_MATCHED (cmd_ipv4_match (command)))
+	      CMD_DESC_BEST (ipv4_match);
+	  }
+	else if (CMD_IPV4_PREFIX (str))
+	  {
+	    if (CMD_DESC_MATCHED (cmd_ipv4_prefix_match (command)))
+	      CMD_DESC_BEST (ipv4_prefix_match);
+	  }
+	else
+	  /* Check is this point's argument optional ? */
+	if (CMD_OPTION (str) || CMD_VARIABLE (str))
+	  CMD_DESC_BEST (extend_match);
+	else if (strict)
+	  {
+	    if (strcmp (command, str) == 0)
+	      match_type = exact_match;
+	  }
+	else if (strncmp (command, str, strlen (command)) == 0)
+	  {
+	    if (strcmp (command, str) == 0)
+	      match_type = exact_match;
+	    else
+	      CMD_DESC_BEST (partly_match);
 	  }
       }
+
+#undef CMD_DESC_MATCHED
+#undef CMD_DESC_BEST
   return match_type;
 }
 
-/* Filter vector by command character with index. */
+/* Filter commands by the word at index, dropping those that do not
+   match it, and return the best match type. */
 static enum match_type
-cmd_filter_by_string (char *command, vector v, unsigned int index)
+cmd_filter (char *command, vector v, unsigned int index, int strict)
 {
   unsigned int i;
-  const char *str;
   struct cmd_element *cmd_element;
   enum match_type match_type;
-  vector descvec;
-  struct desc *desc;
+  enum match_type ret;
 
   match_type = no_match;
 
@@ -1194,188 +1294,253 @@ cmd_filter_by_string (char *command, vector v, unsigned int index)
 	  vector_slot (v, i) = NULL;
 	else
 	  {
-	    unsigned int j;
-	    int matched = 0;
-
-	    descvec = vector_slot (cmd_element->strvec, index);
-
-	    for (j = 0; j < vector_active (descvec); j++)
-	      if ((desc = vector_slot (descvec, j)))
-		{
-		  str = desc->cmd;
-
-		  if (CMD_VARARG (str))
-		    {
-		      if (match_type < vararg_match)
-			match_type = vararg_match;
-		      matched++;
-		    }
-		  else if (CMD_RANGE (str))
-		    {
-		      if (cmd_range_match (str, command))
-			{
-			  if (match_type < range_match)
-			    match_type = range_match;
-			  matched++;
-			}
-		    }
-#ifdef HAVE_IPV6
-		  else if (CMD_IPV6 (str))
-		    {
-		      if (cmd_ipv6_match (command) == exact_match)
-			{
-			  if (match_type < ipv6_match)
-			    match_type = ipv6_match;
-			  matched++;
-			}
-		    }
-		  else if (CMD_IPV6_PREFIX (str))
-		    {
-		      if (cmd_ipv6_prefix_match (command) == exact_match)
-			{
-			  if (match_type < ipv6_prefix_match)
-			    match_type = ipv6_prefix_match;
-			  matched++;
-			}
-		    }
-#endif /* HAVE_IPV6  */
-		  else if (CMD_IPV4 (str))
-		    {
-		      if (cmd_ipv4_match (command) == exact_match)
-			{
-			  if (match_type < ipv4_match)
-			    match_type = ipv4_match;
-			  matched++;
-			}
-		    }
-		  else if (CMD_IPV4_PREFIX (str))
-		    {
-		      if (cmd_ipv4_prefix_match (command) == exact_match)
-			{
-			  if (match_type < ipv4_prefix_match)
-			    match_type = ipv4_prefix_match;
-			  matched++;
-			}
-		    }
-		  else if (CMD_OPTION (str) || CMD_VARIABLE (str))
-		    {
-		      if (match_type < extend_match)
-			match_type = extend_match;
-		      matched++;
-		    }
-		  else
-		    {
-		      if (strcmp (command, str) == 0)
-			{
-			  match_type = exact_match;
-			  matched++;
-			}
-		    }
-		}
-	    if (!matched)
+	    ret = cmd_desc_match (command,
+				  vector_slot (cmd_element->strvec, index),
+				  strict);
+	    if (ret == no_match)
 	      vector_slot (v, i) = NULL;
+	    else if (match_type < ret)
+	      match_type = ret;
 	  }
       }
   return match_type;
 }
 
-/* Check ambiguous match */
+/* Make completion match and return match type flag. */
+static enum match_type
+cmd_filter_by_completion (char *command, vector v, unsigned int index)
+{
+  return cmd_filter (command, v, index, 0);
+}
+
+/* Check the tokens at one position of a command for an ambiguous match
+   of the given type.  matched carries the keyword or range matched so
+   far from one command, or subtrie, to the next, and *match is set to
+   whether this one matches. */
 static int
-is_cmd_ambiguous (char *command, vector v, int index, enum match_type type)
+cmd_desc_ambiguous (const char *command, vector descvec,
+		    enum match_type type, const char **matched, int *match)
 {
-  unsigned int i;
   unsigned int j;
-  const char *str = NULL;
-  struct cmd_element *cmd_element;
-  const char *matched = NULL;
-  vector descvec;
+  const char *str;
   struct desc *desc;
 
-  for (i = 0; i < vector_active (v); i++)
-    if ((cmd_element = vector_slot (v, i)) != NULL)
+  *match = 0;
+  for (j = 0; j < vector_active (descvec); j++)
+    if ((desc = vector_slot (descvec, j)))
       {
-	int match = 0;
-
-	descvec = vector_slot (cmd_element->strvec, index);
-
-	for (j = 0; j < vector_active (descvec); j++)
-	  if ((desc = vector_slot (descvec, j)))
-	    {
-	      enum match_type ret;
+	enum match_type ret;
 	      
-	      str = desc->cmd;
+	str = desc->cmd;
 
-	      switch (type)
-		{
-		case exact_match:
-		  if (!(CMD_OPTION (str) || CMD_VARIABLE (str))
-		      && strcmp (command, str) == 0)
-		    match++;
-		  break;
-		case partly_match:
-		  if (!(CMD_OPTION (str) || CMD_VARIABLE (str))
-		      && strncmp (command, str, strlen (command)) == 0)
-		    {
-		      if (matched && strcmp (matched, str) != 0)
-			return 1;	/* There is ambiguous match. */
-		      else
-			matched = str;
-		      match++;
-		    }
-		  break;
-		case range_match:
-		  if (cmd_range_match (str, command))
-		    {
-		      if (matched && strcmp (matched, str) != 0)
-			return 1;
-		      else
-			matched = str;
-		      match++;
-		    }
-		  break;
+	switch (type)
+	  {
+	  case exact_match:
+	    if (!(CMD_OPTION (str) || CMD_VARIABLE (str))
+		&& strcmp (command, str) == 0)
+	      (*match)++;
+	    break;
+	  case partly_match:
+	    if (!(CMD_OPTION (str) || CMD_VARIABLE (str))
+		&& strncmp (command, str, strlen (command)) == 0)
+	      {
+		if (*matched && strcmp (*matched, str) != 0)
+		  return 1;	/* There is ambiguous match. */
+		else
+		  *matched = str;
+		(*match)++;
+	      }
+	    break;
+	  case range_match:
+	    if (cmd_range_match (str, command))
+	      {
+		if (*matched && strcmp (*matched, str) != 0)
+		  return 1;
+		else
+		  *matched = str;
+		(*match)++;
+	      }
+	    break;
 #ifdef HAVE_IPV6
-		case ipv6_match:
-		  if (CMD_IPV6 (str))
-		    match++;
-		  break;
-		case ipv6_prefix_match:
-		  if ((ret = cmd_ipv6_prefix_match (command)) != no_match)
-		    {
-		      if (ret == partly_match)
-			return 2;	/* There is incomplete match. */
+	  case ipv6_match:
+	    if (CMD_IPV6 (str))
+	      (*match)++;
+	    break;
+	  case ipv6_prefix_match:
+	    if ((ret = cmd_ipv6_prefix_match (command)) != no_match)
+	      {
+		if (ret == partly_match)
+		  return 2;	/* There is incomplete match. */
 
-		      match++;
-		    }
-		  break;
+		(*match)++;
+	      }
+	    break;
 #endif /* HAVE_IPV6 */
-		case ipv4_match:
-		  if (CMD_IPV4 (str))
-		    match++;
-		  break;
-		case ipv4_prefix_match:
-		  if ((ret = cmd_ipv4_prefix_match (command)) != no_match)
-		    {
-		      if (ret == partly_match)
-			return 2;	/* There is incomplete match. */
+	  case ipv4_match:
+	    if (CMD_IPV4 (str))
+	      (*match)++;
+	    break;
+	  case ipv4_prefix_match:
+	    if ((ret = cmd_ipv4_prefix_match (command)) != no_match)
+	      {
+		if (ret == partly_match)
+		  return 2;	/* There is incomplete match. */
 
-		      match++;
-		    }
-		  break;
-		case extend_match:
-		  if (CMD_OPTION (str) || CMD_VARIABLE (str))
-		    match++;
-		  break;
-		case no_match:
-		default:
-		  break;
-		}
-	    }
-	if (!match)
-	  vector_slot (v, i) = NULL;
+		(*match)++;
+	      }
+	    break;
+	  case extend_match:
+	    if (CMD_OPTION (str) || CMD_VARIABLE (str))
+	      (*match)++;
+	    break;
+	  case no_match:
+	  default:
+	    break;
+	  }
       }
   return 0;
 }
 
+/* Step down from the subtries in live to their children which match
+   command, or to all of them for a skipped word, and return the best
+   match type. */
+static enum match_type
+cmd_trie_step (vector *live, char *command, int strict)
+{
+  vector next;
+  struct cmd_trie *trie, *child;
+  unsigned int i, j;
+  enum match_type match, ret;
+
+  next = vector_init (VECTOR_MIN_SIZE);
+  match = no_match;
+  for (i = 0; i < vector_active (*live); i++)
+    if ((trie = vector_slot (*live, i)) != NULL)
+      for (j = 0; j < vector_active (trie->child); j++)
+	if ((child = vector_slot (trie->child, j)) != NULL)
+	  {
+	    if (command == NULL)
+	      ret = no_match;
+	    else if ((ret = cmd_desc_match (command, child->descvec,
+					    strict)) == no_match)
+	      continue;
+	    vector_set (next, child);
+	    if (match < ret)
+	      match = ret;
+	  }
+  vector_free (*live);
+  *live = next;
+  return match;
+}
+
+/* Walk the words of vline before upto down the trie of a node, as the
+   filter loops used to do over a copy of its command vector.  The
+   subtries which survive are left in *live, *index is the word the walk
+   stopped at and *match the match type of the last word looked at.  A
+   vararg match stops the walk if stop_vararg is set, and an incomplete
+   address is not an error if ignore_incomplete is. */
+static int
+cmd_trie_walk (struct cmd_node *cnode, vector vline, unsigned int upto,
+	       int strict, int stop_vararg, int ignore_incomplete,
+	       vector *live, unsigned int *index, enum match_type *match)
+{
+  struct cmd_trie *trie;
+  const char *matched;
+  char *command;
+  unsigned int depth, i, n;
+  int ret, found;
+
+  *live = vector_init (VECTOR_MIN_SIZE);
+  if (cnode->trie)
+    vector_set (*live, cnode->trie);
+  *match = no_match;
+
+  for (depth = 0, *index = 0; *index < upto; (*index)++)
+    if ((command = vector_slot (vline, *index)))
+      {
+	/* Skipped words leave every command in. */
+	for (; depth < *index; depth++)
+	  cmd_trie_step (live, NULL, strict);
+
+	*match = cmd_trie_step (live, command, strict);
+	depth++;
+
+	if (*match == vararg_match && stop_vararg)
+	  break;
+
+	/* Drop the subtries which are not the match, unless the word is
+	   ambiguous or an incomplete address. */
+	matched = NULL;
+	for (i = 0, n = 0; i < vector_active (*live); i++)
+	  {
+	    trie = vector_slot (*live, i);
+	    ret = cmd_desc_ambiguous (command, trie->descvec, *match,
+				      &matched, &found);
+	    if (ret == 1)
+	      return CMD_ERR_AMBIGUOUS;
+	    if (ret == 2)
+	      {
+		if (! ignore_incomplete)
+		  return CMD_ERR_NO_MATCH;
+		while (i < vector_active (*live))
+		  vector_slot (*live, n++) = vector_slot (*live, i++);
+		break;
+	      }
+	    if (found)
+	      vector_slot (*live, n++) = trie;
+	  }
+	(*live)->active = n;
+      }
+  return CMD_SUCCESS;
+}
+
+static int
+cmp_trie_entry (const void *p, const void *q)
+{
+  const struct cmd_trie_entry *a = p;
+  const struct cmd_trie_entry *b = q;
+
+  return (a->pos > b->pos) - (a->pos < b->pos);
+}
+
+/* Commands below the subtries left by cmd_trie_walk (), in the order of
+   the node's command vector. */
+static vector
+cmd_trie_commands (vector live)
+{
+  struct cmd_trie *trie;
+  struct cmd_trie_entry *entry;
+  unsigned int i, j, count;
+  vector v;
+
+  for (i = 0, count = 0; i < vector_active (live); i++)
+    count += ((struct cmd_trie *) vector_slot (live, i))->count;
+
+  v = vector_init (count ? count : VECTOR_MIN_SIZE);
+  if (vector_active (live) == 1)
+    {
+      trie = vector_slot (live, 0);
+      for (j = 0; j < trie->count; j++)
+	vector_set_index (v, j, trie->entry[j].cmd);
+      return v;
+    }
+
+  /* Several subtries are left when a word matches different tokens,
+     such as two variables, so merge them back into order. */
+  entry = XMALLOC (MTYPE_TMP, (count ? count : 1) * sizeof (*entry));
+  for (i = 0, count = 0; i < vector_active (live); i++)
+    {
+      trie = vector_slot (live, i);
+      memcpy (entry + count, trie->entry, trie->count * sizeof (*entry));
+      count += trie->count;
+    }
+  qsort (entry, count, sizeof (*entry), cmp_trie_entry);
+  for (j = 0; j < count; j++)
+    vector_set_index (v, j, entry[j].cmd);
+  XFREE (MTYPE_TMP, entry);
+  return v;
+}
+
 /* If src matches dst return dst string, otherwise return NULL */
 static const char *
 cmd_entry_function (const char *src, const char *dst)
@@ -1509,6 +1674,7 @@ static vector
 cmd_describe_command_real (vector vline, struct vty *vty, int *status)
 {
   unsigned int i;
+  vector live;
   vector cmd_vector;
 #define INIT_MATCHVEC_SIZE 10
   vector matchvec;
@@ -1527,59 +1693,46 @@ cmd_describe_command_real (vector vline, struct vty *vty, int *status)
   else
     index = vector_active (vline) - 1;
   
-  /* Make copy vector of current node's command vector. */
-  cmd_vector = vector_copy (cmd_node_vector (cmdvec, vty->node));
-
   /* Prepare match vector */
   matchvec = vector_init (INIT_MATCHVEC_SIZE);
 
   /* Filter commands. */
-  /* Only words precedes current word will be checked in this loop. */
-  for (i = 0; i < index; i++)
-    if ((command = vector_slot (vline, i)))
-      {
-	match = cmd_filter_by_completion (command, cmd_vector, i);
-	
-	if (match == vararg_match)
-	  {
-	    struct cmd_element *cmd_element;
-	    vector descvec;
-	    unsigned int j, k;
-
-	    for (j = 0; j < vector_active (cmd_vector); j++)
-	      if ((cmd_element = vector_slot (cmd_vector, j)) != NULL
-		  && (vector_active (cmd_element->strvec)))
-		{
-		  descvec = vector_slot (cmd_element->strvec,
-					 vector_active (cmd_element->strvec) - 1);
-		  for (k = 0; k < vector_active (descvec); k++)
-		    {
-		      struct desc *desc = vector_slot (descvec, k);
-		      vector_set (matchvec, desc);
-		    }
-		}
-            
-	    vector_set (matchvec, &desc_cr);
-	    vector_free (cmd_vector);
+  /* Only words precedes current word will be checked in the walk. */
+  ret = cmd_trie_walk (vector_slot (cmdvec, vty->node), vline, index,
+		       0, 1, 0, &live, &i, &match);
+  if (ret != CMD_SUCCESS)
+    {
+      vector_free (live);
+      vector_free (matchvec);
+      *status = ret;
+      return NULL;
+    }
+  cmd_vector = cmd_trie_commands (live);
+  vector_free (live);
 
-	    return matchvec;
-	  }
+  if (match == vararg_match)
+    {
+      vector descvec;
+      unsigned int j, k;
 
-	if ((ret = is_cmd_ambiguous (command, cmd_vector, i, match)) == 1)
+      for (j = 0; j < vector_active (cmd_vector); j++)
+	if ((cmd_element = vector_slot (cmd_vector, j)) != NULL
+	    && (vector_active (cmd_element->strvec)))
 	  {
-	    vector_free (cmd_vector);
-	    vector_free (matchvec);
-	    *status = CMD_ERR_AMBIGUOUS;
-	    return NULL;
-	  }
-	else if (ret == 2)
-	  {
-	    vector_free (cmd_vector);
-	    vector_free (matchvec);
-	    *status = CMD_ERR_NO_MATCH;
-	    return NULL;
+	    descvec = vector_slot (cmd_element->strvec,
+				   vector_active (cmd_element->strvec) - 1);
+	    for (k = 0; k < vector_active (descvec); k++)
+	      {
+		struct desc *desc = vector_slot (descvec, k);
+		vector_set (matchvec, desc);
+	      }
 	  }
-      }
+
+      vector_set (matchvec, &desc_cr);
+      vector_free (cmd_vector);
+
+      return matchvec;
+    }
 
   /* Prepare match vector */
   /*  matchvec = vector_init (INIT_MATCHVEC_SIZE); */
@@ -1713,7 +1866,8 @@ static char **
 cmd_complete_command_real (vector vline, struct vty *vty, int *status)
 {
   unsigned int i;
-  vector cmd_vector = vector_copy (cmd_node_vector (cmdvec, vty->node));
+  vector live;
+  vector cmd_vector;
 #define INIT_MATCHVEC_SIZE 10
   vector matchvec;
   struct cmd_element *cmd_element;
@@ -1721,45 +1875,30 @@ cmd_complete_command_real (vector vline, struct vty *vty, int *status)
   char **match_str;
   struct desc *desc;
   vector descvec;
-  char *command;
+  enum match_type match;
+  int ret;
   int lcd;
 
   if (vector_active (vline) == 0)
     {
-      vector_free (cmd_vector);
       *status = CMD_ERR_NO_MATCH;
       return NULL;
     }
   else
     index = vector_active (vline) - 1;
 
-  /* First, filter by preceeding command string */
-  for (i = 0; i < index; i++)
-    if ((command = vector_slot (vline, i)))
-      {
-	enum match_type match;
-	int ret;
-
-	/* First try completion match, if there is exactly match return 1 */
-	match = cmd_filter_by_completion (command, cmd_vector, i);
-
-	/* If there is exact match then filter ambiguous match else check
-	   ambiguousness. */
-	if ((ret = is_cmd_ambiguous (command, cmd_vector, i, match)) == 1)
-	  {
-	    vector_free (cmd_vector);
-	    *status = CMD_ERR_AMBIGUOUS;
-	    return NULL;
-	  }
-	/*
-	   else if (ret == 2)
-	   {
-	   vector_free (cmd_vector);
-	   *status = CMD_ERR_NO_MATCH;
-	   return NULL;
-	   }
-	 */
-      }
+  /* First, filter by preceeding command string.  An incomplete address
+     is let through here. */
+  ret = cmd_trie_walk (vector_slot (cmdvec, vty->node), vline, index,
+		       0, 0, 1, &live, &i, &match);
+  if (ret != CMD_SUCCESS)
+    {
+      vector_free (live);
+      *status = ret;
+      return NULL;
+    }
+  cmd_vector = cmd_trie_commands (live);
+  vector_free (live);
   
   /* Prepare match vector. */
   matchvec = vector_init (INIT_MATCHVEC_SIZE);
@@ -1930,9 +2069,10 @@ static int
 cmd_execute_command_real (vector vline, struct vty *vty,
 			  struct cmd_element **cmd)
 {
-  unsigned int i;
+  unsigned int i, j;
   unsigned int index;
-  vector cmd_vector;
+  vector live;
+  struct cmd_trie *trie;
   struct cmd_element *cmd_element;
   struct cmd_element *matched_element;
   unsigned int matched_count, incomplete_count;
@@ -1940,59 +2080,40 @@ cmd_execute_command_real (vector vline, struct vty *vty,
   const char *argv[CMD_ARGC_MAX];
   enum match_type match = 0;
   int varflag;
-  char *command;
-
-  /* Make copy of command elements. */
-  cmd_vector = vector_copy (cmd_node_vector (cmdvec, vty->node));
-
-  for (index = 0; index < vector_active (vline); index++)
-    if ((command = vector_slot (vline, index)))
-      {
-	int ret;
-
-	match = cmd_filter_by_completion (command, cmd_vector, index);
-
-	if (match == vararg_match)
-	  break;
-        
-	ret = is_cmd_ambiguous (command, cmd_vector, index, match);
+  int ret;
 
-	if (ret == 1)
-	  {
-	    vector_free (cmd_vector);
-	    return CMD_ERR_AMBIGUOUS;
-	  }
-	else if (ret == 2)
-	  {
-	    vector_free (cmd_vector);
-	    return CMD_ERR_NO_MATCH;
-	  }
-      }
+  /* Walk the words down this node's command trie. */
+  ret = cmd_trie_walk (vector_slot (cmdvec, vty->node), vline,
+		       vector_active (vline), 0, 1, 0, &live, &index, &match);
+  if (ret != CMD_SUCCESS)
+    {
+      vector_free (live);
+      return ret;
+    }
 
   /* Check matched count. */
   matched_element = NULL;
   matched_count = 0;
   incomplete_count = 0;
 
-  for (i = 0; i < vector_active (cmd_vector); i++)
-    if ((cmd_element = vector_slot (cmd_vector, i)))
-      {
-	if (match == vararg_match || index >= cmd_element->cmdsize)
-	  {
-	    matched_element = cmd_element;
-#if 0
-	    printf ("DEBUG: %s\n", cmd_element->string);
-#endif
-	    matched_count++;
-	  }
-	else
-	  {
+  for (i = 0; i < vector_active (live); i++)
+    {
+      trie = vector_slot (live, i);
+      for (j = 0; j < trie->count; j++)
+	{
+	  cmd_element = trie->entry[j].cmd;
+	  if (match == vararg_match || index >= cmd_element->cmdsize)
+	    {
+	      matched_element = cmd_element;
+	      matched_count++;
+	    }
+	  else
 	    incomplete_count++;
-	  }
-      }
+	}
+    }
 
-  /* Finish of using cmd_vector. */
-  vector_free (cmd_vector);
+  /* Finish of using live subtries. */
+  vector_free (live);
 
   /* To execute command, matched_count must be 1. */
   if (matched_count == 0)
@@ -2109,9 +2230,10 @@ int
 cmd_execute_command_strict (vector vline, struct vty *vty,
 			    struct cmd_element **cmd)
 {
-  unsigned int i;
+  unsigned int i, j;
   unsigned int index;
-  vector cmd_vector;
+  vector live;
+  struct cmd_trie *trie;
   struct cmd_element *cmd_element;
   struct cmd_element *matched_element;
   unsigned int matched_count, incomplete_count;
@@ -2119,56 +2241,40 @@ cmd_execute_command_strict (vector vline, struct vty *vty,
   const char *argv[CMD_ARGC_MAX];
   int varflag;
   enum match_type match = 0;
-  char *command;
-
-  /* Make copy of command element */
-  cmd_vector = vector_copy (cmd_node_vector (cmdvec, vty->node));
-
-  for (index = 0; index < vector_active (vline); index++)
-    if ((command = vector_slot (vline, index)))
-      {
-	int ret;
-	
-	match = cmd_filter_by_string (vector_slot (vline, index),
-				      cmd_vector, index);
+  int ret;
 
-	/* If command meets '.VARARG' then finish matching. */
-	if (match == vararg_match)
-	  break;
-        
-	ret = is_cmd_ambiguous (command, cmd_vector, index, match);
-	if (ret == 1)
-	  {
-	    vector_free (cmd_vector);
-	    return CMD_ERR_AMBIGUOUS;
-	  }
-	if (ret == 2)
-	  {
-	    vector_free (cmd_vector);
-	    return CMD_ERR_NO_MATCH;
-	  }
-      }
+  /* Walk the words down this node's command trie. */
+  ret = cmd_trie_walk (vector_slot (cmdvec, vty->node), vline,
+		       vector_active (vline), 1, 1, 0, &live, &index, &match);
+  if (ret != CMD_SUCCESS)
+    {
+      vector_free (live);
+      return ret;
+    }
 
   /* Check matched count. */
   matched_element = NULL;
   matched_count = 0;
   incomplete_count = 0;
-  for (i = 0; i < vector_active (cmd_vector); i++)
-    if (vector_slot (cmd_vector, i) != NULL)
-      {
-	cmd_element = vector_slot (cmd_vector, i);
 
-	if (match == vararg_match || index >= cmd_element->cmdsize)
-	  {
-	    matched_element = cmd_element;
-	    matched_count++;
-	  }
-	else
-	  incomplete_count++;
-      }
+  for (i = 0; i < vector_active (live); i++)
+    {
+      trie = vector_slot (live, i);
+      for (j = 0; j < trie->count; j++)
+	{
+	  cmd_element = trie->entry[j].cmd;
+	  if (match == vararg_match || index >= cmd_element->cmdsize)
+	    {
+	      matched_element = cmd_element;
+	      matched_count++;
+	    }
+	  else
+	    incomplete_count++;
+	}
+    }
 
-  /* Finish of using cmd_vector. */
-  vector_free (cmd_vector);
+  /* Finish of using live subtries. */
+  vector_free (live);
 
   /* To execute command, matched_count must be 1. */
   if (matched_count == 0)
@@ -2223,13 +2329,136 @@ cmd_execute_command_strict (vector vline, struct vty *vty,
   return (*matched_element->func) (matched_element, vty, argc, argv);
 }
 
-/* Configration make from file. */
+/* Hooks queued while a configuration is read. */
+struct cmd_batch_entry
+{
+  void (*func) (void *, const char *);
+  void *arg;
+  char *name;
+
+  struct cmd_batch_entry *next;
+};
+
+static struct
+{
+  /* Nesting of open batches. */
+  unsigned int depth;
+
+  /* Queued entries, by hook and name and in the order queued. */
+  struct hash *entries;
+  struct cmd_batch_entry *head;
+  struct cmd_batch_entry **tail;
+} cmd_batch;
+
+static unsigned int
+cmd_batch_hash_key (void *data)
+{
+  struct cmd_batch_entry *entry = data;
+
+  return jhash_3words (string_hash_make (entry->name),
+		       (u_int32_t) (uintptr_t) entry->arg,
+		       (u_int32_t) (uintptr_t) entry->func, 0);
+}
+
+static int
+cmd_batch_hash_cmp (const void *a, const void *b)
+{
+  const struct cmd_batch_entry *e1 = a;
+  const struct cmd_batch_entry *e2 = b;
+
+  return e1->func == e2->func && e1->arg == e2->arg
+	 && strcmp (e1->name, e2->name) == 0;
+}
+
+static void *
+cmd_batch_entry_alloc (void *data)
+{
+  struct cmd_batch_entry *key = data;
+  struct cmd_batch_entry *entry;
+
+  entry = XCALLOC (MTYPE_CMD_BATCH, sizeof (struct cmd_batch_entry));
+  entry->func = key->func;
+  entry->arg = key->arg;
+  entry->name = XSTRDUP (MTYPE_CMD_BATCH, key->name);
+
+  *cmd_batch.tail = entry;
+  cmd_batch.tail = &entry->next;
+  return entry;
+}
+
+void
+cmd_batch_begin (void)
+{
+  if (cmd_batch.depth++ == 0)
+    {
+      cmd_batch.entries = hash_create (cmd_batch_hash_key,
+				       cmd_batch_hash_cmp);
+      cmd_batch.head = NULL;
+      cmd_batch.tail = &cmd_batch.head;
+    }
+}
+
+/* Run each queued hook once, in the order they were first queued.  The
+   batch stays open while they run, so that a daemon hook which redoes
+   all of its work whatever the name can queue itself under one name,
+   and run once after the others. */
+void
+cmd_batch_end (void)
+{
+  struct cmd_batch_entry *entry, *next;
+
+  assert (cmd_batch.depth > 0);
+  if (cmd_batch.depth > 1)
+    {
+      cmd_batch.depth--;
+      return;
+    }
+
+  while ((entry = cmd_batch.head) != NULL)
+    {
+      hash_clean (cmd_batch.entries, NULL);
+      cmd_batch.head = NULL;
+      cmd_batch.tail = &cmd_batch.head;
+
+      for (; entry; entry = next)
+	{
+	  next = entry->next;
+	  (*entry->func) (entry->arg, entry->name);
+	  XFREE (MTYPE_CMD_BATCH, entry->name);
+	  XFREE (MTYPE_CMD_BATCH, entry);
+	}
+    }
+
+  hash_free (cmd_batch.entries);
+  cmd_batch.entries = NULL;
+  cmd_batch.depth = 0;
+}
+
+int
+cmd_batch_defer (void (*func) (void *, const char *), void *arg,
+		 const char *name)
+{
+  struct cmd_batch_entry key;
+
+  if (cmd_batch.depth == 0)
+    return 0;
+
+  key.func = func;
+  key.arg = arg;
+  key.name = (char *) name;
+  hash_get (cmd_batch.entries, &key, cmd_batch_entry_alloc);
+  return 1;
+}
+
+/* Configration make from file.  Hooks of objects changed by the file
+   run once at the end of it instead of once per line. */
 int
 config_from_file (struct vty *vty, FILE *fp)
 {
   int ret;
   vector vline;
 
+  cmd_batch_begin ();
   while (fgets (vty->buf, VTY_BUFSIZ, fp))
     {
       vline = cmd_make_strvec (vty->buf);
@@ -2252,8 +2481,12 @@ config_from_file (struct vty *vty, FILE *fp)
 
       if (ret != CMD_SUCCESS && ret != CMD_WARNING
 	  && ret != CMD_ERR_NOTHING_TODO)
-	return ret;
+	{
+	  cmd_batch_end ();
+	  return ret;
+	}
     }
+  cmd_batch_end ();
   return CMD_SUCCESS;
 }
 
@@ -3037,6 +3270,8 @@ DEFUN (show_logging,
   	   (zl->record_priority ? "enabled" : "disabled"), VTY_NEWLINE);
   vty_out (vty, "Timestamp precision: %d%s",
 	   zl->timestamp_precision, VTY_NEWLINE);
+  if (zlog_dropped ())
+    vty_out (vty, "Messages dropped: %lu%s", zlog_dropped (), VTY_NEWLINE);
 
   return CMD_SUCCESS;
 }
@@ -3572,6 +3807,8 @@ cmd_init (int terminal)
       install_element (CONFIG_NODE, &no_banner_motd_cmd);
       install_element (CONFIG_NODE, &service_terminal_length_cmd);
       install_element (CONFIG_NODE, &no_service_terminal_length_cmd);
+      install_element (CONFIG_NODE, &thread_cpu_sample_cmd);
+      install_element (CONFIG_NODE, &no_thread_cpu_sample_cmd);
 
       install_element (VIEW_NODE, &show_thread_cpu_cmd);
       install_element (ENABLE_NODE, &show_thread_cpu_cmd);
@@ -3627,6 +3864,10 @@ cmd_terminate ()
                 }
 
             vector_free (cmd_node_v);
+
+            if (cmd_node->trie)
+              cmd_trie_free (cmd_node->trie);
+            cmd_node->trie = NULL;
           }
 
       vector_free (cmdvec);
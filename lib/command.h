@@ -123,6 +123,9 @@ struct cmd_node
 
   /* Vector of this node's command list. */
   vector cmd_vector;	
+
+  /* The same commands compiled into a trie of their words. */
+  struct cmd_trie *trie;
 };
 
 enum
@@ -347,6 +350,16 @@ extern enum node_type node_parent (enum node_type);
 extern int cmd_execute_command (vector, struct vty *, struct cmd_element **, int);
 extern int cmd_execute_command_strict (vector, struct vty *, struct cmd_element **);
 extern void config_replace_string (struct cmd_element *, char *, ...);
+
+/* While a configuration is read, the hooks telling daemons that a named
+   object changed are queued, and each distinct one runs once when the
+   outermost batch ends.  cmd_batch_defer () returns 0 when no batch is
+   open, and the caller is to run the hook itself. */
+extern void cmd_batch_begin (void);
+extern void cmd_batch_end (void);
+extern int cmd_batch_defer (void (*func) (void *, const char *), void *arg,
+			    const char *name);
+
 extern void cmd_init (int);
 extern void cmd_terminate (void);
 
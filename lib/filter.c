@@ -28,6 +28,7 @@
 #include "sockunion.h"
 #include "buffer.h"
 #include "log.h"
+#include "hash.h"
 
 struct filter_cisco
 {
@@ -61,6 +62,9 @@ struct filter
   /* Cisco access-list */
   int cisco;
 
+  /* Position in the access_list when it was last compiled. */
+  int index;
+
   union
     {
       struct filter_cisco cfilter;
@@ -68,6 +72,36 @@ struct filter
     } u;
 };
 
+/* Node of a binary trie on the address bits of the filters. */
+struct access_trie
+{
+  struct access_trie *link[2];
+
+  /* First filter ending here that matches any longer prefix, and the
+     first one matching only a prefix of exactly this length. */
+  struct filter *any;
+  struct filter *exact;
+
+  /* Lowest filter index in this subtree. */
+  int min_index;
+};
+
+/* An access_list compiled for lookup.  Zebra filters are indexed by
+   family, standard Cisco filters whose wildcard mask covers the host
+   bits of a prefix are indexed on that prefix.  Extended filters and
+   those with other wildcard masks are tried in order as before. */
+struct access_compiled
+{
+  struct access_trie *cisco;
+  struct access_trie *inet;
+  struct access_trie *inet6;
+
+  int nfallback;
+  struct filter *fallback[0];
+};
+
+#define ACCESS_TRIE_BIT(A,D) ((((const u_char *) (A))[(D) / 8] >> (7 - (D) % 8)) & 1)
+
 /* List of access_list. */
 struct access_list_list
 {
@@ -89,6 +123,9 @@ struct access_master
 
   /* Hook function which is executed when access_list is deleted. */
   void (*delete_hook) (struct access_list *);
+
+  /* All of the above by name. */
+  struct hash *names;
 };
 
 /* Static structure for IPv4 access_list's master. */
@@ -209,6 +246,154 @@ filter_match_zebra (struct filter *mfilter, struct prefix *p)
     return 0;
 }
 
+static void
+access_trie_free (struct access_trie *node)
+{
+  if (node == NULL)
+    return;
+  access_trie_free (node->link[0]);
+  access_trie_free (node->link[1]);
+  XFREE (MTYPE_ACCESS_TRIE, node);
+}
+
+/* Filters are added in list order, so the first to reach a node or
+   slot is the one that would have been matched first. */
+static void
+access_trie_add (struct access_trie **nodep, const void *addr, int len,
+		 struct filter *filter, int exact)
+{
+  int depth;
+
+  for (depth = 0; ; depth++)
+    {
+      if (*nodep == NULL)
+	{
+	  *nodep = XCALLOC (MTYPE_ACCESS_TRIE, sizeof (struct access_trie));
+	  (*nodep)->min_index = filter->index;
+	}
+      if (depth == len)
+	break;
+      nodep = &(*nodep)->link[ACCESS_TRIE_BIT (addr, depth)];
+    }
+
+  if (exact && (*nodep)->exact == NULL)
+    (*nodep)->exact = filter;
+  else if (! exact && (*nodep)->any == NULL)
+    (*nodep)->any = filter;
+}
+
+/* Walks len bits of addr, the exact slots counting only at the end. */
+static struct filter *
+access_trie_lookup (struct access_trie *node, const void *addr, int len,
+		    struct filter *best)
+{
+  int depth;
+
+  for (depth = 0; node; depth++)
+    {
+      if (best && node->min_index >= best->index)
+	break;
+      if (node->any && (! best || node->any->index < best->index))
+	best = node->any;
+      if (depth == len)
+	{
+	  if (node->exact && (! best || node->exact->index < best->index))
+	    best = node->exact;
+	  break;
+	}
+      node = node->link[ACCESS_TRIE_BIT (addr, depth)];
+    }
+  return best;
+}
+
+/* Number of network bits of a standard Cisco filter which can be looked
+   up in the trie, or -1 if it must be tried in order. */
+static int
+filter_cisco_prefixlen (struct filter *mfilter)
+{
+  struct filter_cisco *filter = &mfilter->u.cfilter;
+  u_int32_t wildcard = ntohl (filter->addr_mask.s_addr);
+  int len;
+
+  if (filter->extended || (wildcard & (wildcard + 1)) != 0)
+    return -1;
+
+  for (len = IPV4_MAX_BITLEN; wildcard; wildcard >>= 1)
+    len--;
+  return len;
+}
+
+static void
+access_list_uncompile (struct access_list *access)
+{
+  struct access_compiled *compiled = access->compiled;
+
+  if (compiled == NULL)
+    return;
+  access_trie_free (compiled->cisco);
+  access_trie_free (compiled->inet);
+  access_trie_free (compiled->inet6);
+  XFREE (MTYPE_ACCESS_TRIE, compiled);
+  access->compiled = NULL;
+}
+
+static struct access_compiled *
+access_list_compile (struct access_list *access)
+{
+  struct access_compiled *compiled;
+  struct filter *filter;
+  struct filter_zebra *zfilter;
+  int count, len;
+
+  for (count = 0, filter = access->head; filter; filter = filter->next)
+    filter->index = count++;
+
+  compiled = XCALLOC (MTYPE_ACCESS_TRIE, sizeof (struct access_compiled)
+				       + count * sizeof (struct filter *));
+
+  for (filter = access->head; filter; filter = filter->next)
+    {
+      if (filter->cisco)
+	{
+	  len = filter_cisco_prefixlen (filter);
+	  if (len >= 0)
+	    access_trie_add (&compiled->cisco, &filter->u.cfilter.addr, len,
+			     filter, 0);
+	  else
+	    compiled->fallback[compiled->nfallback++] = filter;
+	  continue;
+	}
+
+      zfilter = &filter->u.zfilter;
+      if (zfilter->prefix.family == AF_INET)
+	access_trie_add (&compiled->inet, &zfilter->prefix.u.prefix,
+			 zfilter->prefix.prefixlen, filter, zfilter->exact);
+#ifdef HAVE_IPV6
+      else if (zfilter->prefix.family == AF_INET6)
+	access_trie_add (&compiled->inet6, &zfilter->prefix.u.prefix,
+			 zfilter->prefix.prefixlen, filter, zfilter->exact);
+#endif /* HAVE_IPV6 */
+      else
+	compiled->fallback[compiled->nfallback++] = filter;
+    }
+
+  access->compiled = compiled;
+  return compiled;
+}
+
+static unsigned int
+access_list_hash_key (void *data)
+{
+  return string_hash_make (((struct access_list *) data)->name);
+}
+
+static int
+access_list_hash_cmp (const void *a, const void *b)
+{
+  return strcmp (((const struct access_list *) a)->name,
+		 ((const struct access_list *) b)->name) == 0;
+}
+
 /* Allocate new access list structure. */
 static struct access_list *
 access_list_new (void)
@@ -238,8 +423,10 @@ access_list_delete (struct access_list *access)
       next = filter->next;
       filter_free (filter);
     }
+  access_list_uncompile (access);
 
   master = access->master;
+  hash_release (master->names, access);
 
   if (access->type == ACCESS_TYPE_NUMBER)
     list = &master->num;
@@ -286,6 +473,10 @@ access_list_insert (afi_t afi, const char *name)
   access->name = XSTRDUP (MTYPE_ACCESS_LIST_STR, name);
   access->master = master;
 
+  if (master->names == NULL)
+    master->names = hash_create (access_list_hash_key, access_list_hash_cmp);
+  hash_get (master->names, access, hash_alloc_intern);
+
   /* If name is made by all digit character.  We treat it as
      number. */
   for (number = 0, i = 0; i < strlen (name); i++)
@@ -361,25 +552,18 @@ access_list_insert (afi_t afi, const char *name)
 struct access_list *
 access_list_lookup (afi_t afi, const char *name)
 {
-  struct access_list *access;
+  struct access_list key;
   struct access_master *master;
 
   if (name == NULL)
     return NULL;
 
   master = access_master_get (afi);
-  if (master == NULL)
+  if (master == NULL || master->names == NULL)
     return NULL;
 
-  for (access = master->num.head; access; access = access->next)
-    if (strcmp (access->name, name) == 0)
-      return access;
-
-  for (access = master->str.head; access; access = access->next)
-    if (strcmp (access->name, name) == 0)
-      return access;
-
-  return NULL;
+  key.name = (char *) name;
+  return hash_lookup (master->names, &key);
 }
 
 /* Get access list from list of access_list.  If there isn't matched
@@ -399,29 +583,47 @@ access_list_get (afi_t afi, const char *name)
 enum filter_type
 access_list_apply (struct access_list *access, void *object)
 {
+  struct access_compiled *compiled;
   struct filter *filter;
+  struct filter *best;
   struct prefix *p;
+  int i;
 
   p = (struct prefix *) object;
 
   if (access == NULL)
     return FILTER_DENY;
 
-  for (filter = access->head; filter; filter = filter->next)
+  compiled = access->compiled;
+  if (compiled == NULL)
+    compiled = access_list_compile (access);
+
+  /* Cisco filters look at the first four octets whatever the family. */
+  best = access_trie_lookup (compiled->cisco, &p->u.prefix,
+			     IPV4_MAX_BITLEN, NULL);
+  if (p->family == AF_INET)
+    best = access_trie_lookup (compiled->inet, &p->u.prefix, p->prefixlen,
+			       best);
+#ifdef HAVE_IPV6
+  else if (p->family == AF_INET6)
+    best = access_trie_lookup (compiled->inet6, &p->u.prefix, p->prefixlen,
+			       best);
+#endif /* HAVE_IPV6 */
+
+  for (i = 0; i < compiled->nfallback; i++)
     {
-      if (filter->cisco)
-	{
-	  if (filter_match_cisco (filter, p))
-	    return filter->type;
-	}
-      else
+      filter = compiled->fallback[i];
+      if (best && filter->index >= best->index)
+	break;
+      if (filter->cisco ? filter_match_cisco (filter, p)
+			: filter_match_zebra (filter, p))
 	{
-	  if (filter_match_zebra (filter, p))
-	    return filter->type;
+	  best = filter;
+	  break;
 	}
     }
 
-  return FILTER_DENY;
+  return best ? best->type : FILTER_DENY;
 }
 
 /* Add hook function. */
@@ -444,6 +646,21 @@ access_list_delete_hook (void (*func) (struct access_list *access))
 #endif /* HAVE_IPV6 */
 }
 
+/* The add hook of access-lists changed while a configuration is read
+   runs once each at the end of it, if the list is still there. */
+static void
+access_list_batch_add (void *arg, const char *name)
+{
+  struct access_master *master = arg;
+  struct access_list key;
+  struct access_list *access;
+
+  key.name = (char *) name;
+  access = hash_lookup (master->names, &key);
+  if (access && master->add_hook)
+    (*master->add_hook) (access);
+}
+
 /* Add new filter to the end of specified access_list. */
 static void
 access_list_filter_add (struct access_list *access, struct filter *filter)
@@ -456,9 +673,12 @@ access_list_filter_add (struct access_list *access, struct filter *filter)
   else
     access->head = filter;
   access->tail = filter;
+  access_list_uncompile (access);
 
   /* Run hook function. */
-  if (access->master->add_hook)
+  if (access->master->add_hook
+      && ! cmd_batch_defer (access_list_batch_add, access->master,
+			    access->name))
     (*access->master->add_hook) (access);
 }
 
@@ -492,6 +712,7 @@ access_list_filter_delete (struct access_list *access, struct filter *filter)
     access->head = filter->next;
 
   filter_free (filter);
+  access_list_uncompile (access);
 
   /* If access_list becomes empty delete it from access_master. */
   if (access_list_empty (access))
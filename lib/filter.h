@@ -54,6 +54,9 @@ struct access_list
 
   struct filter *head;
   struct filter *tail;
+
+  /* Built from the filters when first applied after a change. */
+  struct access_compiled *compiled;
 };
 
 /* Prototypes for access-list. */
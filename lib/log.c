@@ -27,6 +27,8 @@
 #include "log.h"
 #include "memory.h"
 #include "command.h"
+#include "thread.h"
+#include "ring.h"
 #ifndef SUNOS_5
 #include <sys/un.h>
 #endif
@@ -37,6 +39,24 @@
 
 static int logfile_fd = -1;	/* Used in signal handler. */
 
+#if defined HAVE_PTHREAD && defined __ATOMIC_ACQUIRE
+#define ZLOG_ASYNC
+#include <pthread.h>
+#include <semaphore.h>
+
+#define ZLOG_DEST_BIT(D)	(1 << (D))
+
+static int zlog_main_thread (void);
+static void zlog_ring_flush (void);
+static int zlog_ring_put (struct zlog *, int priority, int dests,
+			  struct timestamp_control *, const char *, va_list);
+static void zlog_ring_dump_sigsafe (void);
+#else /* ZLOG_ASYNC */
+#define zlog_main_thread() 1
+#define zlog_ring_flush()
+#define zlog_ring_dump_sigsafe()
+#endif /* ZLOG_ASYNC */
+
 struct zlog *zlog_default = NULL;
 
 const char *zlog_proto_names[] = 
@@ -72,24 +92,21 @@ const char *zlog_priority[] =
 
 /* For time string format. */
 
-size_t
-quagga_timestamp(int timestamp_precision, char *buf, size_t buflen)
+static size_t
+quagga_timestamp_render(struct timeval *clock, int timestamp_precision,
+			char *buf, size_t buflen)
 {
   static struct {
     time_t last;
     size_t len;
     char buf[28];
   } cache;
-  struct timeval clock;
-
-  /* would it be sufficient to use global 'recent_time' here?  I fear not... */
-  gettimeofday(&clock, NULL);
 
   /* first, we update the cache if the time has changed */
-  if (cache.last != clock.tv_sec)
+  if (cache.last != clock->tv_sec)
     {
       struct tm *tm;
-      cache.last = clock.tv_sec;
+      cache.last = clock->tv_sec;
       tm = localtime(&cache.last);
       cache.len = strftime(cache.buf, sizeof(cache.buf),
       			   "%Y/%m/%d %H:%M:%S", tm);
@@ -107,6 +124,7 @@ quagga_timestamp(int timestamp_precision, char *buf, size_t buflen)
 	  /* should we worry about locale issues? */
 	  static const int divisor[] = {0, 100000, 10000, 1000, 100, 10, 1};
 	  int prec;
+	  long usec = clock->tv_usec;
 	  char *p = buf+cache.len+1+(prec = timestamp_precision);
 	  *p-- = '\0';
 	  while (prec > 6)
@@ -115,11 +133,11 @@ quagga_timestamp(int timestamp_precision, char *buf, size_t buflen)
 	      *p-- = '0';
 	      prec--;
 	    }
-	  clock.tv_usec /= divisor[prec];
+	  usec /= divisor[prec];
 	  do
 	    {
-	      *p-- = '0'+(clock.tv_usec % 10);
-	      clock.tv_usec /= 10;
+	      *p-- = '0'+(usec % 10);
+	      usec /= 10;
 	    }
 	  while (--prec > 0);
 	  *p = '.';
@@ -133,15 +151,58 @@ quagga_timestamp(int timestamp_precision, char *buf, size_t buflen)
   return 0;
 }
 
-/* Utility routine for current time printing. */
+size_t
+quagga_timestamp(int timestamp_precision, char *buf, size_t buflen)
+{
+  struct timeval clock;
+
+  /* would it be sufficient to use global 'recent_time' here?  I fear not... */
+  gettimeofday(&clock, NULL);
+  return quagga_timestamp_render(&clock, timestamp_precision, buf, buflen);
+}
+
+/* Timestamp for a log message.  The event loop brings recent_time up to
+   date before it runs each thread, so everything logged by one thread
+   shares one rendered timestamp, taken when the thread started.  Before
+   the event loop has run, or outside of it, read the clock as usual. */
 static void
-time_print(FILE *fp, struct timestamp_control *ctl)
+zlog_timestamp(struct timestamp_control *ctl)
 {
-  if (!ctl->already_rendered)
+  static struct {
+    struct timeval tv;
+    int precision;
+    size_t len;
+    char buf[sizeof(ctl->buf)];
+  } cache;
+
+  if (ctl->already_rendered)
+    return;
+  ctl->already_rendered = 1;
+
+  if (!recent_time.tv_sec || !zlog_main_thread())
     {
       ctl->len = quagga_timestamp(ctl->precision, ctl->buf, sizeof(ctl->buf));
-      ctl->already_rendered = 1;
+      return;
     }
+
+  if (cache.tv.tv_sec != recent_time.tv_sec
+      || cache.tv.tv_usec != recent_time.tv_usec
+      || cache.precision != ctl->precision || !cache.len)
+    {
+      cache.tv = recent_time;
+      cache.precision = ctl->precision;
+      cache.len = quagga_timestamp_render(&cache.tv, cache.precision,
+					  cache.buf, sizeof(cache.buf));
+    }
+  memcpy(ctl->buf, cache.buf, cache.len+1);
+  ctl->len = cache.len;
+}
+
+/* Utility routine for current time printing. */
+static void
+time_print(FILE *fp, struct timestamp_control *ctl)
+{
+  zlog_timestamp(ctl);
   fprintf(fp, "%s ", ctl->buf);
 }
   
@@ -172,6 +233,36 @@ vzlog (struct zlog *zl, int priority, const char *format, va_list args)
     }
   tsctl.precision = zl->timestamp_precision;
 
+#ifdef ZLOG_ASYNC
+  /* Hand syslog, file and stdout output over to the log writer. */
+  {
+    int dests = 0;
+
+    if (priority <= zl->maxlvl[ZLOG_DEST_SYSLOG])
+      dests |= ZLOG_DEST_BIT (ZLOG_DEST_SYSLOG);
+    if ((priority <= zl->maxlvl[ZLOG_DEST_FILE]) && zl->fp)
+      dests |= ZLOG_DEST_BIT (ZLOG_DEST_FILE);
+    if (priority <= zl->maxlvl[ZLOG_DEST_STDOUT])
+      dests |= ZLOG_DEST_BIT (ZLOG_DEST_STDOUT);
+
+    if (dests)
+      {
+	va_list ac;
+	int queued;
+
+	va_copy(ac, args);
+	queued = zlog_ring_put (zl, priority, dests, &tsctl, format, ac);
+	va_end(ac);
+
+	if (queued)
+	  goto monitor;
+
+	/* Keep what is written directly in order with the queue. */
+	zlog_ring_flush ();
+      }
+  }
+#endif /* ZLOG_ASYNC */
+
   /* Syslog output */
   if (priority <= zl->maxlvl[ZLOG_DEST_SYSLOG])
     {
@@ -211,6 +302,9 @@ vzlog (struct zlog *zl, int priority, const char *format, va_list args)
       fflush (stdout);
     }
 
+#ifdef ZLOG_ASYNC
+ monitor:
+#endif /* ZLOG_ASYNC */
   /* Terminal monitor. */
   if (priority <= zl->maxlvl[ZLOG_DEST_MONITOR])
     vty_log ((zl->record_priority ? zlog_priority[priority] : NULL),
@@ -322,6 +416,308 @@ syslog_sigsafe(int priority, const char *msg, size_t msglen)
 #undef LOC
 }
 
+#ifdef ZLOG_ASYNC
+/* Messages for syslog, stdout and the log file are queued on a
+ * multi-producer ring (see ring.h) and written out by a thread of their
+ * own, so that a slow disk or syslog daemon does not hold up the event
+ * loop and any thread may log without taking a lock.  Messages are
+ * allocated with malloc (), as memory.c keeps its counts without
+ * locking.  When the ring is full the message is counted and dropped,
+ * and the writer reports how many went missing.  Messages too long for
+ * ZLOG_RING_MSG are written out directly, after whatever is queued.
+ */
+#define ZLOG_RING_SIZE	1024
+#define ZLOG_RING_MSG	1024
+
+struct zlog_msg
+{
+  struct zlog *zl;
+  int priority;
+  int dests;			/* ZLOG_DEST_BIT () of each destination */
+  size_t len;
+  char ts[sizeof(((struct timestamp_control *)0)->buf)];
+  char msg[];
+};
+
+static struct
+{
+  struct ring *ring;
+  struct zlog_msg mark;		/* queued by zlog_ring_flush () */
+  int flushed;			/* the writer has reached the mark */
+  unsigned long dropped;	/* since last reported */
+  unsigned long dropped_total;
+  sem_t ready;
+  pthread_t writer;
+  pthread_t main;		/* which opened the log, and flushes it */
+  int running;
+  int failed;
+} zlog_ring;
+
+static int
+zlog_main_thread (void)
+{
+  return !zlog_ring.running || pthread_equal (pthread_self (), zlog_ring.main);
+}
+
+static void
+zlog_ring_write_file (FILE *fp, struct zlog_msg *m)
+{
+  fprintf (fp, "%s ", m->ts);
+  if (m->zl->record_priority)
+    fprintf (fp, "%s: ", zlog_priority[m->priority]);
+  fprintf (fp, "%s: ", zlog_proto_names[m->zl->protocol]);
+  fwrite (m->msg, 1, m->len, fp);
+  fputc ('\n', fp);
+}
+
+static void
+zlog_ring_write (struct zlog_msg *m)
+{
+  if (m->dests & ZLOG_DEST_BIT (ZLOG_DEST_SYSLOG))
+    syslog (m->priority|m->zl->facility, "%s", m->msg);
+  if ((m->dests & ZLOG_DEST_BIT (ZLOG_DEST_FILE)) && m->zl->fp)
+    zlog_ring_write_file (m->zl->fp, m);
+  if (m->dests & ZLOG_DEST_BIT (ZLOG_DEST_STDOUT))
+    zlog_ring_write_file (stdout, m);
+}
+
+/* Report messages dropped since the last report, to wherever the last
+   message written went. */
+static void
+zlog_ring_write_dropped (struct zlog_msg *last)
+{
+  struct zlog_msg *m;
+  unsigned long dropped;
+
+  dropped = __atomic_exchange_n (&zlog_ring.dropped, 0, __ATOMIC_RELAXED);
+  if (!dropped)
+    return;
+
+  m = malloc (sizeof (struct zlog_msg) + ZLOG_RING_MSG);
+  if (m == NULL)
+    return;
+  m->zl = last->zl;
+  m->priority = LOG_WARNING;
+  m->dests = last->dests;
+  memcpy (m->ts, last->ts, sizeof (m->ts));
+  m->len = snprintf (m->msg, ZLOG_RING_MSG,
+		     "%lu log messages dropped, log queue full", dropped);
+  zlog_ring_write (m);
+  free (m);
+}
+
+/* Write out the report of those dropped and what stdio holds back. */
+static void
+zlog_ring_write_flush (struct zlog_msg *last)
+{
+  zlog_ring_write_dropped (last);
+  if (last->zl->fp)
+    fflush (last->zl->fp);
+  fflush (stdout);
+}
+
+static void *
+zlog_ring_writer (void *arg)
+{
+  struct zlog_msg *m;
+  struct zlog_msg *last = NULL;
+
+  while (1)
+    {
+      if (sem_wait (&zlog_ring.ready) < 0)
+	continue;
+
+      /* A wakeup may be for a message further on than one still being
+	 queued, so write whatever is ready and leave the rest for the
+	 wakeup that comes with it.  The last message written is kept for
+	 the report of those dropped. */
+      while ((m = ring_get (zlog_ring.ring)) != NULL)
+	{
+	  if (m == &zlog_ring.mark)
+	    {
+	      /* Once flushed is set, the file may be closed under us, so
+		 let go of the message that points at it first. */
+	      if (last)
+		zlog_ring_write_flush (last);
+	      free (last);
+	      last = NULL;
+	      __atomic_store_n (&zlog_ring.flushed, 1, __ATOMIC_RELEASE);
+	      continue;
+	    }
+	  zlog_ring_write (m);
+	  free (last);
+	  last = m;
+	}
+
+      if (last)
+	zlog_ring_write_flush (last);
+    }
+
+  return NULL;
+}
+
+/* Wait for the writer to get through everything queued so far.  Called
+   before the log file is changed under it, and before a fork.  Only the
+   main thread flushes, so there is only ever one mark on the ring. */
+static void
+zlog_ring_flush (void)
+{
+  struct timespec nap = { 0, 1000000 };
+
+  if (!zlog_ring.running || !zlog_main_thread ())
+    return;
+
+  __atomic_store_n (&zlog_ring.flushed, 0, __ATOMIC_RELAXED);
+  while (ring_put (zlog_ring.ring, &zlog_ring.mark) < 0)
+    nanosleep (&nap, NULL);
+  sem_post (&zlog_ring.ready);
+  while (!__atomic_load_n (&zlog_ring.flushed, __ATOMIC_ACQUIRE))
+    nanosleep (&nap, NULL);
+}
+
+/* The writer does not survive fork (), but the ring was flushed just
+   before, so a new writer can be started on it when next needed. */
+static void
+zlog_ring_child (void)
+{
+  zlog_ring.running = 0;
+  sem_destroy (&zlog_ring.ready);
+}
+
+static int
+zlog_ring_start (void)
+{
+  static int registered;
+  sigset_t all, old;
+  int ret;
+
+  if (zlog_ring.running)
+    return 1;
+  if (zlog_ring.failed)
+    return 0;
+
+  /* After a fork the ring is left as it was, empty. */
+  if (!zlog_ring.ring)
+    zlog_ring.ring = ring_new (ZLOG_RING_SIZE, RING_MPSC);
+  sem_init (&zlog_ring.ready, 0, 0);
+
+  /* Signals are for the event loop to handle, not the writer. */
+  sigfillset (&all);
+  pthread_sigmask (SIG_SETMASK, &all, &old);
+  ret = pthread_create (&zlog_ring.writer, NULL, zlog_ring_writer, NULL);
+  pthread_sigmask (SIG_SETMASK, &old, NULL);
+  if (ret != 0)
+    {
+      zlog_ring.failed = 1;
+      sem_destroy (&zlog_ring.ready);
+      return 0;
+    }
+  pthread_detach (zlog_ring.writer);
+  zlog_ring.running = 1;
+
+  if (!registered)
+    {
+      pthread_atfork (zlog_ring_flush, NULL, zlog_ring_child);
+      atexit (zlog_ring_flush);
+      registered = 1;
+    }
+  return 1;
+}
+
+/* Queue a message for the writer.  Returns 0 if it is to be written out
+   directly instead. */
+static int
+zlog_ring_put (struct zlog *zl, int priority, int dests,
+	       struct timestamp_control *tsctl,
+	       const char *format, va_list args)
+{
+  struct zlog_msg *m;
+  char msg[ZLOG_RING_MSG];
+  int len;
+
+  len = vsnprintf (msg, sizeof (msg), format, args);
+  if (len < 0 || len >= ZLOG_RING_MSG || !zlog_ring_start ())
+    return 0;
+
+  m = malloc (sizeof (struct zlog_msg) + len + 1);
+  if (m == NULL)
+    return 0;
+  zlog_timestamp (tsctl);
+  m->zl = zl;
+  m->priority = priority;
+  m->dests = dests;
+  m->len = len;
+  memcpy (m->ts, tsctl->buf, tsctl->len + 1);
+  memcpy (m->msg, msg, len + 1);
+
+  if (ring_put (zlog_ring.ring, m) < 0)
+    {
+      free (m);
+      __atomic_add_fetch (&zlog_ring.dropped, 1, __ATOMIC_RELAXED);
+      __atomic_add_fetch (&zlog_ring.dropped_total, 1, __ATOMIC_RELAXED);
+      return 1;
+    }
+  sem_post (&zlog_ring.ready);
+  return 1;
+}
+
+/* Write out what is still queued for the log file, stdout and syslog
+   using only async-signal-safe functions.  The writer may be busy with
+   the first of these, which may then appear twice. */
+static void
+zlog_ring_dump_sigsafe (void)
+{
+  struct zlog_msg *m;
+  unsigned long n;
+  char buf[ZLOG_RING_MSG + 100];
+  char *s;
+#define LOC s,buf+sizeof(buf)-s
+
+  if (!zlog_ring.running)
+    return;
+
+  for (n = 0; (m = ring_peek (zlog_ring.ring, n)) != NULL; n++)
+    {
+      if (m == &zlog_ring.mark)
+	continue;
+
+      s = buf;
+      s = str_append(LOC,m->ts);
+      s = str_append(LOC," ");
+      if (m->zl->record_priority)
+	{
+	  s = str_append(LOC,zlog_priority[m->priority]);
+	  s = str_append(LOC,": ");
+	}
+      s = str_append(LOC,zlog_proto_names[m->zl->protocol]);
+      s = str_append(LOC,": ");
+      s = str_append(LOC,m->msg);
+      if (s < buf+sizeof(buf))
+	*s++ = '\n';
+
+      if ((m->dests & ZLOG_DEST_BIT (ZLOG_DEST_FILE)) && logfile_fd >= 0)
+	write(logfile_fd, buf, s-buf);
+      if (m->dests & ZLOG_DEST_BIT (ZLOG_DEST_STDOUT))
+	write(STDOUT_FILENO, buf, s-buf);
+      if (m->dests & ZLOG_DEST_BIT (ZLOG_DEST_SYSLOG))
+	syslog_sigsafe(m->priority|m->zl->facility, m->msg, m->len);
+    }
+#undef LOC
+}
+
+unsigned long
+zlog_dropped (void)
+{
+  return __atomic_load_n (&zlog_ring.dropped_total, __ATOMIC_RELAXED);
+}
+#else /* ZLOG_ASYNC */
+unsigned long
+zlog_dropped (void)
+{
+  return 0;
+}
+#endif /* ZLOG_ASYNC */
+
 static int
 open_crashlog(void)
 {
@@ -399,6 +795,9 @@ zlog_signal(int signo, const char *action
   /* N.B. implicit priority is most severe */
 #define PRI LOG_CRIT
 
+  /* What the log writer has not got to yet comes first. */
+  zlog_ring_dump_sigsafe();
+
 #define DUMP(FD) write(FD, buf, s-buf);
   /* If no file logging configured, try to write to fallback log file. */
   if ((logfile_fd >= 0) || ((logfile_fd = open_crashlog()) >= 0))
@@ -608,6 +1007,8 @@ void
 _zlog_assert_failed (const char *assertion, const char *file,
 		     unsigned int line, const char *function)
 {
+  zlog_ring_flush ();
+
   /* Force fallback file logging? */
   if (zlog_default && !zlog_default->fp &&
       ((logfile_fd = open_crashlog()) >= 0) &&
@@ -616,6 +1017,7 @@ _zlog_assert_failed (const char *assertion, const char *file,
   zlog(NULL, LOG_CRIT, "Assertion `%s' failed in file %s, line %u, function %s",
        assertion,file,line,(function ? function : "?"));
   zlog_backtrace(LOG_CRIT);
+  zlog_ring_flush ();
   abort();
 }
 
@@ -642,6 +1044,11 @@ openzlog (const char *progname, zlog_proto_t protocol,
   zl->default_lvl = LOG_DEBUG;
 
   openlog (progname, syslog_flags, zl->facility);
+
+#ifdef ZLOG_ASYNC
+  /* The writer may be started by another thread that logs first. */
+  zlog_ring.main = pthread_self ();
+#endif /* ZLOG_ASYNC */
   
   return zl;
 }
@@ -649,6 +1056,7 @@ openzlog (const char *progname, zlog_proto_t protocol,
 void
 closezlog (struct zlog *zl)
 {
+  zlog_ring_flush ();
   closelog();
 
   if (zl->fp != NULL)
@@ -706,6 +1114,7 @@ zlog_reset_file (struct zlog *zl)
   if (zl == NULL)
     zl = zlog_default;
 
+  zlog_ring_flush ();
   if (zl->fp)
     fclose (zl->fp);
   zl->fp = NULL;
@@ -728,6 +1137,7 @@ zlog_rotate (struct zlog *zl)
   if (zl == NULL)
     zl = zlog_default;
 
+  zlog_ring_flush ();
   if (zl->fp)
     fclose (zl->fp);
   zl->fp = NULL;
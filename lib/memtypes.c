@@ -32,6 +32,8 @@ struct memory_list memory_list_lib[] =
   { MTYPE_STREAM,		"Stream"			},
   { MTYPE_STREAM_DATA,		"Stream data"			},
   { MTYPE_STREAM_FIFO,		"Stream FIFO"			},
+  { MTYPE_STREAM_CHAIN,		"Stream chain"			},
+  { MTYPE_STREAM_SEGMENT,	"Stream chain segment"		},
   { MTYPE_PREFIX,		"Prefix"			},
   { MTYPE_PREFIX_IPV4,		"Prefix IPv4"			},
   { MTYPE_PREFIX_IPV6,		"Prefix IPv6"			},
@@ -45,16 +47,21 @@ struct memory_list memory_list_lib[] =
   { MTYPE_ACCESS_LIST,		"Access List"			},
   { MTYPE_ACCESS_LIST_STR,	"Access List Str"		},
   { MTYPE_ACCESS_FILTER,	"Access Filter"			},
+  { MTYPE_ACCESS_TRIE,		"Access List Trie"		},
   { MTYPE_PREFIX_LIST,		"Prefix List"			},
   { MTYPE_PREFIX_LIST_ENTRY,	"Prefix List Entry"		},
   { MTYPE_PREFIX_LIST_STR,	"Prefix List Str"		},
+  { MTYPE_PREFIX_LIST_TRIE,	"Prefix List Trie"		},
   { MTYPE_ROUTE_MAP,		"Route map"			},
   { MTYPE_ROUTE_MAP_NAME,	"Route map name"		},
   { MTYPE_ROUTE_MAP_INDEX,	"Route map index"		},
   { MTYPE_ROUTE_MAP_RULE,	"Route map rule"		},
   { MTYPE_ROUTE_MAP_RULE_STR,	"Route map rule str"		},
   { MTYPE_ROUTE_MAP_COMPILED,	"Route map compiled"		},
+  { MTYPE_ROUTE_MAP_CACHE,	"Route map cache"		},
   { MTYPE_DESC,			"Command desc"			},
+  { MTYPE_CMD_TRIE,		"Command trie"			},
+  { MTYPE_CMD_BATCH,		"Command batch"			},
   { MTYPE_KEY,			"Key"				},
   { MTYPE_KEYCHAIN,		"Key chain"			},
   { MTYPE_IF_RMAP,		"Interface route map"		},
@@ -68,6 +75,9 @@ struct memory_list memory_list_lib[] =
   { MTYPE_WORK_QUEUE_NAME,	"Work queue name string"	},
   { MTYPE_PQUEUE,		"Priority queue"		},
   { MTYPE_PQUEUE_DATA,		"Priority queue data"		},
+  { MTYPE_RING,			"Ring queue"			},
+  { MTYPE_WORKER_POOL,		"Worker pool"			},
+  { MTYPE_WORKER_JOB,		"Worker job"			},
   { MTYPE_HOST,			"Host config"			},
   { -1, NULL },
 };
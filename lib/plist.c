@@ -29,6 +29,7 @@
 #include "buffer.h"
 #include "stream.h"
 #include "log.h"
+#include "hash.h"
 
 /* Each prefix-list's entry. */
 struct prefix_list_entry
@@ -46,10 +47,38 @@ struct prefix_list_entry
   unsigned long refcnt;
   unsigned long hitcnt;
 
+  /* Lookups are not counted against every entry they pass: refcnt is
+     worked out from these when shown, see prefix_list_refcnt_update. */
+  unsigned long stopcnt;
+  unsigned long refbase;
+
   struct prefix_list_entry *next;
   struct prefix_list_entry *prev;
+
+  /* Next entry ending at the same trie node, by sequence number. */
+  struct prefix_list_entry *trie_next;
+};
+
+/* Prefix-list entries compiled into a binary trie on their prefix
+   bits.  An entry hangs off the node at the depth of its prefix length,
+   and each node knows the lowest sequence number below it, so a lookup
+   follows the bits of the prefix looked up and need only visit the
+   entries on that path which could still come first. */
+struct prefix_list_trie
+{
+  struct prefix_list_trie *link[2];
+
+  /* Entries whose prefix ends here, by sequence number. */
+  struct prefix_list_entry *entries;
+
+  /* Lowest sequence number in this subtree. */
+  int min_seq;
 };
 
+#define PREFIX_LIST_TRIE_DEPTH  128
+#define PREFIX_LIST_TRIE_BIT(P,D) \
+  ((((const u_char *) &(P)->u.prefix)[(D) / 8] >> (7 - (D) % 8)) & 1)
+
 /* List of struct prefix_list. */
 struct prefix_list_list
 {
@@ -77,6 +106,9 @@ struct prefix_master
 
   /* Hook function which is executed when prefix_list is deleted. */
   void (*delete_hook) (struct prefix_list *);
+
+  /* All of the above by name. */
+  struct hash *names;
 };
 
 /* Static structure of IPv4 prefix_list's master. */
@@ -125,11 +157,35 @@ prefix_master_get (afi_t afi)
   return NULL;
 }
 
+static unsigned int
+prefix_list_hash_key (void *data)
+{
+  return string_hash_make (((struct prefix_list *) data)->name);
+}
+
+static int
+prefix_list_hash_cmp (const void *a, const void *b)
+{
+  return strcmp (((const struct prefix_list *) a)->name,
+		 ((const struct prefix_list *) b)->name) == 0;
+}
+
+static struct prefix_list *
+prefix_master_lookup (struct prefix_master *master, const char *name)
+{
+  struct prefix_list key;
+
+  if (master->names == NULL)
+    return NULL;
+
+  key.name = (char *) name;
+  return hash_lookup (master->names, &key);
+}
+
 /* Lookup prefix_list from list of prefix_list by name. */
 struct prefix_list *
 prefix_list_lookup (afi_t afi, const char *name)
 {
-  struct prefix_list *plist;
   struct prefix_master *master;
 
   if (name == NULL)
@@ -139,15 +195,7 @@ prefix_list_lookup (afi_t afi, const char *name)
   if (master == NULL)
     return NULL;
 
-  for (plist = master->num.head; plist; plist = plist->next)
-    if (strcmp (plist->name, name) == 0)
-      return plist;
-
-  for (plist = master->str.head; plist; plist = plist->next)
-    if (strcmp (plist->name, name) == 0)
-      return plist;
-
-  return NULL;
+  return prefix_master_lookup (master, name);
 }
 
 static struct prefix_list *
@@ -180,6 +228,97 @@ prefix_list_entry_free (struct prefix_list_entry *pentry)
   XFREE (MTYPE_PREFIX_LIST_ENTRY, pentry);
 }
 
+static void
+prefix_list_trie_free (struct prefix_list_trie *node)
+{
+  if (node == NULL)
+    return;
+  prefix_list_trie_free (node->link[0]);
+  prefix_list_trie_free (node->link[1]);
+  XFREE (MTYPE_PREFIX_LIST_TRIE, node);
+}
+
+static int
+prefix_list_trie_min_seq (struct prefix_list_trie *node)
+{
+  int min_seq = INT_MAX;
+
+  if (node->entries)
+    min_seq = node->entries->seq;
+  if (node->link[0] && node->link[0]->min_seq < min_seq)
+    min_seq = node->link[0]->min_seq;
+  if (node->link[1] && node->link[1]->min_seq < min_seq)
+    min_seq = node->link[1]->min_seq;
+  return min_seq;
+}
+
+static void
+prefix_list_trie_add (struct prefix_list *plist,
+		      struct prefix_list_entry *pentry)
+{
+  struct prefix_list_trie **nodep;
+  struct prefix_list_trie *node;
+  struct prefix_list_entry **ep;
+  int depth;
+
+  for (nodep = &plist->trie, depth = 0; ; depth++)
+    {
+      if (*nodep == NULL)
+	{
+	  *nodep = XCALLOC (MTYPE_PREFIX_LIST_TRIE,
+			    sizeof (struct prefix_list_trie));
+	  (*nodep)->min_seq = INT_MAX;
+	}
+      node = *nodep;
+      if (pentry->seq < node->min_seq)
+	node->min_seq = pentry->seq;
+
+      if (depth == pentry->prefix.prefixlen)
+	break;
+      nodep = &node->link[PREFIX_LIST_TRIE_BIT (&pentry->prefix, depth)];
+    }
+
+  for (ep = &node->entries; *ep; ep = &(*ep)->trie_next)
+    if ((*ep)->seq > pentry->seq)
+      break;
+  pentry->trie_next = *ep;
+  *ep = pentry;
+}
+
+static void
+prefix_list_trie_delete (struct prefix_list *plist,
+			 struct prefix_list_entry *pentry)
+{
+  struct prefix_list_trie **path[PREFIX_LIST_TRIE_DEPTH + 1];
+  struct prefix_list_trie *node;
+  struct prefix_list_entry **ep;
+  int depth;
+
+  path[0] = &plist->trie;
+  for (depth = 0; depth < pentry->prefix.prefixlen; depth++)
+    path[depth + 1] =
+      &(*path[depth])->link[PREFIX_LIST_TRIE_BIT (&pentry->prefix, depth)];
+
+  for (ep = &(*path[depth])->entries; *ep != pentry; ep = &(*ep)->trie_next)
+    ;
+  *ep = pentry->trie_next;
+  pentry->trie_next = NULL;
+
+  /* Prune emptied nodes and recompute the minimums up the path. */
+  for (; depth >= 0; depth--)
+    {
+      node = *path[depth];
+      if (node->entries == NULL && node->link[0] == NULL
+	  && node->link[1] == NULL)
+	{
+	  XFREE (MTYPE_PREFIX_LIST_TRIE, node);
+	  *path[depth] = NULL;
+	}
+      else
+	node->min_seq = prefix_list_trie_min_seq (node);
+    }
+}
+
 /* Insert new prefix list to list of prefix_list.  Each prefix_list
    is sorted by the name. */
 static struct prefix_list *
@@ -201,6 +340,10 @@ prefix_list_insert (afi_t afi, const char *name)
   plist->name = XSTRDUP (MTYPE_PREFIX_LIST_STR, name);
   plist->master = master;
 
+  if (master->names == NULL)
+    master->names = hash_create (prefix_list_hash_key, prefix_list_hash_cmp);
+  hash_get (master->names, plist, hash_alloc_intern);
+
   /* If name is made by all digit character.  We treat it as
      number. */
   for (number = 0, i = 0; i < strlen (name); i++)
@@ -300,8 +443,11 @@ prefix_list_delete (struct prefix_list *plist)
       prefix_list_entry_free (pentry);
       plist->count--;
     }
+  prefix_list_trie_free (plist->trie);
+  plist->trie = NULL;
 
   master = plist->master;
+  hash_release (master->names, plist);
 
   if (plist->type == PREFIX_TYPE_NUMBER)
     list = &master->num;
@@ -374,6 +520,31 @@ prefix_list_delete_hook (void (*func) (struct prefix_list *plist))
 #endif /* HAVE_IPVt6 */
 }
 
+/* Hooks of prefix-lists changed while a configuration is read run
+   once each at the end of it, if the list is still there.  Deleting a
+   whole list runs its hook at once. */
+static void
+prefix_list_batch_add (void *arg, const char *name)
+{
+  struct prefix_master *master = arg;
+  struct prefix_list *plist;
+
+  plist = prefix_master_lookup (master, name);
+  if (plist && master->add_hook)
+    (*master->add_hook) (plist);
+}
+
+static void
+prefix_list_batch_delete (void *arg, const char *name)
+{
+  struct prefix_master *master = arg;
+  struct prefix_list *plist;
+
+  plist = prefix_master_lookup (master, name);
+  if (plist && master->delete_hook)
+    (*master->delete_hook) (plist);
+}
+
 /* Calculate new sequential number. */
 static int
 prefix_new_seq_get (struct prefix_list *plist)
@@ -446,13 +617,20 @@ prefix_list_entry_delete (struct prefix_list *plist,
   else
     plist->tail = pentry->prev;
 
+  /* Lookups that stopped here had passed the entries before it. */
+  if (pentry->prev)
+    pentry->prev->stopcnt += pentry->stopcnt;
+
+  prefix_list_trie_delete (plist, pentry);
   prefix_list_entry_free (pentry);
 
   plist->count--;
 
   if (update_list)
     {
-      if (plist->master->delete_hook)
+      if (plist->master->delete_hook
+	  && ! cmd_batch_defer (prefix_list_batch_delete, plist->master,
+				plist->name))
 	(*plist->master->delete_hook) (plist);
 
       if (plist->head == NULL && plist->tail == NULL && plist->desc == NULL)
@@ -507,11 +685,20 @@ prefix_list_entry_add (struct prefix_list *plist,
       plist->tail = pentry;
     }
 
+  /* Its refcount starts from nothing. */
+  pentry->refbase = plist->nomatch;
+  for (point = pentry->next; point; point = point->next)
+    pentry->refbase += point->stopcnt;
+
+  prefix_list_trie_add (plist, pentry);
+
   /* Increment count. */
   plist->count++;
 
   /* Run hook function. */
-  if (plist->master->add_hook)
+  if (plist->master->add_hook
+      && ! cmd_batch_defer (prefix_list_batch_add, plist->master,
+			    plist->name))
     (*plist->master->add_hook) (plist);
 
   plist->master->recent = plist;
@@ -532,32 +719,53 @@ prefix_list_type_str (struct prefix_list_entry *pentry)
     }
 }
 
+/* The entries on the trie path already match the prefix bits, only
+   the lengths are left to check. */
 static int
-prefix_list_entry_match (struct prefix_list_entry *pentry, struct prefix *p)
+prefix_list_entry_len_match (struct prefix_list_entry *pentry,
+			     struct prefix *p)
 {
-  int ret;
+  if (! pentry->le && ! pentry->ge)
+    return pentry->prefix.prefixlen == p->prefixlen;
 
-  ret = prefix_match (&pentry->prefix, p);
-  if (! ret)
+  if (pentry->le && p->prefixlen > pentry->le)
     return 0;
-  
-  /* In case of le nor ge is specified, exact match is performed. */
-  if (! pentry->le && ! pentry->ge)
+  if (pentry->ge && p->prefixlen < pentry->ge)
+    return 0;
+  return 1;
+}
+
+/* First entry in sequence order matching p, or NULL. */
+static struct prefix_list_entry *
+prefix_list_lookup_entry (struct prefix_list *plist, struct prefix *p)
+{
+  struct prefix_list_trie *node;
+  struct prefix_list_entry *pentry;
+  struct prefix_list_entry *best = NULL;
+  int depth;
+
+  for (node = plist->trie, depth = 0; node; depth++)
     {
-      if (pentry->prefix.prefixlen != p->prefixlen)
-	return 0;
-    }
-  else
-    {  
-      if (pentry->le)
-	if (p->prefixlen > pentry->le)
-	  return 0;
+      if (best && node->min_seq >= best->seq)
+	break;
 
-      if (pentry->ge)
-	if (p->prefixlen < pentry->ge)
-	  return 0;
+      for (pentry = node->entries; pentry; pentry = pentry->trie_next)
+	{
+	  if (best && pentry->seq >= best->seq)
+	    break;
+	  if (prefix_list_entry_len_match (pentry, p))
+	    {
+	      best = pentry;
+	      break;
+	    }
+	}
+
+      if (depth == p->prefixlen)
+	break;
+      node = node->link[PREFIX_LIST_TRIE_BIT (p, depth)];
     }
-  return 1;
+
+  return best;
 }
 
 enum prefix_list_type
@@ -574,19 +782,33 @@ prefix_list_apply (struct prefix_list *plist, void *object)
   if (plist->count == 0)
     return PREFIX_PERMIT;
 
-  for (pentry = plist->head; pentry; pentry = pentry->next)
+  pentry = prefix_list_lookup_entry (plist, p);
+  if (pentry)
     {
-      pentry->refcnt++;
-      if (prefix_list_entry_match (pentry, p))
-	{
-	  pentry->hitcnt++;
-	  return pentry->type;
-	}
+      pentry->stopcnt++;
+      pentry->hitcnt++;
+      return pentry->type;
     }
 
+  plist->nomatch++;
   return PREFIX_DENY;
 }
 
+/* An entry is referred to by every lookup that got as far as it: those
+   that stopped at it or a later entry, and those that matched nothing. */
+static void
+prefix_list_refcnt_update (struct prefix_list *plist)
+{
+  struct prefix_list_entry *pentry;
+  unsigned long refcnt = plist->nomatch;
+
+  for (pentry = plist->tail; pentry; pentry = pentry->prev)
+    {
+      refcnt += pentry->stopcnt;
+      pentry->refcnt = refcnt - pentry->refbase;
+    }
+}
+
 static void __attribute__ ((unused))
 prefix_list_print (struct prefix_list *plist)
 {
@@ -955,6 +1177,9 @@ vty_show_prefix_entry (struct vty *vty, afi_t afi, struct prefix_list *plist,
 
   if (dtype != summary_display)
     {
+      if (dtype == detail_display || dtype == sequential_display)
+	prefix_list_refcnt_update (plist);
+
       for (pentry = plist->head; pentry; pentry = pentry->next)
 	{
 	  if (dtype == sequential_display && pentry->seq != seqnum)
@@ -1061,6 +1286,9 @@ vty_show_prefix_list_prefix (struct vty *vty, afi_t afi, const char *name,
       return CMD_WARNING;
     }
 
+  if (type == normal_display || type == first_match_display)
+    prefix_list_refcnt_update (plist);
+
   for (pentry = plist->head; pentry; pentry = pentry->next)
     {
       match = 0;
@@ -52,6 +52,10 @@ struct prefix_list
   struct prefix_list_entry *head;
   struct prefix_list_entry *tail;
 
+  /* The entries compiled for lookup, and lookups matching none. */
+  struct prefix_list_trie *trie;
+  unsigned long nomatch;
+
   struct prefix_list *next;
   struct prefix_list *prev;
 };
@@ -0,0 +1,231 @@
+/*
+ * Bounded lock-free ring queues.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "memory.h"
+#include "ring.h"
+
+#ifdef __ATOMIC_ACQUIRE
+#define RING_LOAD(P, O)		__atomic_load_n ((P), __ATOMIC_##O)
+#define RING_STORE(P, V, O)	__atomic_store_n ((P), (V), __ATOMIC_##O)
+#define RING_CAS(P, E, D) \
+  __atomic_compare_exchange_n ((P), (E), (D), 1, \
+			       __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#else
+#define RING_LOAD(P, O)		(*(P))
+#define RING_STORE(P, V, O)	(*(P) = (V))
+#define RING_CAS(P, E, D) \
+  (*(P) == *(E) ? (*(P) = (D), 1) : (*(E) = *(P), 0))
+#endif /* __ATOMIC_ACQUIRE */
+
+#define RING_CACHELINE	64
+
+struct ring_slot
+{
+  unsigned long seq;		/* MPSC only */
+  void *data;
+};
+
+/* Producers and the consumer each keep to a cache line of their own, so
+ * that they do not take it from each other on every operation.
+ *
+ * A single producer and consumer only need to publish head and tail.
+ * Each remembers the other's position as last seen and reads it again
+ * only when that says the ring is full or empty.
+ *
+ * Several producers use Dmitry Vyukov's bounded queue: a producer claims
+ * a slot by moving head on with compare-and-swap, and publishes it by
+ * setting the slot's sequence number to one past its position.  The
+ * consumer hands the slot back by moving the sequence number on by the
+ * size of the ring.
+ */
+struct ring
+{
+  unsigned long head;		/* next slot to fill */
+  unsigned long tail_seen;	/* SPSC, producer's view of tail */
+  char pad0[RING_CACHELINE - 2 * sizeof (unsigned long)];
+
+  unsigned long tail;		/* next slot to take */
+  unsigned long head_seen;	/* SPSC, consumer's view of head */
+  char pad1[RING_CACHELINE - 2 * sizeof (unsigned long)];
+
+  unsigned long mask;
+  int type;
+  struct ring_slot *slot;
+};
+
+struct ring *
+ring_new (unsigned long size, int type)
+{
+  struct ring *ring;
+  unsigned long i, n;
+
+  for (n = 2; n < size; n <<= 1)
+    ;
+
+  ring = XCALLOC (MTYPE_RING, sizeof (struct ring));
+  ring->slot = XCALLOC (MTYPE_RING, n * sizeof (struct ring_slot));
+  ring->mask = n - 1;
+  ring->type = type;
+  for (i = 0; i < n; i++)
+    ring->slot[i].seq = i;
+  return ring;
+}
+
+void
+ring_free (struct ring *ring)
+{
+  XFREE (MTYPE_RING, ring->slot);
+  XFREE (MTYPE_RING, ring);
+}
+
+static int
+ring_put_spsc (struct ring *ring, void *data)
+{
+  unsigned long head = RING_LOAD (&ring->head, RELAXED);
+
+  if (head - ring->tail_seen > ring->mask)
+    {
+      ring->tail_seen = RING_LOAD (&ring->tail, ACQUIRE);
+      if (head - ring->tail_seen > ring->mask)
+	return -1;
+    }
+  ring->slot[head & ring->mask].data = data;
+  RING_STORE (&ring->head, head + 1, RELEASE);
+  return 0;
+}
+
+static void *
+ring_get_spsc (struct ring *ring)
+{
+  unsigned long tail = RING_LOAD (&ring->tail, RELAXED);
+  void *data;
+
+  if (tail == ring->head_seen)
+    {
+      ring->head_seen = RING_LOAD (&ring->head, ACQUIRE);
+      if (tail == ring->head_seen)
+	return NULL;
+    }
+  data = ring->slot[tail & ring->mask].data;
+  RING_STORE (&ring->tail, tail + 1, RELEASE);
+  return data;
+}
+
+static int
+ring_put_mpsc (struct ring *ring, void *data)
+{
+  struct ring_slot *slot;
+  unsigned long pos, seq;
+
+  pos = RING_LOAD (&ring->head, RELAXED);
+  for (;;)
+    {
+      slot = &ring->slot[pos & ring->mask];
+      seq = RING_LOAD (&slot->seq, ACQUIRE);
+      if (seq == pos)
+	{
+	  if (RING_CAS (&ring->head, &pos, pos + 1))
+	    break;
+	}
+      else if ((long) (seq - pos) < 0)
+	return -1;
+      else
+	pos = RING_LOAD (&ring->head, RELAXED);
+    }
+  slot->data = data;
+  RING_STORE (&slot->seq, pos + 1, RELEASE);
+  return 0;
+}
+
+/* A slot claimed but not yet published keeps the consumer from those
+ * after it, so the ring may look empty for a moment when it is not.
+ */
+static void *
+ring_get_mpsc (struct ring *ring)
+{
+  unsigned long pos = ring->tail;
+  struct ring_slot *slot = &ring->slot[pos & ring->mask];
+  void *data;
+
+  if (RING_LOAD (&slot->seq, ACQUIRE) != pos + 1)
+    return NULL;
+  data = slot->data;
+  RING_STORE (&slot->seq, pos + ring->mask + 1, RELEASE);
+  RING_STORE (&ring->tail, pos + 1, RELAXED);
+  return data;
+}
+
+int
+ring_put (struct ring *ring, void *data)
+{
+  assert (data != NULL);
+  if (ring->type == RING_MPSC)
+    return ring_put_mpsc (ring, data);
+  return ring_put_spsc (ring, data);
+}
+
+void *
+ring_get (struct ring *ring)
+{
+  if (ring->type == RING_MPSC)
+    return ring_get_mpsc (ring);
+  return ring_get_spsc (ring);
+}
+
+void *
+ring_peek (struct ring *ring, unsigned long n)
+{
+  unsigned long pos = RING_LOAD (&ring->tail, RELAXED);
+
+  if (n > ring->mask)
+    return NULL;
+  if (ring->type == RING_MPSC)
+    {
+      struct ring_slot *slot = &ring->slot[(pos + n) & ring->mask];
+
+      if (RING_LOAD (&slot->seq, ACQUIRE) != pos + n + 1)
+	return NULL;
+      return slot->data;
+    }
+  if (RING_LOAD (&ring->head, ACQUIRE) - pos <= n)
+    return NULL;
+  return ring->slot[(pos + n) & ring->mask].data;
+}
+
+unsigned long
+ring_count (struct ring *ring)
+{
+  unsigned long tail = RING_LOAD (&ring->tail, RELAXED);
+  unsigned long head = RING_LOAD (&ring->head, RELAXED);
+
+  /* the two are read at different times */
+  if ((long) (head - tail) < 0)
+    return 0;
+  return MIN (head - tail, ring->mask + 1);
+}
+
+unsigned long
+ring_size (struct ring *ring)
+{
+  return ring->mask + 1;
+}
@@ -0,0 +1,61 @@
+/*
+ * Bounded lock-free ring queues.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _QUAGGA_RING_H
+#define _QUAGGA_RING_H
+
+/* A ring passes pointers from one thread to another without a lock.
+ * There is only ever one consumer.  A RING_SPSC ring has a single
+ * producer too; a RING_MPSC ring may be put to from any number of
+ * threads at once.  Without compiler support for atomics a ring is only
+ * safe to use within a single thread.
+ */
+#define RING_SPSC	0
+#define RING_MPSC	1
+
+struct ring;
+
+/* Create a ring holding at least size pointers; the size is rounded up
+ * to a power of two.
+ */
+extern struct ring *ring_new (unsigned long size, int type);
+extern void ring_free (struct ring *);
+
+/* Queue a pointer, which must not be NULL.  Returns -1 if the ring is
+ * full, 0 otherwise.
+ */
+extern int ring_put (struct ring *, void *);
+
+/* Take the oldest pointer off the ring, NULL if there is none. */
+extern void *ring_get (struct ring *);
+
+/* The pointer n places after the oldest, left on the ring; NULL if
+ * there are not that many.  Like ring_get (), for the consumer only.
+ */
+extern void *ring_peek (struct ring *, unsigned long n);
+
+/* Number of pointers queued; only a snapshot if other threads are at
+ * work on the ring.
+ */
+extern unsigned long ring_count (struct ring *);
+extern unsigned long ring_size (struct ring *);
+
+#endif /* _QUAGGA_RING_H */
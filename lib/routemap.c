@@ -28,6 +28,11 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "command.h"
 #include "vty.h"
 #include "log.h"
+#include "hash.h"
+#include "jhash.h"
+
+/* Entries a route map's cache holds before it is emptied. */
+#define ROUTE_MAP_CACHE_MAX 4096
 
 /* Vector for route match rules. */
 static vector route_match_vec;
@@ -61,17 +66,52 @@ struct route_map_list
   void (*add_hook) (const char *);
   void (*delete_hook) (const char *);
   void (*event_hook) (route_map_event_t, const char *); 
+
+  /* Route maps by name. */
+  struct hash *names;
+
+  /* Bumped whenever a cached match may no longer hold. */
+  unsigned int cache_version;
+
+  /* Hooks giving a referenced key for an object's attributes, and
+     dropping that reference. */
+  void *(*cache_key) (route_map_object_t, void *);
+  void (*cache_release) (void *);
 };
 
 /* Master list of route map. */
 static struct route_map_list route_map_master = { NULL, NULL, NULL, NULL };
 
+/* Cached first matching index of a route map. */
+struct route_map_cache
+{
+  void *key;
+  int family;
+  struct route_map_index *index;
+};
+
 static void
 route_map_rule_delete (struct route_map_rule_list *,
 		       struct route_map_rule *);
 
 static void
 route_map_index_delete (struct route_map_index *, int);
+
+static void
+route_map_cache_free (struct route_map *);
+
+static unsigned int
+route_map_hash_key (void *data)
+{
+  return string_hash_make (((struct route_map *) data)->name);
+}
+
+static int
+route_map_hash_cmp (const void *a, const void *b)
+{
+  return strcmp (((const struct route_map *) a)->name,
+		 ((const struct route_map *) b)->name) == 0;
+}
 
 /* New route map allocation. Please note route map's name must be
    specified. */
@@ -85,6 +125,34 @@ route_map_new (const char *name)
   return new;
 }
 
+/* Add and event hooks of route-maps changed while a configuration is
+   read run once for each route-map and event at the end of it, if the
+   route-map is still there.  Deleting a route-map runs its hook at
+   once. */
+static void
+route_map_batch_add (void *arg, const char *name)
+{
+  if (route_map_lookup_by_name (name) && route_map_master.add_hook)
+    (*route_map_master.add_hook) (name);
+}
+
+static void
+route_map_batch_event (void *arg, const char *name)
+{
+  if (route_map_lookup_by_name (name) && route_map_master.event_hook)
+    (*route_map_master.event_hook) ((route_map_event_t) (uintptr_t) arg,
+				    name);
+}
+
+static void
+route_map_notify (route_map_event_t event, const char *name)
+{
+  if (route_map_master.event_hook
+      && ! cmd_batch_defer (route_map_batch_event,
+			    (void *) (uintptr_t) event, name))
+    (*route_map_master.event_hook) (event, name);
+}
+
 /* Add new name to route_map. */
 static struct route_map *
 route_map_add (const char *name)
@@ -103,8 +171,11 @@ route_map_add (const char *name)
     list->head = map;
   list->tail = map;
 
+  hash_get (list->names, map, hash_alloc_intern);
+
   /* Execute hook. */
-  if (route_map_master.add_hook)
+  if (route_map_master.add_hook
+      && ! cmd_batch_defer (route_map_batch_add, NULL, name))
     (*route_map_master.add_hook) (name);
 
   return map;
@@ -124,6 +195,8 @@ route_map_delete (struct route_map *map)
   name = map->name;
 
   list = &route_map_master;
+  hash_release (list->names, map);
+  route_map_cache_free (map);
 
   if (map->next)
     map->next->prev = map->prev;
@@ -150,12 +223,10 @@ route_map_delete (struct route_map *map)
 struct route_map *
 route_map_lookup_by_name (const char *name)
 {
-  struct route_map *map;
+  struct route_map key;
 
-  for (map = route_map_master.head; map; map = map->next)
-    if (strcmp (map->name, name) == 0)
-      return map;
-  return NULL;
+  key.name = (char *) name;
+  return hash_lookup (route_map_master.names, &key);
 }
 
 /* Lookup route map.  If there isn't route map create one and return
@@ -246,6 +317,12 @@ vty_show_route_map_entry (struct vty *vty, struct route_map *map)
       else if (index->exitpolicy == RMAP_EXIT)
         vty_out (vty, "    Exit routemap%s", VTY_NEWLINE);
     }
+
+  if (map->cache_hits || map->cache_misses)
+    vty_out (vty, "route-map %s cache: %lu hits, %lu misses, %lu%% hit rate%s",
+             map->name, map->cache_hits, map->cache_misses,
+             map->cache_hits * 100 / (map->cache_hits + map->cache_misses),
+             VTY_NEWLINE);
 }
 
 static int
@@ -318,10 +395,11 @@ route_map_index_delete (struct route_map_index *index, int notify)
   if (index->nextrm)
     XFREE (MTYPE_ROUTE_MAP_NAME, index->nextrm);
 
+  route_map_cache_flush ();
+
     /* Execute event hook. */
-  if (route_map_master.event_hook && notify)
-    (*route_map_master.event_hook) (RMAP_EVENT_INDEX_DELETED,
-				    index->map->name);
+  if (notify)
+    route_map_notify (RMAP_EVENT_INDEX_DELETED, index->map->name);
 
   XFREE (MTYPE_ROUTE_MAP_INDEX, index);
 }
@@ -384,10 +462,10 @@ route_map_index_add (struct route_map *map, enum route_map_type type,
       point->prev = index;
     }
 
+  route_map_cache_flush ();
+
   /* Execute event hook. */
-  if (route_map_master.event_hook)
-    (*route_map_master.event_hook) (RMAP_EVENT_INDEX_ADDED,
-				    map->name);
+  route_map_notify (RMAP_EVENT_INDEX_ADDED, map->name);
 
   return index;
 }
@@ -569,13 +647,13 @@ route_map_add_match (struct route_map_index *index, const char *match_name,
 
   /* Add new route match rule to linked list. */
   route_map_rule_add (&index->match_list, rule);
+  route_map_cache_flush ();
 
   /* Execute event hook. */
-  if (route_map_master.event_hook)
-    (*route_map_master.event_hook) (replaced ?
-				    RMAP_EVENT_MATCH_REPLACED:
-				    RMAP_EVENT_MATCH_ADDED,
-				    index->map->name);
+  route_map_notify (replaced ?
+		    RMAP_EVENT_MATCH_REPLACED:
+		    RMAP_EVENT_MATCH_ADDED,
+		    index->map->name);
 
   return 0;
 }
@@ -597,10 +675,9 @@ route_map_delete_match (struct route_map_index *index, const char *match_name,
 	(rulecmp (rule->rule_str, match_arg) == 0 || match_arg == NULL))
       {
 	route_map_rule_delete (&index->match_list, rule);
+	route_map_cache_flush ();
 	/* Execute event hook. */
-	if (route_map_master.event_hook)
-	  (*route_map_master.event_hook) (RMAP_EVENT_MATCH_DELETED,
-					  index->map->name);
+	route_map_notify (RMAP_EVENT_MATCH_DELETED, index->map->name);
 	return 0;
       }
   /* Can't find matched rule. */
@@ -658,11 +735,10 @@ route_map_add_set (struct route_map_index *index, const char *set_name,
   route_map_rule_add (&index->set_list, rule);
 
   /* Execute event hook. */
-  if (route_map_master.event_hook)
-    (*route_map_master.event_hook) (replaced ?
-				    RMAP_EVENT_SET_REPLACED:
-				    RMAP_EVENT_SET_ADDED,
-				    index->map->name);
+  route_map_notify (replaced ?
+		    RMAP_EVENT_SET_REPLACED:
+		    RMAP_EVENT_SET_ADDED,
+		    index->map->name);
   return 0;
 }
 
@@ -684,9 +760,7 @@ route_map_delete_set (struct route_map_index *index, const char *set_name,
       {
         route_map_rule_delete (&index->set_list, rule);
 	/* Execute event hook. */
-	if (route_map_master.event_hook)
-	  (*route_map_master.event_hook) (RMAP_EVENT_SET_DELETED,
-					  index->map->name);
+	route_map_notify (RMAP_EVENT_SET_DELETED, index->map->name);
         return 0;
       }
   /* Can't find matched rule. */
@@ -769,6 +843,120 @@ route_map_apply_match (struct route_map_rule_list *match_list,
   return ret;
 }
 
+/* First index of the map whose match rules all match, if any. */
+static struct route_map_index *
+route_map_match_first (struct route_map *map, struct prefix *prefix,
+                       route_map_object_t type, void *object)
+{
+  struct route_map_index *index;
+
+  for (index = map->head; index; index = index->next)
+    if (route_map_apply_match (&index->match_list, prefix,
+                               type, object) == RMAP_MATCH)
+      return index;
+  return NULL;
+}
+
+static unsigned int
+route_map_cache_hash_key (void *data)
+{
+  struct route_map_cache *cache = data;
+
+  return jhash_2words ((u_int32_t) (uintptr_t) cache->key, cache->family, 0);
+}
+
+static int
+route_map_cache_hash_cmp (const void *a, const void *b)
+{
+  const struct route_map_cache *cache1 = a;
+  const struct route_map_cache *cache2 = b;
+
+  return cache1->key == cache2->key && cache1->family == cache2->family;
+}
+
+static void
+route_map_cache_entry_free (void *data)
+{
+  struct route_map_cache *cache = data;
+
+  (*route_map_master.cache_release) (cache->key);
+  XFREE (MTYPE_ROUTE_MAP_CACHE, cache);
+}
+
+static void
+route_map_cache_free (struct route_map *map)
+{
+  if (map->cache == NULL)
+    return;
+  hash_clean (map->cache, route_map_cache_entry_free);
+  hash_free (map->cache);
+  map->cache = NULL;
+}
+
+/* Only maps matching on attributes alone are cached. */
+static int
+route_map_cacheable (struct route_map *map)
+{
+  struct route_map_index *index;
+  struct route_map_rule *match;
+
+  for (index = map->head; index; index = index->next)
+    for (match = index->match_list.head; match; match = match->next)
+      if (! match->cmd->cacheable)
+        return 0;
+  return 1;
+}
+
+/* route_map_match_first () through the map's cache.  Matching runs
+   before any set statement, so the object still carries the attributes
+   it came with and the key stands for all a cacheable rule looks at. */
+static struct route_map_index *
+route_map_cache_match_first (struct route_map *map, struct prefix *prefix,
+                             route_map_object_t type, void *object)
+{
+  struct route_map_cache key;
+  struct route_map_cache *cache;
+
+  if (map->cache_version != route_map_master.cache_version)
+    {
+      route_map_cache_free (map);
+      map->cacheable = route_map_cacheable (map);
+      map->cache_version = route_map_master.cache_version;
+    }
+
+  if (! map->cacheable || ! route_map_master.cache_key)
+    return route_map_match_first (map, prefix, type, object);
+
+  key.key = (*route_map_master.cache_key) (type, object);
+  if (key.key == NULL)
+    return route_map_match_first (map, prefix, type, object);
+  key.family = prefix->family;
+
+  if (map->cache == NULL)
+    map->cache = hash_create (route_map_cache_hash_key,
+                              route_map_cache_hash_cmp);
+
+  cache = hash_lookup (map->cache, &key);
+  if (cache)
+    {
+      map->cache_hits++;
+      (*route_map_master.cache_release) (key.key);
+      return cache->index;
+    }
+  map->cache_misses++;
+
+  if (map->cache->count >= ROUTE_MAP_CACHE_MAX)
+    hash_clean (map->cache, route_map_cache_entry_free);
+
+  cache = XMALLOC (MTYPE_ROUTE_MAP_CACHE, sizeof (struct route_map_cache));
+  cache->key = key.key;
+  cache->family = key.family;
+  cache->index = route_map_match_first (map, prefix, type, object);
+  hash_get (map->cache, cache, hash_alloc_intern);
+
+  return cache->index;
+}
+
 /* Apply route map to the object. */
 route_map_result_t
 route_map_apply (struct route_map *map, struct prefix *prefix,
@@ -777,6 +965,7 @@ route_map_apply (struct route_map *map, struct prefix *prefix,
   static int recursion = 0;
   int ret = 0;
   struct route_map_index *index;
+  struct route_map_index *first;
   struct route_map_rule *set;
 
   if (recursion > RMAP_RECURSION_LIMIT)
@@ -791,10 +980,17 @@ route_map_apply (struct route_map *map, struct prefix *prefix,
   if (map == NULL)
     return RMAP_DENYMATCH;
 
-  for (index = map->head; index; index = index->next)
+  /* No index before the first match can change the object. */
+  first = route_map_cache_match_first (map, prefix, type, object);
+
+  for (index = first; index; index = index->next)
     {
       /* Apply this index. */
-      ret = route_map_apply_match (&index->match_list, prefix, type, object);
+      if (index == first)
+        ret = RMAP_MATCH;
+      else
+        ret = route_map_apply_match (&index->match_list, prefix,
+                                     type, object);
 
       /* Now we apply the matrix from above */
       if (ret == RMAP_NOMATCH)
@@ -882,12 +1078,42 @@ route_map_event_hook (void (*func) (route_map_event_t, const char *))
   route_map_master.event_hook = func;
 }
 
+/* Hook for the key of an object under which the first matching index
+   of a route map is cached, NULL if the object can't be cached.  The key
+   holds a reference, dropped by the release hook, so it is not reused
+   for other attributes while cached. */
+void
+route_map_cache_hook (void *(*key) (route_map_object_t, void *),
+                      void (*release) (void *))
+{
+  struct route_map *map;
+
+  for (map = route_map_master.head; map; map = map->next)
+    route_map_cache_free (map);
+
+  route_map_master.cache_key = key;
+  route_map_master.cache_release = release;
+  route_map_cache_flush ();
+}
+
+/* Forget all cached matches, for when a rule's result may have changed
+   without the route map changing, e.g. a list it refers to. */
+void
+route_map_cache_flush (void)
+{
+  route_map_master.cache_version++;
+}
+
 void
 route_map_init (void)
 {
   /* Make vector for match and set. */
   route_match_vec = vector_init (1);
   route_set_vec = vector_init (1);
+
+  route_map_master.names = hash_create (route_map_hash_key,
+                                        route_map_hash_cmp);
+  route_map_master.cache_version = 1;
 }
 
 void
@@ -87,6 +87,11 @@ struct route_map_rule_cmd
 
   /* Free allocated value by func_compile (). */
   void (*func_free)(void *);
+
+  /* Set if func_apply looks at nothing but the object's attributes and
+     the prefix family, so its result may be cached under the key
+     given by the hook of route_map_cache_hook (). */
+  int cacheable;
 };
 
 /* Route map apply error. */
@@ -149,6 +154,13 @@ struct route_map
   /* Make linked list. */
   struct route_map *next;
   struct route_map *prev;
+
+  /* First matching index by object key, valid for one cache version. */
+  struct hash *cache;
+  unsigned int cache_version;
+  int cacheable;
+  unsigned long cache_hits;
+  unsigned long cache_misses;
 };
 
 /* Prototypes. */
@@ -194,5 +206,8 @@ extern route_map_result_t route_map_apply (struct route_map *map,
 extern void route_map_add_hook (void (*func) (const char *));
 extern void route_map_delete_hook (void (*func) (const char *));
 extern void route_map_event_hook (void (*func) (route_map_event_t, const char *));
+extern void route_map_cache_hook (void *(*key) (route_map_object_t, void *),
+                                  void (*release) (void *));
+extern void route_map_cache_flush (void);
 
 #endif /* _ZEBRA_ROUTEMAP_H */
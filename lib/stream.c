@@ -111,20 +111,59 @@ stream_new (size_t size)
     }
   
   s->size = size;
+  s->refcnt = 1;
   return s;
 }
 
-/* Free it now. */
+/* Drop a reference, and free it now if that was the last one. */
 void
 stream_free (struct stream *s)
 {
   if (!s)
     return;
   
+  assert (s->refcnt > 0);
+  if (--s->refcnt > 0)
+    return;
+
   XFREE (MTYPE_STREAM_DATA, s->data);
   XFREE (MTYPE_STREAM, s);
 }
 
+/* Take another reference, to be dropped with stream_free (). */
+struct stream *
+stream_ref (struct stream *s)
+{
+  s->refcnt++;
+  return s;
+}
+
+/* Hand the contents of a stream over to a new stream, trimmed to endp,
+ * without copying them.  The old stream is left empty with a fresh
+ * buffer of its size, so it can go on being used as a work buffer.
+ */
+struct stream *
+stream_detach (struct stream *s)
+{
+  struct stream *new;
+
+  STREAM_VERIFY_SANE (s);
+
+  new = XCALLOC (MTYPE_STREAM, sizeof (struct stream));
+  new->data = s->data;
+  new->size = s->size;
+  new->getp = s->getp;
+  new->endp = s->endp;
+  new->refcnt = 1;
+  if (new->endp && new->endp < new->size)
+    stream_resize (new, new->endp);
+
+  s->data = XMALLOC (MTYPE_STREAM_DATA, s->size);
+  s->getp = s->endp = 0;
+
+  return new;
+}
+
 struct stream *
 stream_copy (struct stream *new, struct stream *src)
 {
@@ -993,3 +1032,191 @@ stream_fifo_free (struct stream_fifo *fifo)
   stream_fifo_clean (fifo);
   XFREE (MTYPE_STREAM_FIFO, fifo);
 }
+
+/* Stream chain.  Each segment holds a reference on its stream, and its
+ * own copy of the range still to be written, so the stream's getp may
+ * go on being used by its owner.
+ */
+struct stream_segment
+{
+  struct stream_segment *next;
+
+  struct stream *s;
+  size_t sp;			/* next byte to write */
+  size_t ep;			/* end of range */
+};
+
+/* Most segments given to one writev (). */
+#ifdef IOV_MAX
+#define STREAM_CHAIN_IOV ((IOV_MAX >= 64) ? 64 : IOV_MAX)
+#else
+#define STREAM_CHAIN_IOV 16
+#endif
+
+struct stream_chain *
+stream_chain_new (void)
+{
+  return XCALLOC (MTYPE_STREAM_CHAIN, sizeof (struct stream_chain));
+}
+
+void
+stream_chain_free (struct stream_chain *chain)
+{
+  stream_chain_reset (chain);
+  XFREE (MTYPE_STREAM_CHAIN, chain);
+}
+
+/* Drop everything not yet written. */
+void
+stream_chain_reset (struct stream_chain *chain)
+{
+  struct stream_segment *seg;
+  struct stream_segment *next;
+
+  for (seg = chain->head; seg; seg = next)
+    {
+      next = seg->next;
+      stream_free (seg->s);
+      XFREE (MTYPE_STREAM_SEGMENT, seg);
+    }
+  chain->head = chain->tail = NULL;
+  chain->count = 0;
+  chain->length = 0;
+}
+
+int
+stream_chain_empty (struct stream_chain *chain)
+{
+  return chain->head == NULL;
+}
+
+/* Queue the readable part of a stream by reference.  The stream must not
+ * be written to over that range until the chain is done with it.
+ */
+void
+stream_chain_append (struct stream_chain *chain, struct stream *s)
+{
+  struct stream_segment *seg;
+
+  STREAM_VERIFY_SANE (s);
+
+  if (!STREAM_READABLE (s))
+    return;
+
+  seg = XMALLOC (MTYPE_STREAM_SEGMENT, sizeof (struct stream_segment));
+  seg->next = NULL;
+  seg->s = stream_ref (s);
+  seg->sp = s->getp;
+  seg->ep = s->endp;
+
+  if (chain->tail)
+    chain->tail->next = seg;
+  else
+    chain->head = seg;
+  chain->tail = seg;
+
+  chain->count++;
+  chain->length += seg->ep - seg->sp;
+}
+
+/* Write as much of the chain as one writev () takes, and drop the
+ * segments written in full.  Returns what writev () returned.
+ */
+ssize_t
+stream_chain_writev (struct stream_chain *chain, int fd)
+{
+  struct stream_segment *seg;
+  struct iovec iov[STREAM_CHAIN_IOV];
+  int iovcnt = 0;
+  ssize_t nbytes;
+  size_t written;
+
+  for (seg = chain->head; seg && iovcnt < STREAM_CHAIN_IOV;
+       seg = seg->next, iovcnt++)
+    {
+      iov[iovcnt].iov_base = seg->s->data + seg->sp;
+      iov[iovcnt].iov_len = seg->ep - seg->sp;
+    }
+
+  if (iovcnt == 0)
+    return 0;
+
+  if ((nbytes = writev (fd, iov, iovcnt)) <= 0)
+    return nbytes;
+
+  chain->length -= nbytes;
+  for (written = nbytes; written > 0; )
+    {
+      seg = chain->head;
+      if (written < seg->ep - seg->sp)
+	{
+	  seg->sp += written;
+	  break;
+	}
+
+      written -= seg->ep - seg->sp;
+      if (!(chain->head = seg->next))
+	chain->tail = NULL;
+      chain->count--;
+      stream_free (seg->s);
+      XFREE (MTYPE_STREAM_SEGMENT, seg);
+    }
+
+  return nbytes;
+}
+
+/* Like buffer_flush_available (). */
+buffer_status_t
+stream_chain_flush (struct stream_chain *chain, int fd)
+{
+  if (stream_chain_empty (chain))
+    return BUFFER_EMPTY;
+
+  if (stream_chain_writev (chain, fd) < 0)
+    {
+      if (ERRNO_IO_RETRY (errno))
+	return BUFFER_PENDING;
+      zlog_warn ("%s: write error on fd %d: %s",
+		 __func__, fd, safe_strerror (errno));
+      return BUFFER_ERROR;
+    }
+
+  return stream_chain_empty (chain) ? BUFFER_EMPTY : BUFFER_PENDING;
+}
+
+/* Like buffer_write (), for the readable part of a stream.  Whatever the
+ * socket does not take straight away is queued by handing the contents
+ * of the stream over to the chain with stream_detach (), so the caller
+ * may reuse the stream at once and nothing is copied either way.
+ */
+buffer_status_t
+stream_chain_write (struct stream_chain *chain, int fd, struct stream *s)
+{
+  struct stream *rest;
+  ssize_t nbytes;
+
+  if (!stream_chain_empty (chain))
+    /* Data is queued already, so do not jump ahead of it. */
+    nbytes = 0;
+  else if ((nbytes = write (fd, s->data + s->getp, STREAM_READABLE (s))) < 0)
+    {
+      if (ERRNO_IO_RETRY (errno))
+	nbytes = 0;
+      else
+	{
+	  zlog_warn ("%s: write error on fd %d: %s",
+		     __func__, fd, safe_strerror (errno));
+	  return BUFFER_ERROR;
+	}
+    }
+
+  if ((size_t) nbytes < STREAM_READABLE (s))
+    {
+      stream_forward_getp (s, nbytes);
+      rest = stream_detach (s);
+      stream_chain_append (chain, rest);
+      stream_free (rest);
+    }
+
+  return stream_chain_empty (chain) ? BUFFER_EMPTY : BUFFER_PENDING;
+}
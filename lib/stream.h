@@ -24,6 +24,7 @@
 #define _ZEBRA_STREAM_H
 
 #include "prefix.h"
+#include "buffer.h"
 
 /*
  * A stream is an arbitrary buffer, whose contents generally are assumed to
@@ -104,6 +105,7 @@ struct stream
   size_t endp;		/* last valid data position */
   size_t size;		/* size of data segment */
   unsigned char *data; /* data pointer */
+  unsigned int refcnt;	/* stream_free () frees at zero */
 };
 
 /* First in first out queue structure. */
@@ -115,6 +117,19 @@ struct stream_fifo
   struct stream *tail;
 };
 
+/* Chain of stream ranges waiting to be written out with writev ().
+ * Streams are appended by reference rather than copied, so a packet
+ * goes from the buffer it was built in to the socket without a copy.
+ */
+struct stream_chain
+{
+  struct stream_segment *head;
+  struct stream_segment *tail;
+
+  size_t count;			/* segments */
+  size_t length;		/* bytes not yet written */
+};
+
 /* Utility macros. */
 #define STREAM_SIZE(S)  ((S)->size)
   /* number of bytes which can still be written */
@@ -137,6 +152,8 @@ struct stream_fifo
  */
 extern struct stream *stream_new (size_t);
 extern void stream_free (struct stream *);
+extern struct stream *stream_ref (struct stream *);
+extern struct stream *stream_detach (struct stream *);
 extern struct stream * stream_copy (struct stream *, struct stream *src);
 extern struct stream *stream_dup (struct stream *);
 extern size_t stream_resize (struct stream *, size_t);
@@ -219,4 +236,15 @@ extern struct stream *stream_fifo_head (struct stream_fifo *fifo);
 extern void stream_fifo_clean (struct stream_fifo *fifo);
 extern void stream_fifo_free (struct stream_fifo *fifo);
 
+/* Stream chain. */
+extern struct stream_chain *stream_chain_new (void);
+extern void stream_chain_free (struct stream_chain *);
+extern void stream_chain_reset (struct stream_chain *);
+extern int stream_chain_empty (struct stream_chain *);
+extern void stream_chain_append (struct stream_chain *, struct stream *);
+extern ssize_t stream_chain_writev (struct stream_chain *, int fd);
+extern buffer_status_t stream_chain_flush (struct stream_chain *, int fd);
+extern buffer_status_t stream_chain_write (struct stream_chain *, int fd,
+					   struct stream *);
+
 #endif /* _ZEBRA_STREAM_H */
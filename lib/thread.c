@@ -55,6 +55,8 @@ static struct timeval relative_time_base;
 static unsigned short timers_inited;
 
 static struct hash *cpu_record = NULL;
+
+unsigned int thread_cpu_sample = THREAD_CPU_SAMPLE_DEFAULT;
 
 /* Struct timeval's tv_usec one second value.  */
 #define TIMER_SECOND_MICRO 1000000L
@@ -278,14 +280,68 @@ cpu_record_hash_free (void *a)
   XFREE (MTYPE_THREAD_STATS, hist);
 }
 
+/* Bucket of a latency in the histograms, four to each power of two. */
+static unsigned int
+thread_hist_bucket (unsigned long usec)
+{
+  int msb;
+
+  if (usec < 4)
+    return usec;
+  if (usec > 0xffffffffUL)
+    return THREAD_HIST_BUCKETS - 1;
+  msb = 31 - __builtin_clz ((unsigned int) usec);
+  return (msb - 1) * 4 + ((usec >> (msb - 2)) & 3);
+}
+
+/* Largest latency counted in a bucket. */
+static unsigned long
+thread_hist_value (unsigned int bucket)
+{
+  if (bucket < 4)
+    return bucket;
+  return ((unsigned long) (5 + bucket % 4) << (bucket / 4 - 1)) - 1;
+}
+
+/* Latency under which permille thousandths of count calls came in. */
+static unsigned long
+thread_hist_percentile (const unsigned int *hist, unsigned long count,
+			unsigned long max, unsigned long permille)
+{
+  unsigned long want = (count * permille + 999) / 1000;
+  unsigned long seen = 0;
+  unsigned int i;
+
+  for (i = 0; i < THREAD_HIST_BUCKETS; i++)
+    {
+      seen += hist[i];
+      if (seen >= want)
+	return MIN (thread_hist_value (i), max);
+    }
+  return max;
+}
+
+#ifdef HAVE_RUSAGE
+/* CPU time of the tasks sampled, scaled up to all calls. */
+static unsigned long
+thread_cpu_total (struct cpu_thread_history *a)
+{
+  if (a->cpu_calls == 0)
+    return 0;
+  return (double) a->cpu.total * a->total_calls / a->cpu_calls;
+}
+#endif /* HAVE_RUSAGE */
+
 static void 
 vty_out_cpu_thread_history(struct vty* vty,
 			   struct cpu_thread_history *a)
 {
 #ifdef HAVE_RUSAGE
+  unsigned long cpu = thread_cpu_total (a);
+
   vty_out(vty, "%7ld.%03ld %9d %8ld %9ld %8ld %9ld",
-	  a->cpu.total/1000, a->cpu.total%1000, a->total_calls,
-	  a->cpu.total/a->total_calls, a->cpu.max,
+	  cpu/1000, cpu%1000, a->total_calls,
+	  cpu/a->total_calls, a->cpu.max,
 	  a->real.total/a->total_calls, a->real.max);
 #else
   vty_out(vty, "%7ld.%03ld %9d %8ld %9ld",
@@ -302,6 +358,38 @@ vty_out_cpu_thread_history(struct vty* vty,
 	  a->funcname, VTY_NEWLINE);
 }
 
+static void
+vty_out_cpu_thread_latency (struct vty *vty, struct cpu_thread_history *a)
+{
+  vty_out (vty, "%9lu %9lu %10lu",
+	   thread_hist_percentile (a->real_hist, a->total_calls,
+				   a->real.max, 500),
+	   thread_hist_percentile (a->real_hist, a->total_calls,
+				   a->real.max, 990),
+	   thread_hist_percentile (a->real_hist, a->total_calls,
+				   a->real.max, 999));
+  if (a->delay_calls)
+    vty_out (vty, " %8lu %9lu %9lu",
+	     a->delay.total / a->delay_calls,
+	     thread_hist_percentile (a->delay_hist, a->delay_calls,
+				     a->delay.max, 990),
+	     a->delay.max);
+  else
+    vty_out (vty, " %8s %9s %9s", "-", "-", "-");
+  vty_out (vty, "  %s%s", a->funcname, VTY_NEWLINE);
+}
+
+static void
+cpu_record_hash_latency (struct hash_backet *bucket, void *args[])
+{
+  struct vty *vty = args[1];
+  thread_type *filter = args[2];
+  struct cpu_thread_history *a = bucket->data;
+
+  if (a->types & *filter)
+    vty_out_cpu_thread_latency (vty, a);
+}
+
 static void
 cpu_record_hash_print(struct hash_backet *bucket, 
 		      void *args[])
@@ -310,6 +398,7 @@ cpu_record_hash_print(struct hash_backet *bucket,
   struct vty *vty = args[1];
   thread_type *filter = args[2];
   struct cpu_thread_history *a = bucket->data;
+  unsigned int i;
   
   a = bucket->data;
   if ( !(a->types & *filter) )
@@ -320,10 +409,20 @@ cpu_record_hash_print(struct hash_backet *bucket,
   if (totals->real.max < a->real.max)
     totals->real.max = a->real.max;
 #ifdef HAVE_RUSAGE
-  totals->cpu.total += a->cpu.total;
+  totals->cpu.total += thread_cpu_total (a);
+  totals->cpu_calls += a->total_calls;
   if (totals->cpu.max < a->cpu.max)
     totals->cpu.max = a->cpu.max;
 #endif
+  totals->delay_calls += a->delay_calls;
+  totals->delay.total += a->delay.total;
+  if (totals->delay.max < a->delay.max)
+    totals->delay.max = a->delay.max;
+  for (i = 0; i < THREAD_HIST_BUCKETS; i++)
+    {
+      totals->real_hist[i] += a->real_hist[i];
+      totals->delay_hist[i] += a->delay_hist[i];
+    }
 }
 
 static void
@@ -351,6 +450,23 @@ cpu_record_print(struct vty *vty, thread_type filter)
 
   if (tmp.total_calls > 0)
     vty_out_cpu_thread_history(vty, &tmp);
+
+#ifdef HAVE_RUSAGE
+  vty_out(vty, "%sCPU time is measured for 1 in %u calls of each task.%s",
+	  VTY_NEWLINE, thread_cpu_sample, VTY_NEWLINE);
+  if (thread_cpu_sample > 1)
+    vty_out(vty, "CPU Max uSecs is of the calls sampled; runtime and average "
+	    "are scaled up.%s", VTY_NEWLINE);
+#endif
+  vty_out(vty, "%s%30s %29s%s", VTY_NEWLINE,
+	  "Real (wall-clock):", "Delay from ready to run:", VTY_NEWLINE);
+  vty_out(vty, "%9s %9s %10s %8s %9s %9s  Thread%s", "p50 uSec", "p99 uSec",
+	  "p99.9 uSec", "Avg uSec", "p99 uSec", "Max uSecs", VTY_NEWLINE);
+  hash_iterate(cpu_record,
+	       (void(*)(struct hash_backet*,void*))cpu_record_hash_latency,
+	       args);
+  if (tmp.total_calls > 0)
+    vty_out_cpu_thread_latency (vty, &tmp);
 }
 
 DEFUN(show_thread_cpu,
@@ -495,6 +611,31 @@ DEFUN(clear_thread_cpu,
   cpu_record_clear (filter);
   return CMD_SUCCESS;
 }
+
+DEFUN (config_thread_cpu_sample,
+       thread_cpu_sample_cmd,
+       "thread cpu sample <1-65535>",
+       "Thread information\n"
+       "Thread CPU usage\n"
+       "Measure CPU time for one in so many calls of each task\n"
+       "Calls per measurement, 1 to measure every call\n")
+{
+  VTY_GET_INTEGER_RANGE ("sample", thread_cpu_sample, argv[0], 1, 65535);
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_config_thread_cpu_sample,
+       no_thread_cpu_sample_cmd,
+       "no thread cpu sample [<1-65535>]",
+       NO_STR
+       "Thread information\n"
+       "Thread CPU usage\n"
+       "Measure CPU time for one in so many calls of each task\n"
+       "Calls per measurement, 1 to measure every call\n")
+{
+  thread_cpu_sample = THREAD_CPU_SAMPLE_DEFAULT;
+  return CMD_SUCCESS;
+}
 
 /* List allocation and head/tail print out. */
 static void
@@ -784,10 +925,25 @@ funcname_thread_add_timer_timeval (struct thread_master *m,
   alarm_time.tv_usec = relative_time.tv_usec + time_relative->tv_usec;
   thread->u.sands = timeval_adjust(alarm_time);
 
-  /* Sort by timeval. */
-  for (tt = list->head; tt; tt = tt->next)
-    if (timeval_cmp (thread->u.sands, tt->u.sands) <= 0)
-      break;
+  /* Sort by timeval, ahead of any due at the same time.  Short timers
+     mostly go near the head and long ones near the tail, so look for the
+     place from the end due closer to the new one. */
+  if (list->head
+      && timeval_cmp (timeval_subtract (thread->u.sands, list->head->u.sands),
+                      timeval_subtract (list->tail->u.sands,
+                                        thread->u.sands)) < 0)
+    {
+      for (tt = list->head; tt; tt = tt->next)
+        if (timeval_cmp (thread->u.sands, tt->u.sands) <= 0)
+          break;
+    }
+  else
+    {
+      for (tt = list->tail; tt; tt = tt->prev)
+        if (timeval_cmp (thread->u.sands, tt->u.sands) > 0)
+          break;
+      tt = tt ? tt->next : list->head;
+    }
 
   if (tt)
     thread_list_add_before (list, tt, thread);
@@ -998,6 +1154,7 @@ thread_process_fd (struct thread_list *list, fd_set *fdset, fd_set *mfdset)
           thread_list_delete (list, thread);
           thread_list_add (&thread->master->ready, thread);
           thread->type = THREAD_READY;
+          thread->real = relative_time;
           ready++;
         }
     }
@@ -1019,6 +1176,7 @@ thread_timer_process (struct thread_list *list, struct timeval *timenow)
         return ready;
       thread_list_delete (list, thread);
       thread->type = THREAD_READY;
+      thread->real = thread->u.sands;
       thread_list_add (&thread->master->ready, thread);
       ready++;
     }
@@ -1038,6 +1196,7 @@ thread_process (struct thread_list *list)
       next = thread->next;
       thread_list_delete (list, thread);
       thread->type = THREAD_READY;
+      thread->real = relative_time;
       thread_list_add (&thread->master->ready, thread);
       ready++;
     }
@@ -1226,14 +1385,38 @@ thread_getrusage (RUSAGE_T *r)
 #endif /* HAVE_CLOCK_MONOTONIC */
 }
 
-/* We check thread consumed time. If the system has getrusage, we'll
-   use that to get in-depth stats on the performance of the thread in addition
-   to wall clock time stats from gettimeofday. */
+#ifdef HAVE_RUSAGE
+/* CPU time used by this thread of the process, where the system can
+   tell, so that the log writer and worker pools are not counted. */
+static unsigned long
+thread_cpu_time (void)
+{
+  struct rusage ru;
+
+#if defined HAVE_CLOCK_MONOTONIC && defined CLOCK_THREAD_CPUTIME_ID
+  struct timespec tp;
+
+  if (clock_gettime (CLOCK_THREAD_CPUTIME_ID, &tp) == 0)
+    return tp.tv_sec * TIMER_SECOND_MICRO + tp.tv_nsec / 1000;
+#endif
+  getrusage (RUSAGE_SELF, &ru);
+  return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * TIMER_SECOND_MICRO
+	 + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+#endif /* HAVE_RUSAGE */
+
+/* We check thread consumed time.  Wall clock time comes from the
+   monotonic clock, which costs no system call on most systems, and is
+   taken for every call.  If the system has getrusage, CPU time is taken
+   too, but only for one in thread_cpu_sample calls of each task, as it
+   costs a system call or two. */
 void
 thread_call (struct thread *thread)
 {
-  unsigned long realtime, cputime;
-  RUSAGE_T before, after;
+  unsigned long realtime, cputime = 0, delay;
+  struct timeval start;
+  struct cpu_thread_history *hist;
+  int sample = 0;
 
  /* Cache a pointer to the relevant cpu history thread, if the thread
   * does not have it yet.
@@ -1251,26 +1434,57 @@ thread_call (struct thread *thread)
       thread->hist = hash_get (cpu_record, &tmp, 
                     (void * (*) (void *))cpu_record_hash_alloc);
     }
+  hist = thread->hist;
 
-  GETRUSAGE (&before);
-  thread->real = before.real;
+#ifdef HAVE_RUSAGE
+  sample = (hist->total_calls % thread_cpu_sample == 0);
+  if (sample)
+    cputime = thread_cpu_time ();
+#endif /* HAVE_RUSAGE */
+  quagga_get_relative (&start);
+#ifdef HAVE_CLOCK_MONOTONIC
+  /* quagga_get_relative() only updates recent_time if gettimeofday
+   * based, and we guarantee to update it before threads are run.
+   */
+  quagga_gettimeofday (&recent_time);
+#endif /* HAVE_CLOCK_MONOTONIC */
 
-  (*thread->func) (thread);
+  /* thread->real is when the thread was made ready, unless it is run
+     directly. */
+  if (thread->add_type != THREAD_EXECUTE)
+    {
+      delay = (timeval_cmp (start, thread->real) > 0
+	       ? timeval_elapsed (start, thread->real) : 0);
+      hist->delay.total += delay;
+      if (hist->delay.max < delay)
+	hist->delay.max = delay;
+      hist->delay_hist[thread_hist_bucket (delay)]++;
+      hist->delay_calls++;
+    }
+  thread->real = start;
 
-  GETRUSAGE (&after);
+  (*thread->func) (thread);
 
-  realtime = thread_consumed_time (&after, &before, &cputime);
-  thread->hist->real.total += realtime;
-  if (thread->hist->real.max < realtime)
-    thread->hist->real.max = realtime;
+  quagga_get_relative (NULL);
+  realtime = timeval_elapsed (relative_time, start);
 #ifdef HAVE_RUSAGE
-  thread->hist->cpu.total += cputime;
-  if (thread->hist->cpu.max < cputime)
-    thread->hist->cpu.max = cputime;
-#endif
+  if (sample)
+    {
+      cputime = thread_cpu_time () - cputime;
+      hist->cpu.total += cputime;
+      if (hist->cpu.max < cputime)
+	hist->cpu.max = cputime;
+      hist->cpu_calls++;
+    }
+#endif /* HAVE_RUSAGE */
+
+  hist->real.total += realtime;
+  if (hist->real.max < realtime)
+    hist->real.max = realtime;
+  hist->real_hist[thread_hist_bucket (realtime)]++;
 
-  ++(thread->hist->total_calls);
-  thread->hist->types |= (1 << thread->add_type);
+  ++(hist->total_calls);
+  hist->types |= (1 << thread->add_type);
 
 #ifdef CONSUMED_TIME_CHECK
   if (realtime > CONSUMED_TIME_CHECK)
@@ -1280,10 +1494,16 @@ thread_call (struct thread *thread)
        * Whinge about it now, so we're aware this is yet another task
        * to fix.
        */
-      zlog_warn ("SLOW THREAD: task %s (%lx) ran for %lums (cpu time %lums)",
-		 thread->funcname,
-		 (unsigned long) thread->func,
-		 realtime/1000, cputime/1000);
+      if (sample)
+	zlog_warn ("SLOW THREAD: task %s (%lx) ran for %lums (cpu time %lums)",
+		   thread->funcname,
+		   (unsigned long) thread->func,
+		   realtime/1000, cputime/1000);
+      else
+	zlog_warn ("SLOW THREAD: task %s (%lx) ran for %lums",
+		   thread->funcname,
+		   (unsigned long) thread->func,
+		   realtime/1000);
     }
 #endif /* CONSUMED_TIME_CHECK */
 }
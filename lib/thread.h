@@ -80,11 +80,15 @@ struct thread
     int fd;			/* file descriptor in case of read/write. */
     struct timeval sands;	/* rest of time sands value. */
   } u;
-  struct timeval real;
+  struct timeval real;		/* when made ready, then when run */
   struct cpu_thread_history *hist; /* cache pointer to cpu_history */
   char funcname[FUNCNAME_LEN];
 };
 
+/* Latencies are counted in buckets of microseconds, four to each power
+   of two, up to 2^32. */
+#define THREAD_HIST_BUCKETS	128
+
 struct cpu_thread_history 
 {
   int (*func)(struct thread *);
@@ -95,11 +99,19 @@ struct cpu_thread_history
   } real;
 #ifdef HAVE_RUSAGE
   struct time_stats cpu;
+  unsigned int cpu_calls;	/* calls sampled for cpu */
 #endif
+  struct time_stats delay;	/* from ready to run */
+  unsigned int delay_calls;
+  unsigned int real_hist[THREAD_HIST_BUCKETS];
+  unsigned int delay_hist[THREAD_HIST_BUCKETS];
   thread_type types;
   char funcname[FUNCNAME_LEN];
 };
 
+/* CPU time is measured for one in so many calls of each task. */
+#define THREAD_CPU_SAMPLE_DEFAULT	16
+
 /* Clocks supported by Quagga */
 enum quagga_clkid {
   QUAGGA_CLK_REALTIME = 0,	/* ala gettimeofday() */
@@ -210,6 +222,9 @@ extern int thread_should_yield (struct thread *);
 extern void thread_getrusage (RUSAGE_T *);
 extern struct cmd_element show_thread_cpu_cmd;
 extern struct cmd_element clear_thread_cpu_cmd;
+extern struct cmd_element thread_cpu_sample_cmd;
+extern struct cmd_element no_thread_cpu_sample_cmd;
+extern unsigned int thread_cpu_sample;
 
 /* replacements for the system gettimeofday(), clock_gettime() and
  * time() functions, providing support for non-decrementing clock on
@@ -0,0 +1,339 @@
+/*
+ * Worker thread pools.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "memory.h"
+#include "log.h"
+#include "network.h"
+#include "ring.h"
+#include "worker.h"
+
+#if defined HAVE_PTHREAD && defined __ATOMIC_ACQUIRE
+#define WORKER_THREADS
+#include <pthread.h>
+#include <semaphore.h>
+#endif /* WORKER_THREADS */
+
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif /* HAVE_SYS_EVENTFD_H */
+
+/* Each worker takes jobs from a single-producer ring of its own, filled
+ * in turn by the event loop, and sleeps on a semaphore posted once per
+ * job.  Finished jobs go back on one multi-producer ring.  The first
+ * worker to finish a job after the event loop last looked writes to an
+ * eventfd, or a pipe where there is none, which thread_fetch () is
+ * watching; the others see the flag already set and leave it be.
+ *
+ * No more jobs are let in than the done ring has room for, so putting
+ * to it cannot fail.  Jobs are allocated and freed by the event loop
+ * only, as memory.c keeps its counts without locking.
+ */
+struct worker_job
+{
+  void (*work) (void *);
+  void (*done) (void *);
+  void *arg;
+};
+
+struct worker
+{
+  struct ring *jobs;
+#ifdef WORKER_THREADS
+  struct worker_pool *pool;
+  sem_t ready;
+  pthread_t thread;
+#endif /* WORKER_THREADS */
+};
+
+struct worker_pool
+{
+  struct thread_master *master;
+  struct thread *t_read;
+  struct ring *done;
+  int wake_fd[2];		/* the same eventfd twice, or a pipe */
+  int signalled;		/* a wakeup is on its way */
+  int stop;
+
+  unsigned int pending;
+  unsigned int limit;
+  unsigned int next;		/* worker to try first */
+  unsigned int running;		/* workers started, none runs jobs inline */
+  unsigned int nworkers;
+  struct worker *worker;
+};
+
+static int
+worker_exchange (int *flag, int value)
+{
+#ifdef WORKER_THREADS
+  return __atomic_exchange_n (flag, value, __ATOMIC_ACQ_REL);
+#else
+  int old = *flag;
+
+  *flag = value;
+  return old;
+#endif /* WORKER_THREADS */
+}
+
+static int
+worker_wake_open (int fd[2])
+{
+#ifdef HAVE_SYS_EVENTFD_H
+  fd[0] = fd[1] = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (fd[0] >= 0)
+    return 0;
+#endif /* HAVE_SYS_EVENTFD_H */
+  if (pipe (fd) < 0)
+    return -1;
+  set_nonblocking (fd[0]);
+  set_nonblocking (fd[1]);
+  fcntl (fd[0], F_SETFD, FD_CLOEXEC);
+  fcntl (fd[1], F_SETFD, FD_CLOEXEC);
+  return 0;
+}
+
+/* Called from any thread once a job is done. */
+static void
+worker_complete (struct worker_pool *pool, struct worker_job *job)
+{
+  u_int64_t one = 1;
+  int ret;
+
+  ret = ring_put (pool->done, job);
+  assert (ret == 0);
+
+  /* A full pipe is as good as a write. */
+  if (!worker_exchange (&pool->signalled, 1))
+    ret = write (pool->wake_fd[1], &one, sizeof (one));
+}
+
+static void
+worker_pool_drain (struct worker_pool *pool)
+{
+  struct worker_job *job;
+  char buf[64];
+
+  while (read (pool->wake_fd[0], buf, sizeof (buf)) > 0)
+    ;
+  /* Jobs finished from here on wake us again. */
+  worker_exchange (&pool->signalled, 0);
+
+  while ((job = ring_get (pool->done)) != NULL)
+    {
+      pool->pending--;
+      if (job->done)
+	job->done (job->arg);
+      XFREE (MTYPE_WORKER_JOB, job);
+    }
+}
+
+static int
+worker_pool_read (struct thread *thread)
+{
+  struct worker_pool *pool = THREAD_ARG (thread);
+
+  pool->t_read = NULL;
+  worker_pool_drain (pool);
+  pool->t_read = thread_add_read (pool->master, worker_pool_read, pool,
+				  pool->wake_fd[0]);
+  return 0;
+}
+
+#ifdef WORKER_THREADS
+static void *
+worker_run (void *arg)
+{
+  struct worker *worker = arg;
+  struct worker_job *job;
+
+  for (;;)
+    {
+      while (sem_wait (&worker->ready) < 0 && errno == EINTR)
+	;
+      job = ring_get (worker->jobs);
+      if (job == NULL)
+	{
+	  if (__atomic_load_n (&worker->pool->stop, __ATOMIC_ACQUIRE))
+	    break;
+	  continue;
+	}
+      job->work (job->arg);
+      worker_complete (worker->pool, job);
+    }
+  return NULL;
+}
+
+static void
+worker_pool_start (struct worker_pool *pool)
+{
+  struct worker *worker;
+  sigset_t all, old;
+  unsigned int i;
+  int ret;
+
+  /* Signals are for the event loop to handle, not the workers. */
+  sigfillset (&all);
+  pthread_sigmask (SIG_SETMASK, &all, &old);
+  for (i = 0; i < pool->nworkers; i++)
+    {
+      worker = &pool->worker[i];
+      worker->pool = pool;
+      sem_init (&worker->ready, 0, 0);
+      ret = pthread_create (&worker->thread, NULL, worker_run, worker);
+      if (ret != 0)
+	{
+	  zlog_warn ("worker pool: can't start thread %u: %s", i,
+		     safe_strerror (ret));
+	  sem_destroy (&worker->ready);
+	  break;
+	}
+      pool->running++;
+    }
+  pthread_sigmask (SIG_SETMASK, &old, NULL);
+}
+
+static void
+worker_pool_stop (struct worker_pool *pool)
+{
+  unsigned int i;
+
+  __atomic_store_n (&pool->stop, 1, __ATOMIC_RELEASE);
+  for (i = 0; i < pool->running; i++)
+    sem_post (&pool->worker[i].ready);
+  for (i = 0; i < pool->running; i++)
+    {
+      pthread_join (pool->worker[i].thread, NULL);
+      sem_destroy (&pool->worker[i].ready);
+    }
+  pool->running = 0;
+}
+#endif /* WORKER_THREADS */
+
+struct worker_pool *
+worker_pool_new (struct thread_master *master, unsigned int nthreads,
+		 unsigned int queue_size)
+{
+  struct worker_pool *pool;
+  unsigned int i;
+
+  pool = XCALLOC (MTYPE_WORKER_POOL, sizeof (struct worker_pool));
+  if (worker_wake_open (pool->wake_fd) < 0)
+    {
+      zlog_err ("worker pool: can't open wakeup descriptor: %s",
+		safe_strerror (errno));
+      XFREE (MTYPE_WORKER_POOL, pool);
+      return NULL;
+    }
+
+  pool->master = master;
+  pool->nworkers = nthreads ? nthreads : 1;
+  pool->worker = XCALLOC (MTYPE_WORKER_POOL,
+			  pool->nworkers * sizeof (struct worker));
+  for (i = 0; i < pool->nworkers; i++)
+    pool->worker[i].jobs = ring_new (queue_size, RING_SPSC);
+  pool->limit = pool->nworkers * ring_size (pool->worker[0].jobs);
+  pool->done = ring_new (pool->limit, RING_MPSC);
+
+#ifdef WORKER_THREADS
+  worker_pool_start (pool);
+#endif /* WORKER_THREADS */
+
+  pool->t_read = thread_add_read (master, worker_pool_read, pool,
+				  pool->wake_fd[0]);
+  return pool;
+}
+
+void
+worker_pool_free (struct worker_pool *pool)
+{
+  unsigned int i;
+
+#ifdef WORKER_THREADS
+  worker_pool_stop (pool);
+#endif /* WORKER_THREADS */
+  worker_pool_drain (pool);
+  assert (pool->pending == 0);
+
+  THREAD_READ_OFF (pool->t_read);
+  close (pool->wake_fd[0]);
+  if (pool->wake_fd[1] != pool->wake_fd[0])
+    close (pool->wake_fd[1]);
+
+  for (i = 0; i < pool->nworkers; i++)
+    ring_free (pool->worker[i].jobs);
+  ring_free (pool->done);
+  XFREE (MTYPE_WORKER_POOL, pool->worker);
+  XFREE (MTYPE_WORKER_POOL, pool);
+}
+
+int
+worker_pool_submit (struct worker_pool *pool, void (*work) (void *),
+		    void (*done) (void *), void *arg)
+{
+  struct worker_job *job;
+
+  if (pool->pending >= pool->limit)
+    return -1;
+
+  job = XMALLOC (MTYPE_WORKER_JOB, sizeof (struct worker_job));
+  job->work = work;
+  job->done = done;
+  job->arg = arg;
+
+  if (pool->running == 0)
+    {
+      pool->pending++;
+      work (arg);
+      worker_complete (pool, job);
+      return 0;
+    }
+
+#ifdef WORKER_THREADS
+  {
+    unsigned int i;
+
+    for (i = 0; i < pool->running; i++)
+      {
+	struct worker *worker = &pool->worker[pool->next];
+
+	pool->next = (pool->next + 1) % pool->running;
+	if (ring_put (worker->jobs, job) == 0)
+	  {
+	    pool->pending++;
+	    sem_post (&worker->ready);
+	    return 0;
+	  }
+      }
+  }
+#endif /* WORKER_THREADS */
+
+  XFREE (MTYPE_WORKER_JOB, job);
+  return -1;
+}
+
+unsigned int
+worker_pool_pending (struct worker_pool *pool)
+{
+  return pool->pending;
+}
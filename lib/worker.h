@@ -0,0 +1,60 @@
+/*
+ * Worker thread pools.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _QUAGGA_WORKER_H
+#define _QUAGGA_WORKER_H
+
+/* A worker pool runs jobs on threads of its own and hands each back to
+ * the thread_master it was made with once it is done.  The work
+ * function runs on a worker thread and must not touch daemon state,
+ * allocate through memory.c or log; the done function then runs from
+ * thread_fetch () like any other event, and may do all of those.
+ *
+ * Where POSIX threads are not available the work function runs at
+ * submission, and the done function still runs later from the event
+ * loop.
+ */
+struct worker_pool;
+
+/* Create a pool of nthreads workers, each with room for queue_size
+ * jobs waiting.  Returns NULL if there is no descriptor left to wake
+ * the event loop with.
+ */
+extern struct worker_pool *worker_pool_new (struct thread_master *,
+					    unsigned int nthreads,
+					    unsigned int queue_size);
+
+/* Wait for the jobs submitted to finish, run their done functions and
+ * destroy the pool.
+ */
+extern void worker_pool_free (struct worker_pool *);
+
+/* Queue a job, from the thread running the pool's thread_master.
+ * done may be NULL.  Returns -1 if the pool has no room for it.
+ */
+extern int worker_pool_submit (struct worker_pool *,
+			       void (*work) (void *),
+			       void (*done) (void *), void *arg);
+
+/* Jobs submitted whose done function has not run yet. */
+extern unsigned int worker_pool_pending (struct worker_pool *);
+
+#endif /* _QUAGGA_WORKER_H */
@@ -55,7 +55,7 @@ zclient_new ()
 
   zclient->ibuf = stream_new (ZEBRA_MAX_PACKET_SIZ);
   zclient->obuf = stream_new (ZEBRA_MAX_PACKET_SIZ);
-  zclient->wb = buffer_new(0);
+  zclient->wb = stream_chain_new();
 
   return zclient;
 }
@@ -73,7 +73,7 @@ zclient_free (struct zclient *zclient)
   if (zclient->obuf)
     stream_free(zclient->obuf);
   if (zclient->wb)
-    buffer_free(zclient->wb);
+    stream_chain_free(zclient->wb);
 
   XFREE (MTYPE_ZCLIENT, zclient);
 }
@@ -127,7 +127,7 @@ zclient_stop (struct zclient *zclient)
   stream_reset(zclient->obuf);
 
   /* Empty the write buffer. */
-  buffer_reset(zclient->wb);
+  stream_chain_reset(zclient->wb);
 
   /* Close socket. */
   if (zclient->sock >= 0)
@@ -251,10 +251,10 @@ zclient_flush_data(struct thread *thread)
   zclient->t_write = NULL;
   if (zclient->sock < 0)
     return -1;
-  switch (buffer_flush_available(zclient->wb, zclient->sock))
+  switch (stream_chain_flush(zclient->wb, zclient->sock))
     {
     case BUFFER_ERROR:
-      zlog_warn("%s: buffer_flush_available failed on zclient fd %d, closing",
+      zlog_warn("%s: stream_chain_flush failed on zclient fd %d, closing",
       		__func__, zclient->sock);
       return zclient_failed(zclient);
       break;
@@ -273,11 +273,11 @@ zclient_send_message(struct zclient *zclient)
 {
   if (zclient->sock < 0)
     return -1;
-  switch (buffer_write(zclient->wb, zclient->sock, STREAM_DATA(zclient->obuf),
-		       stream_get_endp(zclient->obuf)))
+  stream_set_getp(zclient->obuf, 0);
+  switch (stream_chain_write(zclient->wb, zclient->sock, zclient->obuf))
     {
     case BUFFER_ERROR:
-      zlog_warn("%s: buffer_write failed to zclient fd %d, closing",
+      zlog_warn("%s: stream_chain_write failed to zclient fd %d, closing",
       		 __func__, zclient->sock);
       return zclient_failed(zclient);
       break;
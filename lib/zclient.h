@@ -53,8 +53,8 @@ struct zclient
   /* Output buffer for zebra message. */
   struct stream *obuf;
 
-  /* Buffer of data waiting to be written to zebra. */
-  struct buffer *wb;
+  /* Messages waiting to be written to zebra. */
+  struct stream_chain *wb;
 
   /* Read and connect thread. */
   struct thread *t_read;
@@ -162,6 +162,7 @@ ospf6_area_create (u_int32_t area_id, struct ospf6 *o)
 
   oa->spf_table = OSPF6_ROUTE_TABLE_CREATE (AREA, SPF_RESULTS);
   oa->spf_table->scope = oa;
+  oa->reachable_routers = ospf6_spf_reachable_create ();
   oa->route_table = OSPF6_ROUTE_TABLE_CREATE (AREA, ROUTES);
   oa->route_table->scope = oa;
   oa->route_table->hook_add = ospf6_area_route_hook_add;
@@ -212,10 +213,13 @@ ospf6_area_delete (struct ospf6_area *oa)
 
   ospf6_spf_table_finish (oa->spf_table);
   ospf6_route_table_delete (oa->spf_table);
+  ospf6_spf_reachable_delete (oa->reachable_routers);
   ospf6_route_table_delete (oa->route_table);
 
   THREAD_OFF (oa->thread_spf_calculation);
   THREAD_OFF (oa->thread_route_calculation);
+  THREAD_OFF (oa->thread_ac_lsa);
+  THREAD_OFF (oa->thread_ac_commit);
 
   listnode_delete (oa->ospf6->area_list, oa);
   oa->ospf6 = NULL;
@@ -281,6 +285,9 @@ ospf6_area_show (struct vty *vty, struct ospf6_area *oa)
   vty_out (vty, " Area %s%s", oa->name, VNL);
   vty_out (vty, "     Number of Area scoped LSAs is %u%s",
            oa->lsdb->count, VNL);
+  vty_out (vty, "     AC-LSA requested %u times, %u fragments originated, "
+           "%u suppressed%s", oa->ac_lsa_schedule, oa->ac_lsa_origination,
+           oa->ac_lsa_suppressed, VNL);
 
   vty_out (vty, "     Interface attached to this area:");
   for (ALL_LIST_ELEMENTS_RO (oa->if_list, i, oi))
@@ -770,9 +777,30 @@ DEFUN (show_ipv6_ospf6_simulate_spf_tree_root,
   return CMD_SUCCESS;
 }
 
+/* Import and export lists are kept by pointer: resolve them again
+   whenever an access-list is added to or deleted */
+static void
+ospf6_area_access_list_update (struct access_list *access)
+{
+  struct ospf6_area *oa;
+  struct listnode *node;
+
+  if (ospf6 == NULL)
+    return;
+
+  for (ALL_LIST_ELEMENTS_RO (ospf6->area_list, node, oa))
+    {
+      IMPORT_LIST (oa) = access_list_lookup (AFI_IP6, IMPORT_NAME (oa));
+      EXPORT_LIST (oa) = access_list_lookup (AFI_IP6, EXPORT_NAME (oa));
+    }
+}
+
 void
 ospf6_area_init (void)
 {
+  access_list_add_hook (ospf6_area_access_list_update);
+  access_list_delete_hook (ospf6_area_access_list_update);
+
   install_element (VIEW_NODE, &show_ipv6_ospf6_spf_tree_cmd);
   install_element (VIEW_NODE, &show_ipv6_ospf6_area_spf_tree_cmd);
   install_element (VIEW_NODE, &show_ipv6_ospf6_simulate_spf_tree_root_cmd);
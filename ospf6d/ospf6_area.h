@@ -55,11 +55,23 @@ struct ospf6_area
   struct ospf6_route_table *spf_table;
   struct ospf6_route_table *route_table;
 
+  /* Router-IDs reached by the last SPF calculation, and whether there
+     has been one yet */
+  struct hash *reachable_routers;
+  u_char reachable_known;
+
   struct thread  *thread_spf_calculation;
   struct thread  *thread_route_calculation;
   u_int32_t spf_calculation;	/* SPF calculation count */
 	
   struct thread *thread_ac_lsa;
+  struct timeval ac_lsa_originated;	/* for the MinLSInterval check */
+  u_int32_t ac_lsa_schedule;		/* AC-LSA origination requests */
+  u_int32_t ac_lsa_origination;		/* AC-LSA fragments originated */
+  u_int32_t ac_lsa_suppressed;		/* ... found identical, not sent */
+
+  struct thread *thread_ac_commit;	/* pending and deprecated prefixes */
+  time_t ac_commit_due;
 
   struct thread *thread_router_lsa;
   struct thread *thread_intra_prefix_lsa;
@@ -1,5 +1,5 @@
-/*TODO: Remove (or change to debug) zlog_warns */
 #include <zebra.h>
+#include <dirent.h>
 
 #include "linklist.h"
 #include "thread.h"
@@ -8,6 +8,8 @@
 #include "command.h"
 #include "if.h"
 #include "md5.h"
+#include "jhash.h"
+#include "memory.h"
 
 #include "ospf6_top.h"
 #include "ospf6_zebra.h"
@@ -21,13 +23,259 @@
 #include "ospf6_lsa.h"
 #include "ospf6_proto.h"
 #include "ospf6_abr.h"
+#include "ospf6_spf.h"
 #include "ospf6d.h"
 
 #include "ospf6_auto.h"
+#include "ospf6_snapshot.h"
 
 /* Proto */
 static void create_ospf6_interface (char * name);
 static void ospf6_read_associated_prefixes_from_file (struct ospf6_interface *ifp);
+static int ospf6_auto_commit (struct thread *thread);
+struct ospf6_auto_state_record;
+static int ospf6_auto_state_commit (struct ospf6_auto_state_record *record,
+                                    unsigned int count);
+
+/* Instrumentation of the assignment algorithm: timings of its phases,
+ * counters of what it decided and a ring of the latest events, shown by
+ * "show ipv6 ospf6 auto-config statistics".  Events are also logged
+ * when "debug ospf6 auto-config" is on. */
+unsigned char conf_debug_ospf6_auto = 0;
+
+enum ospf6_auto_phase
+{
+  OSPF6_AUTO_PHASE_SNAPSHOT,
+  OSPF6_AUTO_PHASE_INACTIVE,
+  OSPF6_AUTO_PHASE_ULA,
+  OSPF6_AUTO_PHASE_PAIRS,
+  OSPF6_AUTO_PHASE_DELETION,
+  OSPF6_AUTO_PHASE_MAX,
+};
+
+static const char *ospf6_auto_phase_str[OSPF6_AUTO_PHASE_MAX] =
+  { "AC-LSDB snapshot", "Inactive neighbors", "ULA check",
+    "Prefix/if pairs", "Deletion" };
+
+enum ospf6_auto_event_type
+{
+  OSPF6_AUTO_EVENT_RUN,
+  OSPF6_AUTO_EVENT_ABORT,
+  OSPF6_AUTO_EVENT_ASSIGN,
+  OSPF6_AUTO_EVENT_ADOPT,
+  OSPF6_AUTO_EVENT_WITHDRAW,
+  OSPF6_AUTO_EVENT_REJECT,
+  OSPF6_AUTO_EVENT_DEPRECATE,
+  OSPF6_AUTO_EVENT_EXHAUST,
+  OSPF6_AUTO_EVENT_ULA_GENERATE,
+  OSPF6_AUTO_EVENT_ULA_TERMINATE,
+  OSPF6_AUTO_EVENT_ROUTER_ID,
+  OSPF6_AUTO_EVENT_MAX,
+};
+
+static const char *ospf6_auto_event_str[OSPF6_AUTO_EVENT_MAX] =
+  { "Run", "Aborted", "Assigned", "Adopted", "Withdrawn", "Rejected",
+    "Deprecated", "Exhausted", "ULA generated", "ULA terminated",
+    "Router-ID changed" };
+
+/* bucket i counts phases that took less than 2^i usec, the last one
+   those that took longer */
+#define OSPF6_AUTO_HISTOGRAM_BUCKETS  20
+#define OSPF6_AUTO_EVENT_RING         64
+
+struct ospf6_auto_phase_stat
+{
+  unsigned long count;
+  unsigned long long total;    /* usec */
+  unsigned long max;
+  unsigned long histogram[OSPF6_AUTO_HISTOGRAM_BUCKETS];
+};
+
+struct ospf6_auto_event
+{
+  struct timeval time;
+  enum ospf6_auto_event_type type;
+  struct prefix prefix;        /* AF_UNSPEC if none */
+  u_int32_t router_id;
+  unsigned int ifindex;
+};
+
+static struct
+{
+  unsigned long counter[OSPF6_AUTO_EVENT_MAX];
+  struct ospf6_auto_phase_stat phase[OSPF6_AUTO_PHASE_MAX];
+  struct ospf6_auto_event ring[OSPF6_AUTO_EVENT_RING];
+  unsigned long events;        /* ever recorded; next slot is modulo */
+} ac_stats;
+
+static void
+ospf6_auto_event (enum ospf6_auto_event_type type, struct prefix *prefix,
+                  u_int32_t router_id, struct ospf6_interface *oi)
+{
+  struct ospf6_auto_event *event;
+
+  event = &ac_stats.ring[ac_stats.events++ % OSPF6_AUTO_EVENT_RING];
+  ac_stats.counter[type]++;
+
+  event->time = recent_relative_time ();
+  event->type = type;
+  if (prefix)
+    event->prefix = *prefix;
+  else
+    event->prefix.family = AF_UNSPEC;
+  event->router_id = router_id;
+  event->ifindex = oi ? oi->interface->ifindex : 0;
+
+  if (IS_OSPF6_DEBUG_AUTO)
+    {
+      char prefix_str[64], router_id_str[16];
+
+      if (prefix)
+        prefix2str (prefix, prefix_str, sizeof (prefix_str));
+      else
+        prefix_str[0] = '\0';
+      inet_ntop (AF_INET, &router_id, router_id_str, sizeof (router_id_str));
+      zlog_debug ("Autoconf: %s %s%sby %s%s%s",
+                  ospf6_auto_event_str[type], prefix_str,
+                  prefix ? " " : "", router_id_str,
+                  oi ? " on " : "", oi ? oi->interface->name : "");
+    }
+}
+
+/* Accounts the time since *start to the phase and restarts the clock */
+static void
+ospf6_auto_phase_done (enum ospf6_auto_phase phase, struct timeval *start)
+{
+  struct ospf6_auto_phase_stat *stat = &ac_stats.phase[phase];
+  struct timeval now;
+  unsigned long usec;
+  int bucket;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+  usec = (now.tv_sec - start->tv_sec) * 1000000UL
+         + now.tv_usec - start->tv_usec;
+  *start = now;
+
+  stat->count++;
+  stat->total += usec;
+  if (usec > stat->max)
+    stat->max = usec;
+  for (bucket = 0; bucket < OSPF6_AUTO_HISTOGRAM_BUCKETS - 1; bucket++)
+    if (usec < (1UL << bucket))
+      break;
+  stat->histogram[bucket]++;
+}
+
+DEFUN (show_ipv6_ospf6_auto_config_statistics,
+       show_ipv6_ospf6_auto_config_statistics_cmd,
+       "show ipv6 ospf6 auto-config statistics",
+       SHOW_STR
+       IP6_STR
+       OSPF6_STR
+       "Prefix autoconfiguration\n"
+       "Timings, counters and recent events\n")
+{
+  struct ospf6_auto_phase_stat *stat;
+  struct ospf6_auto_event *event;
+  struct timeval now;
+  unsigned long i, first;
+  int type, phase, bucket;
+
+  vty_out (vty, "Counters:%s", VNL);
+  for (type = 0; type < OSPF6_AUTO_EVENT_MAX; type++)
+    vty_out (vty, " %-18s %lu%s", ospf6_auto_event_str[type],
+             ac_stats.counter[type], VNL);
+
+  vty_out (vty, "%s%-19s %8s %8s %8s  %s%s", VNL, "Phase", "Runs",
+           "Avg(us)", "Max(us)", "Histogram (<usec:runs)", VNL);
+  for (phase = 0; phase < OSPF6_AUTO_PHASE_MAX; phase++)
+    {
+      stat = &ac_stats.phase[phase];
+      vty_out (vty, " %-18s %8lu %8llu %8lu ", ospf6_auto_phase_str[phase],
+               stat->count, stat->count ? stat->total / stat->count : 0,
+               stat->max);
+      for (bucket = 0; bucket < OSPF6_AUTO_HISTOGRAM_BUCKETS; bucket++)
+        if (stat->histogram[bucket])
+          {
+            if (bucket < OSPF6_AUTO_HISTOGRAM_BUCKETS - 1)
+              vty_out (vty, " %lu:%lu", 1UL << bucket,
+                       stat->histogram[bucket]);
+            else
+              vty_out (vty, " more:%lu", stat->histogram[bucket]);
+          }
+      vty_out (vty, "%s", VNL);
+    }
+
+  vty_out (vty, "%sRecent events, newest first:%s", VNL, VNL);
+  now = recent_relative_time ();
+  first = ac_stats.events > OSPF6_AUTO_EVENT_RING ?
+          ac_stats.events - OSPF6_AUTO_EVENT_RING : 0;
+  for (i = ac_stats.events; i > first; i--)
+    {
+      char prefix_str[64], router_id_str[16], duration[16];
+      struct timeval ago;
+      struct interface *ifp;
+
+      event = &ac_stats.ring[(i - 1) % OSPF6_AUTO_EVENT_RING];
+      timersub (&now, &event->time, &ago);
+      timerstring (&ago, duration, sizeof (duration));
+      if (event->prefix.family != AF_UNSPEC)
+        prefix2str (&event->prefix, prefix_str, sizeof (prefix_str));
+      else
+        strcpy (prefix_str, "-");
+      inet_ntop (AF_INET, &event->router_id, router_id_str,
+                 sizeof (router_id_str));
+      ifp = event->ifindex ? if_lookup_by_index (event->ifindex) : NULL;
+
+      vty_out (vty, " %8s ago %-17s %-24s %-15s %s%s", duration,
+               ospf6_auto_event_str[event->type], prefix_str, router_id_str,
+               ifp ? ifp->name : "", VNL);
+    }
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (debug_ospf6_auto_config,
+       debug_ospf6_auto_config_cmd,
+       "debug ospf6 auto-config",
+       DEBUG_STR
+       OSPF6_STR
+       "Debug prefix autoconfiguration\n"
+      )
+{
+  OSPF6_DEBUG_AUTO_ON ();
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_debug_ospf6_auto_config,
+       no_debug_ospf6_auto_config_cmd,
+       "no debug ospf6 auto-config",
+       NO_STR
+       DEBUG_STR
+       OSPF6_STR
+       "Debug prefix autoconfiguration\n"
+      )
+{
+  OSPF6_DEBUG_AUTO_OFF ();
+  return CMD_SUCCESS;
+}
+
+int
+config_write_ospf6_debug_auto (struct vty *vty)
+{
+  if (IS_OSPF6_DEBUG_AUTO)
+    vty_out (vty, "debug ospf6 auto-config%s", VNL);
+  return 0;
+}
+
+void
+install_element_ospf6_debug_auto (void)
+{
+  install_element (ENABLE_NODE, &debug_ospf6_auto_config_cmd);
+  install_element (ENABLE_NODE, &no_debug_ospf6_auto_config_cmd);
+  install_element (CONFIG_NODE, &debug_ospf6_auto_config_cmd);
+  install_element (CONFIG_NODE, &no_debug_ospf6_auto_config_cmd);
+}
 
 /* Convert a transmission order MAC address to storage order */
 static u_int64_t
@@ -99,11 +347,18 @@ ospf6_generate_router_hardware_fingerprint (void)
   return fingerprint;
 }
 
-/* Initialises the rid seed to the router-hardware fingerprint */
+/* Initialises the rid seed to the router-hardware fingerprint.  rand_r ()
+   only reads its first word, which holds no more than the vendor part of
+   the first MAC, so a hash of the whole fingerprint goes there: routers
+   of one vendor would otherwise all draw the same Router-IDs. */
 void 
 ospf6_init_seed (void)
 {
+  u_int32_t seed;
+
   ospf6->rid_seed = ospf6_generate_router_hardware_fingerprint ();
+  seed = jhash (&ospf6->rid_seed, sizeof (ospf6->rid_seed), 0);
+  memcpy (&ospf6->rid_seed, &seed, sizeof (seed));
 }
 
 /* Generates a _new_ router id */
@@ -121,6 +376,10 @@ ospf6_set_router_id (u_int32_t rid)
   struct ospf6_router_hardware_fingerprint old_seed;
   memset (&old_seed, 0, sizeof (old_seed));
 
+  /* Keep the LSDB for the restart */
+  ospf6_snapshot_save ();
+  ospf6_snapshot_stop ();
+
   /* Remove all timers */
   struct thread *t = master->timer.head;
   for (int i = 0; i < master->timer.count; i++)
@@ -206,8 +465,9 @@ create_ospf6_interface (char * name)
   ospf6_read_associated_prefixes_from_file (oi);
 }
 
-/* Ensure router id is not a duplicate */
-void 
+/* Ensure router id is not a duplicate.  Returns 1 if the router was
+ * restarted with a new router id, which frees every ospf6_interface */
+int 
 ospf6_check_router_id (struct ospf6_header *oh,	
     struct in6_addr src, struct in6_addr dst)
 {
@@ -218,7 +478,7 @@ ospf6_check_router_id (struct ospf6_header *oh,
 
     /* Self originated */
     if (IPV6_ADDR_SAME (&src, &dst))
-      return;
+      return 0;
 
     /* Check all IP Addresses associated with this router*/
     for (ALL_LIST_ELEMENTS (ospf6->area_list, node, nnode, area))
@@ -233,7 +493,7 @@ ospf6_check_router_id (struct ospf6_header *oh,
         { 
           if (IPV6_ADDR_SAME (&src, inf->linklocal_addr))
 	  {
-	    return;
+	    return 0;
 	  }
 	}
       }
@@ -242,10 +502,14 @@ ospf6_check_router_id (struct ospf6_header *oh,
     /* If link local address was smaller */
     if (IPV6_ADDR_CMP (&dst, &src) < 0)
     {
-      zlog_warn ("Changing router-id");
+      ospf6_auto_event (OSPF6_AUTO_EVENT_ROUTER_ID, NULL, oh->router_id,
+                        NULL);
       ospf6_set_router_id (ospf6_generate_router_id ());
+      return 1;
     }
   }
+
+  return 0;
 }
 
 /* Ensure a self originated lsa is from self */
@@ -257,7 +521,8 @@ ospf6_check_hw_fingerprint (struct ospf6_lsa_header *lsa_header)
   /* Check it is an AC LSA */
   if (lsa_header->type != ntohs(OSPF6_LSTYPE_AC)) return 0;
 
-  /* Check it has an LS-ID of 0 */
+  /* Only the first fragment (LS-ID 0) carries the fingerprint; the
+     other fragments are checked through it */
   if (lsa_header->id != 0) return 0;
 
   /* First TLV */
@@ -270,11 +535,11 @@ ospf6_check_hw_fingerprint (struct ospf6_lsa_header *lsa_header)
 
   current = start;
 
-  while (current < end)
+  while (current + sizeof (struct ospf6_ac_tlv_header) <= end)
   {
     struct ospf6_ac_tlv_header *ac_tlv_header;
     ac_tlv_header = (struct ospf6_ac_tlv_header *) current;
-    if (ac_tlv_header->type == OSPF6_AC_TLV_ROUTER_HARDWARE_FINGERPRINT) 
+    if (ac_tlv_header->type == htons (OSPF6_AC_TLV_ROUTER_HARDWARE_FINGERPRINT))
     {
       struct ospf6_router_hardware_fingerprint fingerprint;
       struct ospf6_ac_tlv_router_hardware_fingerprint *ac_tlv_rhfp;
@@ -284,7 +549,7 @@ ospf6_check_hw_fingerprint (struct ospf6_lsa_header *lsa_header)
 	(struct ospf6_ac_tlv_router_hardware_fingerprint *) ac_tlv_header;
 
       /* Check fingerprints, check length first since its variable */
-      if (ac_tlv_header->length == 64
+      if (ntohs (ac_tlv_header->length) == OSPF6_AC_TLV_RHWFP_LENGTH
 	  && R_HW_FP_CMP (&ac_tlv_rhfp->value, &fingerprint) == 0)
       {
 	/* Matching fingerprints implies true self origination*/
@@ -293,26 +558,29 @@ ospf6_check_hw_fingerprint (struct ospf6_lsa_header *lsa_header)
       else 
       {
 	/* If their fingerprint is smaller */
-	if (ac_tlv_header->length <= 64 
+	if (ntohs (ac_tlv_header->length) <= OSPF6_AC_TLV_RHWFP_LENGTH
 	    && R_HW_FP_CMP (&ac_tlv_rhfp->value, &fingerprint) < 0)
 	{
-	  zlog_warn ("Other router must change Router-ID");
+	  if (IS_OSPF6_DEBUG_AUTO)
+	    zlog_debug ("Other router must change Router-ID");
 	  return 0;
 	}
 
+	ospf6_auto_event (OSPF6_AUTO_EVENT_ROUTER_ID, NULL,
+	                  lsa_header->adv_router, NULL);
 	ospf6_set_router_id (ospf6_generate_router_id ());
 
 	return 1;
       }
     }
     /* Step */
-    current = (char *) ac_tlv_header 
-      + sizeof (ac_tlv_header) 
-      + ntohs (ac_tlv_header->length);
+    current += sizeof (struct ospf6_ac_tlv_header)
+      + ((ntohs (ac_tlv_header->length) + 4 - 1) / 4) * 4;
   }
 
   /* There must have been a problem */
-  zlog_warn ("No rhwfp tlv found");
+  if (IS_OSPF6_DEBUG_AUTO)
+    zlog_debug ("No rhwfp tlv found");
   return 1;
 }
 
@@ -355,7 +623,8 @@ DEFUN (ipv6_allocate_prefix,
 
   listnode_add (ospf6->aggregated_prefix_list, aggregated_prefix); 
 
-  zlog_warn ("Allocating %s", argv[0]);
+  if (IS_OSPF6_DEBUG_AUTO)
+    zlog_debug ("Allocating %s", argv[0]);
 
   originate_new_ac_lsa ();
 
@@ -384,7 +653,8 @@ DEFUN (no_ipv6_allocate_prefix,
     }
   }
 
-  zlog_warn ("Deallocating %s", argv[0]);
+  if (IS_OSPF6_DEBUG_AUTO)
+    zlog_debug ("Deallocating %s", argv[0]);
 
   originate_new_ac_lsa ();
 
@@ -606,8 +876,8 @@ handle_assigned_prefix_tlv (char *current, struct ospf6_lsa *current_lsa)
 
   as_prefix->interface = NULL;
 
-  as_prefix->pending_thread = NULL;
-  as_prefix->deprecation_thread = NULL;
+  as_prefix->pending_due = 0;
+  as_prefix->deprecation_due = 0;
 
   apply_mask (&as_prefix->prefix);
 
@@ -618,28 +888,33 @@ static void
 create_ac_lsdb_snapshot (struct ospf6_lsdb *lsdb, 
     struct list **assigned_prefix_list, 
     struct list **aggregated_prefix_list,
-    struct list **reachable_rid_list)
+    u_int32_t *highest_rid)
 {
   struct ospf6_lsa *current_lsa;
 
   *assigned_prefix_list = list_new ();
   *aggregated_prefix_list = list_new ();
-  *reachable_rid_list = list_new ();
+  *highest_rid = 0;
 
   current_lsa = ospf6_lsdb_type_head (htons (OSPF6_LSTYPE_AC), lsdb);
 
-  zlog_warn("snapping");
-  
   while (current_lsa != NULL) 
   {
     struct ospf6_ac_lsa * ac_lsa;
     char *start, *end, *current;
-    u_int32_t *rid;
 
 
     if (!current_lsa->reachable) 
     {
-      zlog_warn("NOT REACHABLE");
+      if (IS_OSPF6_DEBUG_AUTO)
+        zlog_debug ("Not reachable: %s", current_lsa->name);
+      current_lsa = ospf6_lsdb_type_next (htons (OSPF6_LSTYPE_AC), current_lsa);
+      continue;
+    }
+
+    /* Flushed fragment */
+    if (OSPF6_LSA_IS_MAXAGE (current_lsa))
+    {
       current_lsa = ospf6_lsdb_type_next (htons (OSPF6_LSTYPE_AC), current_lsa);
       continue;
     }
@@ -648,9 +923,8 @@ create_ac_lsdb_snapshot (struct ospf6_lsdb *lsdb,
     ac_lsa = (struct ospf6_ac_lsa *)
       ((char *) current_lsa->header + sizeof (struct ospf6_lsa_header));
 
-    rid = malloc (sizeof (u_int32_t));
-    *rid = current_lsa->header->adv_router;
-    listnode_add (*reachable_rid_list, rid);
+    if (current_lsa->header->adv_router > *highest_rid)
+      *highest_rid = current_lsa->header->adv_router;
 
     /* Start and end of all TLVs */
     start = (char *) ac_lsa + sizeof (struct ospf6_ac_lsa);
@@ -661,12 +935,9 @@ create_ac_lsdb_snapshot (struct ospf6_lsdb *lsdb,
     {
       struct ospf6_ac_tlv_header *ac_tlv_header = 
 	(struct ospf6_ac_tlv_header *) current;
-	
-	zlog_warn("LSA");
 
       if (ac_tlv_header->type == htons(OSPF6_AC_TLV_AGGREGATED_PREFIX))
       {
-	zlog_warn("Agg");
 	struct ospf6_aggregated_prefix *ag_prefix;
 	ag_prefix = handle_aggregated_prefix_tlv (current, current_lsa);
 	listnode_add (*aggregated_prefix_list, ag_prefix);
@@ -684,6 +955,22 @@ create_ac_lsdb_snapshot (struct ospf6_lsdb *lsdb,
   }
 }
 
+/* Frees an AC-LSDB snapshot's assigned prefixes, but for those an
+   interface has taken up */
+static void
+free_ac_lsdb_snapshot (struct list *assigned_prefix_list)
+{
+  struct listnode *node, *nnode;
+  struct ospf6_assigned_prefix *ap;
+
+  for (ALL_LIST_ELEMENTS (assigned_prefix_list, node, nnode, ap))
+  {
+    if (ap->interface == NULL)
+      free (ap);
+  }
+  list_delete (assigned_prefix_list);
+}
+
 static struct list *
 generate_active_neighbor_list (const struct list *neighbor_list)
 {
@@ -695,7 +982,11 @@ generate_active_neighbor_list (const struct list *neighbor_list)
 
   for (ALL_LIST_ELEMENTS (neighbor_list, node, nnode, neighbor))
   {
-    if (neighbor->state > OSPF6_NEIGHBOR_INIT)
+    /* One with our own Router-ID is what is left of a conflict we won,
+       until it times out: following it would take up our own assignment
+       of another interface */
+    if (neighbor->state > OSPF6_NEIGHBOR_INIT
+        && neighbor->router_id != ospf6->router_id)
     {
       listnode_add (active_neigbor_list, neighbor);
     }
@@ -919,99 +1210,376 @@ choose_first_unassigned_prefix (struct ospf6_aggregated_prefix *agp,
   return NULL;
 }
 
-static void 
-ospf6_write_associated_prefixes_to_file (struct ospf6_interface *ifp)
+/* Autoconfiguration state kept across restarts: the ULA and, for every
+ * interface, its most recently associated prefixes.  All of it lives in
+ * one binary file which is rewritten as a whole into a temporary file,
+ * synced and renamed over the old one, so that a crash leaves either
+ * the old or the new state.  The file is read once, at the first lookup,
+ * and records of interfaces not currently present are carried over into
+ * later writes.  Everything is in network byte order. */
+#define OSPF6_AUTO_STATE_FILE     "ospf6d_state"
+#define OSPF6_AUTO_STATE_MAGIC    0x4f364153  /* "O6AS" */
+#define OSPF6_AUTO_STATE_VERSION  1
+#define OSPF6_AUTO_STATE_ULA      1
+#define OSPF6_AUTO_STATE_PREFIX   2
+
+/* files in SYSCONFDIR that held the same state before */
+#define OSPF6_AUTO_LEGACY_ULA      "ospf6d_ula"
+#define OSPF6_AUTO_LEGACY_PREFIXES "_prefixes"
+
+/* seconds before writing our own assignments, and those of others */
+#define OSPF6_AUTO_STATE_WRITE_OWN     5
+#define OSPF6_AUTO_STATE_WRITE_OTHER   (60 * 10)
+
+struct ospf6_auto_state_header
+{
+  u_int32_t magic;
+  u_int16_t version;
+  u_int16_t count;
+  u_int32_t checksum;          /* jhash over the records */
+};
+
+struct ospf6_auto_state_record
+{
+  u_char type;
+  u_char prefixlen;
+  u_char reserved[2];
+  char ifname[INTERFACE_NAMSIZ];
+  struct in6_addr prefix;
+};
+
+static struct
+{
+  int loaded;
+  unsigned int count;
+  struct ospf6_auto_state_record *record;
+  struct thread *writer;
+} state;
+
+static void
+ospf6_auto_state_path (char *buf, size_t size, const char *suffix)
 {
-  struct listnode *node, *nnode;
-  struct prefix *prefix;
-  FILE *file_pointer;
-  char filepath[100];
+  snprintf (buf, size, "%s%s%s", SYSCONFDIR, OSPF6_AUTO_STATE_FILE, suffix);
+}
 
-  snprintf (filepath, sizeof (filepath), "%s%s%s", SYSCONFDIR, ifp->interface->name, "_prefixes");
+/* Takes the state from the text files kept before there was a state
+ * file: one ospf6d_ula with the ULA, and one <ifname>_prefixes for each
+ * interface with a prefix a line, most recent first.  The state file
+ * written from them is what is read from then on. */
+static void
+ospf6_auto_state_migrate (void)
+{
+  struct ospf6_auto_state_record *record = NULL;
+  unsigned int count = 0, size = 0;
+  size_t len, suffix = strlen (OSPF6_AUTO_LEGACY_PREFIXES);
+  char filepath[MAXPATHLEN], linebuf[64];
+  struct dirent *entry;
+  struct prefix prefix;
+  FILE *file_pointer;
+  DIR *dir;
+  int ula;
 
-  file_pointer = fopen (filepath, "w");
+  if ((dir = opendir (SYSCONFDIR)) == NULL)
+    return;
 
-  if (file_pointer != NULL) 
+  while ((entry = readdir (dir)) != NULL)
   {
-    for (ALL_LIST_ELEMENTS (ifp->associated_prefixes, node, nnode, prefix))
+    len = strlen (entry->d_name);
+    ula = (strcmp (entry->d_name, OSPF6_AUTO_LEGACY_ULA) == 0);
+    if (! ula &&
+        (len <= suffix || len - suffix >= INTERFACE_NAMSIZ ||
+         strcmp (entry->d_name + len - suffix,
+                 OSPF6_AUTO_LEGACY_PREFIXES) != 0))
+      continue;
+
+    snprintf (filepath, sizeof (filepath), "%s%s", SYSCONFDIR,
+              entry->d_name);
+    if ((file_pointer = fopen (filepath, "r")) == NULL)
+      continue;
+
+    while (fgets (linebuf, sizeof (linebuf), file_pointer) != NULL)
     {
-      char buf[64];
-      prefix2str (prefix, buf, 64);
-      fprintf (file_pointer, "%s\n", buf);
+      linebuf[strcspn (linebuf, "\n")] = '\0';
+      if (str2prefix (linebuf, &prefix) <= 0 || prefix.family != AF_INET6)
+        continue;
+
+      if (count == size)
+      {
+        size = size ? size * 2 : 16;
+        record = XREALLOC (MTYPE_OSPF6_OTHER, record,
+                           size * sizeof (*record));
+      }
+      memset (&record[count], 0, sizeof (*record));
+      if (ula)
+      {
+        record[count].type = OSPF6_AUTO_STATE_ULA;
+        record[count].prefixlen = 48;
+      }
+      else
+      {
+        record[count].type = OSPF6_AUTO_STATE_PREFIX;
+        record[count].prefixlen = prefix.prefixlen;
+        memcpy (record[count].ifname, entry->d_name, len - suffix);
+      }
+      record[count].prefix = prefix.u.prefix6;
+      count++;
+
+      /* only the first line ever held the ULA */
+      if (ula)
+        break;
     }
     fclose (file_pointer);
   }
+  closedir (dir);
+
+  if (count == 0)
+    return;
+
+  zlog_info ("Taking %u autoconf state records from the old files in %s",
+             count, SYSCONFDIR);
+  state.record = record;
+  state.count = count;
+  ospf6_auto_state_commit (record, count);
 }
 
-static void 
-ospf6_read_associated_prefixes_from_file (struct ospf6_interface *ifp)
+/* Reads the state file in one go, dropping it if it is damaged.  When
+ * there is none yet, the old state files are read instead. */
+static void
+ospf6_auto_state_load (void)
 {
+  struct ospf6_auto_state_header header;
+  char filepath[100];
   FILE *file_pointer;
-  char filepath[100], linebuf[100];
+  size_t len;
 
-  list_delete (ifp->associated_prefixes);
-  ifp->associated_prefixes = list_new ();
-
-  snprintf (filepath, sizeof (filepath), "%s%s%s", SYSCONFDIR, ifp->interface->name, "_prefixes");
+  if (state.loaded)
+    return;
+  state.loaded = 1;
 
+  ospf6_auto_state_path (filepath, sizeof (filepath), "");
   file_pointer = fopen (filepath, "r");
-
-  if (file_pointer != NULL)
+  if (file_pointer == NULL)
   {
-    /* XXX: Does this break portability */
-    while (fgets ((char * restrict) &linebuf, 50, file_pointer) != NULL)
-    {
-      struct prefix *prefix;
-      size_t ln = strlen(linebuf) - 1;
-      if (linebuf[ln] == '\n') linebuf[ln] = '\0';
+    if (errno == ENOENT)
+      ospf6_auto_state_migrate ();
+    return;
+  }
 
-      prefix = prefix_new ();
-      str2prefix (linebuf, prefix);
+  if (fread (&header, sizeof (header), 1, file_pointer) != 1 ||
+      ntohl (header.magic) != OSPF6_AUTO_STATE_MAGIC ||
+      ntohs (header.version) != OSPF6_AUTO_STATE_VERSION)
+  {
+    zlog_warn ("Ignoring unknown autoconf state in %s", filepath);
+    fclose (file_pointer);
+    return;
+  }
 
-      listnode_add (ifp->associated_prefixes, prefix);
-    }
+  len = ntohs (header.count) * sizeof (struct ospf6_auto_state_record);
+  state.record = XCALLOC (MTYPE_OSPF6_OTHER, len + 1);
+  if (fread (state.record, 1, len + 1, file_pointer) != len ||
+      jhash (state.record, len, 0) != ntohl (header.checksum))
+  {
+    zlog_warn ("Ignoring damaged autoconf state in %s", filepath);
+    XFREE (MTYPE_OSPF6_OTHER, state.record);
     fclose (file_pointer);
+    return;
   }
+  state.count = ntohs (header.count);
+  fclose (file_pointer);
 }
 
 static int
-ospf6_associated_prefix_writer (struct thread *thread)
+ospf6_auto_state_commit (struct ospf6_auto_state_record *record,
+                         unsigned int count)
 {
-  struct ospf6_interface *oi;
-  oi = (struct ospf6_interface *) THREAD_ARG (thread);
+  struct ospf6_auto_state_header header;
+  char filepath[100], temppath[100];
+  FILE *file_pointer;
+  size_t len;
+  int fd, ok;
 
-  assert (oi);
+  ospf6_auto_state_path (filepath, sizeof (filepath), "");
+  ospf6_auto_state_path (temppath, sizeof (temppath), ".new");
+
+  if (count > 0xffff)
+  {
+    zlog_warn ("Can't write %u autoconf state records to %s", count,
+               filepath);
+    return -1;
+  }
+
+  len = count * sizeof (struct ospf6_auto_state_record);
+  header.magic = htonl (OSPF6_AUTO_STATE_MAGIC);
+  header.version = htons (OSPF6_AUTO_STATE_VERSION);
+  header.count = htons (count);
+  header.checksum = htonl (jhash (record, len, 0));
 
-  ospf6_write_associated_prefixes_to_file (oi);
+  file_pointer = fopen (temppath, "w");
+  if (file_pointer == NULL)
+  {
+    zlog_warn ("Can't write autoconf state to %s: %s", temppath,
+               safe_strerror (errno));
+    return -1;
+  }
+
+  ok = (fwrite (&header, sizeof (header), 1, file_pointer) == 1
+        && fwrite (record, 1, len, file_pointer) == len
+        && fflush (file_pointer) == 0
+        && fsync (fileno (file_pointer)) == 0);
+  if (fclose (file_pointer) != 0)
+    ok = 0;
+  if (! ok || rename (temppath, filepath) < 0)
+  {
+    zlog_warn ("Can't write autoconf state to %s: %s", filepath,
+               safe_strerror (errno));
+    unlink (temppath);
+    return -1;
+  }
 
-  oi->associated_prefixes_writer = NULL;
+  /* make the rename itself durable */
+  if ((fd = open (SYSCONFDIR, O_RDONLY)) >= 0)
+  {
+    fsync (fd);
+    close (fd);
+  }
   return 0;
 }
 
-static void 
-schedule_writing (struct ospf6_assigned_prefix *assigned_prefix,
-    struct ospf6_interface *ifp)
+/* Writes the ULA given, or else the one on record, together with the
+ * associated prefixes of all interfaces */
+static void
+ospf6_auto_state_write (struct in6_addr *ula)
 {
-  if (assigned_prefix->assigning_router_id == ospf6->router_id)
+  struct ospf6_auto_state_record *record;
+  struct listnode *node, *pnode;
+  struct interface *ifp;
+  struct ospf6_interface *oi;
+  struct prefix *prefix;
+  unsigned int count, i;
+
+  ospf6_auto_state_load ();
+  THREAD_OFF (state.writer);
+
+  count = 1;
+  for (ALL_LIST_ELEMENTS_RO (iflist, node, ifp))
+    if ((oi = ifp->info) != NULL)
+      count += listcount (oi->associated_prefixes);
+  record = XCALLOC (MTYPE_OSPF6_OTHER,
+                    (count + state.count) * sizeof (*record));
+
+  count = 0;
+  for (i = 0; i < state.count; i++)
   {
-    /* Write AQ to file */
-    /* Cancel any timers to write */
-    THREAD_OFF(ifp->associated_prefixes_writer);
-    ifp->associated_prefixes_writer = 
-      thread_add_timer (master, ospf6_associated_prefix_writer, 
-	  ifp, 5);
+    if (state.record[i].type == OSPF6_AUTO_STATE_ULA)
+    {
+      if (ula == NULL)
+        record[count++] = state.record[i];
+      continue;
+    }
+    ifp = if_lookup_by_name_len (state.record[i].ifname,
+                                 strnlen (state.record[i].ifname,
+                                          INTERFACE_NAMSIZ));
+    if (ifp == NULL || ifp->info == NULL)
+      record[count++] = state.record[i];
   }
-  else 
+
+  if (ula)
   {
-    /* Schedule writing to file in 10 mins
-     * (Don't touch existing timer) */
-    if (ifp->associated_prefixes_writer == NULL)
+    record[count].type = OSPF6_AUTO_STATE_ULA;
+    record[count].prefixlen = 48;
+    record[count].prefix = *ula;
+    count++;
+  }
+
+  for (ALL_LIST_ELEMENTS_RO (iflist, node, ifp))
+  {
+    if ((oi = ifp->info) == NULL)
+      continue;
+    for (ALL_LIST_ELEMENTS_RO (oi->associated_prefixes, pnode, prefix))
     {
-      ifp->associated_prefixes_writer = 
-	thread_add_timer (master, ospf6_associated_prefix_writer, 
-	    ifp, 60 * 10);
+      record[count].type = OSPF6_AUTO_STATE_PREFIX;
+      record[count].prefixlen = prefix->prefixlen;
+      strlcpy (record[count].ifname, ifp->name,
+               sizeof (record[count].ifname));
+      record[count].prefix = prefix->u.prefix6;
+      count++;
     }
   }
+
+  /* Keep what is on disk in step with what was committed, so that a
+   * failed write is retried with the next one */
+  if (ospf6_auto_state_commit (record, count) == 0)
+  {
+    if (state.record)
+      XFREE (MTYPE_OSPF6_OTHER, state.record);
+    state.record = record;
+    state.count = count;
+  }
+  else
+    XFREE (MTYPE_OSPF6_OTHER, record);
+}
+
+static int
+ospf6_auto_state_writer (struct thread *thread)
+{
+  state.writer = NULL;
+  ospf6_auto_state_write (NULL);
+  return 0;
+}
+
+/* Writes any pending state now, on shutdown */
+void
+ospf6_auto_terminate (void)
+{
+  if (state.writer)
+    ospf6_auto_state_write (NULL);
+}
+
+static void 
+ospf6_read_associated_prefixes_from_file (struct ospf6_interface *ifp)
+{
+  struct prefix *prefix;
+  unsigned int i;
+
+  list_delete (ifp->associated_prefixes);
+  ifp->associated_prefixes = list_new ();
+
+  ospf6_auto_state_load ();
+  for (i = 0; i < state.count; i++)
+  {
+    if (state.record[i].type != OSPF6_AUTO_STATE_PREFIX ||
+        strncmp (state.record[i].ifname, ifp->interface->name,
+                 INTERFACE_NAMSIZ) != 0)
+      continue;
+
+    prefix = prefix_new ();
+    prefix->family = AF_INET6;
+    prefix->prefixlen = state.record[i].prefixlen;
+    prefix->u.prefix6 = state.record[i].prefix;
+    listnode_add (ifp->associated_prefixes, prefix);
+  }
+}
+
+/* Own assignments are written within OSPF6_AUTO_STATE_WRITE_OWN seconds,
+ * other changes may wait for a later write; either way a single write
+ * covers every change made until then */
+static void 
+schedule_writing (struct ospf6_assigned_prefix *assigned_prefix,
+    struct ospf6_interface *ifp)
+{
+  unsigned long delay;
+
+  if (assigned_prefix->assigning_router_id == ospf6->router_id)
+    delay = OSPF6_AUTO_STATE_WRITE_OWN;
+  else
+    delay = OSPF6_AUTO_STATE_WRITE_OTHER;
+
+  if (state.writer && thread_timer_remain_second (state.writer) <= delay)
+    return;
+
+  THREAD_OFF (state.writer);
+  state.writer = thread_add_timer (master, ospf6_auto_state_writer,
+                                   NULL, delay);
 }
 
 static void 
@@ -1058,41 +1626,140 @@ add_to_associated_prefixes (struct ospf6_assigned_prefix *assigned_prefix,
   schedule_writing (assigned_prefix, ifp);
 }
 
-static int
-use_pending_assignment_thread (struct thread *thread)
+/* Pending assignments and deprecations are not given a timer each: they
+ * carry the second they are due at, and a single timer per area commits
+ * everything due by the time it fires.  Pending prefixes are validated
+ * against one AC-LSDB snapshot taken for the whole batch, zebra hears
+ * once per interface that Router Advertisements are on, and at most
+ * one new AC-LSA is originated. */
+static void
+schedule_commit (struct ospf6_area *oa, time_t due)
 {
-  struct ospf6_area *backbone_area;
-  struct ospf6_assigned_prefix *assigned_prefix;
-  struct ospf6_interface *ifp;
-  struct list *assigned_prefix_list, *aggregated_prefix_list, *rid_list;
+  time_t now;
 
-  assigned_prefix = (struct ospf6_assigned_prefix *) THREAD_ARG (thread);
+  if (oa->thread_ac_commit && oa->ac_commit_due <= due)
+    return;
 
-  assert (assigned_prefix && assigned_prefix->interface);
+  now = recent_relative_time ().tv_sec;
+  THREAD_OFF (oa->thread_ac_commit);
+  oa->ac_commit_due = due;
+  oa->thread_ac_commit = thread_add_timer (master, ospf6_auto_commit, oa,
+                                           due > now ? due - now : 0);
+}
 
-  ifp = assigned_prefix->interface;
+static void
+commit_pending_prefix (struct ospf6_assigned_prefix *assigned_prefix,
+    struct ospf6_interface *ifp, struct list **assigned_prefix_list,
+    int *advertise, int *originate)
+{
+  struct list *aggregated_prefix_list;
+  u_int32_t highest_rid;
 
   listnode_delete (ifp->pending_prefix_list, assigned_prefix);
+  assigned_prefix->pending_due = 0;
 
-  /* OSPFv3 Autoconf only runs on the backbone */
-  backbone_area = ospf6_area_lookup (0, ospf6);
-
-  create_ac_lsdb_snapshot (backbone_area->lsdb, 
-      &assigned_prefix_list, &aggregated_prefix_list, &rid_list);
+  if (*assigned_prefix_list == NULL)
+  {
+    create_ac_lsdb_snapshot (ifp->area->lsdb, assigned_prefix_list,
+        &aggregated_prefix_list, &highest_rid);
+    aggregated_prefix_list->del = free;
+    list_delete (aggregated_prefix_list);
+  }
 
-  if (is_prefix_valid_network_wide (assigned_prefix, assigned_prefix_list))
+  if (is_prefix_valid_network_wide (assigned_prefix, *assigned_prefix_list))
   {
     zebra_ipv6_addr_add_send (zclient, ifp->interface->ifindex, &assigned_prefix->prefix.u.prefix6);
     zebra_ipv6_nd_prefix (zclient, ifp->interface->ifindex, &assigned_prefix->prefix);
-    zebra_ipv6_nd_no_suppress_ra (zclient, ifp->interface->ifindex);
+    *advertise = 1;
   }
   else 
   {
     listnode_delete (ifp->assigned_prefix_list, assigned_prefix);
+    *originate = 1;
+  }
+}
+
+static void
+commit_deprecated_prefix (struct ospf6_assigned_prefix *assigned_prefix,
+    struct ospf6_interface *ifp, int *advertise, int *originate)
+{
+  listnode_delete (ifp->assigned_prefix_list, assigned_prefix); 
+  assigned_prefix->deprecation_due = 0;
+
+  if (assigned_prefix->assigning_router_id == ospf6->router_id)
+  {
+    zebra_ipv6_addr_del_send (zclient, ifp->interface->ifindex, &assigned_prefix->prefix.u.prefix6);
+    zebra_ipv6_nd_no_prefix (zclient, ifp->interface->ifindex, &assigned_prefix->prefix);
+    *advertise = 1;
+
+    /*TODO: Should this be for all?? */
+    remove_from_associated_prefixes (assigned_prefix, ifp);
+    *originate = 1;
+  }
+}
+
+static int
+ospf6_auto_commit (struct thread *thread)
+{
+  struct ospf6_area *oa;
+  struct ospf6_interface *ifp;
+  struct ospf6_assigned_prefix *assigned_prefix;
+  struct listnode *node, *nnode, *inner_node, *inner_nnode;
+  struct list *assigned_prefix_list = NULL;
+  time_t now, next = 0;
+  int advertise, originate = 0;
+
+  oa = (struct ospf6_area *) THREAD_ARG (thread);
+  oa->thread_ac_commit = NULL;
+  now = recent_relative_time ().tv_sec;
+
+  for (ALL_LIST_ELEMENTS (oa->if_list, node, nnode, ifp))
+  {
+    advertise = 0;
+
+    for (ALL_LIST_ELEMENTS (ifp->pending_prefix_list, inner_node,
+                            inner_nnode, assigned_prefix))
+    {
+      if (assigned_prefix->pending_due > now)
+      {
+        if (!next || assigned_prefix->pending_due < next)
+          next = assigned_prefix->pending_due;
+        continue;
+      }
+      commit_pending_prefix (assigned_prefix, ifp, &assigned_prefix_list,
+                             &advertise, &originate);
+    }
+
+    for (ALL_LIST_ELEMENTS (ifp->assigned_prefix_list, inner_node,
+                            inner_nnode, assigned_prefix))
+    {
+      if (!assigned_prefix->deprecation_due)
+        continue;
+      if (assigned_prefix->deprecation_due > now)
+      {
+        if (!next || assigned_prefix->deprecation_due < next)
+          next = assigned_prefix->deprecation_due;
+        continue;
+      }
+      commit_deprecated_prefix (assigned_prefix, ifp, &advertise,
+                                &originate);
+    }
+
+    if (advertise)
+      zebra_ipv6_nd_no_suppress_ra (zclient, ifp->interface->ifindex);
+  }
+
+  if (originate)
     originate_new_ac_lsa ();
+
+  if (assigned_prefix_list)
+  {
+    assigned_prefix_list->del = free;
+    list_delete (assigned_prefix_list);
   }
 
-  assigned_prefix->pending_thread = NULL;
+  if (next)
+    schedule_commit (oa, next);
 
   return 0;
 }
@@ -1139,11 +1806,9 @@ schedule_using_assigned_prefix (struct ospf6_assigned_prefix *assigned_prefix,
   listnode_add (ifp->assigned_prefix_list, assigned_prefix);
 
   originate_new_ac_lsa ();
-  assigned_prefix->pending_thread =
-    thread_add_timer (master,
-	use_pending_assignment_thread,
-	assigned_prefix,
-	OSPF6_NEW_PREFIX_ASSIGNMENT_SECONDS);
+  assigned_prefix->pending_due =
+    recent_relative_time ().tv_sec + OSPF6_NEW_PREFIX_ASSIGNMENT_SECONDS;
+  schedule_commit (ifp->area, assigned_prefix->pending_due);
 }
 
 static void 
@@ -1153,6 +1818,9 @@ start_using_prefix (struct ospf6_assigned_prefix *assigned_prefix,
   struct ospf6_assigned_prefix *pending_prefix;
   mark_prefix_valid (assigned_prefix);
 
+  /* Prefixes taken from the AC-LSDB snapshot have no interface yet */
+  assigned_prefix->interface = ifp;
+
   if (assigned_prefix->assigning_router_id == ospf6->router_id)
   {
     schedule_using_assigned_prefix (assigned_prefix, ifp); 
@@ -1171,7 +1839,9 @@ start_using_prefix (struct ospf6_assigned_prefix *assigned_prefix,
       pending_prefix = find_pending_assignment (assigned_prefix, current_interface);
       if (pending_prefix != NULL)
       {
-	THREAD_OFF (pending_prefix->pending_thread);
+	ospf6_auto_event (OSPF6_AUTO_EVENT_WITHDRAW, &pending_prefix->prefix,
+	                  ospf6->router_id, current_interface);
+	pending_prefix->pending_due = 0;
 
 	listnode_delete (current_interface->pending_prefix_list, pending_prefix);
 	listnode_delete (current_interface->assigned_prefix_list, pending_prefix);
@@ -1181,6 +1851,8 @@ start_using_prefix (struct ospf6_assigned_prefix *assigned_prefix,
       }
     }
 
+    ospf6_auto_event (OSPF6_AUTO_EVENT_ADOPT, &assigned_prefix->prefix,
+                      assigned_prefix->assigning_router_id, ifp);
     mark_prefix_valid (assigned_prefix);
     assigned_prefix->interface = ifp;
     /*XXX: do we need add_to_associated_prefixes (assigned_prefix, ifp); */
@@ -1222,7 +1894,9 @@ stop_using_prefix (struct ospf6_assigned_prefix *assigned_prefix,
   pending_prefix = find_pending_assignment (assigned_prefix, ifp);
   if (pending_prefix != NULL)
   {
-    THREAD_OFF (pending_prefix->pending_thread);
+    ospf6_auto_event (OSPF6_AUTO_EVENT_WITHDRAW, &pending_prefix->prefix,
+                      ospf6->router_id, ifp);
+    pending_prefix->pending_due = 0;
     listnode_delete (ifp->pending_prefix_list, pending_prefix);
     listnode_delete (ifp->assigned_prefix_list, pending_prefix);
     remove_from_associated_prefixes (assigned_prefix, ifp);
@@ -1286,14 +1960,17 @@ make_prefix_assignment (struct ospf6_aggregated_prefix *agp,
     assigned_prefix->is_valid = 1;
     assigned_prefix->interface = ifp;
 
-    assigned_prefix->pending_thread = NULL;
-    assigned_prefix->deprecation_thread = NULL;
+    assigned_prefix->pending_due = 0;
+    assigned_prefix->deprecation_due = 0;
 
+    ospf6_auto_event (OSPF6_AUTO_EVENT_ASSIGN, &assigned_prefix->prefix,
+                      ospf6->router_id, ifp);
     start_using_prefix (assigned_prefix, ifp, aspl);
   }
   else 
   {
-    zlog_warn ("Couldn't make assignment");
+    ospf6_auto_event (OSPF6_AUTO_EVENT_EXHAUST, &agp->prefix,
+                      ospf6->router_id, ifp);
   }
   list_delete (in_use_prefixes);
 }
@@ -1323,8 +2000,13 @@ handle_other_assigned (struct ospf6_assigned_prefix *existing_assigned_prefix,
   {
     start_using_prefix (existing_assigned_prefix, ifp, aspl);
   }
-
-  /* Silently ignore invalid assignments */
+  else
+  {
+    /* Otherwise ignore invalid assignments */
+    ospf6_auto_event (OSPF6_AUTO_EVENT_REJECT,
+                      &existing_assigned_prefix->prefix,
+                      existing_assigned_prefix->assigning_router_id, ifp);
+  }
 }
 
 static void 
@@ -1442,44 +2124,18 @@ process_prefix_interface_pairs (struct ospf6_area *oa,
   }
 }
 
-static int
-assigned_prefix_deprication_thread (struct thread *thread)
-{
-  struct ospf6_assigned_prefix *assigned_prefix;
-  struct ospf6_interface *ifp;
-
-  assigned_prefix = (struct ospf6_assigned_prefix *) THREAD_ARG (thread);
-
-  assert (assigned_prefix && assigned_prefix->interface);
-
-  ifp = assigned_prefix->interface;
-
-  listnode_delete (ifp->assigned_prefix_list, assigned_prefix); 
-
-  if (assigned_prefix->assigning_router_id == ospf6->router_id)
-  {
-    zebra_ipv6_addr_del_send (zclient, ifp->interface->ifindex, &assigned_prefix->prefix.u.prefix6);
-    zebra_ipv6_nd_no_prefix (zclient, ifp->interface->ifindex, &assigned_prefix->prefix);
-    zebra_ipv6_nd_no_suppress_ra (zclient, ifp->interface->ifindex);
-
-    /*TODO: Should this be for all?? */
-    remove_from_associated_prefixes (assigned_prefix, ifp);
-    originate_new_ac_lsa ();
-  }
-  assigned_prefix->deprecation_thread = NULL;
-  return 0;
-}
-
 static void
 schedule_assigned_prefix_deprecation (struct ospf6_assigned_prefix *assigned_prefix)
 {
-  if (!assigned_prefix->deprecation_thread)
+  if (!assigned_prefix->deprecation_due)
   {
-    assigned_prefix->deprecation_thread =
-      thread_add_timer (master,
-	  assigned_prefix_deprication_thread,
-	  assigned_prefix,
-	  OSPF6_TERMINATE_PREFIX_ASSIGNMENT_SECONDS);
+    ospf6_auto_event (OSPF6_AUTO_EVENT_DEPRECATE, &assigned_prefix->prefix,
+                      assigned_prefix->assigning_router_id,
+                      assigned_prefix->interface);
+    assigned_prefix->deprecation_due = recent_relative_time ().tv_sec
+                                       + OSPF6_TERMINATE_PREFIX_ASSIGNMENT_SECONDS;
+    schedule_commit (assigned_prefix->interface->area,
+                     assigned_prefix->deprecation_due);
   }
 }
 
@@ -1491,6 +2147,7 @@ delete_invalid_assigned_prefixes_on_interface (struct ospf6_interface *oi)
 
   assert (oi);
 
+again:
   for (ALL_LIST_ELEMENTS (oi->assigned_prefix_list, node, nnode, ap))
   {
     if (!ap->is_valid) 
@@ -1500,12 +2157,15 @@ delete_invalid_assigned_prefixes_on_interface (struct ospf6_interface *oi)
 
       if (pending_prefix != NULL)
       {
-	THREAD_OFF (pending_prefix->pending_thread);
+	pending_prefix->pending_due = 0;
 	listnode_delete (oi->pending_prefix_list, pending_prefix);
 	listnode_delete (oi->assigned_prefix_list, pending_prefix);
 	/* XXX: Not sure we want this */
 	remove_from_associated_prefixes (ap, oi);
 	originate_new_ac_lsa ();
+
+	/* that need not have been the current node: start over */
+	goto again;
       }
       else 
       {
@@ -1514,7 +2174,7 @@ delete_invalid_assigned_prefixes_on_interface (struct ospf6_interface *oi)
     }
     else 
     {
-      THREAD_OFF (ap->deprecation_thread);
+      ap->deprecation_due = 0;
     }
   }
 }
@@ -1575,9 +2235,9 @@ get_first_hw_addr (void)
 
   assert (backbone_area);
 
-  oi = listhead (backbone_area->if_list);
+  oi = listgetdata (listhead (backbone_area->if_list));
 
-  return hw_addr_to_long (&oi->interface->hw_addr, oi->interface->hw_addr_len);
+  return hw_addr_to_long (oi->interface->hw_addr, oi->interface->hw_addr_len);
 }
 
 static struct in6_addr * 
@@ -1609,35 +2269,17 @@ generate_random_prefix (void)
 static struct in6_addr *
 read_ula (void)
 {
-  FILE *file_pointer;
-  char filepath[100], linebuf[64];
   struct in6_addr *addr;
-  struct prefix *prefix;
-
-  snprintf (filepath, sizeof (filepath), "%s%s", SYSCONFDIR, "ospf6d_ula");
-
-  file_pointer = fopen (filepath, "r");
-
-  if (file_pointer != NULL)
-  {
-    /*XXX: Portability? */
-    fgets ((char * restrict) linebuf, 64, file_pointer);
-
-    addr = malloc (sizeof (struct in6_addr));
+  unsigned int i;
 
-    prefix = prefix_new ();
-
-    str2prefix (linebuf, prefix);
-    memcpy (&addr->s6_addr[0], &prefix->u.prefix6, sizeof (struct in6_addr));
-
-    prefix_free (prefix);
-    fclose (file_pointer); 
-    return addr;
-  }
-  else 
-  {
-    zlog_warn ("Failed to open file");
-  }
+  ospf6_auto_state_load ();
+  for (i = 0; i < state.count; i++)
+    if (state.record[i].type == OSPF6_AUTO_STATE_ULA)
+    {
+      addr = malloc (sizeof (struct in6_addr));
+      *addr = state.record[i].prefix;
+      return addr;
+    }
 
   return NULL; 
 }
@@ -1646,23 +2288,7 @@ read_ula (void)
 static void
 write_ula (struct in6_addr *addr)
 {
-  char filepath[100], buf[64];
-  FILE *file_pointer;
-
-  snprintf (filepath, sizeof (filepath), "%s%s", SYSCONFDIR, "ospf6d_ula");
-
-  file_pointer = fopen (filepath, "w");
-
-  if (file_pointer)
-  {
-    in6_addr2str (*addr, 0, buf, 64);
-    fprintf (file_pointer, "%s", buf);
-    fclose (file_pointer);  
-  }
-  else
-  {
-    zlog_warn ("Failed to open file");
-  }
+  ospf6_auto_state_write (addr);
 }
 
 static int
@@ -1694,6 +2320,8 @@ ula_generator (struct thread *thread)
   new_ula_prefix->prefix.u.prefix6 = *addr;
 
   listnode_add (ospf6->aggregated_prefix_list, new_ula_prefix);
+  ospf6_auto_event (OSPF6_AUTO_EVENT_ULA_GENERATE, &new_ula_prefix->prefix,
+                    ospf6->router_id, NULL);
   originate_new_ac_lsa ();
 
   ospf6->ula_generation_thread = NULL;
@@ -1711,6 +2339,8 @@ ula_terminator (struct thread *thread)
   {
     if (agp->source == OSPF6_PREFIX_SOURCE_GENERATED)
     {
+      ospf6_auto_event (OSPF6_AUTO_EVENT_ULA_TERMINATE, &agp->prefix,
+                        agp->advertising_router_id, NULL);
       listnode_delete (ospf6->aggregated_prefix_list, agp);
       originate_new_ac_lsa ();
     }
@@ -1753,19 +2383,13 @@ cancel_ula_termination (void)
 
 static void 
 check_for_ula_generation (struct list *aggregated_prefix_list, 
-    struct list *reachable_rid_list)
+    u_int32_t highest_rid)
 {
   struct listnode *node, *nnode;
-  u_int32_t *rid, highest_rid, highest_advertiser;
+  u_int32_t highest_advertiser;
   struct ospf6_aggregated_prefix *agp;
   u_int8_t exists_non_generated;
 
-  highest_rid = 0;
-  for (ALL_LIST_ELEMENTS (reachable_rid_list, node, nnode, rid))
-  {
-    if (*rid > highest_rid) highest_rid = *rid;
-  }
-
   exists_non_generated = 0;
   highest_advertiser = 0;
   for (ALL_LIST_ELEMENTS (aggregated_prefix_list, node, nnode, agp))
@@ -1811,23 +2435,23 @@ check_for_ula_generation (struct list *aggregated_prefix_list,
   }
 }
 
+/* Reached by the last SPF calculation and advertising an AC-LSA.  A
+   router's first fragment is there for as long as it advertises any. */
 static u_int8_t
-router_has_reachable_ac_lsa (struct ospf6_neighbor *neighbor, struct list *reachable_rid_list)
+router_has_reachable_ac_lsa (struct ospf6_area *oa, u_int32_t router_id)
 {
-  struct listnode *node, *nnode;
-  u_int32_t *rid;
+  struct ospf6_lsa *lsa;
 
-  assert (neighbor);
+  if (!ospf6_spf_router_reachable (oa, router_id))
+    return 0;
 
-  for (ALL_LIST_ELEMENTS (reachable_rid_list, node, nnode, rid))
-  {
-    if (neighbor->router_id == *rid) return 1;
-  }
-  return 0;
+  lsa = ospf6_lsdb_lookup (htons (OSPF6_LSTYPE_AC), htonl (0), router_id,
+                           oa->lsdb);
+  return (lsa != NULL && !OSPF6_LSA_IS_MAXAGE (lsa));
 }
 
 static u_int8_t 
-detect_inactive_neighbors (struct ospf6_area *oa, struct list * reachable_rid_list)
+detect_inactive_neighbors (struct ospf6_area *oa)
 {
   struct listnode *node, *nnode;
   struct ospf6_interface *oi;
@@ -1838,9 +2462,10 @@ detect_inactive_neighbors (struct ospf6_area *oa, struct list * reachable_rid_li
   {
     struct listnode *inner_node, *inner_nnode;
     struct ospf6_neighbor *neighbor;
-    for (ALL_LIST_ELEMENTS (oi->neighbor_list, node, nnode, neighbor))
+    for (ALL_LIST_ELEMENTS (oi->neighbor_list, inner_node, inner_nnode,
+                            neighbor))
     {
-      if (!router_has_reachable_ac_lsa (neighbor, reachable_rid_list)) return 1;
+      if (!router_has_reachable_ac_lsa (oa, neighbor->router_id)) return 1;
     }
   }
 
@@ -1851,9 +2476,13 @@ void
 ospf6_assign_prefixes (void)
 {
   struct ospf6_area *backbone_area;
-  struct list *assigned_prefix_list, *aggregated_prefix_list, *reachable_rid_list;
+  struct list *assigned_prefix_list, *aggregated_prefix_list;
+  u_int32_t highest_rid;
+  struct timeval clock;
 
-  zlog_warn("Runnign assignment algorithm");
+  /* runs are only counted, not to crowd out the event ring */
+  ac_stats.counter[OSPF6_AUTO_EVENT_RUN]++;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &clock);
 
   /* OSPFv3 Autoconf only runs on the backbone */
   backbone_area = ospf6_area_lookup (0, ospf6);
@@ -1863,30 +2492,44 @@ ospf6_assign_prefixes (void)
   create_ac_lsdb_snapshot (backbone_area->lsdb, 
       &assigned_prefix_list, 
       &aggregated_prefix_list,
-      &reachable_rid_list);
+      &highest_rid);
+  ospf6_auto_phase_done (OSPF6_AUTO_PHASE_SNAPSHOT, &clock);
 
-  if (detect_inactive_neighbors (backbone_area, reachable_rid_list))
+  if (detect_inactive_neighbors (backbone_area))
   {
+    ospf6_auto_phase_done (OSPF6_AUTO_PHASE_INACTIVE, &clock);
+    ac_stats.counter[OSPF6_AUTO_EVENT_ABORT]++;
+    if (IS_OSPF6_DEBUG_AUTO)
+      zlog_debug ("Autoconf: waiting for AC-LSAs of all neighbors");
     cancel_ula_generation ();
     /* TODO: Maybe cancel other things too */
+    aggregated_prefix_list->del = free;
+    list_delete (aggregated_prefix_list);
+    free_ac_lsdb_snapshot (assigned_prefix_list);
     return;
   }
 
+  ospf6_auto_phase_done (OSPF6_AUTO_PHASE_INACTIVE, &clock);
+
   mark_area_prefixes_invalid (backbone_area);
 
-  check_for_ula_generation (aggregated_prefix_list, reachable_rid_list);
+  check_for_ula_generation (aggregated_prefix_list, highest_rid);
+  ospf6_auto_phase_done (OSPF6_AUTO_PHASE_ULA, &clock);
 
   process_prefix_interface_pairs (backbone_area, 
       aggregated_prefix_list, assigned_prefix_list);
+  ospf6_auto_phase_done (OSPF6_AUTO_PHASE_PAIRS, &clock);
 
   delete_invalid_assigned_prefixes_in_area (backbone_area); 
+  ospf6_auto_phase_done (OSPF6_AUTO_PHASE_DELETION, &clock);
 
   /* Tidy up */
   /* Keep hold of aggregated prefix list */
+  ospf6->aggregated_prefix_list->del = free;
   list_delete (ospf6->aggregated_prefix_list);
   ospf6->aggregated_prefix_list = aggregated_prefix_list;
 
-  list_free (assigned_prefix_list);
+  free_ac_lsdb_snapshot (assigned_prefix_list);
 }
 
 static int 
@@ -1922,4 +2565,7 @@ ospf6_auto_init (void)
   install_element (ENABLE_NODE, &show_ipv6_allocated_prefix_cmd); 
   install_element (ENABLE_NODE, &show_ipv6_aggregated_prefix_cmd); 
   install_element (ENABLE_NODE, &show_ipv6_assigned_prefix_cmd); 
+
+  install_element (VIEW_NODE, &show_ipv6_ospf6_auto_config_statistics_cmd);
+  install_element (ENABLE_NODE, &show_ipv6_ospf6_auto_config_statistics_cmd);
 }
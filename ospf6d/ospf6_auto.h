@@ -44,11 +44,23 @@ struct ospf6_assigned_prefix
 
   struct ospf6_interface *interface;
 
-  struct thread *pending_thread;
-  struct thread *deprecation_thread;
+  /* relative seconds the assignment is committed or deprecated at,
+     0 when not pending or deprecating */
+  time_t pending_due;
+  time_t deprecation_due;
 };
 
+/* Debug option */
+extern unsigned char conf_debug_ospf6_auto;
+#define OSPF6_DEBUG_AUTO_ON() (conf_debug_ospf6_auto = 1)
+#define OSPF6_DEBUG_AUTO_OFF() (conf_debug_ospf6_auto = 0)
+#define IS_OSPF6_DEBUG_AUTO (conf_debug_ospf6_auto)
+
 void ospf6_auto_init (void); 
+void ospf6_auto_terminate (void);
+struct vty;
+int config_write_ospf6_debug_auto (struct vty *);
+void install_element_ospf6_debug_auto (void);
 
 u_int32_t ospf6_generate_router_id (void);
 struct ospf6_router_hardware_fingerprint ospf6_generate_router_hardware_fingerprint (void); 
@@ -56,8 +68,11 @@ void ospf6_init_seed (void);
 
 void ospf6_set_router_id (u_int32_t rid);
 
-/*void ospf6_check_router_id (struct ospf6_header *oh, struct in6_addr src, struct in6_addr dst);
-int ospf6_check_hw_fingerprint (struct ospf6_lsa_header *lsa_header);  */
+struct ospf6_header;
+struct ospf6_lsa_header;
+int ospf6_check_router_id (struct ospf6_header *oh, struct in6_addr src,
+                           struct in6_addr dst);
+int ospf6_check_hw_fingerprint (struct ospf6_lsa_header *lsa_header);
 
 void ospf6_schedule_assign_prefixes (void);
 
@@ -236,6 +236,9 @@ ospf6_install_lsa (struct ospf6_lsa *lsa)
   lsa->installed = now;
   ospf6_lsdb_add (lsa, lsa->lsdb);
 
+  if (OSPF6_LSA_IS_MAXAGE (lsa))
+    ospf6_lsdb_maxage_add (lsa, lsa->lsdb);
+
   return;
 }
 
@@ -514,6 +517,93 @@ ospf6_flood_clear (struct ospf6_lsa *lsa)
   ospf6_flood_clear_process (lsa, ospf6);
 }
 
+/* Drop the LSA from the request lists of neighbors in its scope that
+   asked for it or for an older instance, as flooding it would have;
+   used for self-originated LSAs, which are not flooded as received */
+static void
+ospf6_flood_clear_request (struct ospf6_lsa *lsa)
+{
+  struct listnode *node, *inode, *nnode;
+  struct ospf6_area *oa;
+  struct ospf6_interface *oi;
+  struct ospf6_neighbor *on;
+  struct ospf6_lsa *req;
+
+  for (ALL_LIST_ELEMENTS_RO (ospf6->area_list, node, oa))
+    {
+      if (OSPF6_LSA_SCOPE (lsa->header->type) == OSPF6_SCOPE_AREA &&
+          oa != OSPF6_AREA (lsa->lsdb->data))
+        continue;
+
+      for (ALL_LIST_ELEMENTS_RO (oa->if_list, inode, oi))
+        {
+          if (OSPF6_LSA_SCOPE (lsa->header->type) == OSPF6_SCOPE_LINKLOCAL &&
+              oi != OSPF6_INTERFACE (lsa->lsdb->data))
+            continue;
+
+          for (ALL_LIST_ELEMENTS_RO (oi->neighbor_list, nnode, on))
+            {
+              req = ospf6_lsdb_lookup (lsa->header->type, lsa->header->id,
+                                       lsa->header->adv_router,
+                                       on->request_list);
+              if (req && ospf6_lsa_compare (lsa, req) <= 0)
+                ospf6_lsdb_remove (req, on->request_list);
+            }
+        }
+    }
+}
+
+/* Queue a delayed acknowledgement on the interface. Acknowledgements
+   are held for the interface's delayed-ack window so that one LSAck
+   carries as many headers as possible; once a full packet's worth is
+   queued it is sent without waiting for the window to close. */
+static void
+ospf6_lsack_delayed (struct ospf6_lsa *lsa, struct ospf6_interface *oi)
+{
+  struct ospf6_lsa *queued;
+
+  /* suppress duplicate acknowledgement of the same instance */
+  queued = ospf6_lsdb_lookup (lsa->header->type, lsa->header->id,
+                              lsa->header->adv_router, oi->lsack_list);
+  if (queued && ospf6_lsa_compare (queued, lsa) == 0)
+    {
+      oi->lsack_suppressed++;
+      return;
+    }
+
+  ospf6_lsdb_add (ospf6_lsa_copy (lsa), oi->lsack_list);
+
+  if (oi->lsack_list->count >= ospf6_lsack_capacity (oi))
+    {
+      THREAD_OFF (oi->thread_send_lsack);
+      oi->thread_send_lsack =
+        thread_add_event (master, ospf6_lsack_send_interface, oi, 0);
+    }
+  else if (oi->thread_send_lsack == NULL)
+    oi->thread_send_lsack =
+      thread_add_timer_msec (master, ospf6_lsack_send_interface, oi,
+                             oi->lsack_delay);
+}
+
+/* Queue a direct acknowledgement to the neighbor */
+static void
+ospf6_lsack_direct (struct ospf6_lsa *lsa, struct ospf6_neighbor *on)
+{
+  struct ospf6_lsa *queued;
+
+  queued = ospf6_lsdb_lookup (lsa->header->type, lsa->header->id,
+                              lsa->header->adv_router, on->lsack_list);
+  if (queued && ospf6_lsa_compare (queued, lsa) == 0)
+    {
+      on->ospf6_if->lsack_suppressed++;
+      return;
+    }
+
+  ospf6_lsdb_add (ospf6_lsa_copy (lsa), on->lsack_list);
+  if (on->thread_send_lsack == NULL)
+    on->thread_send_lsack =
+      thread_add_event (master, ospf6_lsack_send_neighbor, on, 0);
+}
 
 /* RFC2328 13.5 (Table 19): Sending link state acknowledgements. */
 static void
@@ -550,10 +640,7 @@ ospf6_acknowledge_lsa_bdrouter (struct ospf6_lsa *lsa, int ismore_recent,
           if (is_debug)
             zlog_debug ("Delayed acknowledgement (BDR & MoreRecent & from DR)");
           /* Delayed acknowledgement */
-          ospf6_lsdb_add (ospf6_lsa_copy (lsa), oi->lsack_list);
-          if (oi->thread_send_lsack == NULL)
-            oi->thread_send_lsack =
-              thread_add_timer (master, ospf6_lsack_send_interface, oi, 3);
+          ospf6_lsack_delayed (lsa, oi);
         }
       else
         {
@@ -574,10 +661,7 @@ ospf6_acknowledge_lsa_bdrouter (struct ospf6_lsa *lsa, int ismore_recent,
           if (is_debug)
             zlog_debug ("Delayed acknowledgement (BDR & Duplicate & ImpliedAck & from DR)");
           /* Delayed acknowledgement */
-          ospf6_lsdb_add (ospf6_lsa_copy (lsa), oi->lsack_list);
-          if (oi->thread_send_lsack == NULL)
-            oi->thread_send_lsack =
-              thread_add_timer (master, ospf6_lsack_send_interface, oi, 3);
+          ospf6_lsack_delayed (lsa, oi);
         }
       else
         {
@@ -594,10 +678,7 @@ ospf6_acknowledge_lsa_bdrouter (struct ospf6_lsa *lsa, int ismore_recent,
     {
       if (is_debug)
         zlog_debug ("Direct acknowledgement (BDR & Duplicate)");
-      ospf6_lsdb_add (ospf6_lsa_copy (lsa), from->lsack_list);
-      if (from->thread_send_lsack == NULL)
-        from->thread_send_lsack =
-          thread_add_event (master, ospf6_lsack_send_neighbor, from, 0);
+      ospf6_lsack_direct (lsa, from);
       return;
     }
 
@@ -638,10 +719,7 @@ ospf6_acknowledge_lsa_allother (struct ospf6_lsa *lsa, int ismore_recent,
       if (is_debug)
         zlog_debug ("Delayed acknowledgement (AllOther & MoreRecent)");
       /* Delayed acknowledgement */
-      ospf6_lsdb_add (ospf6_lsa_copy (lsa), oi->lsack_list);
-      if (oi->thread_send_lsack == NULL)
-        oi->thread_send_lsack =
-          thread_add_timer (master, ospf6_lsack_send_interface, oi, 3);
+      ospf6_lsack_delayed (lsa, oi);
       return;
     }
 
@@ -662,10 +740,7 @@ ospf6_acknowledge_lsa_allother (struct ospf6_lsa *lsa, int ismore_recent,
     {
       if (is_debug)
         zlog_debug ("Direct acknowledgement (AllOther & Duplicate)");
-      ospf6_lsdb_add (ospf6_lsa_copy (lsa), from->lsack_list);
-      if (from->thread_send_lsack == NULL)
-        from->thread_send_lsack =
-          thread_add_event (master, ospf6_lsack_send_neighbor, from, 0);
+      ospf6_lsack_direct (lsa, from);
       return;
     }
 
@@ -731,7 +806,7 @@ void
 ospf6_receive_lsa (struct ospf6_neighbor *from,
                    struct ospf6_lsa_header *lsa_header)
 {
-  struct ospf6_lsa *new = NULL, *old = NULL, *rem = NULL;
+  struct ospf6_lsa *new = NULL, *old = NULL, *rem = NULL, *req;
   int ismore_recent;
   int is_debug = 0;
 
@@ -800,10 +875,7 @@ ospf6_receive_lsa (struct ospf6_neighbor *from,
         zlog_debug ("Drop MaxAge LSA with direct acknowledgement.");
 
       /* a) Acknowledge back to neighbor (Direct acknowledgement, 13.5) */
-      ospf6_lsdb_add (ospf6_lsa_copy (new), from->lsack_list);
-      if (from->thread_send_lsack == NULL)
-        from->thread_send_lsack =
-          thread_add_event (master, ospf6_lsack_send_neighbor, from, 0);
+      ospf6_lsack_direct (new, from);
 
       /* b) Discard */
       ospf6_lsa_delete (new);
@@ -831,8 +903,13 @@ ospf6_receive_lsa (struct ospf6_neighbor *from,
       /* in case we have no database copy */
       ismore_recent = -1;
 
-      /* (a) MinLSArrival check */
-      if (old)
+      /* (a) MinLSArrival check.  It damps flooding, so an instance
+         that we requested, such as a newer one of our own LSAs after
+         a restart, is taken at once, provided it is at least as
+         recent as the one requested */
+      req = ospf6_lsdb_lookup (new->header->type, new->header->id,
+                               new->header->adv_router, from->request_list);
+      if (old && ! (req && ospf6_lsa_compare (new, req) <= 0))
         {
           struct timeval now, res;
           quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
@@ -857,6 +934,8 @@ ospf6_receive_lsa (struct ospf6_neighbor *from,
       due to MinLSArrival. */
       if (new->header->adv_router != from->ospf6_if->area->ospf6->router_id)
         ospf6_flood (from, new);
+      else
+        ospf6_flood_clear_request (new);
 
       /* (c) Remove the current database copy from all neighbors' Link
              state retransmission lists. */
@@ -28,6 +28,7 @@
 #include "thread.h"
 #include "prefix.h"
 #include "plist.h"
+#include "hash.h"
 
 #include "ospf6_lsa.h"
 #include "ospf6_lsdb.h"
@@ -90,6 +91,8 @@ ospf6_interface_lsdb_hook (struct ospf6_lsa *lsa)
     }
 }
 
+static int ospf6_candidate_cmp (void *, void *);
+
 /* Create new ospf6 interface structure */
 struct ospf6_interface *
 ospf6_interface_create (struct interface *ifp)
@@ -109,6 +112,14 @@ ospf6_interface_create (struct interface *ifp)
   oi->area = (struct ospf6_area *) NULL;
   oi->neighbor_list = list_new ();
   oi->neighbor_list->cmp = ospf6_neighbor_cmp;
+  oi->neighbor_hash = hash_create (ospf6_neighbor_hash_key,
+                                   ospf6_neighbor_hash_cmp);
+  oi->dr_candidate_list = list_new ();
+  oi->dr_candidate_list->cmp = ospf6_candidate_cmp;
+  oi->bdr_candidate_list = list_new ();
+  oi->bdr_candidate_list->cmp = ospf6_candidate_cmp;
+  oi->eligible_list = list_new ();
+  oi->eligible_list->cmp = ospf6_candidate_cmp;
   oi->linklocal_addr = (struct in6_addr *) NULL;
   oi->instance_id = OSPF6_INTERFACE_INSTANCE_ID;
   oi->transdelay = OSPF6_INTERFACE_TRANSDELAY;
@@ -121,6 +132,7 @@ ospf6_interface_create (struct interface *ifp)
   oi->hello_interval = OSPF6_INTERFACE_HELLO_INTERVAL;
   oi->dead_interval = OSPF6_INTERFACE_DEAD_INTERVAL;
   oi->rxmt_interval = OSPF6_INTERFACE_RXMT_INTERVAL;
+  oi->lsack_delay = OSPF6_INTERFACE_LSACK_DELAY;
   oi->cost = OSPF6_INTERFACE_COST;
   oi->state = OSPF6_INTERFACE_DOWN;
   oi->flag = 0;
@@ -170,6 +182,10 @@ ospf6_interface_delete (struct ospf6_interface *oi)
       ospf6_neighbor_delete (on);
   
   list_delete (oi->neighbor_list);
+  hash_free (oi->neighbor_hash);
+  list_delete (oi->dr_candidate_list);
+  list_delete (oi->bdr_candidate_list);
+  list_delete (oi->eligible_list);
 
   THREAD_OFF (oi->thread_send_hello);
   THREAD_OFF (oi->thread_send_lsupdate);
@@ -327,6 +343,7 @@ ospf6_interface_connected_route_update (struct interface *ifp)
   struct ospf6_route *route;
   struct connected *c;
   struct listnode *node, *nnode;
+  struct in6_addr loopback;
 
   oi = (struct ospf6_interface *) ifp->info;
   if (oi == NULL)
@@ -379,8 +396,8 @@ ospf6_interface_connected_route_update (struct interface *ifp)
       route->path.area_id = oi->area->area_id;
       route->path.type = OSPF6_PATH_TYPE_INTRA;
       route->path.cost = oi->cost;
-      route->nexthop[0].ifindex = oi->interface->ifindex;
-      inet_pton (AF_INET6, "::1", &route->nexthop[0].address);
+      inet_pton (AF_INET6, "::1", &loopback);
+      ospf6_route_set_nexthop (route, oi->interface->ifindex, &loopback);
       ospf6_route_add (route, oi->route_connected);
     }
 
@@ -455,6 +472,48 @@ ospf6_interface_state_change (u_char next_state, struct ospf6_interface *oi)
 #define IS_ELIGIBLE(n) \
   ((n)->state >= OSPF6_NEIGHBOR_TWOWAY && (n)->priority != 0)
 
+/* Order of DR/BDR candidates: higher priority, then higher Router ID */
+static int
+ospf6_candidate_cmp (void *va, void *vb)
+{
+  struct ospf6_neighbor *a = (struct ospf6_neighbor *) va;
+  struct ospf6_neighbor *b = (struct ospf6_neighbor *) vb;
+
+  if (a->priority != b->priority)
+    return (a->priority > b->priority ? -1 : 1);
+  return (ntohl (a->router_id) > ntohl (b->router_id) ? -1 : 1);
+}
+
+/* Move the neighbor to the candidate list matching its state, priority
+   and the DR/BDR it declares, so that DR election only has to look at
+   the head of each list.  Called whenever one of those changes. */
+void
+ospf6_interface_candidate_update (struct ospf6_neighbor *on)
+{
+  struct ospf6_interface *oi = on->ospf6_if;
+  struct list *list = NULL;
+
+  if (IS_ELIGIBLE (on))
+    {
+      if (on->drouter == on->router_id)
+        list = oi->dr_candidate_list;
+      else if (on->bdrouter == on->router_id)
+        list = oi->bdr_candidate_list;
+      else
+        list = oi->eligible_list;
+    }
+
+  if (on->candidate_list == list && on->candidate_priority == on->priority)
+    return;
+
+  if (on->candidate_list)
+    listnode_delete (on->candidate_list, on);
+  on->candidate_list = list;
+  on->candidate_priority = on->priority;
+  if (list)
+    listnode_add_sort (list, on);
+}
+
 static struct ospf6_neighbor *
 better_bdrouter (struct ospf6_neighbor *a, struct ospf6_neighbor *b)
 {
@@ -518,7 +577,7 @@ better_drouter (struct ospf6_neighbor *a, struct ospf6_neighbor *b)
 static u_char
 dr_election (struct ospf6_interface *oi)
 {
-  struct listnode *node, *nnode;
+  struct listnode *node;
   struct ospf6_neighbor *on, *drouter, *bdrouter, myself;
   struct ospf6_neighbor *best_drouter, *best_bdrouter;
   u_char next_state = 0;
@@ -536,18 +595,17 @@ dr_election (struct ospf6_interface *oi)
   myself.priority = oi->priority;
   myself.router_id = oi->area->ospf6->router_id;
 
-  /* Electing BDR (2) */
-  for (ALL_LIST_ELEMENTS (oi->neighbor_list, node, nnode, on))
-    bdrouter = better_bdrouter (bdrouter, on);
-  
-  best_bdrouter = bdrouter;
+  /* Electing BDR (2): best of the neighbors declaring themselves BDR,
+     else of the other eligible ones not declaring themselves DR */
+  if (listhead (oi->bdr_candidate_list))
+    best_bdrouter = listgetdata (listhead (oi->bdr_candidate_list));
+  else if (listhead (oi->eligible_list))
+    best_bdrouter = listgetdata (listhead (oi->eligible_list));
   bdrouter = better_bdrouter (best_bdrouter, &myself);
 
   /* Electing DR (3) */
-  for (ALL_LIST_ELEMENTS (oi->neighbor_list, node, nnode, on))
-    drouter = better_drouter (drouter, on);
-
-  best_drouter = drouter;
+  if (listhead (oi->dr_candidate_list))
+    best_drouter = listgetdata (listhead (oi->dr_candidate_list));
   drouter = better_drouter (best_drouter, &myself);
   if (drouter == NULL)
     drouter = bdrouter;
@@ -831,6 +889,7 @@ ospf6_interface_show (struct vty *vty, struct interface *ifp)
   vty_out (vty, "   Hello %d, Dead %d, Retransmit %d%s",
            oi->hello_interval, oi->dead_interval, oi->rxmt_interval,
 	   VNL);
+  vty_out (vty, "   Delayed LSAck %u msec%s", oi->lsack_delay, VNL);
 
   inet_ntop (AF_INET, &oi->drouter, drouter, sizeof (drouter));
   inet_ntop (AF_INET, &oi->bdrouter, bdrouter, sizeof (bdrouter));
@@ -865,6 +924,14 @@ ospf6_interface_show (struct vty *vty, struct interface *ifp)
        lsa = ospf6_lsdb_next (lsa))
     vty_out (vty, "      %s%s", lsa->name, VNL);
 
+  vty_out (vty, "    LSAck sent %u, acknowledged %u (%u.%02u per LSAck), "
+           "duplicates suppressed %u%s",
+           oi->lsack_packets, oi->lsack_headers,
+           (oi->lsack_packets ? oi->lsack_headers / oi->lsack_packets : 0),
+           (oi->lsack_packets ?
+            (oi->lsack_headers * 100 / oi->lsack_packets) % 100 : 0),
+           oi->lsack_suppressed, VNL);
+
   return 0;
 }
 
@@ -1286,6 +1353,55 @@ DEFUN (ipv6_ospf6_retransmitinterval,
   return CMD_SUCCESS;
 }
 
+/* interface variable set command */
+DEFUN (ipv6_ospf6_lsackdelay,
+       ipv6_ospf6_lsackdelay_cmd,
+       "ipv6 ospf6 lsack-delay <0-65535>",
+       IP6_STR
+       OSPF6_STR
+       "Delay before sending delayed link state acknowledgements\n"
+       "Milliseconds\n"
+       )
+{
+  struct ospf6_interface *oi;
+  struct interface *ifp;
+
+  ifp = (struct interface *) vty->index;
+  assert (ifp);
+
+  oi = (struct ospf6_interface *) ifp->info;
+  if (oi == NULL)
+    oi = ospf6_interface_create (ifp);
+  assert (oi);
+
+  oi->lsack_delay = strtol (argv[0], NULL, 10);
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_ipv6_ospf6_lsackdelay,
+       no_ipv6_ospf6_lsackdelay_cmd,
+       "no ipv6 ospf6 lsack-delay",
+       NO_STR
+       IP6_STR
+       OSPF6_STR
+       "Delay before sending delayed link state acknowledgements\n"
+       )
+{
+  struct ospf6_interface *oi;
+  struct interface *ifp;
+
+  ifp = (struct interface *) vty->index;
+  assert (ifp);
+
+  oi = (struct ospf6_interface *) ifp->info;
+  if (oi == NULL)
+    oi = ospf6_interface_create (ifp);
+  assert (oi);
+
+  oi->lsack_delay = OSPF6_INTERFACE_LSACK_DELAY;
+  return CMD_SUCCESS;
+}
+
 /* interface variable set command */
 DEFUN (ipv6_ospf6_priority,
        ipv6_ospf6_priority_cmd,
@@ -1570,6 +1686,10 @@ config_write_ospf6_interface (struct vty *vty)
         vty_out (vty, " ipv6 ospf6 retransmit-interval %d%s",
                  oi->rxmt_interval, VNL);
 
+      if (oi->lsack_delay != OSPF6_INTERFACE_LSACK_DELAY)
+        vty_out (vty, " ipv6 ospf6 lsack-delay %u%s",
+                 oi->lsack_delay, VNL);
+
       if (oi->priority != OSPF6_INTERFACE_PRIORITY)
         vty_out (vty, " ipv6 ospf6 priority %d%s",
                  oi->priority, VNL);
@@ -1639,6 +1759,8 @@ ospf6_interface_init (void)
   install_element (INTERFACE_NODE, &ipv6_ospf6_priority_cmd);
   install_element (INTERFACE_NODE, &ipv6_ospf6_retransmitinterval_cmd);
   install_element (INTERFACE_NODE, &ipv6_ospf6_transmitdelay_cmd);
+  install_element (INTERFACE_NODE, &ipv6_ospf6_lsackdelay_cmd);
+  install_element (INTERFACE_NODE, &no_ipv6_ospf6_lsackdelay_cmd);
   install_element (INTERFACE_NODE, &ipv6_ospf6_instance_cmd);
 
   install_element (INTERFACE_NODE, &ipv6_ospf6_passive_cmd);
@@ -45,6 +45,15 @@ struct ospf6_interface
   /* list of ospf6 neighbor */
   struct list *neighbor_list;
 
+  /* ospf6 neighbors indexed by Router ID */
+  struct hash *neighbor_hash;
+
+  /* DR/BDR candidates, best first: neighbors declaring themselves DR,
+     declaring themselves BDR (but not DR), and the other eligible ones */
+  struct list *dr_candidate_list;
+  struct list *bdr_candidate_list;
+  struct list *eligible_list;
+
   /* linklocal address of this I/F */
   struct in6_addr *linklocal_addr;
 
@@ -54,7 +63,6 @@ struct ospf6_interface
 
   /* list of prefixes stored in non-volatile memory */
   struct list *associated_prefixes;
-  struct thread *associated_prefixes_writer;
 
   /* Interface ID; use interface->ifindex */
 
@@ -72,6 +80,9 @@ struct ospf6_interface
   u_int16_t dead_interval;
   u_int32_t rxmt_interval;
 
+  /* Delayed acknowledgement window in milliseconds */
+  u_int32_t lsack_delay;
+
   u_int32_t state_change;
 
   /* Cost */
@@ -102,6 +113,11 @@ struct ospf6_interface
   struct ospf6_lsdb *lsupdate_list;
   struct ospf6_lsdb *lsack_list;
 
+  /* LSAck statistics */
+  u_int32_t lsack_packets;     /* LSAck packets sent */
+  u_int32_t lsack_headers;     /* LSA headers acknowledged in them */
+  u_int32_t lsack_suppressed;  /* duplicate acks not queued */
+
   /* Ongoing Tasks */
   struct thread *thread_send_hello;
   struct thread *thread_send_lsupdate;
@@ -139,6 +155,7 @@ extern const char *ospf6_interface_state_str[];
 #define OSPF6_INTERFACE_DEAD_INTERVAL  40
 #define OSPF6_INTERFACE_AUTO_WAIT_INTERVAL 11
 #define OSPF6_INTERFACE_RXMT_INTERVAL  5
+#define OSPF6_INTERFACE_LSACK_DELAY    3000 /* msec */
 #define OSPF6_INTERFACE_COST           1
 #define OSPF6_INTERFACE_PRIORITY       1
 #define OSPF6_INTERFACE_TRANSDELAY     1
@@ -166,6 +183,9 @@ extern int wait_timer (struct thread *);
 extern int backup_seen (struct thread *);
 extern int neighbor_change (struct thread *);
 
+struct ospf6_neighbor;
+extern void ospf6_interface_candidate_update (struct ospf6_neighbor *);
+
 extern void ospf6_interface_init (void);
 
 extern int config_write_ospf6_debug_interface (struct vty *vty);
@@ -766,6 +766,197 @@ ospf6_ac_lsa_show (struct vty *vty, struct ospf6_lsa *lsa)
   return 0;
 }
 
+/* A TLV of the self-originated AC-LSA, other than the fingerprint, and
+   the fragment (LS-ID) it is placed in */
+struct ospf6_ac_tlv_entry
+{
+  union
+  {
+    struct ospf6_ac_tlv_header header;
+    struct ospf6_ac_tlv_aggregated_prefix aggregated;
+    struct ospf6_ac_tlv_assigned_prefix assigned;
+  } tlv;
+  u_int16_t size;
+  u_int32_t fragment;
+  u_int32_t order;
+};
+#define OSPF6_AC_TLV_UNPLACED 0xffffffff
+
+#define OSPF6_AC_TLV_SIZE(h) \
+  (sizeof (struct ospf6_ac_tlv_header) + ((ntohs ((h)->length) + 3) / 4) * 4)
+
+static int
+ospf6_ac_tlv_entry_cmp (const void *a, const void *b)
+{
+  const struct ospf6_ac_tlv_entry *ea = a;
+  const struct ospf6_ac_tlv_entry *eb = b;
+
+  if (ea->fragment != eb->fragment)
+    return (ea->fragment < eb->fragment ? -1 : 1);
+  if (ea->order != eb->order)
+    return (ea->order < eb->order ? -1 : 1);
+  return 0;
+}
+
+/* Self-advertised aggregated prefixes and self-assigned prefixes */
+static struct ospf6_ac_tlv_entry *
+ospf6_ac_lsa_tlvs (struct ospf6_area *oa, unsigned int *count)
+{
+  struct ospf6_ac_tlv_entry *tlvs, *e;
+  struct listnode *node, *inner_node;
+  struct ospf6_aggregated_prefix *aggregated_prefix;
+  struct ospf6_assigned_prefix *assigned_prefix;
+  struct ospf6_interface *ifp;
+  unsigned int n;
+
+  n = listcount (ospf6->aggregated_prefix_list);
+  for (ALL_LIST_ELEMENTS_RO (oa->if_list, node, ifp))
+    n += listcount (ifp->assigned_prefix_list);
+  tlvs = XCALLOC (MTYPE_OSPF6_OTHER,
+                  (n ? n : 1) * sizeof (struct ospf6_ac_tlv_entry));
+
+  n = 0;
+  for (ALL_LIST_ELEMENTS_RO (ospf6->aggregated_prefix_list, node,
+                             aggregated_prefix))
+    {
+      if (aggregated_prefix->advertising_router_id != ospf6->router_id)
+        continue;
+      e = &tlvs[n++];
+      e->tlv.aggregated.header.type = htons (OSPF6_AC_TLV_AGGREGATED_PREFIX);
+      e->tlv.aggregated.header.length =
+        htons (OSPF6_AC_TLV_AGGREGATED_PREFIX_LENGTH);
+      e->tlv.aggregated.prefix_length = aggregated_prefix->prefix.prefixlen;
+      e->tlv.aggregated.prefix = aggregated_prefix->prefix.u.prefix6;
+      e->size = sizeof (struct ospf6_ac_tlv_aggregated_prefix);
+    }
+
+  for (ALL_LIST_ELEMENTS_RO (oa->if_list, node, ifp))
+    for (ALL_LIST_ELEMENTS_RO (ifp->assigned_prefix_list, inner_node,
+                               assigned_prefix))
+      {
+        if (assigned_prefix->assigning_router_id != ospf6->router_id)
+          continue;
+        e = &tlvs[n++];
+        e->tlv.assigned.header.type = htons (OSPF6_AC_TLV_ASSIGNED_PREFIX);
+        e->tlv.assigned.header.length =
+          htons (OSPF6_AC_TLV_ASSIGNED_PREFIX_LENGTH);
+        e->tlv.assigned.prefix_length = assigned_prefix->prefix.prefixlen;
+        e->tlv.assigned.prefix = assigned_prefix->prefix.u.prefix6;
+        e->tlv.assigned.interface_id = ifp->interface->ifindex;
+        e->size = sizeof (struct ospf6_ac_tlv_assigned_prefix);
+      }
+
+  *count = n;
+  return tlvs;
+}
+
+/* Place the TLVs into fragments.  A TLV already advertised stays in the
+   fragment that carries it, in the same position, so that a change
+   only alters the fragments it touches: ospf6_lsa_originate () then
+   suppresses the others.  New TLVs go into the first fragment with
+   room.  Returns the number of fragments, whose sizes are in used[]. */
+static u_int32_t
+ospf6_ac_lsa_place (struct ospf6_area *oa, struct ospf6_ac_tlv_entry *tlvs,
+                    unsigned int count, u_int16_t *used)
+{
+  struct ospf6_lsa *lsa;
+  struct ospf6_ac_tlv_header *h;
+  char *current, *end;
+  u_int16_t type = htons (OSPF6_LSTYPE_AC);
+  u_int32_t id, nfragment = 1, order = 0;
+  unsigned int i;
+
+  for (id = 0; id < OSPF6_AC_LSA_MAX_FRAGMENTS; id++)
+    used[id] = sizeof (struct ospf6_lsa_header) + sizeof (struct ospf6_ac_lsa);
+  used[0] += sizeof (struct ospf6_ac_tlv_router_hardware_fingerprint);
+
+  for (i = 0; i < count; i++)
+    tlvs[i].fragment = OSPF6_AC_TLV_UNPLACED;
+
+  for (lsa = ospf6_lsdb_type_router_head (type, oa->ospf6->router_id,
+                                          oa->lsdb);
+       lsa; lsa = ospf6_lsdb_type_router_next (type, oa->ospf6->router_id, lsa))
+    {
+      id = ntohl (lsa->header->id);
+      if (id >= OSPF6_AC_LSA_MAX_FRAGMENTS || OSPF6_LSA_IS_MAXAGE (lsa))
+        continue;
+
+      current = (char *) lsa->header + sizeof (struct ospf6_lsa_header)
+                + sizeof (struct ospf6_ac_lsa);
+      end = (char *) lsa->header + ntohs (lsa->header->length);
+      while (current + sizeof (struct ospf6_ac_tlv_header) <= end)
+        {
+          h = (struct ospf6_ac_tlv_header *) current;
+          for (i = 0; i < count; i++)
+            {
+              if (tlvs[i].fragment != OSPF6_AC_TLV_UNPLACED ||
+                  tlvs[i].size != OSPF6_AC_TLV_SIZE (h) ||
+                  current + tlvs[i].size > end ||
+                  memcmp (&tlvs[i].tlv, current, tlvs[i].size))
+                continue;
+              tlvs[i].fragment = id;
+              tlvs[i].order = order++;
+              used[id] += tlvs[i].size;
+              if (id >= nfragment)
+                nfragment = id + 1;
+              break;
+            }
+          current += OSPF6_AC_TLV_SIZE (h);
+        }
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      if (tlvs[i].fragment != OSPF6_AC_TLV_UNPLACED)
+        continue;
+      for (id = 0; id < OSPF6_AC_LSA_MAX_FRAGMENTS; id++)
+        if (used[id] + tlvs[i].size <= OSPF6_AC_LSA_FRAGMENT_SIZE)
+          break;
+      if (id == OSPF6_AC_LSA_MAX_FRAGMENTS)
+        {
+          zlog_warn ("AC-LSA: no room left for TLV, not advertised");
+          continue;
+        }
+      tlvs[i].fragment = id;
+      tlvs[i].order = order++;
+      used[id] += tlvs[i].size;
+      if (id >= nfragment)
+        nfragment = id + 1;
+    }
+
+  return nfragment;
+}
+
+/* Request AC-LSA origination.  Requests made while one is pending,
+   such as the several made by one prefix assignment run, are folded
+   into it, and originations are kept MinLSInterval apart. */
+void
+ospf6_ac_lsa_schedule (struct ospf6_area *oa)
+{
+  struct timeval now, elapsed;
+  long delay;
+
+  oa->ac_lsa_schedule++;
+  if (oa->thread_ac_lsa)
+    return;
+
+  delay = 0;
+  if (timerisset (&oa->ac_lsa_originated))
+    {
+      quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+      timersub (&now, &oa->ac_lsa_originated, &elapsed);
+      delay = MIN_LS_INTERVAL * 1000
+              - (elapsed.tv_sec * 1000 + elapsed.tv_usec / 1000);
+    }
+
+  if (delay > 0)
+    oa->thread_ac_lsa =
+      thread_add_timer_msec (master, ospf6_ac_lsa_originate, oa, delay);
+  else
+    oa->thread_ac_lsa =
+      thread_add_event (master, ospf6_ac_lsa_originate, oa, 0);
+}
+
 /* Originate an Auto-Configuration LSA */
 int
 ospf6_ac_lsa_originate (struct thread *thread)
@@ -774,18 +965,16 @@ ospf6_ac_lsa_originate (struct thread *thread)
 
   char buffer [OSPF6_MAX_LSASIZE];
   struct ospf6_lsa_header *lsa_header;
-  struct ospf6_lsa *lsa;
+  struct ospf6_lsa *lsa, *old;
 
-  u_int32_t link_state_id = 0;
-  void *current_tlv;
+  u_int32_t link_state_id, nfragment;
+  char *current_tlv;
   struct ospf6_ac_lsa *ac_lsa;
   struct ospf6_ac_tlv_router_hardware_fingerprint *ac_tlv_rhwfp;
-  struct ospf6_ac_tlv_aggregated_prefix *ac_tlv_ag_p;
-  struct ospf6_ac_tlv_assigned_prefix *ac_tlv_as_p;
-
-  struct listnode *node, *nextnode;
-  struct ospf6_aggregated_prefix *aggregated_prefix;
-  struct ospf6_interface *ifp;
+  struct ospf6_ac_tlv_entry *tlvs;
+  unsigned int count, i;
+  u_int16_t used[OSPF6_AC_LSA_MAX_FRAGMENTS];
+  u_int16_t type;
 
   oa = (struct ospf6_area *) THREAD_ARG (thread);
   oa->thread_ac_lsa = NULL;
@@ -795,82 +984,96 @@ ospf6_ac_lsa_originate (struct thread *thread)
   if (IS_OSPF6_DEBUG_ORIGINATE (ROUTER))
     zlog_debug ("Originate AC-LSA for Area %s", oa->name);
 
-  memset (buffer, 0, sizeof (buffer));
+  tlvs = ospf6_ac_lsa_tlvs (oa, &count);
+  nfragment = ospf6_ac_lsa_place (oa, tlvs, count, used);
+  qsort (tlvs, count, sizeof (struct ospf6_ac_tlv_entry),
+         ospf6_ac_tlv_entry_cmp);
+
   lsa_header = (struct ospf6_lsa_header *) buffer;
   ac_lsa = (struct ospf6_ac_lsa *)
     ((caddr_t) lsa_header + sizeof (struct ospf6_lsa_header));
-  
-  current_tlv = ac_lsa;
-
-  /* Fill AC-LSA */
-  /* Router-Hardware Fingerprint */
-  ac_tlv_rhwfp = (struct ospf6_ac_tlv_router_hardware_fingerprint *) current_tlv; 
-  ac_tlv_rhwfp->header.type = htons (OSPF6_AC_TLV_ROUTER_HARDWARE_FINGERPRINT);
-  ac_tlv_rhwfp->header.length = htons (OSPF6_AC_TLV_RHWFP_LENGTH);
-  ac_tlv_rhwfp->value = ospf6_generate_router_hardware_fingerprint ();
 
-  /* Step onto next tlv? */
-  current_tlv = ++ac_tlv_rhwfp;
+  i = 0;
+  for (link_state_id = 0; link_state_id < nfragment; link_state_id++)
+    {
+      memset (buffer, 0, sizeof (buffer));
+      current_tlv = (char *) ac_lsa;
 
-  /* Aggregated (allocated) prefixes */
-  for (ALL_LIST_ELEMENTS (ospf6->aggregated_prefix_list, node, nextnode, aggregated_prefix)) 
-  {
-    if (aggregated_prefix->advertising_router_id == ospf6->router_id) {
-      ac_tlv_ag_p = (struct ospf6_ac_tlv_aggregated_prefix *) current_tlv;
-      ac_tlv_ag_p->header.type = htons (OSPF6_AC_TLV_AGGREGATED_PREFIX);
-      ac_tlv_ag_p->header.length = htons (OSPF6_AC_TLV_AGGREGATED_PREFIX_LENGTH);
+      /* Router-Hardware Fingerprint, in the first fragment only */
+      if (link_state_id == 0)
+        {
+          ac_tlv_rhwfp =
+            (struct ospf6_ac_tlv_router_hardware_fingerprint *) current_tlv;
+          ac_tlv_rhwfp->header.type =
+            htons (OSPF6_AC_TLV_ROUTER_HARDWARE_FINGERPRINT);
+          ac_tlv_rhwfp->header.length = htons (OSPF6_AC_TLV_RHWFP_LENGTH);
+          ac_tlv_rhwfp->value = ospf6_generate_router_hardware_fingerprint ();
+          current_tlv += sizeof (*ac_tlv_rhwfp);
+        }
+      else if (i == count || tlvs[i].fragment != link_state_id)
+        continue;   /* emptied fragment, flushed below */
 
-      /* Send prefix */ 
-      ac_tlv_ag_p->prefix_length = aggregated_prefix->prefix.prefixlen;
-      ac_tlv_ag_p->prefix = aggregated_prefix->prefix.u.prefix6;
+      /* Aggregated (allocated) and assigned prefixes of this fragment */
+      for (; i < count && tlvs[i].fragment == link_state_id; i++)
+        {
+          memcpy (current_tlv, &tlvs[i].tlv, tlvs[i].size);
+          current_tlv += tlvs[i].size;
+        }
 
-      current_tlv = ++ac_tlv_ag_p;
-    }
-  }
- 
-  /* Assigned prefixes */
-  for (ALL_LIST_ELEMENTS (oa->if_list, node, nextnode, ifp)) 
-  {
-    struct listnode *inner_node, *inner_nextnode;
-    struct ospf6_assigned_prefix *assigned_prefix;
-    
-    for (ALL_LIST_ELEMENTS (ifp->assigned_prefix_list, inner_node, inner_nextnode, assigned_prefix)) 
-    {
-      if (assigned_prefix->assigning_router_id == ospf6->router_id) {
-	ac_tlv_as_p = (struct ospf6_ac_tlv_assigned_prefix *) current_tlv;
-	ac_tlv_as_p->header.type = htons (OSPF6_AC_TLV_ASSIGNED_PREFIX);
-	ac_tlv_as_p->header.length = htons (OSPF6_AC_TLV_ASSIGNED_PREFIX_LENGTH);
+      /* Same TLVs as the installed instance: no new sequence number */
+      old = ospf6_lsdb_lookup (htons (OSPF6_LSTYPE_AC), htonl (link_state_id),
+                               oa->ospf6->router_id, oa->lsdb);
+      if (old && ! OSPF6_LSA_IS_MAXAGE (old) &&
+          ntohs (old->header->length) == current_tlv - buffer &&
+          ! memcmp ((char *) old->header + sizeof (struct ospf6_lsa_header),
+                    (char *) ac_lsa, current_tlv - (char *) ac_lsa))
+        {
+          oa->ac_lsa_suppressed++;
+          continue;
+        }
 
-	/* Send prefix */ 
-	ac_tlv_as_p->prefix_length = assigned_prefix->prefix.prefixlen;
-	ac_tlv_as_p->prefix = assigned_prefix->prefix.u.prefix6;
-	ac_tlv_as_p->interface_id = ifp->interface->ifindex;
+      /* Fill LSA Header */
+      lsa_header->age = 0;
+      lsa_header->type = htons (OSPF6_LSTYPE_AC);
+      lsa_header->id = htonl (link_state_id);
+      lsa_header->adv_router = oa->ospf6->router_id;
+      lsa_header->seqnum =
+        ospf6_new_ls_seqnum (lsa_header->type, lsa_header->id,
+            lsa_header->adv_router, oa->lsdb);
+      lsa_header->length = htons (current_tlv - buffer);
 
-	current_tlv = ++ac_tlv_as_p;
-      }
-    }
-  }
+      /* LSA checksum */
+      ospf6_lsa_checksum (lsa_header);
 
-  /* Fill LSA Header */
-  lsa_header->age = 0;
-  lsa_header->type = htons (OSPF6_LSTYPE_AC);
-  lsa_header->id = htonl (link_state_id);
-  lsa_header->adv_router = oa->ospf6->router_id;
-  lsa_header->seqnum =
-    ospf6_new_ls_seqnum (lsa_header->type, lsa_header->id,
-	lsa_header->adv_router, oa->lsdb);
-  lsa_header->length = htons ((caddr_t) current_tlv - (caddr_t) buffer);
+      /* create LSA */
+      lsa = ospf6_lsa_create (lsa_header);
 
-  /* LSA checksum */
-  ospf6_lsa_checksum (lsa_header);
+      /* Originate */
+      ospf6_lsa_originate_area (lsa, oa);
+      oa->ac_lsa_origination++;
+      quagga_gettime (QUAGGA_CLK_MONOTONIC, &oa->ac_lsa_originated);
+    }
 
-  /* create LSA */
-  lsa = ospf6_lsa_create (lsa_header);
+  XFREE (MTYPE_OSPF6_OTHER, tlvs);
 
-  /* Originate */
-  ospf6_lsa_originate_area (lsa, oa);
+  /* Do premature-aging of emptied and rest, undesired AC-LSAs */
+  type = htons (OSPF6_LSTYPE_AC);
+  for (lsa = ospf6_lsdb_type_router_head (type, oa->ospf6->router_id,
+                                          oa->lsdb);
+       lsa; lsa = ospf6_lsdb_type_router_next (type, oa->ospf6->router_id, lsa))
+    {
+      link_state_id = ntohl (lsa->header->id);
+      if (link_state_id == 0 ||
+          (link_state_id < nfragment &&
+           used[link_state_id] > sizeof (struct ospf6_lsa_header)
+                                 + sizeof (struct ospf6_ac_lsa)))
+        continue;
+      if (! OSPF6_LSA_IS_MAXAGE (lsa))
+        ospf6_lsa_purge (lsa);
+    }
 
-  zlog_warn ("Originating AC-LSA");
+  if (IS_OSPF6_DEBUG_AUTO)
+    zlog_debug ("Originating AC-LSA");
   return 0;
 }
 
@@ -1282,6 +1485,35 @@ ospf6_intra_prefix_lsa_originate_transit (struct thread *thread)
   return 0;
 }
 
+/* Build the link state prefix of the vertex (Router-LSA or
+   Network-LSA) an Intra-Area-Prefix-LSA refers to.  The referenced
+   LSA is always originated by the advertising router of the
+   Intra-Area-Prefix-LSA itself (RFC 5340 A.4.10), which is what lets
+   the route calculation find the LSAs depending on a vertex by
+   advertising router alone; references breaking this are ignored. */
+static int
+ospf6_intra_prefix_lsa_reference (struct ospf6_lsa *lsa,
+                                  struct prefix *ls_prefix)
+{
+  struct ospf6_intra_prefix_lsa *intra_prefix_lsa;
+
+  intra_prefix_lsa = (struct ospf6_intra_prefix_lsa *)
+    OSPF6_LSA_HEADER_END (lsa->header);
+  if (intra_prefix_lsa->ref_adv_router != lsa->header->adv_router)
+    return -1;
+
+  if (intra_prefix_lsa->ref_type == htons (OSPF6_LSTYPE_ROUTER))
+    ospf6_linkstate_prefix (intra_prefix_lsa->ref_adv_router,
+                            htonl (0), ls_prefix);
+  else if (intra_prefix_lsa->ref_type == htons (OSPF6_LSTYPE_NETWORK))
+    ospf6_linkstate_prefix (intra_prefix_lsa->ref_adv_router,
+                            intra_prefix_lsa->ref_id, ls_prefix);
+  else
+    return -1;
+
+  return 0;
+}
+
 void
 ospf6_intra_prefix_lsa_add (struct ospf6_lsa *lsa)
 {
@@ -1289,7 +1521,7 @@ ospf6_intra_prefix_lsa_add (struct ospf6_lsa *lsa)
   struct ospf6_intra_prefix_lsa *intra_prefix_lsa;
   struct prefix ls_prefix;
   struct ospf6_route *route, *ls_entry;
-  int i, prefix_num;
+  int prefix_num;
   struct ospf6_prefix *op;
   char *start, *current, *end;
   char buf[64];
@@ -1304,16 +1536,10 @@ ospf6_intra_prefix_lsa_add (struct ospf6_lsa *lsa)
 
   intra_prefix_lsa = (struct ospf6_intra_prefix_lsa *)
     OSPF6_LSA_HEADER_END (lsa->header);
-  if (intra_prefix_lsa->ref_type == htons (OSPF6_LSTYPE_ROUTER))
-    ospf6_linkstate_prefix (intra_prefix_lsa->ref_adv_router,
-                            htonl (0), &ls_prefix);
-  else if (intra_prefix_lsa->ref_type == htons (OSPF6_LSTYPE_NETWORK))
-    ospf6_linkstate_prefix (intra_prefix_lsa->ref_adv_router,
-                            intra_prefix_lsa->ref_id, &ls_prefix);
-  else
+  if (ospf6_intra_prefix_lsa_reference (lsa, &ls_prefix) < 0)
     {
       if (IS_OSPF6_DEBUG_EXAMIN (INTRA_PREFIX))
-        zlog_debug ("Unknown reference LS-type: %#hx",
+        zlog_debug ("Unknown reference LS-type %#hx or advertising router",
 		    ntohs (intra_prefix_lsa->ref_type));
       return;
     }
@@ -1359,9 +1585,7 @@ ospf6_intra_prefix_lsa_add (struct ospf6_lsa *lsa)
       route->path.cost = ls_entry->path.cost +
                          ntohs (op->prefix_metric);
 
-      for (i = 0; ospf6_nexthop_is_set (&ls_entry->nexthop[i]) &&
-           i < OSPF6_MULTI_PATH_LIMIT; i++)
-        ospf6_nexthop_copy (&route->nexthop[i], &ls_entry->nexthop[i]);
+      ospf6_route_set_nexthops (route, ls_entry->nh);
 
       if (IS_OSPF6_DEBUG_EXAMIN (INTRA_PREFIX))
         {
@@ -1449,59 +1673,187 @@ ospf6_intra_prefix_lsa_remove (struct ospf6_lsa *lsa)
     zlog_debug ("Trailing garbage ignored");
 }
 
-void
-ospf6_intra_route_calculation (struct ospf6_area *oa)
+/* Settle the flags left on an intra-area route by re-adding it with
+   the route table hooks disabled, and run the hooks for what actually
+   changed. */
+static void
+ospf6_intra_route_settle (struct ospf6_route *route,
+                          struct ospf6_route_table *table)
+{
+  if (CHECK_FLAG (route->flag, OSPF6_ROUTE_REMOVE) &&
+      CHECK_FLAG (route->flag, OSPF6_ROUTE_ADD))
+    {
+      UNSET_FLAG (route->flag, OSPF6_ROUTE_REMOVE);
+      UNSET_FLAG (route->flag, OSPF6_ROUTE_ADD);
+    }
+
+  if (CHECK_FLAG (route->flag, OSPF6_ROUTE_REMOVE))
+    ospf6_route_remove (route, table);
+  else if (CHECK_FLAG (route->flag, OSPF6_ROUTE_ADD) ||
+           CHECK_FLAG (route->flag, OSPF6_ROUTE_CHANGE))
+    {
+      if (table->hook_add)
+        (*table->hook_add) (route);
+    }
+
+  UNSET_FLAG (route->flag, OSPF6_ROUTE_ADD);
+  UNSET_FLAG (route->flag, OSPF6_ROUTE_CHANGE);
+  UNSET_FLAG (route->flag, OSPF6_ROUTE_REMOVE);
+}
+
+/* Walk the intra-area routes originated by an Intra-Area-Prefix-LSA,
+   either marking them for removal or settling them. */
+static void
+ospf6_intra_prefix_lsa_routes (struct ospf6_lsa *lsa, struct ospf6_area *oa,
+                               int settle)
+{
+  struct ospf6_intra_prefix_lsa *intra_prefix_lsa;
+  struct prefix prefix;
+  struct ospf6_route *route, *next;
+  int prefix_num;
+  struct ospf6_prefix *op;
+  char *start, *current, *end;
+
+  intra_prefix_lsa = (struct ospf6_intra_prefix_lsa *)
+    OSPF6_LSA_HEADER_END (lsa->header);
+
+  prefix_num = ntohs (intra_prefix_lsa->prefix_num);
+  start = (caddr_t) intra_prefix_lsa +
+          sizeof (struct ospf6_intra_prefix_lsa);
+  end = OSPF6_LSA_END (lsa->header);
+  for (current = start; current < end; current += OSPF6_PREFIX_SIZE (op))
+    {
+      op = (struct ospf6_prefix *) current;
+      if (prefix_num == 0)
+        break;
+      if (end < current + OSPF6_PREFIX_SIZE (op))
+        break;
+      prefix_num--;
+
+      memset (&prefix, 0, sizeof (struct prefix));
+      prefix.family = AF_INET6;
+      prefix.prefixlen = op->prefix_length;
+      ospf6_prefix_in6_addr (&prefix.u.prefix6, op);
+
+      route = ospf6_route_lookup (&prefix, oa->route_table);
+      if (route == NULL)
+        continue;
+
+      for (ospf6_route_lock (route);
+           route && ospf6_route_is_prefix (&prefix, route);
+           route = next)
+        {
+          next = ospf6_route_next (route);
+
+          if (route->type != OSPF6_DEST_TYPE_NETWORK ||
+              route->path.area_id != oa->area_id ||
+              route->path.type != OSPF6_PATH_TYPE_INTRA ||
+              route->path.origin.type != lsa->header->type ||
+              route->path.origin.id != lsa->header->id ||
+              route->path.origin.adv_router != lsa->header->adv_router)
+            continue;
+
+          if (settle)
+            ospf6_intra_route_settle (route, oa->route_table);
+          else
+            SET_FLAG (route->flag, OSPF6_ROUTE_REMOVE);
+        }
+      if (route)
+        ospf6_route_unlock (route);
+    }
+}
+
+/* Recalculate the routes of the Intra-Area-Prefix-LSAs referring to a
+   vertex whose cost or nexthops changed, or which (dis)appeared. */
+static void
+ospf6_intra_route_vertex_recalc (struct prefix *vertex_id,
+                                 struct ospf6_area *oa)
 {
-  struct ospf6_route *route;
-  u_int16_t type;
   struct ospf6_lsa *lsa;
+  struct prefix ls_prefix;
+  u_int16_t type;
+  u_int32_t adv_router;
   void (*hook_add) (struct ospf6_route *) = NULL;
   void (*hook_remove) (struct ospf6_route *) = NULL;
 
-  if (IS_OSPF6_DEBUG_EXAMIN (INTRA_PREFIX))
-    zlog_debug ("Re-examin intra-routes for area %s", oa->name);
+  type = htons (OSPF6_LSTYPE_INTRA_PREFIX);
+  adv_router = ADV_ROUTER_IN_PREFIX (vertex_id);
 
-  hook_add = oa->route_table->hook_add;
-  hook_remove = oa->route_table->hook_remove;
-  oa->route_table->hook_add = NULL;
-  oa->route_table->hook_remove = NULL;
+  for (lsa = ospf6_lsdb_type_router_head (type, adv_router, oa->lsdb); lsa;
+       lsa = ospf6_lsdb_type_router_next (type, adv_router, lsa))
+    {
+      if (ospf6_intra_prefix_lsa_reference (lsa, &ls_prefix) < 0 ||
+          ! prefix_same (&ls_prefix, vertex_id))
+        continue;
 
-  for (route = ospf6_route_head (oa->route_table); route;
-       route = ospf6_route_next (route))
-    route->flag = OSPF6_ROUTE_REMOVE;
+      ospf6_intra_prefix_lsa_routes (lsa, oa, 0);
 
-  type = htons (OSPF6_LSTYPE_INTRA_PREFIX);
-  for (lsa = ospf6_lsdb_type_head (type, oa->lsdb); lsa;
-       lsa = ospf6_lsdb_type_next (type, lsa))
-    ospf6_intra_prefix_lsa_add (lsa);
+      hook_add = oa->route_table->hook_add;
+      hook_remove = oa->route_table->hook_remove;
+      oa->route_table->hook_add = NULL;
+      oa->route_table->hook_remove = NULL;
 
-  oa->route_table->hook_add = hook_add;
-  oa->route_table->hook_remove = hook_remove;
+      ospf6_intra_prefix_lsa_add (lsa);
 
-  for (route = ospf6_route_head (oa->route_table); route;
-       route = ospf6_route_next (route))
-    {
-      if (CHECK_FLAG (route->flag, OSPF6_ROUTE_REMOVE) &&
-          CHECK_FLAG (route->flag, OSPF6_ROUTE_ADD))
-        {
-          UNSET_FLAG (route->flag, OSPF6_ROUTE_REMOVE);
-          UNSET_FLAG (route->flag, OSPF6_ROUTE_ADD);
-        }
+      oa->route_table->hook_add = hook_add;
+      oa->route_table->hook_remove = hook_remove;
 
-      if (CHECK_FLAG (route->flag, OSPF6_ROUTE_REMOVE))
-        ospf6_route_remove (route, oa->route_table);
-      else if (CHECK_FLAG (route->flag, OSPF6_ROUTE_ADD) ||
-               CHECK_FLAG (route->flag, OSPF6_ROUTE_CHANGE))
-        {
-          if (hook_add)
-            (*hook_add) (route);
-        }
+      ospf6_intra_prefix_lsa_routes (lsa, oa, 1);
+    }
+}
+
+static int
+ospf6_intra_vertex_is_changed (struct ospf6_route *vertex,
+                               struct ospf6_route_table *old_spf_table)
+{
+  struct ospf6_route *old;
+
+  old = ospf6_route_lookup (&vertex->prefix, old_spf_table);
+  if (old == NULL)
+    return 1;
+  if (old->path.cost != vertex->path.cost)
+    return 1;
+  /* interned nexthop sets are the same if and only if equal */
+  if (old->nh != vertex->nh)
+    return 1;
+  return 0;
+}
+
+/* Bring the intra-area routes in line with a new SPF result.  Changes
+   of Intra-Area-Prefix-LSAs themselves are applied by the LSDB hooks
+   as they happen, so only the LSAs referring to vertices that differ
+   from the previous SPF result (old_spf_table) are looked at. */
+void
+ospf6_intra_route_calculation (struct ospf6_area *oa,
+                               struct ospf6_route_table *old_spf_table)
+{
+  struct ospf6_route *vertex;
+  unsigned int changed = 0;
+
+  if (IS_OSPF6_DEBUG_EXAMIN (INTRA_PREFIX))
+    zlog_debug ("Re-examin intra-routes for area %s", oa->name);
 
-      route->flag = 0;
+  for (vertex = ospf6_route_head (oa->spf_table); vertex;
+       vertex = ospf6_route_next (vertex))
+    {
+      if (! ospf6_intra_vertex_is_changed (vertex, old_spf_table))
+        continue;
+      ospf6_intra_route_vertex_recalc (&vertex->prefix, oa);
+      changed++;
+    }
+
+  for (vertex = ospf6_route_head (old_spf_table); vertex;
+       vertex = ospf6_route_next (vertex))
+    {
+      if (ospf6_route_lookup (&vertex->prefix, oa->spf_table))
+        continue;
+      ospf6_intra_route_vertex_recalc (&vertex->prefix, oa);
+      changed++;
     }
 
   if (IS_OSPF6_DEBUG_EXAMIN (INTRA_PREFIX))
-    zlog_debug ("Re-examin intra-routes for area %s: Done", oa->name);
+    zlog_debug ("Re-examin intra-routes for area %s: Done, %u vertices changed",
+                oa->name, changed);
 }
 
 static void
@@ -137,6 +137,11 @@ struct ospf6_link_lsa
 
 /* Auto-Configuration-LSA */
 #define OSPF6_AC_LSA_MIN_SIZE             4U
+/* AC-LSA content is split over LS-IDs 0 .. MAX_FRAGMENTS - 1, each no
+   larger than FRAGMENT_SIZE so that it fits an LSUpdate at the IPv6
+   minimum MTU.  The fingerprint TLV is always in LS-ID 0. */
+#define OSPF6_AC_LSA_FRAGMENT_SIZE        1024U
+#define OSPF6_AC_LSA_MAX_FRAGMENTS        64U
 struct ospf6_ac_lsa
 {
   /* followed by tlv(s) */
@@ -213,12 +218,7 @@ struct ospf6_intra_prefix_lsa
       (oi)->thread_link_lsa = \
         thread_add_event (master, ospf6_link_lsa_originate, oi, 0); \
   } while (0)
-#define OSPF6_AC_LSA_SCHEDULE(oa) \
-  do { \
-    if (! (oa)->thread_ac_lsa) \
-      (oa)->thread_ac_lsa = \
-        thread_add_event (master, ospf6_ac_lsa_originate, oa, 0); \
-  } while (0)
+#define OSPF6_AC_LSA_SCHEDULE(oa) ospf6_ac_lsa_schedule (oa)
 #define OSPF6_INTRA_PREFIX_LSA_SCHEDULE_STUB(oa) \
   do { \
     if (! (oa)->thread_intra_prefix_lsa) \
@@ -258,12 +258,14 @@ extern int ospf6_router_lsa_originate (struct thread *);
 extern int ospf6_network_lsa_originate (struct thread *);
 extern int ospf6_link_lsa_originate (struct thread *);
 extern int ospf6_ac_lsa_originate (struct thread *);
+extern void ospf6_ac_lsa_schedule (struct ospf6_area *oa);
 extern int ospf6_intra_prefix_lsa_originate_transit (struct thread *);
 extern int ospf6_intra_prefix_lsa_originate_stub (struct thread *);
 extern void ospf6_intra_prefix_lsa_add (struct ospf6_lsa *lsa);
 extern void ospf6_intra_prefix_lsa_remove (struct ospf6_lsa *lsa);
 
-extern void ospf6_intra_route_calculation (struct ospf6_area *oa);
+extern void ospf6_intra_route_calculation (struct ospf6_area *oa,
+                                           struct ospf6_route_table *old);
 extern void ospf6_intra_brouter_calculation (struct ospf6_area *oa);
 
 extern void ospf6_intra_init (void);
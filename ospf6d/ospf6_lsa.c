@@ -202,22 +202,20 @@ ospf6_lsa_age_set (struct ospf6_lsa *lsa)
 }
 
 /* this function calculates current age from its birth,
-   then update age field of LSA header. return value is current age */
+   then update age field of LSA header. return value is current age.
+   The clock used is the one cached by the thread loop for the current
+   event, so this costs no system call; ospf6_lsa_age_set () reads the
+   clock precisely, which also refreshes that cache, so the cached time
+   is never behind the birth time of an LSA. */
 u_int16_t
 ospf6_lsa_age_current (struct ospf6_lsa *lsa)
 {
   struct timeval now;
-  u_int32_t ulage;
-  u_int16_t age;
+  long age;
 
   assert (lsa);
   assert (lsa->header);
 
-  /* current time */
-  if (quagga_gettime (QUAGGA_CLK_MONOTONIC, &now) < 0)
-    zlog_warn ("LSA: quagga_gettime failed, may fail LSA AGEs: %s",
-               safe_strerror (errno));
-
   if (ntohs (lsa->header->age) >= MAXAGE)
     {
       /* ospf6_lsa_premature_aging () sets age to MAXAGE; when using
@@ -226,16 +224,32 @@ ospf6_lsa_age_current (struct ospf6_lsa *lsa)
       lsa->header->age = htons (MAXAGE);
       return MAXAGE;
     }
-  /* calculate age */
-  ulage = now.tv_sec - lsa->birth.tv_sec;
 
-  /* if over MAXAGE, set to it */
-  age = (ulage > MAXAGE ? MAXAGE : ulage);
+  /* calculate age, clamped to [0, MAXAGE] */
+  now = recent_relative_time ();
+  age = now.tv_sec - lsa->birth.tv_sec;
+  if (age > MAXAGE)
+    age = MAXAGE;
+  else if (age < 0)
+    age = 0;
 
   lsa->header->age = htons (age);
   return age;
 }
 
+/* Same as ospf6_lsa_age_current (), but reads the clock first, for
+   callers which may run long after the current event started, or
+   outside of any event. */
+u_int16_t
+ospf6_lsa_age_precise (struct ospf6_lsa *lsa)
+{
+  if (quagga_gettime (QUAGGA_CLK_MONOTONIC, NULL) < 0)
+    zlog_warn ("LSA: quagga_gettime failed, may fail LSA AGEs: %s",
+               safe_strerror (errno));
+
+  return ospf6_lsa_age_current (lsa);
+}
+
 /* update age field of LSA header with adding InfTransDelay */
 void
 ospf6_lsa_age_update_to_send (struct ospf6_lsa *lsa, u_int32_t transdelay)
@@ -418,7 +432,7 @@ ospf6_lsa_show_internal (struct vty *vty, struct ospf6_lsa *lsa)
              adv_router, sizeof (adv_router));
 
   vty_out (vty, "%s", VNL);
-  vty_out (vty, "Age: %4hu Type: %s%s", ospf6_lsa_age_current (lsa),
+  vty_out (vty, "Age: %4hu Type: %s%s", ospf6_lsa_age_precise (lsa),
            ospf6_lstype_name (lsa->header->type), VNL);
   vty_out (vty, "Link State ID: %s%s", id, VNL);
   vty_out (vty, "Advertising Router: %s%s", adv_router, VNL);
@@ -445,7 +459,7 @@ ospf6_lsa_show (struct vty *vty, struct ospf6_lsa *lsa)
   inet_ntop (AF_INET, &lsa->header->adv_router,
              adv_router, sizeof (adv_router));
 
-  vty_out (vty, "Age: %4hu Type: %s%s", ospf6_lsa_age_current (lsa),
+  vty_out (vty, "Age: %4hu Type: %s%s", ospf6_lsa_age_precise (lsa),
            ospf6_lstype_name (lsa->header->type), VNL);
   vty_out (vty, "Link State ID: %s%s", id, VNL);
   vty_out (vty, "Advertising Router: %s%s", adv_router, VNL);
@@ -119,7 +119,7 @@ struct ospf6_lsa
   struct ospf6_lsa *prev;
   struct ospf6_lsa *next;
 
-  unsigned char     lock;           /* reference counter */
+  u_int32_t         lock;           /* reference counter */
   unsigned char     flag;           /* special meaning (e.g. floodback) */
 
   struct timeval    birth;          /* tv_sec when LS age 0 */
@@ -144,6 +144,7 @@ struct ospf6_lsa
 #define OSPF6_LSA_FLOODBACK  0x02
 #define OSPF6_LSA_DUPLICATE  0x04
 #define OSPF6_LSA_IMPLIEDACK 0x08
+#define OSPF6_LSA_MAXAGE_LISTED 0x10
 
 struct ospf6_lsa_handler
 {
@@ -216,6 +217,7 @@ extern u_char ospf6_lstype_debug (u_int16_t type);
 extern int ospf6_lsa_is_differ (struct ospf6_lsa *lsa1, struct ospf6_lsa *lsa2);
 extern int ospf6_lsa_is_changed (struct ospf6_lsa *lsa1, struct ospf6_lsa *lsa2);
 extern u_int16_t ospf6_lsa_age_current (struct ospf6_lsa *);
+extern u_int16_t ospf6_lsa_age_precise (struct ospf6_lsa *);
 extern void ospf6_lsa_age_update_to_send (struct ospf6_lsa *, u_int32_t);
 extern void ospf6_lsa_premature_aging (struct ospf6_lsa *);
 extern int ospf6_lsa_compare (struct ospf6_lsa *, struct ospf6_lsa *);
@@ -27,6 +27,7 @@
 #include "prefix.h"
 #include "table.h"
 #include "vty.h"
+#include "linklist.h"
 
 #include "ospf6_proto.h"
 #include "ospf6_lsa.h"
@@ -48,6 +49,7 @@ ospf6_lsdb_create (void *data)
 
   lsdb->data = data;
   lsdb->table = route_table_init ();
+  lsdb->maxage_list = list_new ();
   return lsdb;
 }
 
@@ -55,6 +57,7 @@ void
 ospf6_lsdb_delete (struct ospf6_lsdb *lsdb)
 {
   ospf6_lsdb_remove_all (lsdb);
+  list_delete (lsdb->maxage_list);
   route_table_finish (lsdb->table);
   XFREE (MTYPE_OSPF6_LSDB, lsdb);
 }
@@ -70,7 +73,7 @@ ospf6_lsdb_set_key (struct prefix_ipv6 *key, void *value, int len)
   key->prefixlen += len * 8;
 }
 
-#ifndef NDEBUG
+#ifdef DEBUG
 static void
 _lsdb_count_assert (struct ospf6_lsdb *lsdb)
 {
@@ -94,16 +97,16 @@ _lsdb_count_assert (struct ospf6_lsdb *lsdb)
   assert (num == lsdb->count);
 }
 #define ospf6_lsdb_count_assert(t) (_lsdb_count_assert (t))
-#else /*NDEBUG*/
+#else /*DEBUG*/
 #define ospf6_lsdb_count_assert(t) ((void) 0)
-#endif /*NDEBUG*/
+#endif /*DEBUG*/
 
 void
 ospf6_lsdb_add (struct ospf6_lsa *lsa, struct ospf6_lsdb *lsdb)
 {
   struct prefix_ipv6 key;
-  struct route_node *current, *nextnode, *prevnode;
-  struct ospf6_lsa *next, *prev, *old = NULL;
+  struct route_node *current, *nextnode;
+  struct ospf6_lsa *old = NULL;
 
   memset (&key, 0, sizeof (key));
   ospf6_lsdb_set_key (&key, &lsa->header->type, sizeof (lsa->header->type));
@@ -118,6 +121,9 @@ ospf6_lsdb_add (struct ospf6_lsa *lsa, struct ospf6_lsdb *lsdb)
 
   if (old)
     {
+      /* the node keeps the lock it was added with */
+      route_unlock_node (current);
+
       if (old->prev)
         old->prev->next = lsa;
       if (old->next)
@@ -137,30 +143,25 @@ ospf6_lsdb_add (struct ospf6_lsa *lsa, struct ospf6_lsdb *lsdb)
         lsa->next = NULL;
       else
         {
-          next = nextnode->info;
-          lsa->next = next;
-          next->prev = lsa;
+          lsa->next = nextnode->info;
           route_unlock_node (nextnode);
         }
 
-      /* prev link */
-      prevnode = current;
-      route_lock_node (prevnode);
-      do {
-        prevnode = route_prev (prevnode);
-      } while (prevnode && prevnode->info == NULL);
-      if (prevnode == NULL)
-        lsa->prev = NULL;
-      else
-        {
-          prev = prevnode->info;
-          lsa->prev = prev;
-          prev->next = lsa;
-          route_unlock_node (prevnode);
-        }
+      /* prev link: the list is in table order, so this goes just before
+         next, or last.  Looking for it back through the table would cost
+         as much as the table is large. */
+      lsa->prev = lsa->next ? lsa->next->prev : lsdb->tail;
+      if (lsa->prev)
+        lsa->prev->next = lsa;
+      if (lsa->next)
+        lsa->next->prev = lsa;
 
       lsdb->count++;
     }
+  if (lsa->prev == NULL)
+    lsdb->head = lsa;
+  if (lsa->next == NULL)
+    lsdb->tail = lsa;
 
   if (old)
     {
@@ -222,8 +223,12 @@ ospf6_lsdb_remove (struct ospf6_lsa *lsa, struct ospf6_lsdb *lsdb)
 
   if (lsa->prev)
     lsa->prev->next = lsa->next;
+  else
+    lsdb->head = lsa->next;
   if (lsa->next)
     lsa->next->prev = lsa->prev;
+  else
+    lsdb->tail = lsa->prev;
 
   node->info = NULL;
   lsdb->count--;
@@ -232,7 +237,8 @@ ospf6_lsdb_remove (struct ospf6_lsa *lsa, struct ospf6_lsdb *lsdb)
     (*lsdb->hook_remove) (lsa);
 
   ospf6_lsa_unlock (lsa);
-  route_unlock_node (node);
+  route_unlock_node (node);  /* the lookup's lock */
+  route_unlock_node (node);  /* the one it was added with */
 
   ospf6_lsdb_count_assert (lsdb);
 }
@@ -255,6 +261,7 @@ ospf6_lsdb_lookup (u_int16_t type, u_int32_t id, u_int32_t adv_router,
   node = route_node_lookup (lsdb->table, (struct prefix *) &key);
   if (node == NULL || node->info == NULL)
     return NULL;
+  route_unlock_node (node);
   return (struct ospf6_lsa *) node->info;
 }
 
@@ -334,22 +341,9 @@ ospf6_lsdb_lookup_next (u_int16_t type, u_int32_t id, u_int32_t adv_router,
 struct ospf6_lsa *
 ospf6_lsdb_head (struct ospf6_lsdb *lsdb)
 {
-  struct route_node *node;
-
-  node = route_top (lsdb->table);
-  if (node == NULL)
-    return NULL;
-
-  /* skip to the existing lsdb entry */
-  while (node && node->info == NULL)
-    node = route_next (node);
-  if (node == NULL)
-    return NULL;
-
-  route_unlock_node (node);
-  if (node->info)
-    ospf6_lsa_lock ((struct ospf6_lsa *) node->info);
-  return (struct ospf6_lsa *) node->info;
+  if (lsdb->head)
+    ospf6_lsa_lock (lsdb->head);
+  return lsdb->head;
 }
 
 struct ospf6_lsa *
@@ -473,12 +467,122 @@ ospf6_lsdb_type_next (u_int16_t type, struct ospf6_lsa *lsa)
   return next;
 }
 
+static void ospf6_lsdb_maxage_clear (struct ospf6_lsdb *);
+
 void
 ospf6_lsdb_remove_all (struct ospf6_lsdb *lsdb)
 {
   struct ospf6_lsa *lsa;
   for (lsa = ospf6_lsdb_head (lsdb); lsa; lsa = ospf6_lsdb_next (lsa))
     ospf6_lsdb_remove (lsa, lsdb);
+  ospf6_lsdb_maxage_clear (lsdb);
+}
+
+/* Remember an installed MaxAge LSA, so that the MaxAge remover only
+   has to look at these instead of scanning the whole database. */
+void
+ospf6_lsdb_maxage_add (struct ospf6_lsa *lsa, struct ospf6_lsdb *lsdb)
+{
+  if (CHECK_FLAG (lsa->flag, OSPF6_LSA_MAXAGE_LISTED))
+    return;
+
+  SET_FLAG (lsa->flag, OSPF6_LSA_MAXAGE_LISTED);
+  ospf6_lsa_lock (lsa);
+  listnode_add (lsdb->maxage_list, lsa);
+}
+
+static void
+ospf6_lsdb_maxage_forget (struct listnode *node, struct ospf6_lsa *lsa,
+                          struct ospf6_lsdb *lsdb)
+{
+  list_delete_node (lsdb->maxage_list, node);
+  UNSET_FLAG (lsa->flag, OSPF6_LSA_MAXAGE_LISTED);
+  ospf6_lsa_unlock (lsa);
+}
+
+static void
+ospf6_lsdb_maxage_clear (struct ospf6_lsdb *lsdb)
+{
+  struct listnode *node, *nnode;
+  struct ospf6_lsa *lsa;
+
+  for (ALL_LIST_ELEMENTS (lsdb->maxage_list, node, nnode, lsa))
+    ospf6_lsdb_maxage_forget (node, lsa, lsdb);
+}
+
+/* Remove the MaxAge LSAs which are no longer on any neighbor's
+   retransmission list.  Candidates that have been replaced by a newer
+   instance in the meantime are simply forgotten.  Returns how many are
+   left waiting for a retransmission list to let go of them. */
+unsigned int
+ospf6_lsdb_maxage_remover (struct ospf6_lsdb *lsdb)
+{
+  struct listnode *node, *nnode;
+  struct ospf6_lsa *lsa;
+  unsigned int left = 0;
+
+  for (ALL_LIST_ELEMENTS (lsdb->maxage_list, node, nnode, lsa))
+    {
+      if (ospf6_lsdb_lookup (lsa->header->type, lsa->header->id,
+                             lsa->header->adv_router, lsdb) != lsa)
+        {
+          ospf6_lsdb_maxage_forget (node, lsa, lsdb);
+          continue;
+        }
+
+      if (lsa->retrans_count != 0)
+        {
+          left++;
+          continue;
+        }
+
+      if (IS_OSPF6_DEBUG_LSA_TYPE (lsa->header->type))
+        zlog_debug ("Remove MaxAge %s", lsa->name);
+      ospf6_lsdb_remove (lsa, lsdb);
+      ospf6_lsdb_maxage_forget (node, lsa, lsdb);
+    }
+
+  return left;
+}
+
+void
+ospf6_lsdb_cursor_open (struct ospf6_lsdb_cursor *cursor,
+                        struct ospf6_lsdb *lsdb)
+{
+  ospf6_lsdb_cursor_close (cursor);
+  cursor->lsdb = lsdb;
+  cursor->node = route_top (lsdb->table);
+}
+
+/* Return the LSA at the cursor without moving it, or NULL at the end */
+struct ospf6_lsa *
+ospf6_lsdb_cursor_lsa (struct ospf6_lsdb_cursor *cursor)
+{
+  while (cursor->node && cursor->node->info == NULL)
+    cursor->node = route_next (cursor->node);
+
+  if (cursor->node == NULL)
+    {
+      cursor->lsdb = NULL;
+      return NULL;
+    }
+  return (struct ospf6_lsa *) cursor->node->info;
+}
+
+void
+ospf6_lsdb_cursor_advance (struct ospf6_lsdb_cursor *cursor)
+{
+  if (cursor->node)
+    cursor->node = route_next (cursor->node);
+}
+
+void
+ospf6_lsdb_cursor_close (struct ospf6_lsdb_cursor *cursor)
+{
+  if (cursor->node)
+    route_unlock_node (cursor->node);
+  cursor->node = NULL;
+  cursor->lsdb = NULL;
 }
 
 void
@@ -25,30 +25,19 @@
 #include "prefix.h"
 #include "table.h"
 
+struct ospf6_lsa;
+
 struct ospf6_lsdb
 {
   void *data; /* data structure that holds this lsdb */
   struct route_table *table;
+  struct ospf6_lsa *head, *tail; /* the list of LSAs, in table order */
   u_int32_t count;
+  struct list *maxage_list; /* MaxAge LSAs awaiting removal */
   void (*hook_add) (struct ospf6_lsa *);
   void (*hook_remove) (struct ospf6_lsa *);
 };
 
-#define OSPF6_LSDB_MAXAGE_REMOVER(lsdb)                                  \
-  do {                                                                   \
-    struct ospf6_lsa *lsa;                                               \
-    for (lsa = ospf6_lsdb_head (lsdb); lsa; lsa = ospf6_lsdb_next (lsa)) \
-      {                                                                  \
-        if (! OSPF6_LSA_IS_MAXAGE (lsa))                                 \
-          continue;                                                      \
-        if (lsa->retrans_count != 0)                                     \
-          continue;                                                      \
-        if (IS_OSPF6_DEBUG_LSA_TYPE (lsa->header->type))                 \
-          zlog_debug ("Remove MaxAge %s", lsa->name);                    \
-        ospf6_lsdb_remove (lsa, lsdb);                                   \
-      }                                                                  \
-  } while (0)
-
 /* Function Prototypes */
 extern struct ospf6_lsdb *ospf6_lsdb_create (void *data);
 extern void ospf6_lsdb_delete (struct ospf6_lsdb *lsdb);
@@ -80,6 +69,25 @@ extern struct ospf6_lsa *ospf6_lsdb_type_next (u_int16_t type,
 
 extern void ospf6_lsdb_remove_all (struct ospf6_lsdb *lsdb);
 
+extern void ospf6_lsdb_maxage_add (struct ospf6_lsa *lsa,
+                                   struct ospf6_lsdb *lsdb);
+extern unsigned int ospf6_lsdb_maxage_remover (struct ospf6_lsdb *lsdb);
+
+/* In-place walk over a LSDB.  The cursor holds a lock on its current
+   route_node, so LSAs may be added, replaced or removed while it is
+   open; it always yields the instance currently in the database. */
+struct ospf6_lsdb_cursor
+{
+  struct ospf6_lsdb *lsdb;
+  struct route_node *node;
+};
+
+extern void ospf6_lsdb_cursor_open (struct ospf6_lsdb_cursor *cursor,
+                                    struct ospf6_lsdb *lsdb);
+extern struct ospf6_lsa *ospf6_lsdb_cursor_lsa (struct ospf6_lsdb_cursor *cursor);
+extern void ospf6_lsdb_cursor_advance (struct ospf6_lsdb_cursor *cursor);
+extern void ospf6_lsdb_cursor_close (struct ospf6_lsdb_cursor *cursor);
+
 #define OSPF6_LSDB_SHOW_LEVEL_NORMAL   0
 #define OSPF6_LSDB_SHOW_LEVEL_DETAIL   1
 #define OSPF6_LSDB_SHOW_LEVEL_INTERNAL 2
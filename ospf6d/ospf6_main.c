@@ -41,6 +41,8 @@
 #include "ospf6_message.h"
 #include "ospf6_asbr.h"
 #include "ospf6_lsa.h"
+#include "ospf6_auto.h"
+#include "ospf6_snapshot.h"
 
 /* Default configuration file name for ospf6d. */
 #define OSPF6_DEFAULT_CONFIG       "ospf6d.conf"
@@ -85,6 +87,7 @@ struct option longopts[] =
   { "version",     no_argument,       NULL, 'v'},
   { "dryrun",      no_argument,       NULL, 'C'},
   { "help",        no_argument,       NULL, 'h'},
+  { "lsdb_snapshot", required_argument, NULL, 'S'},
   { 0 }
 };
 
@@ -127,6 +130,7 @@ Daemon which manages OSPF version 3.\n\n\
 -g, --group        Group to run as\n\
 -v, --version      Print program version\n\
 -C, --dryrun       Check configuration for validity and exit\n\
+-S, --lsdb_snapshot Keep LSDB snapshots in this file for warm restarts\n\
 -h, --help         Display this help and exit\n\
 \n\
 Report bugs to zebra@zebra.org\n", progname);
@@ -142,7 +146,12 @@ ospf6_exit (int status)
   extern struct zclient *zclient;
 
   if (ospf6)
-    ospf6_delete (ospf6);
+    {
+      ospf6_auto_terminate ();
+      ospf6_snapshot_save ();
+      ospf6_snapshot_stop ();
+      ospf6_delete (ospf6);
+    }
 
   ospf6_message_terminate ();
   ospf6_asbr_terminate ();
@@ -238,7 +247,7 @@ main (int argc, char *argv[], char *envp[])
   /* Command line argument treatment. */
   while (1) 
     {
-      opt = getopt_long (argc, argv, "df:i:z:hp:A:P:u:g:vC:a", longopts, 0);
+      opt = getopt_long (argc, argv, "df:i:z:hp:A:P:u:g:vC:aS:", longopts, 0);
     
       if (opt == EOF)
         break;
@@ -293,6 +302,9 @@ main (int argc, char *argv[], char *envp[])
 	case 'a':
 	  auto_conf = 1;
 	  break;
+	case 'S':
+	  ospf6_snapshot_file = optarg;
+	  break;
         default:
           usage (progname, 1);
           break;
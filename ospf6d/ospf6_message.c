@@ -46,6 +46,7 @@
 #include "ospf6_intra.h"
 
 #include "ospf6_flood.h"
+#include "ospf6_snapshot.h"
 #include "ospf6d.h"
 
 #include <netinet/ip6.h>
@@ -247,6 +248,7 @@ ospf6_hello_recv (struct in6_addr *src, struct in6_addr *dst,
   int twoway = 0;
   int neighborchange = 0;
   int backupseen = 0;
+  u_char prev_state;
 
   hello = (struct ospf6_hello *)
     ((caddr_t) oh + sizeof (struct ospf6_header));
@@ -328,6 +330,9 @@ ospf6_hello_recv (struct in6_addr *src, struct in6_addr *dst,
         neighborchange++;
     }
 
+  if (neighborchange)
+    ospf6_interface_candidate_update (on);
+
   /* BackupSeen check */
   if (oi->state == OSPF6_INTERFACE_WAITING)
     {
@@ -338,12 +343,26 @@ ospf6_hello_recv (struct in6_addr *src, struct in6_addr *dst,
     }
 
   /* Execute neighbor events */
+  prev_state = on->state;
   thread_execute (master, hello_received, on, 0);
   if (twoway)
     thread_execute (master, twoway_received, on, 0);
   else
     thread_execute (master, oneway_received, on, 0);
 
+  /* A neighbor that is new, or has restarted, waits for our next Hello
+     to list it before it can go on to 2-Way: send that Hello now rather
+     than up to HelloInterval later.  It happens once per neighbor each
+     time it goes back to Init. */
+  if (! twoway && prev_state != OSPF6_NEIGHBOR_INIT &&
+      on->state == OSPF6_NEIGHBOR_INIT && oi->thread_send_hello &&
+      oi->thread_send_hello->type == THREAD_TIMER)
+    {
+      THREAD_OFF (oi->thread_send_hello);
+      oi->thread_send_hello =
+        thread_add_event (master, ospf6_hello_send, oi, 0);
+    }
+
   /* Schedule interface events */
   if (backupseen)
     thread_add_event (master, backup_seen, oi, 0);
@@ -351,6 +370,28 @@ ospf6_hello_recv (struct in6_addr *src, struct in6_addr *dst,
     thread_add_event (master, neighbor_change, oi, 0);
 }
 
+/* An instance the neighbor describes that is in the LSDB snapshot is
+   installed from there, as if received, rather than requested */
+static int
+ospf6_dbdesc_from_snapshot (struct ospf6_lsa *his, struct ospf6_lsdb *lsdb,
+                            struct ospf6_neighbor *on)
+{
+  struct ospf6_lsa *lsa;
+
+  lsa = ospf6_snapshot_lookup (his, on);
+  if (lsa == NULL)
+    return 0;
+
+  if (IS_OSPF6_DEBUG_MESSAGE (OSPF6_MESSAGE_TYPE_DBDESC, RECV))
+    zlog_debug ("Install from snapshot: %s", lsa->name);
+
+  lsa->lsdb = lsdb;
+  ospf6_flood (on, lsa);
+  ospf6_install_lsa (lsa);
+  ospf6_lsa_delete (his);
+  return 1;
+}
+
 static void
 ospf6_dbdesc_recv_master (struct ospf6_header *oh,
                           struct ospf6_neighbor *on)
@@ -514,6 +555,9 @@ ospf6_dbdesc_recv_master (struct ospf6_header *oh,
 
       mine = ospf6_lsdb_lookup (his->header->type, his->header->id,
                                 his->header->adv_router, lsdb);
+      if ((mine == NULL || ospf6_lsa_compare (his, mine) < 0) &&
+          ospf6_dbdesc_from_snapshot (his, lsdb, on))
+        continue;
       if (mine == NULL)
         {
           if (IS_OSPF6_DEBUG_MESSAGE (oh->type, RECV))
@@ -732,6 +776,9 @@ ospf6_dbdesc_recv_slave (struct ospf6_header *oh,
 
       mine = ospf6_lsdb_lookup (his->header->type, his->header->id,
                                 his->header->adv_router, lsdb);
+      if ((mine == NULL || ospf6_lsa_compare (his, mine) < 0) &&
+          ospf6_dbdesc_from_snapshot (his, lsdb, on))
+        continue;
       if (mine == NULL || ospf6_lsa_compare (his, mine) < 0)
         {
           if (IS_OSPF6_DEBUG_MESSAGE (oh->type, RECV))
@@ -1358,7 +1405,8 @@ ospf6_lsupdate_recv (struct in6_addr *src, struct in6_addr *dst,
       
       if (lsa_header->adv_router == ospf6->router_id)
 	{
-	  zlog_warn ("Check for RID conflict");
+	  if (IS_OSPF6_DEBUG_AUTO)
+	    zlog_debug ("Check for RID conflict");
 	  if (ospf6_check_hw_fingerprint (lsa_header))
 	  {
 	    return;
@@ -1597,9 +1645,10 @@ ospf6_receive (struct thread *thread)
      and also in the type-specific dispatching functions a dead code,
      which can be dismissed in a cleanup-focused review round later. */
 
-  /* Valid packet received, check for duplicate router-id */
-  if(auto_conf)
-    ospf6_check_router_id(oh, src, dst);
+  /* Valid packet received, check for duplicate router-id; oi is gone
+     if that restarted the router */
+  if(auto_conf && ospf6_check_router_id(oh, src, dst))
+    return 0;
 
   /* Log */
   if (IS_OSPF6_DEBUG_MESSAGE (oh->type, RECV))
@@ -1729,13 +1778,21 @@ ospf6_send (struct in6_addr *src, struct in6_addr *dst,
     zlog_err ("Could not send entire message");
 }
 
-static uint32_t
-ospf6_packet_max(struct ospf6_interface *oi)
+u_int32_t
+ospf6_packet_max (struct ospf6_interface *oi)
 {
   assert (oi->ifmtu > sizeof (struct ip6_hdr));
   return oi->ifmtu - (sizeof (struct ip6_hdr));
 }
 
+/* Number of LSA headers that fit in one LSAck on this interface */
+unsigned int
+ospf6_lsack_capacity (struct ospf6_interface *oi)
+{
+  return (ospf6_packet_max (oi) - sizeof (struct ospf6_header)) /
+         sizeof (struct ospf6_lsa_header);
+}
+
 int
 ospf6_hello_send (struct thread *thread)
 {
@@ -1808,6 +1865,8 @@ ospf6_dbdesc_send (struct thread *thread)
   struct ospf6_dbdesc *dbdesc;
   u_char *p;
   struct ospf6_lsa *lsa;
+  unsigned int i;
+  u_int16_t age;
 
   on = (struct ospf6_neighbor *) THREAD_ARG (thread);
   on->thread_send_dbdesc = (struct thread *) NULL;
@@ -1851,19 +1910,22 @@ ospf6_dbdesc_send (struct thread *thread)
   p = (u_char *)((caddr_t) dbdesc + sizeof (struct ospf6_dbdesc));
   if (! CHECK_FLAG (on->dbdesc_bits, OSPF6_DBDESC_IBIT))
     {
-      for (lsa = ospf6_lsdb_head (on->dbdesc_list); lsa;
-           lsa = ospf6_lsdb_next (lsa))
+      for (i = 0; i < on->dbdesc_count; i++)
         {
-          ospf6_lsa_age_update_to_send (lsa, on->ospf6_if->transdelay);
+          lsa = on->dbdesc_lsa[i];
 
           /* MTU check */
           if (p - sendbuf + sizeof (struct ospf6_lsa_header) >
               ospf6_packet_max(on->ospf6_if))
-            {
-              ospf6_lsa_unlock (lsa);
-              break;
-            }
+            break;
+
+          /* these are the database's own LSAs: age the packet's copy
+             of the header, not the LSA */
           memcpy (p, lsa->header, sizeof (struct ospf6_lsa_header));
+          age = ospf6_lsa_age_current (lsa) + on->ospf6_if->transdelay;
+          if (age > MAXAGE)
+            age = MAXAGE;
+          ((struct ospf6_lsa_header *) p)->age = htons (age);
           p += sizeof (struct ospf6_lsa_header);
         }
     }
@@ -1884,26 +1946,23 @@ ospf6_dbdesc_send_newone (struct thread *thread)
   unsigned int size = 0;
 
   on = (struct ospf6_neighbor *) THREAD_ARG (thread);
-  ospf6_lsdb_remove_all (on->dbdesc_list);
+  ospf6_neighbor_dbdesc_clear (on);
 
-  /* move LSAs from summary_list to dbdesc_list (within neighbor structure)
-     so that ospf6_send_dbdesc () can send those LSAs */
+  /* take the next LSAs of the database summary into dbdesc_lsa
+     (within neighbor structure) so that ospf6_send_dbdesc () can send
+     and retransmit those LSAs */
   size = sizeof (struct ospf6_lsa_header) + sizeof (struct ospf6_dbdesc);
-  for (lsa = ospf6_lsdb_head (on->summary_list); lsa;
-       lsa = ospf6_lsdb_next (lsa))
+  while ((lsa = ospf6_neighbor_summary_lsa (on)) != NULL)
     {
       if (size + sizeof (struct ospf6_lsa_header) > ospf6_packet_max(on->ospf6_if))
-        {
-          ospf6_lsa_unlock (lsa);
-          break;
-        }
+        break;
 
-      ospf6_lsdb_add (ospf6_lsa_copy (lsa), on->dbdesc_list);
-      ospf6_lsdb_remove (lsa, on->summary_list);
+      ospf6_neighbor_dbdesc_add (on, lsa);
+      ospf6_neighbor_summary_next (on);
       size += sizeof (struct ospf6_lsa_header);
     }
 
-  if (on->summary_list->count == 0)
+  if (lsa == NULL)
     UNSET_FLAG (on->dbdesc_bits, OSPF6_DBDESC_MBIT);
 
   /* If slave, More bit check must be done here */
@@ -2203,6 +2262,7 @@ ospf6_lsack_send_neighbor (struct thread *thread)
       ospf6_lsa_age_update_to_send (lsa, on->ospf6_if->transdelay);
       memcpy (p, lsa->header, sizeof (struct ospf6_lsa_header));
       p += sizeof (struct ospf6_lsa_header);
+      on->ospf6_if->lsack_headers++;
 
       assert (lsa->lock == 2);
       ospf6_lsdb_remove (lsa, on->lsack_list);
@@ -2210,6 +2270,7 @@ ospf6_lsack_send_neighbor (struct thread *thread)
 
   oh->type = OSPF6_MESSAGE_TYPE_LSACK;
   oh->length = htons (p - sendbuf);
+  on->ospf6_if->lsack_packets++;
 
   ospf6_send (on->ospf6_if->linklocal_addr, &on->linklocal_addr,
               on->ospf6_if, oh);
@@ -2263,6 +2324,7 @@ ospf6_lsack_send_interface (struct thread *thread)
       ospf6_lsa_age_update_to_send (lsa, oi->transdelay);
       memcpy (p, lsa->header, sizeof (struct ospf6_lsa_header));
       p += sizeof (struct ospf6_lsa_header);
+      oi->lsack_headers++;
 
       assert (lsa->lock == 2);
       ospf6_lsdb_remove (lsa, oi->lsack_list);
@@ -2270,6 +2332,7 @@ ospf6_lsack_send_interface (struct thread *thread)
 
   oh->type = OSPF6_MESSAGE_TYPE_LSACK;
   oh->length = htons (p - sendbuf);
+  oi->lsack_packets++;
 
   if (oi->state == OSPF6_INTERFACE_DR ||
       oi->state == OSPF6_INTERFACE_BDR)
@@ -116,6 +116,8 @@ struct ospf6_lsupdate
 /* It is just a sequence of LSA Headers */
 
 /* Function definition */
+struct ospf6_interface;
+
 extern void ospf6_hello_print (struct ospf6_header *);
 extern void ospf6_dbdesc_print (struct ospf6_header *);
 extern void ospf6_lsreq_print (struct ospf6_header *);
@@ -135,6 +137,9 @@ extern int ospf6_lsupdate_send_neighbor (struct thread *thread);
 extern int ospf6_lsack_send_interface (struct thread *thread);
 extern int ospf6_lsack_send_neighbor (struct thread *thread);
 
+extern u_int32_t ospf6_packet_max (struct ospf6_interface *oi);
+extern unsigned int ospf6_lsack_capacity (struct ospf6_interface *oi);
+
 extern int config_write_ospf6_debug_message (struct vty *);
 extern void install_element_ospf6_debug_message (void);
 
@@ -27,6 +27,8 @@
 #include "linklist.h"
 #include "vty.h"
 #include "command.h"
+#include "hash.h"
+#include "jhash.h"
 
 #include "ospf6_proto.h"
 #include "ospf6_lsa.h"
@@ -47,6 +49,9 @@ const char *ospf6_neighbor_state_str[] =
 { "None", "Down", "Attempt", "Init", "Twoway", "ExStart", "ExChange",
   "Loading", "Full", NULL };
 
+static const char *ospf6_neighbor_summary_str[] =
+{ "Interface", "Area", "AS", "no", NULL };
+
 int
 ospf6_neighbor_cmp (void *va, void *vb)
 {
@@ -55,18 +60,118 @@ ospf6_neighbor_cmp (void *va, void *vb)
   return (ntohl (ona->router_id) < ntohl (onb->router_id) ? -1 : 1);
 }
 
+unsigned int
+ospf6_neighbor_hash_key (void *p)
+{
+  struct ospf6_neighbor *on = (struct ospf6_neighbor *) p;
+  return jhash_1word (on->router_id, 0);
+}
+
+int
+ospf6_neighbor_hash_cmp (const void *a, const void *b)
+{
+  const struct ospf6_neighbor *ona = a;
+  const struct ospf6_neighbor *onb = b;
+  return (ona->router_id == onb->router_id);
+}
+
 struct ospf6_neighbor *
 ospf6_neighbor_lookup (u_int32_t router_id,
                        struct ospf6_interface *oi)
 {
-  struct listnode *n;
-  struct ospf6_neighbor *on;
+  struct ospf6_neighbor key;
 
-  for (ALL_LIST_ELEMENTS_RO (oi->neighbor_list, n, on))
-    if (on->router_id == router_id)
-      return on;
-  
-  return (struct ospf6_neighbor *) NULL;
+  key.router_id = router_id;
+  return (struct ospf6_neighbor *) hash_lookup (oi->neighbor_hash, &key);
+}
+
+/* The database summary is not copied at NegotiationDone: a cursor walks
+   the Interface, Area and AS scoped LSDBs in turn as DbDescs are built,
+   describing whatever instance is in the database at that moment. */
+static struct ospf6_lsdb *
+ospf6_neighbor_summary_lsdb (struct ospf6_neighbor *on)
+{
+  switch (on->summary_scope)
+    {
+    case OSPF6_NEIGHBOR_SUMMARY_LINK:
+      return on->ospf6_if->lsdb;
+    case OSPF6_NEIGHBOR_SUMMARY_AREA:
+      return on->ospf6_if->area->lsdb;
+    case OSPF6_NEIGHBOR_SUMMARY_AS:
+      return on->ospf6_if->area->ospf6->lsdb;
+    default:
+      return NULL;
+    }
+}
+
+static void
+ospf6_neighbor_summary_start (struct ospf6_neighbor *on)
+{
+  on->summary_scope = OSPF6_NEIGHBOR_SUMMARY_LINK;
+  ospf6_lsdb_cursor_open (&on->summary, ospf6_neighbor_summary_lsdb (on));
+}
+
+static void
+ospf6_neighbor_summary_clear (struct ospf6_neighbor *on)
+{
+  ospf6_lsdb_cursor_close (&on->summary);
+  on->summary_scope = OSPF6_NEIGHBOR_SUMMARY_DONE;
+}
+
+/* Next LSA to describe in DbDesc, or NULL when the summary is exhausted.
+   MaxAge LSAs are skipped; they went to the retrans-list instead. */
+struct ospf6_lsa *
+ospf6_neighbor_summary_lsa (struct ospf6_neighbor *on)
+{
+  struct ospf6_lsa *lsa;
+
+  while (on->summary_scope != OSPF6_NEIGHBOR_SUMMARY_DONE)
+    {
+      lsa = ospf6_lsdb_cursor_lsa (&on->summary);
+      if (lsa == NULL)
+        {
+          on->summary_scope++;
+          if (on->summary_scope != OSPF6_NEIGHBOR_SUMMARY_DONE)
+            ospf6_lsdb_cursor_open (&on->summary,
+                                    ospf6_neighbor_summary_lsdb (on));
+          continue;
+        }
+
+      if (! OSPF6_LSA_IS_MAXAGE (lsa))
+        return lsa;
+      ospf6_lsdb_cursor_advance (&on->summary);
+    }
+
+  return NULL;
+}
+
+void
+ospf6_neighbor_summary_next (struct ospf6_neighbor *on)
+{
+  ospf6_lsdb_cursor_advance (&on->summary);
+}
+
+void
+ospf6_neighbor_dbdesc_add (struct ospf6_neighbor *on, struct ospf6_lsa *lsa)
+{
+  if (on->dbdesc_count == on->dbdesc_size)
+    {
+      on->dbdesc_size = (on->dbdesc_size ? on->dbdesc_size * 2 : 64);
+      on->dbdesc_lsa = XREALLOC (MTYPE_OSPF6_NEIGHBOR, on->dbdesc_lsa,
+                                 on->dbdesc_size * sizeof (struct ospf6_lsa *));
+    }
+  ospf6_lsa_lock (lsa);
+  on->dbdesc_lsa[on->dbdesc_count++] = lsa;
+}
+
+void
+ospf6_neighbor_dbdesc_clear (struct ospf6_neighbor *on)
+{
+  unsigned int i;
+
+  for (i = 0; i < on->dbdesc_count; i++)
+    ospf6_lsa_unlock (on->dbdesc_lsa[i]);
+  on->dbdesc_count = 0;
 }
 
 /* create ospf6_neighbor */
@@ -94,16 +199,16 @@ ospf6_neighbor_create (u_int32_t router_id, struct ospf6_interface *oi)
   quagga_gettime (QUAGGA_CLK_MONOTONIC, &on->last_changed);
   on->router_id = router_id;
 
-  on->summary_list = ospf6_lsdb_create (on);
+  on->summary_scope = OSPF6_NEIGHBOR_SUMMARY_DONE;
   on->request_list = ospf6_lsdb_create (on);
   on->retrans_list = ospf6_lsdb_create (on);
 
-  on->dbdesc_list = ospf6_lsdb_create (on);
   on->lsreq_list = ospf6_lsdb_create (on);
   on->lsupdate_list = ospf6_lsdb_create (on);
   on->lsack_list = ospf6_lsdb_create (on);
 
   listnode_add_sort (oi->neighbor_list, on);
+  hash_get (oi->neighbor_hash, on, hash_alloc_intern);
   return on;
 }
 
@@ -112,7 +217,7 @@ ospf6_neighbor_delete (struct ospf6_neighbor *on)
 {
   struct ospf6_lsa *lsa;
 
-  ospf6_lsdb_remove_all (on->summary_list);
+  ospf6_neighbor_summary_clear (on);
   ospf6_lsdb_remove_all (on->request_list);
   for (lsa = ospf6_lsdb_head (on->retrans_list); lsa;
        lsa = ospf6_lsdb_next (lsa))
@@ -121,16 +226,16 @@ ospf6_neighbor_delete (struct ospf6_neighbor *on)
       ospf6_lsdb_remove (lsa, on->retrans_list);
     }
 
-  ospf6_lsdb_remove_all (on->dbdesc_list);
+  ospf6_neighbor_dbdesc_clear (on);
+  if (on->dbdesc_lsa)
+    XFREE (MTYPE_OSPF6_NEIGHBOR, on->dbdesc_lsa);
   ospf6_lsdb_remove_all (on->lsreq_list);
   ospf6_lsdb_remove_all (on->lsupdate_list);
   ospf6_lsdb_remove_all (on->lsack_list);
 
-  ospf6_lsdb_delete (on->summary_list);
   ospf6_lsdb_delete (on->request_list);
   ospf6_lsdb_delete (on->retrans_list);
 
-  ospf6_lsdb_delete (on->dbdesc_list);
   ospf6_lsdb_delete (on->lsreq_list);
   ospf6_lsdb_delete (on->lsupdate_list);
   ospf6_lsdb_delete (on->lsack_list);
@@ -142,6 +247,10 @@ ospf6_neighbor_delete (struct ospf6_neighbor *on)
   THREAD_OFF (on->thread_send_lsupdate);
   THREAD_OFF (on->thread_send_lsack);
 
+  if (on->candidate_list)
+    listnode_delete (on->candidate_list, on);
+  hash_release (on->ospf6_if->neighbor_hash, on);
+
   XFREE (MTYPE_OSPF6_NEIGHBOR, on);
 }
 
@@ -158,6 +267,7 @@ ospf6_neighbor_state_change (u_char next_state, struct ospf6_neighbor *on)
 
   on->state_change++;
   quagga_gettime (QUAGGA_CLK_MONOTONIC, &on->last_changed);
+  ospf6_interface_candidate_update (on);
 
   /* log */
   if (IS_OSPF6_DEBUG_NEIGHBOR (STATE))
@@ -272,6 +382,9 @@ negotiation_done (struct thread *thread)
 {
   struct ospf6_neighbor *on;
   struct ospf6_lsa *lsa;
+  struct ospf6_lsdb *lsdb;
+  struct listnode *node;
+  u_char scope;
 
   on = (struct ospf6_neighbor *) THREAD_ARG (thread);
   assert (on);
@@ -283,7 +396,7 @@ negotiation_done (struct thread *thread)
     zlog_debug ("Neighbor Event %s: *NegotiationDone*", on->name);
 
   /* clear ls-list */
-  ospf6_lsdb_remove_all (on->summary_list);
+  ospf6_neighbor_dbdesc_clear (on);
   ospf6_lsdb_remove_all (on->request_list);
   for (lsa = ospf6_lsdb_head (on->retrans_list); lsa;
        lsa = ospf6_lsdb_next (lsa))
@@ -292,44 +405,24 @@ negotiation_done (struct thread *thread)
       ospf6_lsdb_remove (lsa, on->retrans_list);
     }
 
-  /* Interface scoped LSAs */
-  for (lsa = ospf6_lsdb_head (on->ospf6_if->lsdb); lsa;
-       lsa = ospf6_lsdb_next (lsa))
-    {
-      if (OSPF6_LSA_IS_MAXAGE (lsa))
-        {
-          ospf6_increment_retrans_count (lsa);
-          ospf6_lsdb_add (ospf6_lsa_copy (lsa), on->retrans_list);
-        }
-      else
-        ospf6_lsdb_add (ospf6_lsa_copy (lsa), on->summary_list);
-    }
-
-  /* Area scoped LSAs */
-  for (lsa = ospf6_lsdb_head (on->ospf6_if->area->lsdb); lsa;
-       lsa = ospf6_lsdb_next (lsa))
+  /* MaxAge LSAs go to the retrans-list; the rest is described in
+     DbDesc straight out of the LSDBs */
+  for (scope = OSPF6_NEIGHBOR_SUMMARY_LINK;
+       scope != OSPF6_NEIGHBOR_SUMMARY_DONE; scope++)
     {
-      if (OSPF6_LSA_IS_MAXAGE (lsa))
+      on->summary_scope = scope;
+      lsdb = ospf6_neighbor_summary_lsdb (on);
+      for (ALL_LIST_ELEMENTS_RO (lsdb->maxage_list, node, lsa))
         {
+          if (! OSPF6_LSA_IS_MAXAGE (lsa) ||
+              ospf6_lsdb_lookup (lsa->header->type, lsa->header->id,
+                                 lsa->header->adv_router, lsdb) != lsa)
+            continue;
           ospf6_increment_retrans_count (lsa);
           ospf6_lsdb_add (ospf6_lsa_copy (lsa), on->retrans_list);
         }
-      else
-        ospf6_lsdb_add (ospf6_lsa_copy (lsa), on->summary_list);
-    }
-
-  /* AS scoped LSAs */
-  for (lsa = ospf6_lsdb_head (on->ospf6_if->area->ospf6->lsdb); lsa;
-       lsa = ospf6_lsdb_next (lsa))
-    {
-      if (OSPF6_LSA_IS_MAXAGE (lsa))
-        {
-          ospf6_increment_retrans_count (lsa);
-          ospf6_lsdb_add (ospf6_lsa_copy (lsa), on->retrans_list);
-        }
-      else
-        ospf6_lsdb_add (ospf6_lsa_copy (lsa), on->summary_list);
     }
+  ospf6_neighbor_summary_start (on);
 
   UNSET_FLAG (on->dbdesc_bits, OSPF6_DBDESC_IBIT);
   ospf6_neighbor_state_change (OSPF6_NEIGHBOR_EXCHANGE, on);
@@ -352,7 +445,7 @@ exchange_done (struct thread *thread)
     zlog_debug ("Neighbor Event %s: *ExchangeDone*", on->name);
 
   THREAD_OFF (on->thread_send_dbdesc);
-  ospf6_lsdb_remove_all (on->dbdesc_list);
+  ospf6_neighbor_dbdesc_clear (on);
 
 /* XXX
   thread_add_timer (master, ospf6_neighbor_last_dbdesc_release, on,
@@ -416,7 +509,8 @@ adj_ok (struct thread *thread)
            ! need_adjacency (on))
     {
       ospf6_neighbor_state_change (OSPF6_NEIGHBOR_TWOWAY, on);
-      ospf6_lsdb_remove_all (on->summary_list);
+      ospf6_neighbor_summary_clear (on);
+      ospf6_neighbor_dbdesc_clear (on);
       ospf6_lsdb_remove_all (on->request_list);
       for (lsa = ospf6_lsdb_head (on->retrans_list); lsa;
            lsa = ospf6_lsdb_next (lsa))
@@ -449,7 +543,8 @@ seqnumber_mismatch (struct thread *thread)
   SET_FLAG (on->dbdesc_bits, OSPF6_DBDESC_MBIT);
   SET_FLAG (on->dbdesc_bits, OSPF6_DBDESC_IBIT);
 
-  ospf6_lsdb_remove_all (on->summary_list);
+  ospf6_neighbor_summary_clear (on);
+  ospf6_neighbor_dbdesc_clear (on);
   ospf6_lsdb_remove_all (on->request_list);
   for (lsa = ospf6_lsdb_head (on->retrans_list); lsa;
        lsa = ospf6_lsdb_next (lsa))
@@ -485,7 +580,8 @@ bad_lsreq (struct thread *thread)
   SET_FLAG (on->dbdesc_bits, OSPF6_DBDESC_MBIT);
   SET_FLAG (on->dbdesc_bits, OSPF6_DBDESC_IBIT);
 
-  ospf6_lsdb_remove_all (on->summary_list);
+  ospf6_neighbor_summary_clear (on);
+  ospf6_neighbor_dbdesc_clear (on);
   ospf6_lsdb_remove_all (on->request_list);
   for (lsa = ospf6_lsdb_head (on->retrans_list); lsa;
        lsa = ospf6_lsdb_next (lsa))
@@ -519,7 +615,8 @@ oneway_received (struct thread *thread)
   ospf6_neighbor_state_change (OSPF6_NEIGHBOR_INIT, on);
   thread_add_event (master, neighbor_change, on->ospf6_if, 0);
 
-  ospf6_lsdb_remove_all (on->summary_list);
+  ospf6_neighbor_summary_clear (on);
+  ospf6_neighbor_dbdesc_clear (on);
   ospf6_lsdb_remove_all (on->request_list);
   for (lsa = ospf6_lsdb_head (on->retrans_list); lsa;
        lsa = ospf6_lsdb_next (lsa))
@@ -661,6 +758,7 @@ ospf6_neighbor_show_detail (struct vty *vty, struct ospf6_neighbor *on)
   char linklocal_addr[64], duration[32];
   struct timeval now, res;
   struct ospf6_lsa *lsa;
+  unsigned int i;
 
   inet_ntop (AF_INET6, &on->linklocal_addr, linklocal_addr,
              sizeof (linklocal_addr));
@@ -694,11 +792,10 @@ ospf6_neighbor_show_detail (struct vty *vty, struct ospf6_neighbor *on)
             "Master" : "Slave"), (u_long) ntohl (on->dbdesc_seqnum),
            VNL);
 
-  vty_out (vty, "    Summary-List: %d LSAs%s", on->summary_list->count,
-           VNL);
-  for (lsa = ospf6_lsdb_head (on->summary_list); lsa;
-       lsa = ospf6_lsdb_next (lsa))
-    vty_out (vty, "      %s%s", lsa->name, VNL);
+  lsa = ospf6_neighbor_summary_lsa (on);
+  vty_out (vty, "    Summary-List: %s scope, next %s%s",
+           ospf6_neighbor_summary_str[on->summary_scope],
+           (lsa ? lsa->name : "none"), VNL);
 
   vty_out (vty, "    Request-List: %d LSAs%s", on->request_list->count,
            VNL);
@@ -717,12 +814,11 @@ ospf6_neighbor_show_detail (struct vty *vty, struct ospf6_neighbor *on)
     timersub (&on->thread_send_dbdesc->u.sands, &now, &res);
   timerstring (&res, duration, sizeof (duration));
   vty_out (vty, "    %d Pending LSAs for DbDesc in Time %s [thread %s]%s",
-           on->dbdesc_list->count, duration,
+           on->dbdesc_count, duration,
            (on->thread_send_dbdesc ? "on" : "off"),
            VNL);
-  for (lsa = ospf6_lsdb_head (on->dbdesc_list); lsa;
-       lsa = ospf6_lsdb_next (lsa))
-    vty_out (vty, "      %s%s", lsa->name, VNL);
+  for (i = 0; i < on->dbdesc_count; i++)
+    vty_out (vty, "      %s%s", on->dbdesc_lsa[i]->name, VNL);
 
   timerclear (&res);
   if (on->thread_send_lsreq)
@@ -22,6 +22,8 @@
 #ifndef OSPF6_NEIGHBOR_H
 #define OSPF6_NEIGHBOR_H
 
+#include "ospf6_lsdb.h"
+
 /* Debug option */
 extern unsigned char conf_debug_ospf6_neighbor;
 #define OSPF6_DEBUG_NEIGHBOR_STATE   0x01
@@ -58,6 +60,11 @@ struct ospf6_neighbor
   /* Router Priority of this neighbor */
   u_char priority;
 
+  /* DR/BDR candidate list of the interface this neighbor is on, and
+     the priority it was sorted with */
+  struct list *candidate_list;
+  u_char candidate_priority;
+
   u_int32_t drouter;
   u_int32_t bdrouter;
   u_int32_t prev_drouter;
@@ -75,13 +82,20 @@ struct ospf6_neighbor
   /* Last received Database Description packet */
   struct ospf6_dbdesc  dbdesc_last;
 
+  /* Database summary: walks the Interface, Area and AS LSDBs in place */
+  struct ospf6_lsdb_cursor summary;
+  u_char summary_scope;
+
   /* LS-list */
-  struct ospf6_lsdb *summary_list;
   struct ospf6_lsdb *request_list;
   struct ospf6_lsdb *retrans_list;
 
+  /* LSAs described by the last Database Description (locked, not copied) */
+  struct ospf6_lsa **dbdesc_lsa;
+  unsigned int dbdesc_count;
+  unsigned int dbdesc_size;
+
   /* LSA list for message transmission */
-  struct ospf6_lsdb *dbdesc_list;
   struct ospf6_lsdb *lsreq_list;
   struct ospf6_lsdb *lsupdate_list;
   struct ospf6_lsdb *lsack_list;
@@ -108,9 +122,17 @@ struct ospf6_neighbor
 
 extern const char *ospf6_neighbor_state_str[];
 
+/* Database summary scope being walked */
+#define OSPF6_NEIGHBOR_SUMMARY_LINK  0
+#define OSPF6_NEIGHBOR_SUMMARY_AREA  1
+#define OSPF6_NEIGHBOR_SUMMARY_AS    2
+#define OSPF6_NEIGHBOR_SUMMARY_DONE  3
+
 
 /* Function Prototypes */
 int ospf6_neighbor_cmp (void *va, void *vb);
+unsigned int ospf6_neighbor_hash_key (void *);
+int ospf6_neighbor_hash_cmp (const void *, const void *);
 void ospf6_neighbor_dbex_init (struct ospf6_neighbor *on);
 
 struct ospf6_neighbor *ospf6_neighbor_lookup (u_int32_t,
@@ -119,6 +141,11 @@ struct ospf6_neighbor *ospf6_neighbor_create (u_int32_t,
                                               struct ospf6_interface *);
 void ospf6_neighbor_delete (struct ospf6_neighbor *);
 
+struct ospf6_lsa *ospf6_neighbor_summary_lsa (struct ospf6_neighbor *);
+void ospf6_neighbor_summary_next (struct ospf6_neighbor *);
+void ospf6_neighbor_dbdesc_add (struct ospf6_neighbor *, struct ospf6_lsa *);
+void ospf6_neighbor_dbdesc_clear (struct ospf6_neighbor *);
+
 /* Neighbor event */
 extern int hello_received (struct thread *);
 extern int twoway_received (struct thread *);
@@ -28,6 +28,8 @@
 #include "vty.h"
 #include "command.h"
 #include "linklist.h"
+#include "hash.h"
+#include "jhash.h"
 
 #include "ospf6_proto.h"
 #include "ospf6_lsa.h"
@@ -173,6 +175,143 @@ const char *ospf6_path_type_substr[OSPF6_PATH_TYPE_MAX] =
 { "??", "IA", "IE", "E1", "E2", };
 
 
+/* Interned nexthop sets */
+static struct hash *ospf6_nexthop_set_hash;
+
+static unsigned int
+ospf6_nexthop_set_hash_key (void *p)
+{
+  struct ospf6_nexthop_set *set = p;
+
+  return jhash (set->nexthop, set->count * sizeof (struct ospf6_nexthop),
+                set->count);
+}
+
+static int
+ospf6_nexthop_set_hash_cmp (const void *p1, const void *p2)
+{
+  const struct ospf6_nexthop_set *set1 = p1;
+  const struct ospf6_nexthop_set *set2 = p2;
+
+  return (set1->count == set2->count &&
+          memcmp (set1->nexthop, set2->nexthop,
+                  set1->count * sizeof (struct ospf6_nexthop)) == 0);
+}
+
+static void *
+ospf6_nexthop_set_hash_alloc (void *p)
+{
+  struct ospf6_nexthop_set *val = p;
+  struct ospf6_nexthop_set *set;
+
+  /* the nexthops follow the set in the same allocation */
+  set = XMALLOC (MTYPE_OSPF6_NEXTHOP, sizeof (struct ospf6_nexthop_set) +
+                 val->count * sizeof (struct ospf6_nexthop));
+  set->refcnt = 0;
+  set->count = val->count;
+  set->nexthop = (struct ospf6_nexthop *) (set + 1);
+  memcpy (set->nexthop, val->nexthop,
+          val->count * sizeof (struct ospf6_nexthop));
+  return set;
+}
+
+/* Return the interned set holding the given nexthops, with a reference
+   taken on it; an empty set is represented by NULL. */
+struct ospf6_nexthop_set *
+ospf6_nexthop_set_intern (struct ospf6_nexthop *nexthop, unsigned int count)
+{
+  struct ospf6_nexthop_set tmp;
+  struct ospf6_nexthop_set *set;
+
+  if (count == 0)
+    return NULL;
+
+  if (ospf6_nexthop_set_hash == NULL)
+    ospf6_nexthop_set_hash = hash_create (ospf6_nexthop_set_hash_key,
+                                          ospf6_nexthop_set_hash_cmp);
+
+  tmp.count = count;
+  tmp.nexthop = nexthop;
+  set = hash_get (ospf6_nexthop_set_hash, &tmp, ospf6_nexthop_set_hash_alloc);
+  set->refcnt++;
+  return set;
+}
+
+struct ospf6_nexthop_set *
+ospf6_nexthop_set_lock (struct ospf6_nexthop_set *set)
+{
+  if (set)
+    set->refcnt++;
+  return set;
+}
+
+void
+ospf6_nexthop_set_unintern (struct ospf6_nexthop_set *set)
+{
+  if (set == NULL)
+    return;
+
+  assert (set->refcnt > 0);
+  if (--set->refcnt)
+    return;
+
+  hash_release (ospf6_nexthop_set_hash, set);
+  XFREE (MTYPE_OSPF6_NEXTHOP, set);
+}
+
+/* Append the nexthops of set which are not in nexthop[0..count) yet,
+   up to limit entries in total.  Returns the new count. */
+unsigned int
+ospf6_nexthop_set_merge (struct ospf6_nexthop *nexthop, unsigned int count,
+                         struct ospf6_nexthop_set *set, unsigned int limit)
+{
+  unsigned int i, j;
+
+  for (i = 0; i < ospf6_nexthop_set_count (set) && count < limit; i++)
+    {
+      for (j = 0; j < count; j++)
+        if (ospf6_nexthop_is_same (&nexthop[j], &set->nexthop[i]))
+          break;
+      if (j == count)
+        ospf6_nexthop_copy (&nexthop[count++], &set->nexthop[i]);
+    }
+
+  return count;
+}
+
+unsigned long
+ospf6_nexthop_set_table_count (void)
+{
+  return (ospf6_nexthop_set_hash ? ospf6_nexthop_set_hash->count : 0);
+}
+
+/* Replace the nexthops of route by set, taking a reference on it. */
+void
+ospf6_route_set_nexthops (struct ospf6_route *route,
+                          struct ospf6_nexthop_set *set)
+{
+  ospf6_nexthop_set_lock (set);
+  ospf6_nexthop_set_unintern (route->nh);
+  route->nh = set;
+}
+
+/* Replace the nexthops of route by a single nexthop. */
+void
+ospf6_route_set_nexthop (struct ospf6_route *route, unsigned int ifindex,
+                         struct in6_addr *address)
+{
+  struct ospf6_nexthop nexthop;
+
+  nexthop.ifindex = ifindex;
+  if (address)
+    memcpy (&nexthop.address, address, sizeof (struct in6_addr));
+  else
+    memset (&nexthop.address, 0, sizeof (struct in6_addr));
+
+  ospf6_nexthop_set_unintern (route->nh);
+  route->nh = ospf6_nexthop_set_intern (&nexthop, 1);
+}
+
 struct ospf6_route *
 ospf6_route_create (void)
 {
@@ -184,6 +323,7 @@ ospf6_route_create (void)
 void
 ospf6_route_delete (struct ospf6_route *route)
 {
+  ospf6_nexthop_set_unintern (route->nh);
   XFREE (MTYPE_OSPF6_ROUTE, route);
 }
 
@@ -199,6 +339,7 @@ ospf6_route_copy (struct ospf6_route *route)
   new->next = NULL;
   new->table = NULL;
   new->lock = 0;
+  ospf6_nexthop_set_lock (new->nh);
   return new;
 }
 
@@ -304,7 +445,7 @@ ospf6_route_lookup_bestmatch (struct prefix *prefix,
   return route;
 }
 
-#ifndef NDEBUG
+#ifdef DEBUG
 static void
 route_table_assert (struct ospf6_route_table *table)
 {
@@ -350,7 +491,7 @@ route_table_assert (struct ospf6_route_table *table)
 #define ospf6_route_table_assert(t) (route_table_assert (t))
 #else
 #define ospf6_route_table_assert(t) ((void) 0)
-#endif /*NDEBUG*/
+#endif /*DEBUG*/
 
 struct ospf6_route *
 ospf6_route_add (struct ospf6_route *route,
@@ -367,10 +508,14 @@ ospf6_route_add (struct ospf6_route *route,
   assert (route->next == NULL);
   assert (route->prev == NULL);
 
-  if (route->type == OSPF6_DEST_TYPE_LINKSTATE)
-    ospf6_linkstate_prefix2str (&route->prefix, buf, sizeof (buf));
-  else
-    prefix2str (&route->prefix, buf, sizeof (buf));
+  /* Only named when debugging: this runs for every route of every SPF */
+  if (IS_OSPF6_DEBUG_ROUTE (MEMORY) || IS_OSPF6_DEBUG_ROUTE (TABLE))
+    {
+      if (route->type == OSPF6_DEST_TYPE_LINKSTATE)
+        ospf6_linkstate_prefix2str (&route->prefix, buf, sizeof (buf));
+      else
+        prefix2str (&route->prefix, buf, sizeof (buf));
+    }
 
   if (IS_OSPF6_DEBUG_ROUTE (MEMORY))
     zlog_debug ("%s %p: route add %p: %s", ospf6_route_table_name (table),
@@ -540,28 +685,40 @@ ospf6_route_add (struct ospf6_route *route,
 
       next = nextnode->info;
       route->next = next;
-      next->prev = route;
     }
 
-  /* lookup real existing prev route */
-  prevnode = node;
-  route_lock_node (prevnode);
-  do {
-    prevnode = route_prev (prevnode);
-  } while (prevnode && prevnode->info == NULL);
-
-  /* set prev link */
-  if (prevnode == NULL)
-    route->prev = NULL;
+  /* set prev link: the list is in table order, so this goes just before
+     next.  Only the last route has to look for it back through the
+     table, which costs as much as the table is large. */
+  if (route->next)
+    {
+      prev = route->next->prev;
+      route->prev = prev;
+      if (prev)
+        prev->next = route;
+      route->next->prev = route;
+    }
   else
     {
-      route_unlock_node (prevnode);
+      /* lookup real existing prev route */
+      prevnode = node;
+      route_lock_node (prevnode);
+      do {
+        prevnode = route_prev (prevnode);
+      } while (prevnode && prevnode->info == NULL);
+
+      if (prevnode == NULL)
+        route->prev = NULL;
+      else
+        {
+          route_unlock_node (prevnode);
 
-      prev = prevnode->info;
-      while (prev->next && ospf6_route_is_same (prev, prev->next))
-        prev = prev->next;
-      route->prev = prev;
-      prev->next = route;
+          prev = prevnode->info;
+          while (prev->next && ospf6_route_is_same (prev, prev->next))
+            prev = prev->next;
+          route->prev = prev;
+          prev->next = route;
+        }
     }
 
   table->count++;
@@ -582,10 +739,13 @@ ospf6_route_remove (struct ospf6_route *route,
   struct ospf6_route *current;
   char buf[64];
 
-  if (route->type == OSPF6_DEST_TYPE_LINKSTATE)
-    ospf6_linkstate_prefix2str (&route->prefix, buf, sizeof (buf));
-  else
-    prefix2str (&route->prefix, buf, sizeof (buf));
+  if (IS_OSPF6_DEBUG_ROUTE (MEMORY) || IS_OSPF6_DEBUG_ROUTE (TABLE))
+    {
+      if (route->type == OSPF6_DEST_TYPE_LINKSTATE)
+        ospf6_linkstate_prefix2str (&route->prefix, buf, sizeof (buf));
+      else
+        prefix2str (&route->prefix, buf, sizeof (buf));
+    }
 
   if (IS_OSPF6_DEBUG_ROUTE (MEMORY))
     zlog_debug ("%s %p: route remove %p: %s",
@@ -785,7 +945,8 @@ ospf6_route_table_delete (struct ospf6_route_table *table)
 void
 ospf6_route_show (struct vty *vty, struct ospf6_route *route)
 {
-  int i;
+  unsigned int i;
+  struct ospf6_nexthop *nh;
   char destination[64], nexthop[64];
   char duration[16], ifname[IFNAMSIZ];
   struct timeval now, res;
@@ -805,10 +966,18 @@ ospf6_route_show (struct vty *vty, struct ospf6_route *route)
     prefix2str (&route->prefix, destination, sizeof (destination));
 
   /* nexthop */
-  inet_ntop (AF_INET6, &route->nexthop[0].address, nexthop,
-             sizeof (nexthop));
-  if (! if_indextoname (route->nexthop[0].ifindex, ifname))
-    snprintf (ifname, sizeof (ifname), "%d", route->nexthop[0].ifindex);
+  if (ospf6_route_nexthop_count (route))
+    {
+      nh = ospf6_route_nexthop (route, 0);
+      inet_ntop (AF_INET6, &nh->address, nexthop, sizeof (nexthop));
+      if (! if_indextoname (nh->ifindex, ifname))
+        snprintf (ifname, sizeof (ifname), "%d", nh->ifindex);
+    }
+  else
+    {
+      strlcpy (nexthop, "::", sizeof (nexthop));
+      strlcpy (ifname, "0", sizeof (ifname));
+    }
 
   vty_out (vty, "%c%1s %2s %-30s %-25s %6.*s %s%s",
            (ospf6_route_is_best (route) ? '*' : ' '),
@@ -816,14 +985,13 @@ ospf6_route_show (struct vty *vty, struct ospf6_route *route)
            OSPF6_PATH_TYPE_SUBSTR (route->path.type),
            destination, nexthop, IFNAMSIZ, ifname, duration, VNL);
 
-  for (i = 1; ospf6_nexthop_is_set (&route->nexthop[i]) &&
-       i < OSPF6_MULTI_PATH_LIMIT; i++)
+  for (i = 1; i < ospf6_route_nexthop_count (route); i++)
     {
       /* nexthop */
-      inet_ntop (AF_INET6, &route->nexthop[i].address, nexthop,
-                 sizeof (nexthop));
-      if (! if_indextoname (route->nexthop[i].ifindex, ifname))
-        snprintf (ifname, sizeof (ifname), "%d", route->nexthop[i].ifindex);
+      nh = ospf6_route_nexthop (route, i);
+      inet_ntop (AF_INET6, &nh->address, nexthop, sizeof (nexthop));
+      if (! if_indextoname (nh->ifindex, ifname))
+        snprintf (ifname, sizeof (ifname), "%d", nh->ifindex);
 
       vty_out (vty, "%c%1s %2s %-30s %-25s %6.*s %s%s",
                ' ', "", "", "", nexthop, IFNAMSIZ, ifname, "", VNL);
@@ -837,7 +1005,8 @@ ospf6_route_show_detail (struct vty *vty, struct ospf6_route *route)
   char area_id[16], id[16], adv_router[16], capa[16], options[16];
   struct timeval now, res;
   char duration[16];
-  int i;
+  unsigned int i;
+  struct ospf6_nexthop *nh;
 
   quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
 
@@ -913,14 +1082,13 @@ ospf6_route_show_detail (struct vty *vty, struct ospf6_route *route)
 
   /* Nexthops */
   vty_out (vty, "Nexthop:%s", VNL);
-  for (i = 0; ospf6_nexthop_is_set (&route->nexthop[i]) &&
-       i < OSPF6_MULTI_PATH_LIMIT; i++)
+  for (i = 0; i < ospf6_route_nexthop_count (route); i++)
     {
       /* nexthop */
-      inet_ntop (AF_INET6, &route->nexthop[i].address, nexthop,
-                 sizeof (nexthop));
-      if (! if_indextoname (route->nexthop[i].ifindex, ifname))
-        snprintf (ifname, sizeof (ifname), "%d", route->nexthop[i].ifindex);
+      nh = ospf6_route_nexthop (route, i);
+      inet_ntop (AF_INET6, &nh->address, nexthop, sizeof (nexthop));
+      if (! if_indextoname (nh->ifindex, ifname))
+        snprintf (ifname, sizeof (ifname), "%d", nh->ifindex);
       vty_out (vty, "  %s %.*s%s", nexthop, IFNAMSIZ, ifname, VNL);
     }
   vty_out (vty, "%s", VNL);
@@ -946,9 +1114,9 @@ ospf6_route_show_table_summary (struct vty *vty,
         destination++;
       else
         alternative++;
-      if (! ospf6_nexthop_is_set (&route->nexthop[0]))
+      if (ospf6_route_nexthop_count (route) == 0)
         nhinval++;
-      else if (ospf6_nexthop_is_set (&route->nexthop[1]))
+      else if (ospf6_route_nexthop_count (route) > 1)
         ecmp++;
       pathtype[route->path.type]++;
       number++;
@@ -962,6 +1130,8 @@ ospf6_route_show_table_summary (struct vty *vty,
   vty_out (vty, "Number of Destination: %d%s", destination, VNL);
   vty_out (vty, "Number of Alternative routes: %d%s", alternative, VNL);
   vty_out (vty, "Number of Equal Cost Multi Path: %d%s", ecmp, VNL);
+  vty_out (vty, "Number of shared nexthop sets: %lu%s",
+           ospf6_nexthop_set_table_count (), VNL);
   for (i = OSPF6_PATH_TYPE_INTRA; i <= OSPF6_PATH_TYPE_EXTERNAL2; i++)
     {
       vty_out (vty, "Number of %s routes: %d%s",
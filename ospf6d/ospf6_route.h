@@ -22,7 +22,8 @@
 #ifndef OSPF6_ROUTE_H
 #define OSPF6_ROUTE_H
 
-#define OSPF6_MULTI_PATH_LIMIT    4
+#define OSPF6_MULTI_PATH_LIMIT    4   /* default maximum-paths */
+#define OSPF6_MULTI_PATH_MAX      64
 
 /* Debug option */
 extern unsigned char conf_debug_ospf6_route;
@@ -64,6 +65,19 @@ struct ospf6_nexthop
             sizeof (struct in6_addr));                        \
   } while (0)
 
+/* Set of equal-cost nexthops.  Sets are interned, so routes and SPF
+   vertices with the same paths share one copy, sized to the number of
+   nexthops actually present, and identical sets compare equal by
+   pointer. */
+struct ospf6_nexthop_set
+{
+  unsigned long refcnt;
+  unsigned int count;
+  struct ospf6_nexthop *nexthop;
+};
+
+#define ospf6_nexthop_set_count(s) ((s) ? (s)->count : 0)
+
 /* Path */
 struct ospf6_ls_origin
 {
@@ -135,8 +149,8 @@ struct ospf6_route
   /* path */
   struct ospf6_path path;
 
-  /* nexthop */
-  struct ospf6_nexthop nexthop[OSPF6_MULTI_PATH_LIMIT];
+  /* nexthops, NULL if none */
+  struct ospf6_nexthop_set *nh;
 
   /* route option */
   void *route_option;
@@ -231,10 +245,14 @@ extern const char *ospf6_path_type_substr[OSPF6_PATH_TYPE_MAX];
   ((ra)->type == (rb)->type && \
    memcmp (&(ra)->prefix, &(rb)->prefix, sizeof (struct prefix)) == 0 && \
    memcmp (&(ra)->path, &(rb)->path, sizeof (struct ospf6_path)) == 0 && \
-   memcmp (&(ra)->nexthop, &(rb)->nexthop,                               \
-           sizeof (struct ospf6_nexthop) * OSPF6_MULTI_PATH_LIMIT) == 0)
+   (ra)->nh == (rb)->nh)
 #define ospf6_route_is_best(r) (CHECK_FLAG ((r)->flag, OSPF6_ROUTE_BEST))
 
+#define ospf6_route_nexthop_count(r) (ospf6_nexthop_set_count ((r)->nh))
+#define ospf6_route_nexthop(r, i) (&(r)->nh->nexthop[i])
+#define ospf6_route_nexthop_ifindex(r) \
+  ((r)->nh ? (r)->nh->nexthop[0].ifindex : 0)
+
 #define ospf6_linkstate_prefix_adv_router(x) \
   (*(u_int32_t *)(&(x)->u.prefix6.s6_addr[0]))
 #define ospf6_linkstate_prefix_id(x) \
@@ -246,6 +264,23 @@ extern const char *ospf6_path_type_substr[OSPF6_PATH_TYPE_MAX];
   (*(u_int32_t *)(&(x)->u.prefix6.s6_addr[4]))
 
 /* Function prototype */
+extern struct ospf6_nexthop_set *
+ospf6_nexthop_set_intern (struct ospf6_nexthop *nexthop, unsigned int count);
+extern struct ospf6_nexthop_set *
+ospf6_nexthop_set_lock (struct ospf6_nexthop_set *set);
+extern void ospf6_nexthop_set_unintern (struct ospf6_nexthop_set *set);
+extern unsigned int ospf6_nexthop_set_merge (struct ospf6_nexthop *nexthop,
+                                             unsigned int count,
+                                             struct ospf6_nexthop_set *set,
+                                             unsigned int limit);
+extern unsigned long ospf6_nexthop_set_table_count (void);
+
+extern void ospf6_route_set_nexthops (struct ospf6_route *route,
+                                      struct ospf6_nexthop_set *set);
+extern void ospf6_route_set_nexthop (struct ospf6_route *route,
+                                     unsigned int ifindex,
+                                     struct in6_addr *address);
+
 extern void ospf6_linkstate_prefix (u_int32_t adv_router, u_int32_t id,
                                     struct prefix *prefix);
 extern void ospf6_linkstate_prefix2str (struct prefix *prefix, char *buf,
@@ -0,0 +1,453 @@
+/*
+ * LSDB snapshot for warm restarts of ospf6d.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Every OSPF6_SNAPSHOT_INTERVAL seconds, on shutdown and before a
+ * router-id change restarts ospf6, the LSDB is written to
+ * ospf6_snapshot_file if any LSA in it has changed since the last
+ * write.  Refreshes change every LSA at least once per LS_REFRESH_TIME,
+ * so a snapshot left alone never grows too old to use.  When ospf6
+ * starts, the file is mapped and
+ * indexed.  Whenever a neighbor's Database Description lists an
+ * instance we lack that is identical (same sequence number and checksum)
+ * to one in the snapshot, the snapshot copy is installed and flooded as
+ * if it had just been received, instead of being put on the request
+ * list.  LSAs are never installed on the snapshot's word alone, so a
+ * stale snapshot costs nothing but requests.  The mapping is dropped
+ * OSPF6_SNAPSHOT_HOLD seconds after startup, when the adjacencies it
+ * helps to bring up are expected to be full. */
+
+#include <zebra.h>
+#include <sys/mman.h>
+
+#include "log.h"
+#include "memory.h"
+#include "thread.h"
+#include "hash.h"
+#include "jhash.h"
+#include "linklist.h"
+#include "if.h"
+#include "vty.h"
+
+#include "ospf6_proto.h"
+#include "ospf6_lsa.h"
+#include "ospf6_lsdb.h"
+#include "ospf6_message.h"
+#include "ospf6_top.h"
+#include "ospf6_area.h"
+#include "ospf6_interface.h"
+#include "ospf6_neighbor.h"
+#include "ospf6_snapshot.h"
+#include "ospf6d.h"
+
+#define OSPF6_SNAPSHOT_MAGIC    0x4f364c53  /* "O6LS" */
+#define OSPF6_SNAPSHOT_VERSION  1
+
+/* All in network byte order, followed by count records of a 32 bit
+ * scope (ifindex of link-local LSAs, area ID of area LSAs, else 0) and
+ * the LSA itself, whose length is a multiple of 4 */
+struct ospf6_snapshot_header
+{
+  u_int32_t magic;
+  u_int16_t version;
+  u_int16_t reserved;
+  u_int32_t saved;             /* wall clock seconds */
+  u_int32_t count;
+};
+
+struct ospf6_snapshot_entry
+{
+  u_int32_t scope;
+  struct ospf6_lsa_header *header;
+};
+
+const char *ospf6_snapshot_file = NULL;
+
+static struct
+{
+  caddr_t map;
+  size_t len;
+  time_t saved;
+  struct ospf6_snapshot_entry *entry;
+  struct hash *index;
+  unsigned long count;
+  unsigned long reused;
+
+  /* LSDB as last written */
+  u_int32_t sig;
+  int written;
+
+  struct thread *t_save;
+  struct thread *t_release;
+} snapshot;
+
+static unsigned int
+ospf6_snapshot_hash_key (void *data)
+{
+  struct ospf6_snapshot_entry *entry = data;
+
+  return jhash_3words (entry->header->id, entry->header->adv_router,
+                       entry->scope, entry->header->type);
+}
+
+static int
+ospf6_snapshot_hash_cmp (const void *a, const void *b)
+{
+  const struct ospf6_snapshot_entry *ea = a, *eb = b;
+
+  return (ea->scope == eb->scope &&
+          ea->header->type == eb->header->type &&
+          ea->header->id == eb->header->id &&
+          ea->header->adv_router == eb->header->adv_router);
+}
+
+static u_int32_t
+ospf6_snapshot_scope (u_int16_t type, struct ospf6_interface *oi)
+{
+  switch (OSPF6_LSA_SCOPE (type))
+    {
+    case OSPF6_SCOPE_LINKLOCAL:
+      return htonl (oi->interface->ifindex);
+    case OSPF6_SCOPE_AREA:
+      return oi->area->area_id;
+    default:
+      return 0;
+    }
+}
+
+static void
+ospf6_snapshot_release (void)
+{
+  if (snapshot.map == NULL)
+    return;
+
+  if (snapshot.index)
+    {
+      zlog_info ("LSDB snapshot: %lu of %lu LSAs reused", snapshot.reused,
+                 snapshot.count);
+      hash_clean (snapshot.index, NULL);
+      hash_free (snapshot.index);
+      snapshot.index = NULL;
+    }
+  if (snapshot.entry)
+    XFREE (MTYPE_OSPF6_OTHER, snapshot.entry);
+  munmap (snapshot.map, snapshot.len);
+  snapshot.map = NULL;
+  snapshot.count = snapshot.reused = 0;
+}
+
+static int
+ospf6_snapshot_releaser (struct thread *thread)
+{
+  snapshot.t_release = NULL;
+  ospf6_snapshot_release ();
+  return 0;
+}
+
+static int
+ospf6_snapshot_index (void)
+{
+  struct ospf6_snapshot_header *header;
+  struct ospf6_lsa_header *lsa_header;
+  struct timeval now;
+  caddr_t p, end;
+  u_int32_t i;
+  u_int16_t length;
+
+  header = (struct ospf6_snapshot_header *) snapshot.map;
+  end = snapshot.map + snapshot.len;
+  quagga_gettime (QUAGGA_CLK_REALTIME, &now);
+
+  if (snapshot.len < sizeof (struct ospf6_snapshot_header) ||
+      ntohl (header->magic) != OSPF6_SNAPSHOT_MAGIC ||
+      ntohs (header->version) != OSPF6_SNAPSHOT_VERSION)
+    return -1;
+
+  snapshot.saved = ntohl (header->saved);
+  if (snapshot.saved > now.tv_sec || now.tv_sec - snapshot.saved >= MAXAGE)
+    return -1;
+
+  snapshot.count = ntohl (header->count);
+  if (snapshot.count > snapshot.len / sizeof (struct ospf6_lsa_header))
+    return -1;
+  snapshot.entry = XCALLOC (MTYPE_OSPF6_OTHER, snapshot.count *
+                            sizeof (struct ospf6_snapshot_entry));
+  snapshot.index = hash_create_size (snapshot.count + 1,
+                                     ospf6_snapshot_hash_key,
+                                     ospf6_snapshot_hash_cmp);
+
+  p = snapshot.map + sizeof (struct ospf6_snapshot_header);
+  for (i = 0; i < snapshot.count; i++)
+    {
+      if (p + sizeof (u_int32_t) + sizeof (struct ospf6_lsa_header) > end)
+        return -1;
+      lsa_header = (struct ospf6_lsa_header *) (p + sizeof (u_int32_t));
+      length = ntohs (lsa_header->length);
+      if (length < sizeof (struct ospf6_lsa_header) || length % 4 ||
+          (caddr_t) lsa_header + length > end ||
+          ! ospf6_lsa_checksum_valid (lsa_header))
+        return -1;
+
+      memcpy (&snapshot.entry[i].scope, p, sizeof (u_int32_t));
+      snapshot.entry[i].header = lsa_header;
+      hash_get (snapshot.index, &snapshot.entry[i], hash_alloc_intern);
+      p = (caddr_t) lsa_header + length;
+    }
+
+  return 0;
+}
+
+static int
+ospf6_snapshot_saver (struct thread *thread)
+{
+  snapshot.t_save = NULL;
+  if (ospf6 == NULL)
+    return 0;
+
+  ospf6_snapshot_save ();
+  snapshot.t_save = thread_add_timer (master, ospf6_snapshot_saver, NULL,
+                                      OSPF6_SNAPSHOT_INTERVAL);
+  return 0;
+}
+
+/* Maps and indexes the snapshot, if there is one, and starts taking
+ * new ones; called whenever ospf6 starts */
+void
+ospf6_snapshot_load (void)
+{
+  struct stat st;
+  caddr_t map;
+  int fd;
+
+  ospf6_snapshot_stop ();
+  snapshot.written = 0;
+  if (ospf6_snapshot_file == NULL)
+    return;
+
+  snapshot.t_save = thread_add_timer (master, ospf6_snapshot_saver, NULL,
+                                      OSPF6_SNAPSHOT_INTERVAL);
+
+  fd = open (ospf6_snapshot_file, O_RDONLY);
+  if (fd < 0)
+    return;
+  if (fstat (fd, &st) < 0 || st.st_size == 0)
+    {
+      close (fd);
+      return;
+    }
+  map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (map == MAP_FAILED)
+    {
+      zlog_warn ("Can't map LSDB snapshot %s: %s", ospf6_snapshot_file,
+                 safe_strerror (errno));
+      return;
+    }
+
+  snapshot.map = map;
+  snapshot.len = st.st_size;
+  if (ospf6_snapshot_index () < 0)
+    {
+      zlog_warn ("Ignoring stale or damaged LSDB snapshot %s",
+                 ospf6_snapshot_file);
+      ospf6_snapshot_release ();
+      return;
+    }
+
+  snapshot.t_release = thread_add_timer (master, ospf6_snapshot_releaser,
+                                         NULL, OSPF6_SNAPSHOT_HOLD);
+}
+
+/* Hash of the instances in a LSDB, chained on from sig */
+static u_int32_t
+ospf6_snapshot_sig (struct ospf6_lsdb *lsdb, u_int32_t scope, u_int32_t sig)
+{
+  struct ospf6_lsa *lsa;
+
+  for (lsa = ospf6_lsdb_head (lsdb); lsa; lsa = ospf6_lsdb_next (lsa))
+    {
+      sig = jhash_3words (lsa->header->type ^ scope, lsa->header->id,
+                          lsa->header->adv_router, sig);
+      sig = jhash_3words (lsa->header->seqnum, lsa->header->checksum,
+                          OSPF6_LSA_IS_MAXAGE (lsa), sig);
+    }
+  return sig;
+}
+
+static int
+ospf6_snapshot_write_lsdb (FILE *fp, struct ospf6_lsdb *lsdb,
+                           u_int32_t scope)
+{
+  struct ospf6_lsa *lsa;
+
+  for (lsa = ospf6_lsdb_head (lsdb); lsa; lsa = ospf6_lsdb_next (lsa))
+    {
+      ospf6_lsa_age_precise (lsa);
+      if (fwrite (&scope, sizeof (scope), 1, fp) != 1 ||
+          fwrite (lsa->header, ntohs (lsa->header->length), 1, fp) != 1)
+        {
+          ospf6_lsa_unlock (lsa);
+          return -1;
+        }
+    }
+  return 0;
+}
+
+/* Writes the LSDB, unless it is as last written, to a temporary file
+ * that replaces the snapshot once it is complete and synced */
+void
+ospf6_snapshot_save (void)
+{
+  struct ospf6_snapshot_header header;
+  struct listnode *node, *inode;
+  struct ospf6_area *oa;
+  struct ospf6_interface *oi;
+  struct timeval now;
+  char temppath[MAXPATHLEN + 1], dirpath[MAXPATHLEN + 1];
+  u_int32_t count, sig;
+  FILE *fp;
+  char *p;
+  int fd, ret;
+
+  if (ospf6_snapshot_file == NULL || ospf6 == NULL)
+    return;
+
+  count = ospf6->lsdb->count;
+  sig = ospf6_snapshot_sig (ospf6->lsdb, 0, 0);
+  for (ALL_LIST_ELEMENTS_RO (ospf6->area_list, node, oa))
+    {
+      count += oa->lsdb->count;
+      sig = ospf6_snapshot_sig (oa->lsdb, oa->area_id, sig);
+      for (ALL_LIST_ELEMENTS_RO (oa->if_list, inode, oi))
+        {
+          count += oi->lsdb->count;
+          sig = ospf6_snapshot_sig (oi->lsdb, htonl (oi->interface->ifindex),
+                                    sig);
+        }
+    }
+  if (snapshot.written && sig == snapshot.sig)
+    return;
+
+  quagga_gettime (QUAGGA_CLK_REALTIME, &now);
+  header.magic = htonl (OSPF6_SNAPSHOT_MAGIC);
+  header.version = htons (OSPF6_SNAPSHOT_VERSION);
+  header.reserved = 0;
+  header.saved = htonl (now.tv_sec);
+  header.count = htonl (count);
+
+  snprintf (temppath, sizeof (temppath), "%s.new", ospf6_snapshot_file);
+  fd = open (temppath, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0 || (fp = fdopen (fd, "w")) == NULL)
+    {
+      zlog_warn ("Can't write LSDB snapshot %s: %s", temppath,
+                 safe_strerror (errno));
+      if (fd >= 0)
+        close (fd);
+      return;
+    }
+
+  ret = (fwrite (&header, sizeof (header), 1, fp) == 1) ? 0 : -1;
+  if (ret == 0)
+    ret = ospf6_snapshot_write_lsdb (fp, ospf6->lsdb, 0);
+  for (ALL_LIST_ELEMENTS_RO (ospf6->area_list, node, oa))
+    {
+      if (ret == 0)
+        ret = ospf6_snapshot_write_lsdb (fp, oa->lsdb, oa->area_id);
+      for (ALL_LIST_ELEMENTS_RO (oa->if_list, inode, oi))
+        if (ret == 0)
+          ret = ospf6_snapshot_write_lsdb (fp, oi->lsdb,
+                                           htonl (oi->interface->ifindex));
+    }
+  if (ret == 0 && (fflush (fp) != 0 || fsync (fileno (fp)) != 0))
+    ret = -1;
+  if (fclose (fp) != 0)
+    ret = -1;
+
+  if (ret < 0 || rename (temppath, ospf6_snapshot_file) < 0)
+    {
+      zlog_warn ("Can't write LSDB snapshot %s: %s", ospf6_snapshot_file,
+                 safe_strerror (errno));
+      unlink (temppath);
+      return;
+    }
+
+  /* make the rename itself durable */
+  snprintf (dirpath, sizeof (dirpath), "%s", ospf6_snapshot_file);
+  if ((p = strrchr (dirpath, '/')) == NULL)
+    strcpy (dirpath, ".");
+  else
+    *(p == dirpath ? p + 1 : p) = '\0';
+  if ((fd = open (dirpath, O_RDONLY)) >= 0)
+    {
+      fsync (fd);
+      close (fd);
+    }
+
+  snapshot.sig = sig;
+  snapshot.written = 1;
+}
+
+/* Stops taking snapshots and drops the one loaded */
+void
+ospf6_snapshot_stop (void)
+{
+  THREAD_OFF (snapshot.t_save);
+  THREAD_OFF (snapshot.t_release);
+  ospf6_snapshot_release ();
+}
+
+/* Returns a copy of the snapshot's instance of the LSA that a neighbor
+ * described, if it is the same instance, to be installed in place of
+ * requesting it */
+struct ospf6_lsa *
+ospf6_snapshot_lookup (struct ospf6_lsa *his, struct ospf6_neighbor *on)
+{
+  struct ospf6_snapshot_entry key, *entry;
+  struct ospf6_lsa *lsa;
+  struct timeval now;
+
+  if (snapshot.index == NULL)
+    return NULL;
+
+  /* our own LSAs are originated afresh, or flushed */
+  if (his->header->adv_router == on->ospf6_if->area->ospf6->router_id ||
+      ntohs (his->header->age) >= MAXAGE)
+    return NULL;
+
+  key.scope = ospf6_snapshot_scope (his->header->type, on->ospf6_if);
+  key.header = his->header;
+  entry = hash_lookup (snapshot.index, &key);
+  if (entry == NULL ||
+      entry->header->seqnum != his->header->seqnum ||
+      entry->header->checksum != his->header->checksum)
+    return NULL;
+
+  quagga_gettime (QUAGGA_CLK_REALTIME, &now);
+  if (ntohs (entry->header->age) + now.tv_sec - snapshot.saved >= MAXAGE)
+    return NULL;
+
+  /* the neighbor's age is the more recent one */
+  lsa = ospf6_lsa_create (entry->header);
+  lsa->birth.tv_sec += ntohs (lsa->header->age) - ntohs (his->header->age);
+  lsa->header->age = his->header->age;
+
+  snapshot.reused++;
+  return lsa;
+}
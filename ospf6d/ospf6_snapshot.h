@@ -0,0 +1,42 @@
+/*
+ * LSDB snapshot for warm restarts of ospf6d.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef OSPF6_SNAPSHOT_H
+#define OSPF6_SNAPSHOT_H
+
+struct ospf6_lsa;
+struct ospf6_neighbor;
+
+/* seconds between checks for LSDB changes to write out, and for which
+ * a loaded snapshot is kept */
+#define OSPF6_SNAPSHOT_INTERVAL  60
+#define OSPF6_SNAPSHOT_HOLD      120
+
+/* snapshot file, or NULL when not taking snapshots */
+extern const char *ospf6_snapshot_file;
+
+extern void ospf6_snapshot_load (void);
+extern void ospf6_snapshot_save (void);
+extern void ospf6_snapshot_stop (void);
+extern struct ospf6_lsa *ospf6_snapshot_lookup (struct ospf6_lsa *his,
+                                                struct ospf6_neighbor *on);
+
+#endif /* OSPF6_SNAPSHOT_H */
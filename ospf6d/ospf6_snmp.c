@@ -810,7 +810,7 @@ ospfv3WwLsdbEntry (struct variable *v, oid *name, size_t *length,
       return SNMP_INTEGER (ntohl (lsa->header->seqnum));
       break;
     case OSPFv3WWLSDBAGE:
-      ospf6_lsa_age_current (lsa);
+      ospf6_lsa_age_precise (lsa);
       return SNMP_INTEGER (ntohs (lsa->header->age));
       break;
     case OSPFv3WWLSDBCHECKSUM:
@@ -31,10 +31,13 @@
 #include "pqueue.h"
 #include "linklist.h"
 #include "thread.h"
+#include "hash.h"
+#include "jhash.h"
 
 #include "ospf6_lsa.h"
 #include "ospf6_lsdb.h"
 #include "ospf6_route.h"
+#include "ospf6_top.h"
 #include "ospf6_area.h"
 #include "ospf6_spf.h"
 #include "ospf6_auto.h"
@@ -44,41 +47,74 @@
 
 unsigned char conf_debug_ospf6_spf = 0;
 
-/* XXX: LSA reachability methods probably don't belong here */
-static void 
-set_all_lsas_unreachable (struct ospf6_lsdb *lsdb)
+/* The routers reached by the last SPF calculation of an area, keyed by
+   Router-ID, and the area scoped LSAs they originated marked reachable */
+static unsigned int
+ospf6_spf_reachable_key (void *p)
 {
-  struct ospf6_lsa *lsa;
+  return jhash_1word (*(u_int32_t *) p, 0);
+}
 
-  lsa = ospf6_lsdb_head (lsdb);
+static int
+ospf6_spf_reachable_cmp (const void *a, const void *b)
+{
+  return (*(const u_int32_t *) a == *(const u_int32_t *) b);
+}
 
-  while (lsa != NULL)
-  {
-    if (lsa->header->adv_router != ospf6->router_id
-	&& OSPF6_LSA_SCOPE (lsa->header->type) == OSPF6_SCOPE_AREA)  
-    {
-      lsa->reachable = 0;
-    }
-    lsa = ospf6_lsdb_next (lsa);
-  }
+static void *
+ospf6_spf_reachable_alloc (void *p)
+{
+  u_int32_t *router_id;
+
+  router_id = XMALLOC (MTYPE_OSPF6_OTHER, sizeof (u_int32_t));
+  *router_id = *(u_int32_t *) p;
+  return router_id;
 }
 
-static void 
-set_routers_lsas_reachable (struct ospf6_lsa *router_lsa, struct ospf6_lsdb *lsdb)
+static void
+ospf6_spf_reachable_free (void *p)
 {
-  struct ospf6_lsa *lsa;
+  XFREE (MTYPE_OSPF6_OTHER, p);
+}
 
-  lsa = ospf6_lsdb_head (lsdb);
+struct hash *
+ospf6_spf_reachable_create (void)
+{
+  return hash_create (ospf6_spf_reachable_key, ospf6_spf_reachable_cmp);
+}
+
+void
+ospf6_spf_reachable_delete (struct hash *reachable)
+{
+  hash_clean (reachable, ospf6_spf_reachable_free);
+  hash_free (reachable);
+}
+
+/* Until SPF has run, every router counts as reachable, as the LSAs'
+   reachable flags do */
+int
+ospf6_spf_router_reachable (struct ospf6_area *oa, u_int32_t router_id)
+{
+  if (! oa->reachable_known)
+    return 1;
+  return (hash_lookup (oa->reachable_routers, &router_id) != NULL);
+}
+
+/* one pass over the LSDB once the tree is complete, where a rescan per
+   vertex used to be made as it was dequeued */
+static void
+ospf6_spf_mark_reachable (struct ospf6_area *oa)
+{
+  struct ospf6_lsa *lsa;
 
-  while (lsa != NULL)
-  {
-    if (lsa->header->adv_router == router_lsa->header->adv_router
-	&& OSPF6_LSA_SCOPE (lsa->header->type) == OSPF6_SCOPE_AREA)
+  for (lsa = ospf6_lsdb_head (oa->lsdb); lsa; lsa = ospf6_lsdb_next (lsa))
     {
-      lsa->reachable = 1;
+      if (lsa->header->adv_router == oa->ospf6->router_id ||
+          OSPF6_LSA_SCOPE (lsa->header->type) != OSPF6_SCOPE_AREA)
+        continue;
+      lsa->reachable =
+        ospf6_spf_router_reachable (oa, lsa->header->adv_router);
     }
-    lsa = ospf6_lsdb_next (lsa);
-  }
 }
 
 static int
@@ -114,7 +150,6 @@ static struct ospf6_vertex *
 ospf6_vertex_create (struct ospf6_lsa *lsa)
 {
   struct ospf6_vertex *v;
-  int i;
 
   v = (struct ospf6_vertex *)
     XMALLOC (MTYPE_OSPF6_VERTEX, sizeof (struct ospf6_vertex));
@@ -131,8 +166,8 @@ ospf6_vertex_create (struct ospf6_lsa *lsa)
   ospf6_linkstate_prefix (lsa->header->adv_router, lsa->header->id,
                           &v->vertex_id);
 
-  /* name */
-  ospf6_linkstate_prefix2str (&v->vertex_id, v->name, sizeof (v->name));
+  /* name, made when first asked for: most vertices never are */
+  v->name[0] = '\0';
 
   /* Associated LSA */
   v->lsa = lsa;
@@ -143,8 +178,7 @@ ospf6_vertex_create (struct ospf6_lsa *lsa)
   v->options[1] = *(u_char *)(OSPF6_LSA_HEADER_END (lsa->header) + 2);
   v->options[2] = *(u_char *)(OSPF6_LSA_HEADER_END (lsa->header) + 3);
 
-  for (i = 0; i < OSPF6_MULTI_PATH_LIMIT; i++)
-    ospf6_nexthop_clear (&v->nexthop[i]);
+  v->nh = NULL;
 
   v->parent = NULL;
   v->child_list = list_new ();
@@ -153,9 +187,18 @@ ospf6_vertex_create (struct ospf6_lsa *lsa)
   return v;
 }
 
+static const char *
+ospf6_vertex_name (struct ospf6_vertex *v)
+{
+  if (v->name[0] == '\0')
+    ospf6_linkstate_prefix2str (&v->vertex_id, v->name, sizeof (v->name));
+  return v->name;
+}
+
 static void
 ospf6_vertex_delete (struct ospf6_vertex *v)
 {
+  ospf6_nexthop_set_unintern (v->nh);
   list_delete (v->child_list);
   XFREE (MTYPE_OSPF6_VERTEX, v);
 }
@@ -262,16 +305,19 @@ static void
 ospf6_nexthop_calc (struct ospf6_vertex *w, struct ospf6_vertex *v,
                     caddr_t lsdesc)
 {
-  int i, ifindex;
+  unsigned int i, limit;
+  int ifindex;
   struct ospf6_interface *oi;
   u_int16_t type;
   u_int32_t adv_router;
   struct ospf6_lsa *lsa;
   struct ospf6_link_lsa *link_lsa;
+  struct ospf6_nexthop nexthop[OSPF6_MULTI_PATH_MAX];
   char buf[64];
 
   assert (VERTEX_IS_TYPE (ROUTER, w));
-  ifindex = (VERTEX_IS_TYPE (NETWORK, v) ? v->nexthop[0].ifindex :
+  ifindex = (VERTEX_IS_TYPE (NETWORK, v) ?
+             (v->nh ? v->nh->nexthop[0].ifindex : 0) :
              ROUTER_LSDESC_GET_IFID (lsdesc));
   oi = ospf6_interface_lookup_by_ifindex (ifindex);
   if (oi == NULL)
@@ -281,6 +327,7 @@ ospf6_nexthop_calc (struct ospf6_vertex *w, struct ospf6_vertex *v,
       return;
     }
 
+  limit = w->area->ospf6->max_paths;
   type = htons (OSPF6_LSTYPE_LINK);
   adv_router = (VERTEX_IS_TYPE (NETWORK, v) ?
                 NETWORK_LSDESC_GET_NBR_ROUTERID (lsdesc) :
@@ -301,17 +348,20 @@ ospf6_nexthop_calc (struct ospf6_vertex *w, struct ospf6_vertex *v,
           zlog_debug ("  nexthop %s from %s", buf, lsa->name);
         }
 
-      if (i < OSPF6_MULTI_PATH_LIMIT)
+      if (i < limit)
         {
-          memcpy (&w->nexthop[i].address, &link_lsa->linklocal_addr,
+          memcpy (&nexthop[i].address, &link_lsa->linklocal_addr,
                   sizeof (struct in6_addr));
-          w->nexthop[i].ifindex = ifindex;
+          nexthop[i].ifindex = ifindex;
           i++;
         }
     }
 
   if (i == 0 && IS_OSPF6_DEBUG_SPF (PROCESS))
-    zlog_debug ("No nexthop for %s found", w->name);
+    zlog_debug ("No nexthop for %s found", ospf6_vertex_name (w));
+
+  ospf6_nexthop_set_unintern (w->nh);
+  w->nh = ospf6_nexthop_set_intern (nexthop, i);
 }
 
 static int
@@ -319,12 +369,13 @@ ospf6_spf_install (struct ospf6_vertex *v,
                    struct ospf6_route_table *result_table)
 {
   struct ospf6_route *route;
-  int i, j;
+  struct ospf6_nexthop nexthop[OSPF6_MULTI_PATH_MAX];
+  unsigned int count;
   struct ospf6_vertex *prev;
 
   if (IS_OSPF6_DEBUG_SPF (PROCESS))
     zlog_debug ("SPF install %s hops %d cost %d",
-		v->name, v->hops, v->cost);
+		ospf6_vertex_name (v), v->hops, v->cost);
 
   route = ospf6_route_lookup (&v->vertex_id, result_table);
   if (route && route->path.cost < v->cost)
@@ -340,22 +391,14 @@ ospf6_spf_install (struct ospf6_vertex *v,
       if (IS_OSPF6_DEBUG_SPF (PROCESS))
         zlog_debug ("  another path found, merge");
 
-      for (i = 0; ospf6_nexthop_is_set (&v->nexthop[i]) &&
-           i < OSPF6_MULTI_PATH_LIMIT; i++)
+      count = ospf6_nexthop_set_merge (nexthop, 0, route->nh,
+                                       v->area->ospf6->max_paths);
+      count = ospf6_nexthop_set_merge (nexthop, count, v->nh,
+                                       v->area->ospf6->max_paths);
+      if (count != ospf6_route_nexthop_count (route))
         {
-          for (j = 0; j < OSPF6_MULTI_PATH_LIMIT; j++)
-            {
-              if (ospf6_nexthop_is_set (&route->nexthop[j]))
-                {
-                  if (ospf6_nexthop_is_same (&route->nexthop[j],
-                                             &v->nexthop[i]))
-                    break;
-                  else
-                    continue;
-                }
-              ospf6_nexthop_copy (&route->nexthop[j], &v->nexthop[i]);
-              break;
-            }
+          ospf6_nexthop_set_unintern (route->nh);
+          route->nh = ospf6_nexthop_set_intern (nexthop, count);
         }
 
       prev = (struct ospf6_vertex *) route->route_option;
@@ -389,9 +432,7 @@ ospf6_spf_install (struct ospf6_vertex *v,
   route->path.options[1] = v->options[1];
   route->path.options[2] = v->options[2];
 
-  for (i = 0; ospf6_nexthop_is_set (&v->nexthop[i]) &&
-       i < OSPF6_MULTI_PATH_LIMIT; i++)
-    ospf6_nexthop_copy (&route->nexthop[i], &v->nexthop[i]);
+  ospf6_route_set_nexthops (route, v->nh);
 
   if (v->parent)
     listnode_add_sort (v->parent->child_list, v);
@@ -424,10 +465,11 @@ ospf6_spf_calculation (u_int32_t router_id,
 {
   struct pqueue *candidate_list;
   struct ospf6_vertex *root, *v, *w;
-  int i;
+  struct ospf6_nexthop nexthop;
   int size;
   caddr_t lsdesc;
   struct ospf6_lsa *lsa;
+  int reachable;
 
   ospf6_spf_table_finish (result_table);
 
@@ -435,11 +477,21 @@ ospf6_spf_calculation (u_int32_t router_id,
   /* construct root vertex */
   lsa = ospf6_lsdb_lookup (htons (OSPF6_LSTYPE_ROUTER), htonl (0),
                            router_id, oa->lsdb);
-  
-  set_all_lsas_unreachable (oa->lsdb);
-  
+
+  /* reachability is only recorded for the tree rooted at ourselves */
+  reachable = (router_id == oa->ospf6->router_id);
+  if (reachable)
+    {
+      hash_clean (oa->reachable_routers, ospf6_spf_reachable_free);
+      oa->reachable_known = 1;
+    }
+
   if (lsa == NULL)
-    return;
+    {
+      if (reachable)
+        ospf6_spf_mark_reachable (oa);
+      return;
+    }
 
   /* initialize */
   candidate_list = pqueue_create ();
@@ -449,8 +501,9 @@ ospf6_spf_calculation (u_int32_t router_id,
   root->area = oa;
   root->cost = 0;
   root->hops = 0;
-  root->nexthop[0].ifindex = 0; /* loopbak I/F is better ... */
-  inet_pton (AF_INET6, "::1", &root->nexthop[0].address);
+  nexthop.ifindex = 0; /* loopbak I/F is better ... */
+  inet_pton (AF_INET6, "::1", &nexthop.address);
+  root->nh = ospf6_nexthop_set_intern (&nexthop, 1);
 
   /* Actually insert root to the candidate-list as the only candidate */
   pqueue_enqueue (root, candidate_list);
@@ -461,8 +514,9 @@ ospf6_spf_calculation (u_int32_t router_id,
       /* get closest candidate from priority queue */
       v = pqueue_dequeue (candidate_list);
 
-      /* XXX: LSA is used as a vertex, must be reachable? */
-      set_routers_lsas_reachable (v->lsa, v->lsa->lsdb);
+      if (reachable)
+        hash_get (oa->reachable_routers, &v->lsa->header->adv_router,
+                  ospf6_spf_reachable_alloc);
 
       /* installing may result in merging or rejecting of the vertex */
       if (ospf6_spf_install (v, result_table) < 0)
@@ -498,26 +552,29 @@ ospf6_spf_calculation (u_int32_t router_id,
 
           /* nexthop calculation */
           if (w->hops == 0)
-            w->nexthop[0].ifindex = ROUTER_LSDESC_GET_IFID (lsdesc);
+            {
+              memset (&nexthop, 0, sizeof (nexthop));
+              nexthop.ifindex = ROUTER_LSDESC_GET_IFID (lsdesc);
+              w->nh = ospf6_nexthop_set_intern (&nexthop, 1);
+            }
           else if (w->hops == 1 && v->hops == 0)
             ospf6_nexthop_calc (w, v, lsdesc);
           else
-            {
-              for (i = 0; ospf6_nexthop_is_set (&v->nexthop[i]) &&
-                   i < OSPF6_MULTI_PATH_LIMIT; i++)
-                ospf6_nexthop_copy (&w->nexthop[i], &v->nexthop[i]);
-            }
+            w->nh = ospf6_nexthop_set_lock (v->nh);
 
           /* add new candidate to the candidate_list */
           if (IS_OSPF6_DEBUG_SPF (PROCESS))
             zlog_debug ("  New candidate: %s hops %d cost %d",
-			w->name, w->hops, w->cost);
+			ospf6_vertex_name (w), w->hops, w->cost);
           pqueue_enqueue (w, candidate_list);
         }
     }
 
   pqueue_delete (candidate_list);
 
+  if (reachable)
+    ospf6_spf_mark_reachable (oa);
+
   oa->spf_calculation++;
 }
 
@@ -550,6 +607,7 @@ static int
 ospf6_spf_calculation_thread (struct thread *t)
 {
   struct ospf6_area *oa;
+  struct ospf6_route_table *old_spf_table;
   struct timeval start, end, runtime;
 
   oa = (struct ospf6_area *) THREAD_ARG (t);
@@ -560,6 +618,12 @@ ospf6_spf_calculation_thread (struct thread *t)
   if (IS_OSPF6_DEBUG_SPF (DATABASE))
     ospf6_spf_log_database (oa);
 
+  /* keep the previous result, so that intra-area routes only need
+     recalculating for the vertices which changed */
+  old_spf_table = oa->spf_table;
+  oa->spf_table = OSPF6_ROUTE_TABLE_CREATE (AREA, SPF_RESULTS);
+  oa->spf_table->scope = oa;
+
   /* execute SPF calculation */
   quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
   ospf6_spf_calculation (oa->ospf6->router_id, oa->spf_table, oa);
@@ -570,9 +634,12 @@ ospf6_spf_calculation_thread (struct thread *t)
     zlog_debug ("SPF runtime: %ld sec %ld usec",
 		runtime.tv_sec, runtime.tv_usec);
 
-  ospf6_intra_route_calculation (oa);
+  ospf6_intra_route_calculation (oa, old_spf_table);
   ospf6_intra_brouter_calculation (oa);
 
+  ospf6_spf_table_finish (old_spf_table);
+  ospf6_route_table_delete (old_spf_table);
+
   return 0;
 }
 
@@ -596,7 +663,8 @@ ospf6_spf_display_subtree (struct vty *vty, const char *prefix, int rest,
   int restnum;
 
   /* "prefix" is the space prefix of the display line */
-  vty_out (vty, "%s+-%s [%d]%s", prefix, v->name, v->cost, VNL);
+  vty_out (vty, "%s+-%s [%d]%s", prefix, ospf6_vertex_name (v), v->cost,
+           VNL);
 
   len = strlen (prefix) + 4;
   next_prefix = (char *) malloc (len);
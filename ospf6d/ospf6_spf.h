@@ -22,6 +22,8 @@
 #ifndef OSPF6_SPF_H
 #define OSPF6_SPF_H
 
+struct hash;
+
 /* Debug option */
 extern unsigned char conf_debug_ospf6_spf;
 #define OSPF6_DEBUG_SPF_PROCESS   0x01
@@ -59,7 +61,7 @@ struct ospf6_vertex
   u_char hops;
 
   /* nexthops to this node */
-  struct ospf6_nexthop nexthop[OSPF6_MULTI_PATH_LIMIT];
+  struct ospf6_nexthop_set *nh;
 
   /* capability bits */
   u_char capability;
@@ -82,6 +84,10 @@ extern void ospf6_spf_calculation (u_int32_t router_id,
                                    struct ospf6_route_table *result_table,
                                    struct ospf6_area *oa);
 extern void ospf6_spf_schedule (struct ospf6_area *oa);
+extern struct hash *ospf6_spf_reachable_create (void);
+extern void ospf6_spf_reachable_delete (struct hash *reachable);
+extern int ospf6_spf_router_reachable (struct ospf6_area *oa,
+                                       u_int32_t router_id);
 
 extern void ospf6_spf_display_subtree (struct vty *vty, const char *prefix,
                                        int rest, struct ospf6_vertex *v);
@@ -39,6 +39,7 @@
 
 #include "ospf6_top.h"
 #include "ospf6_area.h"
+#include "ospf6_spf.h"
 #include "ospf6_interface.h"
 #include "ospf6_neighbor.h"
 
@@ -46,6 +47,7 @@
 #include "ospf6_asbr.h"
 #include "ospf6_abr.h"
 #include "ospf6_auto.h"
+#include "ospf6_snapshot.h"
 #include "ospf6_intra.h"
 #include "ospf6d.h"
 
@@ -130,6 +132,8 @@ ospf6_create (void)
 
   o->aggregated_prefix_list = list_new ();
 
+  o->max_paths = OSPF6_MULTI_PATH_LIMIT;
+
   o->route_table = OSPF6_ROUTE_TABLE_CREATE (GLOBAL, ROUTES);
   o->route_table->scope = o;
   o->route_table->hook_add = ospf6_top_route_hook_add;
@@ -148,6 +152,8 @@ ospf6_create (void)
   o->ula_generation_thread = NULL;
   o->ula_termination_thread = NULL;
 
+  ospf6_snapshot_load ();
+
   return o;
 }
 
@@ -218,9 +224,13 @@ ospf6_maxage_remover (struct thread *thread)
   struct ospf6_interface *oi;
   struct ospf6_neighbor *on;
   struct listnode *i, *j, *k;
+  unsigned int left = 0;
 
   o->maxage_remover = (struct thread *) NULL;
 
+  /* Not while a database exchange is under way.  Try again later rather
+     than rely on the neighbor's next state change to call us back, as
+     a neighbor that is deleted while loading never makes one. */
   for (ALL_LIST_ELEMENTS_RO (o->area_list, i, oa))
     {
       for (ALL_LIST_ELEMENTS_RO (oa->if_list, j, oi))
@@ -231,6 +241,9 @@ ospf6_maxage_remover (struct thread *thread)
                   on->state != OSPF6_NEIGHBOR_LOADING)
                 continue;
 
+              o->maxage_remover =
+                thread_add_timer (master, ospf6_maxage_remover, o,
+                                  OSPF6_MAXAGE_REMOVE_RETRY);
               return 0;
             }
         }
@@ -239,11 +252,17 @@ ospf6_maxage_remover (struct thread *thread)
   for (ALL_LIST_ELEMENTS_RO (o->area_list, i, oa))
     {
       for (ALL_LIST_ELEMENTS_RO (oa->if_list, j, oi))
-        OSPF6_LSDB_MAXAGE_REMOVER (oi->lsdb);
+        left += ospf6_lsdb_maxage_remover (oi->lsdb);
       
-      OSPF6_LSDB_MAXAGE_REMOVER (oa->lsdb);
+      left += ospf6_lsdb_maxage_remover (oa->lsdb);
     }
-  OSPF6_LSDB_MAXAGE_REMOVER (o->lsdb);
+  left += ospf6_lsdb_maxage_remover (o->lsdb);
+
+  /* The ones still on a retransmission list are usually let go by the
+     acknowledgement, but not when the neighbor holding them goes away. */
+  if (left)
+    o->maxage_remover = thread_add_timer (master, ospf6_maxage_remover, o,
+                                          OSPF6_MAXAGE_REMOVE_RETRY);
 
   return 0;
 }
@@ -320,6 +339,54 @@ DEFUN (ospf6_router_id,
   return CMD_SUCCESS;
 }
 
+DEFUN (ospf6_maximum_paths,
+       ospf6_maximum_paths_cmd,
+       "maximum-paths <1-64>",
+       "Forward packets over multiple paths\n"
+       "Number of paths\n")
+{
+  struct ospf6 *o;
+  struct ospf6_area *oa;
+  struct listnode *node;
+  unsigned int max_paths;
+
+  o = (struct ospf6 *) vty->index;
+
+  VTY_GET_INTEGER_RANGE ("maximum-paths", max_paths, argv[0],
+                         1, OSPF6_MULTI_PATH_MAX);
+
+  if (o->max_paths == max_paths)
+    return CMD_SUCCESS;
+
+  o->max_paths = max_paths;
+  for (ALL_LIST_ELEMENTS_RO (o->area_list, node, oa))
+    ospf6_spf_schedule (oa);
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_ospf6_maximum_paths,
+       no_ospf6_maximum_paths_cmd,
+       "no maximum-paths",
+       NO_STR
+       "Forward packets over multiple paths\n")
+{
+  struct ospf6 *o;
+  struct ospf6_area *oa;
+  struct listnode *node;
+
+  o = (struct ospf6 *) vty->index;
+
+  if (o->max_paths == OSPF6_MULTI_PATH_LIMIT)
+    return CMD_SUCCESS;
+
+  o->max_paths = OSPF6_MULTI_PATH_LIMIT;
+  for (ALL_LIST_ELEMENTS_RO (o->area_list, node, oa))
+    ospf6_spf_schedule (oa);
+
+  return CMD_SUCCESS;
+}
+
 DEFUN (ospf6_interface_area,
        ospf6_interface_area_cmd,
        "interface IFNAME area A.B.C.D",
@@ -468,6 +535,9 @@ ospf6_show (struct vty *vty, struct ospf6 *o)
   /* Redistribute configuration */
   /* XXX */
 
+  vty_out (vty, " Maximum number of equal-cost paths is %u%s",
+           o->max_paths, VNL);
+
   /* LSAs */
   vty_out (vty, " Number of AS scoped LSAs is %u%s",
            o->lsdb->count, VNL);
@@ -655,6 +725,8 @@ config_write_ospf6 (struct vty *vty)
   vty_out (vty, "router ospf6%s", VNL);
   if (ospf6->router_id_static != 0)
     vty_out (vty, " router-id %s%s", router_id, VNL);
+  if (ospf6->max_paths != OSPF6_MULTI_PATH_LIMIT)
+    vty_out (vty, " maximum-paths %u%s", ospf6->max_paths, VNL);
 
   ospf6_redistribute_config_write (vty);
   ospf6_area_config_write (vty);
@@ -708,6 +780,8 @@ ospf6_top_init (void)
 
   install_default (OSPF6_NODE);
   install_element (OSPF6_NODE, &ospf6_router_id_cmd);
+  install_element (OSPF6_NODE, &ospf6_maximum_paths_cmd);
+  install_element (OSPF6_NODE, &no_ospf6_maximum_paths_cmd);
   install_element (OSPF6_NODE, &ospf6_interface_area_cmd);
   install_element (OSPF6_NODE, &no_ospf6_interface_area_cmd);
 }
@@ -66,6 +66,9 @@ struct ospf6
 
   u_char flag;
 
+  /* maximum number of equal-cost paths per route */
+  unsigned int max_paths;
+
   struct thread *maxage_remover;
   struct thread *assign_prefix_thread;
  
@@ -75,6 +78,9 @@ struct ospf6
 
 #define OSPF6_DISABLED    0x01
 
+/* seconds before MaxAge LSAs that could not be removed are tried again */
+#define OSPF6_MAXAGE_REMOVE_RETRY 1
+
 /* global pointer for OSPF top data structure */
 extern struct ospf6 *ospf6;
 
@@ -389,6 +389,7 @@ ospf6_zebra_route_update (int type, struct ospf6_route *request)
   struct in6_addr **nexthops;
   unsigned int *ifindexes;
   int i, ret = 0;
+  struct ospf6_nexthop *nh;
   struct prefix_ipv6 *dest;
 
   if (IS_OSPF6_DEBUG_ZEBRA (SEND))
@@ -434,10 +435,7 @@ ospf6_zebra_route_update (int type, struct ospf6_route *request)
       return;
     }
 
-  nhcount = 0;
-  for (i = 0; i < OSPF6_MULTI_PATH_LIMIT; i++)
-    if (ospf6_nexthop_is_set (&request->nexthop[i]))
-      nhcount++;
+  nhcount = ospf6_route_nexthop_count (request);
 
   if (nhcount == 0)
     {
@@ -467,18 +465,18 @@ ospf6_zebra_route_update (int type, struct ospf6_route *request)
 
   for (i = 0; i < nhcount; i++)
     {
+      nh = ospf6_route_nexthop (request, i);
       if (IS_OSPF6_DEBUG_ZEBRA (SEND))
 	{
 	  char ifname[IFNAMSIZ];
-	  inet_ntop (AF_INET6, &request->nexthop[i].address,
-		     buf, sizeof (buf));
-	  if (!if_indextoname(request->nexthop[i].ifindex, ifname))
+	  inet_ntop (AF_INET6, &nh->address, buf, sizeof (buf));
+	  if (!if_indextoname(nh->ifindex, ifname))
 	    strlcpy(ifname, "unknown", sizeof(ifname));
 	  zlog_debug ("  nexthop: %s%%%.*s(%d)", buf, IFNAMSIZ, ifname,
-		      request->nexthop[i].ifindex);
+		      nh->ifindex);
 	}
-      nexthops[i] = &request->nexthop[i].address;
-      ifindexes[i] = request->nexthop[i].ifindex;
+      nexthops[i] = &nh->address;
+      ifindexes[i] = nh->ifindex;
     }
 
   api.type = ZEBRA_ROUTE_OSPF6;
@@ -115,6 +115,7 @@ config_write_ospf6_debug (struct vty *vty)
   config_write_ospf6_debug_asbr (vty);
   config_write_ospf6_debug_abr (vty);
   config_write_ospf6_debug_flood (vty);
+  config_write_ospf6_debug_auto (vty);
   vty_out (vty, "!%s", VNL);
   return 0;
 }
@@ -1815,6 +1816,7 @@ ospf6_init (void)
   install_element_ospf6_debug_asbr ();
   install_element_ospf6_debug_abr ();
   install_element_ospf6_debug_flood ();
+  install_element_ospf6_debug_auto ();
 
   install_element (VIEW_NODE, &show_version_ospf6_cmd);
   install_element (ENABLE_NODE, &show_version_ospf6_cmd);
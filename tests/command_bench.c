@@ -0,0 +1,271 @@
+/*
+ * Command line parser benchmark.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Checks how a few lines are matched, completed and described, then
+ * loads configurations of growing size made of prefix-list and
+ * access-list lines through config_from_file (), as a daemon does at
+ * startup, and prints the time taken.  The lists are kept short so that
+ * the time is spent parsing rather than adding entries.  Add hooks
+ * must run once for each list while a file is read, and once for each
+ * line otherwise.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "memory.h"
+#include "vty.h"
+#include "prefix.h"
+#include "filter.h"
+#include "plist.h"
+#include "routemap.h"
+
+#define BENCH_LIST_SIZE 50
+
+struct thread_master *master = NULL;
+
+static struct vty *vty;
+static unsigned long prefix_hooks, access_hooks, rmap_hooks, rmap_events;
+
+static const int bench_sizes[] = { 1000, 10000, 100000 };
+
+static void
+bench_expect (int (*func) (vector, struct vty *, struct cmd_element **),
+	      const char *line, int expect)
+{
+  vector vline;
+  int ret;
+
+  vline = cmd_make_strvec (line);
+  ret = func (vline, vty, NULL);
+  cmd_free_strvec (vline);
+  if (ret != expect)
+    {
+      fprintf (stderr, "%s: returned %d, expected %d\n", line, ret, expect);
+      exit (1);
+    }
+}
+
+static int
+bench_execute (vector vline, struct vty *vty, struct cmd_element **cmd)
+{
+  return cmd_execute_command (vline, vty, cmd, 0);
+}
+
+static void
+bench_prefix_hook (struct prefix_list *plist)
+{
+  prefix_hooks++;
+}
+
+static void
+bench_access_hook (struct access_list *access)
+{
+  access_hooks++;
+}
+
+static void
+bench_rmap_hook (const char *name)
+{
+  rmap_hooks++;
+}
+
+static void
+bench_rmap_event (route_map_event_t event, const char *name)
+{
+  rmap_events++;
+}
+
+static int
+bench_file (const char *text)
+{
+  FILE *fp;
+  int ret;
+
+  fp = tmpfile ();
+  assert (fp);
+  fputs (text, fp);
+  rewind (fp);
+  ret = config_from_file (vty, fp);
+  fclose (fp);
+  vty->node = CONFIG_NODE;
+  return ret;
+}
+
+/* Words are matched as the parser always did. */
+static void
+bench_check (void)
+{
+  vector vline, descs;
+  struct desc *desc;
+  char **match;
+  int status;
+
+  bench_expect (cmd_execute_command_strict, "ip prefix-list",
+		CMD_ERR_INCOMPLETE);
+  bench_expect (cmd_execute_command_strict,
+		"ip prefix-list check seq 5 permit 10.0.0.0/8", CMD_SUCCESS);
+  bench_expect (cmd_execute_command_strict,
+		"ip prefix-list check seq 6 perm 11.0.0.0/8", CMD_ERR_NO_MATCH);
+  bench_expect (bench_execute,
+		"ip prefix-list check seq 6 perm 11.0.0.0/8", CMD_SUCCESS);
+  bench_expect (bench_execute,
+		"ip prefix-list check seq 7 permit 10.0.0", CMD_ERR_NO_MATCH);
+  bench_expect (bench_execute,
+		"i prefix-list check seq 8 deny 1.0.0.0/8", CMD_ERR_AMBIGUOUS);
+  bench_expect (bench_execute,
+		"ip prefix-list check description one two three", CMD_SUCCESS);
+  bench_expect (bench_execute, "no ip prefix-list check", CMD_SUCCESS);
+  bench_expect (bench_execute,
+		"access-list 1 permit 10.0.0.0 0.255.255.255", CMD_SUCCESS);
+  bench_expect (bench_execute, "no access-list 1", CMD_SUCCESS);
+  assert (prefix_hooks == 2 && access_hooks == 1);
+
+  /* Hooks of a file run at its end. */
+  prefix_hooks = access_hooks = 0;
+  assert (bench_file ("ip prefix-list one seq 5 permit 10.0.0.0/8\n"
+		      "ip prefix-list two seq 5 permit 10.0.0.0/8\n"
+		      "ip prefix-list one seq 6 permit 11.0.0.0/8\n"
+		      "access-list one permit 10.0.0.0/8\n"
+		      "access-list one permit 11.0.0.0/8\n"
+		      "route-map one permit 10\n"
+		      "route-map one permit 20\n"
+		      "route-map two deny 10\n"
+		      "no route-map two\n") == CMD_SUCCESS);
+  assert (prefix_hooks == 2 && access_hooks == 1);
+  assert (rmap_hooks == 1 && rmap_events == 1);
+  bench_expect (bench_execute, "no ip prefix-list one", CMD_SUCCESS);
+  bench_expect (bench_execute, "no ip prefix-list two", CMD_SUCCESS);
+  bench_expect (bench_execute, "no access-list one", CMD_SUCCESS);
+  bench_expect (bench_execute, "no route-map one", CMD_SUCCESS);
+  assert (rmap_hooks == 1 && rmap_events == 1);
+
+  vline = cmd_make_strvec ("ip prefix-l");
+  match = cmd_complete_command (vline, vty, &status);
+  cmd_free_strvec (vline);
+  assert (status == CMD_COMPLETE_FULL_MATCH);
+  assert (strcmp (match[0], "prefix-list") == 0);
+  XFREE (MTYPE_TMP, match[0]);
+  vector_only_index_free (match);
+
+  /* As vty.c does for '?' after a space. */
+  vline = cmd_make_strvec ("ip prefix-list check seq 9");
+  vector_set (vline, NULL);
+  descs = cmd_describe_command (vline, vty, &status);
+  cmd_free_strvec (vline);
+  assert (status == CMD_SUCCESS);
+  assert (vector_active (descs) == 2);
+  desc = vector_slot (descs, 0);
+  assert (strcmp (desc->cmd, "deny") == 0);
+  desc = vector_slot (descs, 1);
+  assert (strcmp (desc->cmd, "permit") == 0);
+  vector_free (descs);
+
+  printf ("match, completion and help ok\n");
+}
+
+static unsigned long
+bench_usec (struct timeval *start)
+{
+  struct timeval end;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1000000UL
+	 + end.tv_usec - start->tv_usec;
+}
+
+static void
+bench_run (int size)
+{
+  struct timeval start;
+  unsigned long usec;
+  FILE *fp;
+  int i, ret;
+
+  fp = tmpfile ();
+  assert (fp);
+  for (i = 0; i < size; i++)
+    if (i % 2)
+      fprintf (fp, "ip prefix-list bench%d seq %d %s 10.%d.%d.0/24 le 32\n",
+	       i / 2 / BENCH_LIST_SIZE, i / 2 % BENCH_LIST_SIZE + 1,
+	       i % 4 == 1 ? "permit" : "deny",
+	       (i / 256) % 256, i % 256);
+    else
+      fprintf (fp, "access-list bench%d %s 10.%d.%d.0/24\n",
+	       i / 2 / BENCH_LIST_SIZE, i % 4 ? "permit" : "deny",
+	       (i / 256) % 256, i % 256);
+  rewind (fp);
+
+  prefix_hooks = access_hooks = 0;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  ret = config_from_file (vty, fp);
+  usec = bench_usec (&start);
+  fclose (fp);
+  if (ret != CMD_SUCCESS)
+    {
+      fprintf (stderr, "%d lines: config_from_file returned %d\n", size, ret);
+      exit (1);
+    }
+
+  assert (prefix_list_lookup (AFI_IP, "bench0") != NULL);
+  assert (access_list_lookup (AFI_IP, "bench0") != NULL);
+  printf ("%6d lines: %lu usec, %.2f usec per line, %lu add hooks\n",
+	  size, usec, (double) usec / size, prefix_hooks + access_hooks);
+  assert (prefix_hooks + access_hooks
+	  == 2 * ((size - 1) / 2 / BENCH_LIST_SIZE + 1));
+
+  for (i = 0; i <= (size - 1) / 2 / BENCH_LIST_SIZE; i++)
+    {
+      char line[64];
+
+      snprintf (line, sizeof (line), "no ip prefix-list bench%d", i);
+      bench_expect (bench_execute, line, CMD_SUCCESS);
+      snprintf (line, sizeof (line), "no access-list bench%d", i);
+      bench_expect (bench_execute, line, CMD_SUCCESS);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  unsigned int i;
+
+  cmd_init (1);
+  access_list_init ();
+  prefix_list_init ();
+  route_map_init ();
+  route_map_init_vty ();
+  sort_node ();
+
+  prefix_list_add_hook (bench_prefix_hook);
+  access_list_add_hook (bench_access_hook);
+  route_map_add_hook (bench_rmap_hook);
+  route_map_event_hook (bench_rmap_event);
+
+  vty = vty_new ();
+  vty->node = CONFIG_NODE;
+
+  bench_check ();
+  for (i = 0; i < array_size (bench_sizes); i++)
+    bench_run (bench_sizes[i]);
+
+  return 0;
+}
@@ -0,0 +1,273 @@
+/*
+ * Access-list benchmark.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Configures a zebra access-list and a standard Cisco access-list of
+ * growing size through the CLI, some of the Cisco entries with wildcard
+ * masks that are not a prefix, and looks up random prefixes in both with
+ * access_list_apply ().  Every result is checked against a walk over the
+ * same entries in order, which is how access_list_apply () used to do
+ * it, and the time taken by both is printed.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "memory.h"
+#include "vty.h"
+#include "prefix.h"
+#include "filter.h"
+
+#define BENCH_LOOKUPS 100000
+
+struct thread_master *master = NULL;
+
+struct bench_entry
+{
+  int cisco;
+  enum filter_type type;
+  u_int32_t addr;		/* host order */
+  u_int32_t wildcard;		/* Cisco only */
+  int len;			/* zebra only */
+  int exact;
+};
+
+static struct vty *vty;
+static struct bench_entry *entries;
+static int nentries;
+
+static const int bench_sizes[] = { 10, 100, 1000, 10000 };
+
+static u_int32_t
+bench_masklen (int len)
+{
+  return len ? 0xffffffffU << (IPV4_MAX_BITLEN - len) : 0;
+}
+
+/* Addresses are drawn from 10.0.0.0/8 so that entries overlap. */
+static u_int32_t
+bench_addr (void)
+{
+  return (10U << 24) | (random () & 0xffffff);
+}
+
+static void
+bench_command (const char *fmt, ...)
+{
+  char line[128];
+  va_list args;
+  vector vline;
+  int ret;
+
+  va_start (args, fmt);
+  vsnprintf (line, sizeof (line), fmt, args);
+  va_end (args);
+
+  vline = cmd_make_strvec (line);
+  ret = cmd_execute_command (vline, vty, NULL, 0);
+  cmd_free_strvec (vline);
+  if (ret != CMD_SUCCESS)
+    {
+      fprintf (stderr, "%s: failed with %d\n", line, ret);
+      exit (1);
+    }
+}
+
+static const char *
+bench_inet (u_int32_t addr)
+{
+  static char buf[2][INET_ADDRSTRLEN];
+  static int i;
+  struct in_addr in;
+
+  in.s_addr = htonl (addr);
+  i ^= 1;
+  return inet_ntop (AF_INET, &in, buf[i], sizeof (buf[i]));
+}
+
+/* Entries the CLI would refuse as duplicates are left out. */
+static int
+bench_duplicate (struct bench_entry *new)
+{
+  int i;
+
+  for (i = 0; i < nentries; i++)
+    if (entries[i].cisco == new->cisco && entries[i].type == new->type
+	&& entries[i].addr == new->addr
+	&& entries[i].wildcard == new->wildcard
+	&& entries[i].len == new->len && entries[i].exact == new->exact)
+      return 1;
+  return 0;
+}
+
+static void
+bench_config (int size)
+{
+  struct bench_entry *e;
+  int i;
+
+  nentries = 0;
+  for (i = 0; i < size; i++)
+    {
+      e = &entries[nentries];
+      memset (e, 0, sizeof (*e));
+      e->type = random () % 2 ? FILTER_PERMIT : FILTER_DENY;
+      e->cisco = random () % 2;
+      if (e->cisco)
+	{
+	  /* one in ten with wildcard bits in the middle */
+	  if (random () % 10 == 0)
+	    e->wildcard = 0x00ff00ffU;
+	  else
+	    e->wildcard = ~bench_masklen (16 + random () % 17);
+	  e->addr = bench_addr () & ~e->wildcard;
+	}
+      else
+	{
+	  e->len = 16 + random () % 17;
+	  e->addr = bench_addr () & bench_masklen (e->len);
+	  e->exact = random () % 8 == 0;
+	}
+
+      if (bench_duplicate (e))
+	continue;
+      nentries++;
+
+      if (e->cisco)
+	bench_command ("access-list 1 %s %s %s",
+		       e->type == FILTER_PERMIT ? "permit" : "deny",
+		       bench_inet (e->addr), bench_inet (e->wildcard));
+      else
+	bench_command ("access-list bench %s %s/%d%s",
+		       e->type == FILTER_PERMIT ? "permit" : "deny",
+		       bench_inet (e->addr), e->len,
+		       e->exact ? " exact-match" : "");
+    }
+}
+
+static enum filter_type
+bench_linear (int cisco, struct prefix *p)
+{
+  u_int32_t addr = ntohl (p->u.prefix4.s_addr);
+  struct bench_entry *e;
+  int i;
+
+  for (i = 0; i < nentries; i++)
+    {
+      e = &entries[i];
+      if (e->cisco != cisco)
+	continue;
+      if (e->cisco)
+	{
+	  if ((addr & ~e->wildcard) == e->addr)
+	    return e->type;
+	}
+      else if (p->prefixlen >= e->len
+	       && (addr & bench_masklen (e->len)) == e->addr
+	       && (! e->exact || p->prefixlen == e->len))
+	return e->type;
+    }
+  return FILTER_DENY;
+}
+
+static unsigned long
+bench_usec (struct timeval *start)
+{
+  struct timeval end;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1000000UL
+	 + end.tv_usec - start->tv_usec;
+}
+
+static void
+bench_run (int size)
+{
+  struct access_list *access[2];
+  struct prefix *p;
+  struct timeval start;
+  unsigned long compiled, linear;
+  int i, cisco, permit = 0;
+
+  p = XCALLOC (MTYPE_TMP, BENCH_LOOKUPS * sizeof (struct prefix));
+  for (i = 0; i < BENCH_LOOKUPS; i++)
+    {
+      p[i].family = AF_INET;
+      p[i].prefixlen = 24 + random () % 9;
+      p[i].u.prefix4.s_addr = htonl (bench_addr ()
+				     & bench_masklen (p[i].prefixlen));
+    }
+
+  bench_config (size);
+  access[0] = access_list_lookup (AFI_IP, "bench");
+  access[1] = access_list_lookup (AFI_IP, "1");
+
+  for (cisco = 0; cisco < 2; cisco++)
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+      if (access_list_apply (access[cisco], &p[i])
+	  != bench_linear (cisco, &p[i]))
+	{
+	  fprintf (stderr, "%d entries: %s/%d differs in %s list\n", size,
+		   bench_inet (ntohl (p[i].u.prefix4.s_addr)),
+		   p[i].prefixlen, cisco ? "Cisco" : "zebra");
+	  exit (1);
+	}
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (cisco = 0; cisco < 2; cisco++)
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+      permit += access_list_apply (access[cisco], &p[i]) == FILTER_PERMIT;
+  compiled = bench_usec (&start);
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (cisco = 0; cisco < 2; cisco++)
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+      permit -= bench_linear (cisco, &p[i]) == FILTER_PERMIT;
+  linear = bench_usec (&start);
+  assert (permit == 0);
+
+  printf ("%5d entries, %d lookups: compiled %lu usec, linear %lu usec\n",
+	  nentries, 2 * BENCH_LOOKUPS, compiled, linear);
+
+  bench_command ("no access-list bench");
+  bench_command ("no access-list 1");
+  XFREE (MTYPE_TMP, p);
+}
+
+int
+main (int argc, char **argv)
+{
+  unsigned int i;
+
+  srandom (1);
+  cmd_init (1);
+  access_list_init ();
+
+  vty = vty_new ();
+  vty->node = CONFIG_NODE;
+
+  entries = XCALLOC (MTYPE_TMP, bench_sizes[array_size (bench_sizes) - 1]
+				* sizeof (struct bench_entry));
+  for (i = 0; i < array_size (bench_sizes); i++)
+    bench_run (bench_sizes[i]);
+
+  XFREE (MTYPE_TMP, entries);
+  return 0;
+}
@@ -555,8 +555,8 @@ create_ac_lsa (struct ospf6_area *oa,
 
       ass_p->interface = oi;
 
-      ass_p->pending_thread = NULL;
-      ass_p->deprecation_thread = NULL;
+      ass_p->pending_due = 0;
+      ass_p->deprecation_due = 0;
 
       if (!oi->assigned_prefix_list)
       {
@@ -617,7 +617,7 @@ setup (void)
 {
   struct ospf6_area *backbone_area;
 
-  master = malloc ( sizeof (struct thread));
+  master = thread_master_create ();
 
   ospf6 = ospf6_create ();
   backbone_area = ospf6_area_create (0, ospf6);
@@ -816,7 +816,7 @@ check_test_case (struct test_case *test_case)
 	  {
 	    if (prefix_contains (&prefix, &asp->prefix))
 	    {
-	      if (asp->pending_thread)
+	      if (asp->pending_due)
 	      {
 		found = 1;
 	      }
@@ -847,7 +847,7 @@ check_test_case (struct test_case *test_case)
 	  {
 	    if (prefix_same (&asp->prefix, &prefix))
 	    {
-	      if (asp->deprecation_thread)
+	      if (asp->deprecation_due)
 	      {
 		found = 1;
 	      }
@@ -901,9 +901,9 @@ print_details (void)
 	char buf[64];
 	prefix2str (&ap->prefix, buf, 64);
 	printf ("  Assigned Prefix: %s\n", buf);
-	if (ap->pending_thread) printf ("   Pending Thread\n");
+	if (ap->pending_due) printf ("   Pending Thread\n");
 	if (!ap->is_valid) printf ("   Not Valid\n");
-	if (ap->deprecation_thread) printf ("   Deprecation Thread\n");
+	if (ap->deprecation_due) printf ("   Deprecation Thread\n");
       }
       
       assigned_prefix_count += oi->assigned_prefix_list->count;
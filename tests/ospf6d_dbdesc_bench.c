@@ -0,0 +1,358 @@
+/*
+ * Database Description benchmark for ospf6d.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Sets up ospf6d as the DR of a broadcast link with a number of
+ * neighbors, all in Init state, and an area LSDB of Router-LSAs.  It
+ * brings up the adjacencies at once, as master: 2-WayReceived starts
+ * each one, and every DbDesc ospf6d sends is answered by its slave with
+ * an empty DbDesc, through ospf6_receive ().  This runs NegotiationDone
+ * and the DbDesc exchange of ospf6_message.c until every neighbor is
+ * Full.  Once the first DbDescs are out, part of the LSDB is replaced
+ * and removed underneath the exchange, and every LSA header sent is
+ * checked to describe the instance in the database at the time.  It
+ * prints the time taken and the peak number of LSA and route_node
+ * allocations beyond those of the LSDB.
+ */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "memory.h"
+#include "log.h"
+#include "vty.h"
+#include "privs.h"
+#include "if.h"
+#include "linklist.h"
+
+#include "ospf6d/ospf6_proto.h"
+#include "ospf6d/ospf6_lsa.h"
+#include "ospf6d/ospf6_lsdb.h"
+#include "ospf6d/ospf6_message.h"
+#include "ospf6d/ospf6_network.h"
+#include "ospf6d/ospf6_top.h"
+#include "ospf6d/ospf6_area.h"
+#include "ospf6d/ospf6_interface.h"
+#include "ospf6d/ospf6_neighbor.h"
+#include "ospf6d/ospf6_intra.h"
+#include "ospf6d/ospf6d.h"
+
+#define BENCH_LSAS        10000
+#define BENCH_NEIGHBORS   20
+#define BENCH_MTU         1500
+#define BENCH_ROUTER_ID   0x0a0000ff  /* above the neighbors': master */
+#define BENCH_LSA_SIZE    (sizeof (struct ospf6_lsa_header) + 4)
+
+struct thread_master *master = NULL;
+
+int auto_conf = 0;
+
+struct zebra_privs_t ospf6d_privs;
+
+static struct ospf6_interface *oi;
+static struct ospf6_neighbor *neighbors[BENCH_NEIGHBORS];
+static struct in6_addr linklocal[BENCH_NEIGHBORS + 1];
+
+/* the last DbDesc sent to each neighbor, waiting for its answer */
+static int pending[BENCH_NEIGHBORS];
+static u_int32_t pending_seqnum[BENCH_NEIGHBORS];
+
+static u_char packet[BENCH_MTU];
+static unsigned int packet_len;
+static struct ospf6_neighbor *packet_from;
+
+static unsigned long dbdescs, headers;
+static unsigned long base_lsa, base_node, peak_lsa, peak_node;
+
+/* Stand-ins for ospf6_network.c */
+int ospf6_sock = -1;
+struct in6_addr allspfrouters6;
+struct in6_addr alldrouters6;
+
+void ospf6_set_reuseaddr (void) { }
+void ospf6_reset_mcastloop (void) { }
+void ospf6_set_pktinfo (void) { }
+void ospf6_set_checksum (void) { }
+void ospf6_sso (u_int ifindex, struct in6_addr *group, int option) { }
+
+int
+ospf6_serv_sock (void)
+{
+  int fd[2];
+
+  /* never written: ospf6_receive () is only ever run by the benchmark */
+  if (ospf6_sock < 0 && pipe (fd) == 0)
+    ospf6_sock = fd[0];
+  return 0;
+}
+
+static void
+bench_peak (void)
+{
+  if (mtype_stats_alloc (MTYPE_OSPF6_LSA) > peak_lsa)
+    peak_lsa = mtype_stats_alloc (MTYPE_OSPF6_LSA);
+  if (mtype_stats_alloc (MTYPE_ROUTE_NODE) > peak_node)
+    peak_node = mtype_stats_alloc (MTYPE_ROUTE_NODE);
+}
+
+/* Checks the DbDescs sent and queues the slave's answer to each */
+int
+ospf6_sendmsg (struct in6_addr *src, struct in6_addr *dst,
+               unsigned int *ifindex, struct iovec *message)
+{
+  struct ospf6_header *oh;
+  struct ospf6_dbdesc *dbdesc;
+  struct ospf6_lsa_header *header;
+  struct ospf6_lsa *lsa;
+  unsigned int len, i;
+  int n;
+
+  for (len = 0, i = 0; message[i].iov_base; i++)
+    len += message[i].iov_len;
+
+  oh = (struct ospf6_header *) message[0].iov_base;
+  if (oh->type != OSPF6_MESSAGE_TYPE_DBDESC)
+    return len;
+
+  for (n = 0; n < BENCH_NEIGHBORS; n++)
+    if (IN6_ARE_ADDR_EQUAL (dst, &linklocal[n + 1]))
+      break;
+  assert (n < BENCH_NEIGHBORS);
+
+  dbdesc = (struct ospf6_dbdesc *) (oh + 1);
+  for (header = (struct ospf6_lsa_header *) (dbdesc + 1);
+       (caddr_t) (header + 1) <= OSPF6_MESSAGE_END (oh); header++)
+    {
+      lsa = ospf6_lsdb_lookup (header->type, header->id, header->adv_router,
+                               oi->area->lsdb);
+      assert (lsa && lsa->header->seqnum == header->seqnum);
+      headers++;
+    }
+
+  dbdescs++;
+  pending[n] = 1;
+  pending_seqnum[n] = ntohl (dbdesc->seqnum);
+  bench_peak ();
+  return len;
+}
+
+int
+ospf6_recvmsg (struct in6_addr *src, struct in6_addr *dst,
+               unsigned int *ifindex, struct iovec *message)
+{
+  assert (packet_from);
+  assert (packet_len <= message[0].iov_len);
+
+  memcpy (message[0].iov_base, packet, packet_len);
+  *src = packet_from->linklocal_addr;
+  *dst = *oi->linklocal_addr;
+  *ifindex = oi->interface->ifindex;
+  return packet_len;
+}
+
+/* Runs the events and whatever else is ready, as the thread loop would
+ * right after a packet is read */
+static void
+bench_events (void)
+{
+  struct thread thread;
+
+  while (master->event.count || master->ready.count)
+    if (thread_fetch (master, &thread))
+      thread_call (&thread);
+}
+
+/* The slave's answer: an empty DbDesc with the master's sequence number */
+static void
+bench_answer (int n)
+{
+  struct ospf6_header *oh = (struct ospf6_header *) packet;
+  struct ospf6_dbdesc *dbdesc = (struct ospf6_dbdesc *) (oh + 1);
+  struct thread *t, *next;
+
+  memset (packet, 0, sizeof (packet));
+  oh->version = OSPFV3_VERSION;
+  oh->type = OSPF6_MESSAGE_TYPE_DBDESC;
+  oh->length = htons (sizeof (*oh) + sizeof (*dbdesc));
+  oh->router_id = neighbors[n]->router_id;
+  oh->area_id = oi->area->area_id;
+  oh->instance_id = oi->instance_id;
+  memcpy (dbdesc->options, oi->area->options, sizeof (dbdesc->options));
+  dbdesc->ifmtu = htons (oi->ifmtu);
+  dbdesc->seqnum = htonl (pending_seqnum[n]);
+  packet_len = ntohs (oh->length);
+  pending[n] = 0;
+
+  packet_from = neighbors[n];
+  thread_execute (master, ospf6_receive, NULL, ospf6_sock);
+  packet_from = NULL;
+
+  /* ospf6_receive () has rearmed itself for the next packet */
+  for (t = master->read.head; t; t = next)
+    {
+      next = t->next;
+      if (t->u.fd == ospf6_sock)
+        thread_cancel (t);
+    }
+  bench_events ();
+}
+
+static struct ospf6_lsa *
+bench_lsa (u_int32_t adv_router, u_int32_t seqnum)
+{
+  char buf[BENCH_LSA_SIZE];
+  struct ospf6_lsa_header *header = (struct ospf6_lsa_header *) buf;
+  struct ospf6_lsa *lsa;
+
+  memset (buf, 0, sizeof (buf));
+  header->type = htons (OSPF6_LSTYPE_ROUTER);
+  header->length = htons (sizeof (buf));
+  header->adv_router = htonl (adv_router);
+  header->seqnum = htonl (seqnum);
+  ospf6_lsa_checksum (header);
+  lsa = ospf6_lsa_create (header);
+  lsa->lsdb = oi->area->lsdb;
+  return lsa;
+}
+
+static void
+bench_setup (void)
+{
+  struct ospf6_area *oa;
+  struct interface *ifp;
+  struct zlog *zl;
+  int i;
+
+  zl = zlog_default = openzlog ("benchospf6dbdesc", ZLOG_OSPF6, 0,
+                                LOG_DAEMON);
+  zlog_set_level (zl, ZLOG_DEST_SYSLOG, ZLOG_DISABLED);
+  zlog_set_level (zl, ZLOG_DEST_MONITOR, ZLOG_DISABLED);
+  zlog_set_level (zl, ZLOG_DEST_STDOUT, LOG_ERR);
+
+  master = thread_master_create ();
+  if_init ();
+  ospf6_lsa_init ();
+  ospf6_intra_init ();
+  ospf6_serv_sock ();
+  inet_pton (AF_INET6, ALLSPFROUTERS6, &allspfrouters6);
+  inet_pton (AF_INET6, ALLDROUTERS6, &alldrouters6);
+
+  ospf6 = ospf6_create ();
+  ospf6->router_id = htonl (BENCH_ROUTER_ID);
+  oa = ospf6_area_create (0, ospf6);
+
+  for (i = 0; i <= BENCH_NEIGHBORS; i++)
+    {
+      linklocal[i].s6_addr[0] = 0xfe;
+      linklocal[i].s6_addr[1] = 0x80;
+      linklocal[i].s6_addr[15] = i + 1;
+    }
+
+  ifp = if_create ("eth0", strlen ("eth0"));
+  ifp->ifindex = 1;
+  ifp->flags = IFF_UP | IFF_RUNNING | IFF_BROADCAST | IFF_MULTICAST;
+  ifp->mtu = ifp->mtu6 = BENCH_MTU;
+  oi = ospf6_interface_create (ifp);
+  oi->area = oa;
+  oi->linklocal_addr = &linklocal[0];
+  oi->state = OSPF6_INTERFACE_DR;
+  oi->drouter = ospf6->router_id;
+  listnode_add (oa->if_list, oi);
+
+  for (i = 0; i < BENCH_NEIGHBORS; i++)
+    {
+      neighbors[i] = ospf6_neighbor_create (htonl (BENCH_ROUTER_ID
+                                                   - BENCH_NEIGHBORS + i),
+                                            oi);
+      neighbors[i]->linklocal_addr = linklocal[i + 1];
+      neighbors[i]->state = OSPF6_NEIGHBOR_INIT;
+    }
+
+  for (i = 0; i < BENCH_LSAS; i++)
+    ospf6_lsdb_add (bench_lsa (0x0b000000 + i, INITIAL_SEQUENCE_NUMBER),
+                    oa->lsdb);
+  bench_events ();
+}
+
+/* Replaces one LSA in ten and removes one in a hundred */
+static void
+bench_churn (void)
+{
+  struct ospf6_lsa *lsa;
+  int i;
+
+  for (i = 0; i < BENCH_LSAS; i += 10)
+    {
+      if (i % 100 == 0)
+        {
+          lsa = ospf6_lsdb_lookup (htons (OSPF6_LSTYPE_ROUTER), 0,
+                                   htonl (0x0b000000 + i), oi->area->lsdb);
+          ospf6_lsdb_remove (lsa, oi->area->lsdb);
+        }
+      else
+        ospf6_lsdb_add (bench_lsa (0x0b000000 + i,
+                                   INITIAL_SEQUENCE_NUMBER + 1),
+                        oi->area->lsdb);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  struct timeval start, end;
+  unsigned long usec;
+  int n, open, round = 0;
+
+  bench_setup ();
+  base_lsa = peak_lsa = mtype_stats_alloc (MTYPE_OSPF6_LSA);
+  base_node = peak_node = mtype_stats_alloc (MTYPE_ROUTE_NODE);
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+
+  for (n = 0; n < BENCH_NEIGHBORS; n++)
+    thread_execute (master, twoway_received, neighbors[n], 0);
+  bench_events ();
+
+  /* answer each neighbor's DbDesc in turn, until none is left */
+  do
+    {
+      for (open = 0, n = 0; n < BENCH_NEIGHBORS; n++)
+        if (pending[n])
+          {
+            bench_answer (n);
+            open++;
+          }
+      if (++round == 3)
+        bench_churn ();
+    }
+  while (open);
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  usec = (end.tv_sec - start.tv_sec) * 1000000UL
+         + end.tv_usec - start.tv_usec;
+
+  for (n = 0; n < BENCH_NEIGHBORS; n++)
+    assert (neighbors[n]->state == OSPF6_NEIGHBOR_FULL);
+
+  printf ("%d neighbors Full over a %d LSA LSDB: %lu DbDescs, %lu headers, "
+          "%lu usec, peak %lu LSAs %lu route nodes beyond the LSDB\n",
+          BENCH_NEIGHBORS, BENCH_LSAS, dbdescs, headers, usec,
+          peak_lsa - base_lsa, peak_node - base_node);
+  return 0;
+}
@@ -0,0 +1,1098 @@
+/*
+ * Multi-router convergence simulator for zOSPF autoconfiguration.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Runs a number of autoconfiguring ospf6d instances in one process,
+ * connected by simulated links, as a deterministic discrete-event
+ * simulation over a virtual clock.  Every instance runs the real
+ * ospf6d code, from the thread loop down to flooding, SPF and prefix
+ * assignment; only ospf6_network.c is replaced, by links that deliver
+ * packets after a fixed delay.  Each instance has its own thread_master,
+ * interface list and struct ospf6, which are swapped into the globals of
+ * the same names whenever it runs.
+ *
+ * After the routers have booted, and after every link failure and
+ * repair of the churn script, it prints the time taken to converge, the
+ * packets sent, the CPU time spent per router and how stable the
+ * prefix assignments were.  Then routers picked at random are restarted,
+ * once from scratch and once with an LSDB snapshot, to compare the time
+ * they take to get full adjacencies and a prefix again.  A run that
+ * keeps executing threads at one instant of virtual time is stopped and
+ * reported as livelocked.  The program exits with status 1, saying why,
+ * if it livelocked or if at the end adjacencies are not full, LSDBs or
+ * prefixes disagree, or the network has not settled.
+ *
+ *   simospf6d [-t line|grid|random] [-n routers] [-d seconds]
+ *             [-c churn events] [-r restarts] [-s seed] [-v]
+ */
+
+#include <zebra.h>
+#include <math.h>
+#include <sys/syscall.h>
+
+#include "thread.h"
+#include "memory.h"
+#include "log.h"
+#include "privs.h"
+#include "if.h"
+#include "prefix.h"
+#include "linklist.h"
+#include "command.h"
+#include "jhash.h"
+#include "zclient.h"
+
+#include "ospf6d/ospf6_proto.h"
+#include "ospf6d/ospf6_lsa.h"
+#include "ospf6d/ospf6_lsdb.h"
+#include "ospf6d/ospf6_message.h"
+#include "ospf6d/ospf6_network.h"
+#include "ospf6d/ospf6_top.h"
+#include "ospf6d/ospf6_area.h"
+#include "ospf6d/ospf6_interface.h"
+#include "ospf6d/ospf6_neighbor.h"
+#include "ospf6d/ospf6_auto.h"
+#include "ospf6d/ospf6_snapshot.h"
+#include "ospf6d/ospf6d.h"
+
+/* The hardware fingerprint holds the MACs of at most eight interfaces */
+#define SIM_MAX_DEGREE    (R_HW_FP_BYTELEN / 8)
+#define SIM_LINK_DELAY    1000           /* usec */
+#define SIM_BOOT_STAGGER  1000           /* usec between router boots */
+#define SIM_SETTLE        (300 * 1000000ULL) /* quiet time ending a phase,
+                                                 above any protocol timer */
+#define SIM_LIVELOCK      100000         /* threads run at one instant */
+#define SIM_EPOCH         1300000000ULL  /* wall clock at virtual time 0 */
+#define SIM_START         1000000000ULL  /* monotonic clock at time 0 */
+
+struct thread_master *master = NULL;
+
+int auto_conf = 1;
+
+struct zebra_privs_t ospf6d_privs;
+
+struct sim_router;
+struct sim_link;
+
+struct sim_port
+{
+  struct sim_router *router;
+  struct sim_link *link;
+  struct interface *ifp;
+  struct in6_addr linklocal;
+  int allspfrouters, alldrouters;
+
+  /* XOR of the hashes of the valid prefixes assigned on this port */
+  u_int32_t prefix_sig;
+};
+
+struct sim_link
+{
+  int up;
+  struct sim_port *port[2];
+
+  u_int32_t prefix_sig;  /* as agreed at the end of the last phase */
+};
+
+struct sim_router
+{
+  int index;
+  double x, y;
+
+  struct thread_master *master;
+  struct list *iflist;
+  struct ospf6 *ospf6;
+
+  int nports;
+  struct sim_port port[SIM_MAX_DEGREE];
+
+  u_int64_t wake;        /* time of the pending wake event, or ~0 */
+  u_int32_t prefix_sig;
+  unsigned long prefix_changes;
+  unsigned long cpu;     /* usec */
+  unsigned long cpu_phase;
+  unsigned long threads;
+  int component;
+
+  /* restart measurements */
+  char snapshot[64];     /* LSDB snapshot file for warm restarts */
+  int restarting;
+  u_int64_t full_at, prefix_at;
+};
+
+struct sim_packet
+{
+  struct sim_port *to;
+  struct in6_addr src, dst;
+  unsigned int len;
+  u_char data[];
+};
+
+struct sim_event
+{
+  u_int64_t time;
+  u_int64_t seq;
+  struct sim_router *router;  /* wake a router ... */
+  struct sim_packet *packet;  /* ... or deliver a packet */
+};
+
+static const char *sim_message_name[] =
+  { "unknown", "hello", "dbdesc", "lsreq", "lsupdate", "lsack" };
+
+static struct sim_router *routers;
+static int nrouters;
+static struct sim_link *links;
+static int nlinks;
+
+static struct sim_event *heap;
+static unsigned int heap_count, heap_size;
+static u_int64_t heap_seq;
+
+static u_int64_t sim_now;
+static u_int64_t last_change;  /* of any LSDB or prefix assignment */
+static struct sim_router *current;
+static struct sim_packet *receiving;
+static unsigned long rand_state;
+
+static unsigned long sent[6], sent_bytes, dropped;
+static char sim_failure[128];  /* why the last phase failed, if it did */
+static void (*area_hook_add) (struct ospf6_lsa *);
+static void (*area_hook_remove) (struct ospf6_lsa *);
+
+/* The virtual clock: these stand in for the C library's, so that the
+ * thread library's timers, ospf6d's LSA ages and the NTP time seeding
+ * the ULA all run on simulated time.  Other clocks are passed on. */
+int
+clock_gettime (clockid_t clk, struct timespec *ts)
+{
+  u_int64_t usec;
+
+  if (clk != CLOCK_MONOTONIC && clk != CLOCK_REALTIME)
+    return syscall (SYS_clock_gettime, clk, ts);
+
+  usec = sim_now + (clk == CLOCK_MONOTONIC ? SIM_START : SIM_EPOCH) * 1000000;
+  ts->tv_sec = usec / 1000000;
+  ts->tv_nsec = (usec % 1000000) * 1000;
+  return 0;
+}
+
+int
+gettimeofday (struct timeval *tv, void *tz)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_REALTIME, &ts);
+  tv->tv_sec = ts.tv_sec;
+  tv->tv_usec = ts.tv_nsec / 1000;
+  return 0;
+}
+
+/* The routers have no stable storage: nothing is carried over between
+ * runs, and they cannot see each other's files. */
+FILE *
+fopen (const char *path, const char *mode)
+{
+  errno = EROFS;
+  return NULL;
+}
+
+static u_int64_t
+sim_cpu (clockid_t clk)
+{
+  struct timespec ts;
+
+  syscall (SYS_clock_gettime, clk, &ts);
+  return (u_int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static u_int32_t
+sim_rand (void)
+{
+  rand_state = rand_state * 1103515245UL + 12345UL;
+  return (rand_state >> 16) & 0x7fff;
+}
+
+/* event queue, a binary heap ordered by time and then insertion */
+static int
+sim_event_before (struct sim_event *a, struct sim_event *b)
+{
+  if (a->time != b->time)
+    return a->time < b->time;
+  return a->seq < b->seq;
+}
+
+static void
+sim_event_push (u_int64_t time, struct sim_router *router,
+                struct sim_packet *packet)
+{
+  struct sim_event ev;
+  unsigned int i;
+
+  if (heap_count == heap_size)
+    {
+      heap_size = heap_size ? heap_size * 2 : 1024;
+      heap = realloc (heap, heap_size * sizeof (struct sim_event));
+      assert (heap);
+    }
+
+  ev.time = time;
+  ev.seq = heap_seq++;
+  ev.router = router;
+  ev.packet = packet;
+
+  for (i = heap_count++; i > 0; i = (i - 1) / 2)
+    {
+      if (! sim_event_before (&ev, &heap[(i - 1) / 2]))
+        break;
+      heap[i] = heap[(i - 1) / 2];
+    }
+  heap[i] = ev;
+}
+
+static struct sim_event
+sim_event_pop (void)
+{
+  struct sim_event top = heap[0], last = heap[--heap_count];
+  unsigned int i, child;
+
+  for (i = 0; (child = 2 * i + 1) < heap_count; i = child)
+    {
+      if (child + 1 < heap_count &&
+          sim_event_before (&heap[child + 1], &heap[child]))
+        child++;
+      if (! sim_event_before (&heap[child], &last))
+        break;
+      heap[i] = heap[child];
+    }
+  heap[i] = last;
+  return top;
+}
+
+/* Router context */
+static void
+sim_enter (struct sim_router *r)
+{
+  current = r;
+  master = r->master;
+  iflist = r->iflist;
+  ospf6 = r->ospf6;
+  ospf6_snapshot_file = r->snapshot[0] ? r->snapshot : NULL;
+}
+
+static void
+sim_leave (void)
+{
+  /* ospf6_set_router_id () replaces the instance on a restart */
+  current->ospf6 = ospf6;
+  current->iflist = iflist;
+  current = NULL;
+}
+
+static struct sim_port *
+sim_port_lookup (struct sim_router *r, unsigned int ifindex)
+{
+  if (ifindex == 0 || ifindex > (unsigned int) r->nports)
+    return NULL;
+  return &r->port[ifindex - 1];
+}
+
+/* Stand-ins for ospf6_network.c */
+int ospf6_sock = -1;
+struct in6_addr allspfrouters6;
+struct in6_addr alldrouters6;
+
+void ospf6_set_reuseaddr (void) { }
+void ospf6_reset_mcastloop (void) { }
+void ospf6_set_pktinfo (void) { }
+void ospf6_set_checksum (void) { }
+
+int
+ospf6_serv_sock (void)
+{
+  int fd[2];
+
+  /* never written: ospf6_receive () is only ever run by the simulator */
+  if (ospf6_sock < 0 && pipe (fd) == 0)
+    ospf6_sock = fd[0];
+
+  inet_pton (AF_INET6, ALLSPFROUTERS6, &allspfrouters6);
+  inet_pton (AF_INET6, ALLDROUTERS6, &alldrouters6);
+  return 0;
+}
+
+void
+ospf6_sso (u_int ifindex, struct in6_addr *group, int option)
+{
+  struct sim_port *port;
+  int join = (option == IPV6_JOIN_GROUP);
+
+  port = sim_port_lookup (current, ifindex);
+  if (port == NULL)
+    return;
+
+  if (IN6_ARE_ADDR_EQUAL (group, &allspfrouters6))
+    port->allspfrouters = join;
+  else if (IN6_ARE_ADDR_EQUAL (group, &alldrouters6))
+    port->alldrouters = join;
+}
+
+int
+ospf6_sendmsg (struct in6_addr *src, struct in6_addr *dst,
+               unsigned int *ifindex, struct iovec *message)
+{
+  struct sim_port *port, *peer;
+  struct sim_packet *packet;
+  struct ospf6_header *oh;
+  unsigned int len, i;
+
+  port = sim_port_lookup (current, *ifindex);
+  assert (port);
+
+  for (len = 0, i = 0; message[i].iov_base; i++)
+    len += message[i].iov_len;
+
+  oh = (struct ospf6_header *) message[0].iov_base;
+  sent[oh->type < 6 ? oh->type : 0]++;
+  sent_bytes += len;
+
+  peer = port->link->port[port->link->port[0] == port ? 1 : 0];
+  if (! port->link->up ||
+      (IN6_ARE_ADDR_EQUAL (dst, &allspfrouters6) && ! peer->allspfrouters) ||
+      (IN6_ARE_ADDR_EQUAL (dst, &alldrouters6) && ! peer->alldrouters) ||
+      (! IN6_IS_ADDR_MULTICAST (dst) &&
+       ! IN6_ARE_ADDR_EQUAL (dst, &peer->linklocal)))
+    {
+      dropped++;
+      return len;
+    }
+
+  packet = malloc (sizeof (struct sim_packet) + len);
+  assert (packet);
+  packet->to = peer;
+  packet->src = *src;
+  packet->dst = *dst;
+  packet->len = len;
+  for (len = 0, i = 0; message[i].iov_base; i++)
+    {
+      memcpy (packet->data + len, message[i].iov_base, message[i].iov_len);
+      len += message[i].iov_len;
+    }
+
+  sim_event_push (sim_now + SIM_LINK_DELAY, NULL, packet);
+  return len;
+}
+
+int
+ospf6_recvmsg (struct in6_addr *src, struct in6_addr *dst,
+               unsigned int *ifindex, struct iovec *message)
+{
+  assert (receiving);
+  assert (receiving->len <= message[0].iov_len);
+
+  memcpy (message[0].iov_base, receiving->data, receiving->len);
+  *src = receiving->src;
+  *dst = receiving->dst;
+  *ifindex = receiving->to->ifp->ifindex;
+  return receiving->len;
+}
+
+/* Changes are noticed through the area LSDB hooks, by every Link State
+ * Update delivered and by comparing the prefixes assigned to each
+ * interface after a router has run.  The hooks alone miss refreshes,
+ * which only change the sequence number, but those cannot reach another
+ * router other than in an update.  Walking the whole LSDB after every
+ * run instead would make each event cost as much as the network is
+ * large. */
+static void
+sim_hook_add (struct ospf6_lsa *lsa)
+{
+  last_change = sim_now;
+  (*area_hook_add) (lsa);
+}
+
+static void
+sim_hook_remove (struct ospf6_lsa *lsa)
+{
+  last_change = sim_now;
+  (*area_hook_remove) (lsa);
+}
+
+static u_int32_t
+sim_area_sig (struct ospf6_area *oa)
+{
+  struct ospf6_lsa *lsa;
+  u_int32_t sig = 0;
+
+  for (lsa = ospf6_lsdb_head (oa->lsdb); lsa; lsa = ospf6_lsdb_next (lsa))
+    if (! OSPF6_LSA_IS_MAXAGE (lsa))
+      sig = jhash_3words (sig, lsa->header->type << 16,
+                          lsa->header->id ^ lsa->header->adv_router,
+                          lsa->header->seqnum);
+  return sig;
+}
+
+static u_int32_t
+sim_port_prefixes (struct sim_port *port)
+{
+  struct ospf6_interface *oi = port->ifp->info;
+  struct ospf6_assigned_prefix *ap;
+  struct listnode *node;
+  u_int32_t sig = 0;
+
+  if (oi == NULL)
+    return 0;
+
+  for (ALL_LIST_ELEMENTS_RO (oi->assigned_prefix_list, node, ap))
+    if (ap->is_valid)
+      sig ^= jhash (&ap->prefix.u.prefix6, sizeof (struct in6_addr),
+                    ap->prefix.prefixlen);
+  return sig;
+}
+
+/* All ports on live links have a full adjacency */
+static int
+sim_router_full (struct sim_router *r)
+{
+  struct ospf6_interface *oi;
+  struct ospf6_neighbor *on;
+  struct listnode *node;
+  int i, full;
+
+  for (i = 0; i < r->nports; i++)
+    {
+      if (! r->port[i].link->up)
+        continue;
+      if ((oi = r->port[i].ifp->info) == NULL)
+        return 0;
+      full = 0;
+      for (ALL_LIST_ELEMENTS_RO (oi->neighbor_list, node, on))
+        if (on->state == OSPF6_NEIGHBOR_FULL)
+          full = 1;
+      if (! full)
+        return 0;
+    }
+  return 1;
+}
+
+static void
+sim_observe (struct sim_router *r)
+{
+  struct ospf6_area *oa;
+  u_int32_t sig = 0;
+  int i;
+
+  oa = ospf6 ? ospf6_area_lookup (0, ospf6) : NULL;
+  if (oa && oa->lsdb->hook_add != sim_hook_add)
+    {
+      area_hook_add = oa->lsdb->hook_add;
+      area_hook_remove = oa->lsdb->hook_remove;
+      oa->lsdb->hook_add = sim_hook_add;
+      oa->lsdb->hook_remove = sim_hook_remove;
+    }
+
+  for (i = 0; i < r->nports; i++)
+    {
+      r->port[i].prefix_sig = sim_port_prefixes (&r->port[i]);
+      sig = jhash_2words (sig, r->port[i].prefix_sig, i);
+    }
+  if (sig != r->prefix_sig)
+    {
+      r->prefix_sig = sig;
+      r->prefix_changes++;
+      last_change = sim_now;
+    }
+
+  if (r->restarting)
+    {
+      if (! r->full_at && sim_router_full (r))
+        r->full_at = sim_now;
+      for (i = 0; i < r->nports && ! r->prefix_at; i++)
+        if (r->port[i].prefix_sig)
+          r->prefix_at = sim_now;
+    }
+}
+
+/* Virtual time stands still while threads run, so protocol loops that
+ * keep rescheduling themselves without a timer are caught by counting */
+static u_int64_t instant;
+static unsigned long instant_threads;
+
+static int
+sim_runnable (struct thread_master *m, u_int64_t *wake)
+{
+  u_int64_t t;
+
+  *wake = ~0ULL;
+  if (m->ready.count || m->event.count)
+    {
+      *wake = sim_now;
+      return 1;
+    }
+  if (m->timer.head)
+    {
+      t = m->timer.head->u.sands.tv_sec * 1000000ULL
+          + m->timer.head->u.sands.tv_usec - SIM_START * 1000000;
+      *wake = t;
+    }
+  if (m->background.head)
+    {
+      t = m->background.head->u.sands.tv_sec * 1000000ULL
+          + m->background.head->u.sands.tv_usec - SIM_START * 1000000;
+      if (t < *wake)
+        *wake = t;
+    }
+  return *wake <= sim_now;
+}
+
+/* Run whatever a router has due now, then queue its next wake-up */
+static void
+sim_run (struct sim_router *r)
+{
+  struct thread thread;
+  u_int64_t wake = ~0ULL, start;
+
+  if (sim_now != instant)
+    {
+      instant = sim_now;
+      instant_threads = 0;
+    }
+
+  start = sim_cpu (CLOCK_THREAD_CPUTIME_ID);
+  while (instant_threads <= SIM_LIVELOCK && sim_runnable (master, &wake))
+    if (thread_fetch (master, &thread))
+      {
+        thread_call (&thread);
+        r->threads++;
+        instant_threads++;
+      }
+  sim_observe (r);
+  r->cpu += sim_cpu (CLOCK_THREAD_CPUTIME_ID) - start;
+
+  if (wake != ~0ULL && wake != r->wake)
+    {
+      r->wake = wake;
+      sim_event_push (wake, r, NULL);
+    }
+}
+
+static void
+sim_deliver (struct sim_packet *packet)
+{
+  struct sim_router *r = packet->to->router;
+  struct thread *t, *next;
+  u_int64_t start;
+
+  sim_enter (r);
+  if (packet->to->link->up)
+    {
+      start = sim_cpu (CLOCK_THREAD_CPUTIME_ID);
+      receiving = packet;
+      if (((struct ospf6_header *) packet->data)->type
+          == OSPF6_MESSAGE_TYPE_LSUPDATE)
+        last_change = sim_now;
+      thread_execute (master, ospf6_receive, NULL, ospf6_sock);
+      receiving = NULL;
+
+      /* ospf6_receive () has rearmed itself for the next packet */
+      for (t = master->read.head; t; t = next)
+        {
+          next = t->next;
+          if (t->u.fd == ospf6_sock)
+            thread_cancel (t);
+        }
+      r->cpu += sim_cpu (CLOCK_THREAD_CPUTIME_ID) - start;
+    }
+  else
+    dropped++;
+  sim_run (r);
+  sim_leave ();
+  free (packet);
+}
+
+static void
+sim_boot (struct sim_router *r)
+{
+  struct sim_port *port;
+  struct connected *c;
+  char name[INTERFACE_NAMSIZ];
+  int i;
+
+  sim_enter (r);
+  r->master = master = thread_master_create ();
+  if_init ();
+
+  for (i = 0; i < r->nports; i++)
+    {
+      port = &r->port[i];
+      snprintf (name, sizeof (name), "eth%d", i);
+      port->ifp = if_create (name, strlen (name));
+      port->ifp->ifindex = i + 1;
+      port->ifp->flags = IFF_UP | IFF_RUNNING | IFF_BROADCAST | IFF_MULTICAST;
+      port->ifp->mtu = port->ifp->mtu6 = 1500;
+
+      port->ifp->hw_addr_len = 6;
+      port->ifp->hw_addr[0] = 0x02;
+      port->ifp->hw_addr[2] = (r->index >> 16) & 0xff;
+      port->ifp->hw_addr[3] = (r->index >> 8) & 0xff;
+      port->ifp->hw_addr[4] = r->index & 0xff;
+      port->ifp->hw_addr[5] = i;
+
+      memset (&port->linklocal, 0, sizeof (struct in6_addr));
+      port->linklocal.s6_addr[0] = 0xfe;
+      port->linklocal.s6_addr[1] = 0x80;
+      memcpy (&port->linklocal.s6_addr[10], port->ifp->hw_addr, 6);
+
+      c = connected_new ();
+      c->ifp = port->ifp;
+      c->address = prefix_new ();
+      c->address->family = AF_INET6;
+      c->address->prefixlen = 64;
+      c->address->u.prefix6 = port->linklocal;
+      listnode_add (port->ifp->connected, c);
+    }
+
+  /* as ospf6d does on its first router-id update from zebra */
+  ospf6_set_router_id (0);
+  ospf6_init_seed ();
+  ospf6_set_router_id (ospf6_generate_router_id ());
+
+  r->wake = ~0ULL;
+  sim_run (r);
+  sim_leave ();
+}
+
+/* Topologies */
+static void
+sim_connect (int a, int b)
+{
+  struct sim_link *link;
+
+  if (routers[a].nports == SIM_MAX_DEGREE ||
+      routers[b].nports == SIM_MAX_DEGREE)
+    return;
+
+  link = &links[nlinks++];
+  link->up = 1;
+  link->port[0] = &routers[a].port[routers[a].nports++];
+  link->port[1] = &routers[b].port[routers[b].nports++];
+  link->port[0]->router = &routers[a];
+  link->port[1]->router = &routers[b];
+  link->port[0]->link = link->port[1]->link = link;
+}
+
+static void
+sim_topology (const char *type)
+{
+  int i, j, side;
+  double r, dx, dy;
+
+  routers = calloc (nrouters, sizeof (struct sim_router));
+  links = calloc (nrouters * SIM_MAX_DEGREE / 2, sizeof (struct sim_link));
+  assert (routers && links);
+  for (i = 0; i < nrouters; i++)
+    routers[i].index = i + 1;
+
+  if (strcmp (type, "line") == 0)
+    {
+      for (i = 0; i + 1 < nrouters; i++)
+        sim_connect (i, i + 1);
+    }
+  else if (strcmp (type, "grid") == 0)
+    {
+      for (side = 1; side * side < nrouters; side++)
+        ;
+      for (i = 0; i < nrouters; i++)
+        {
+          if ((i + 1) % side && i + 1 < nrouters)
+            sim_connect (i, i + 1);
+          if (i + side < nrouters)
+            sim_connect (i, i + side);
+        }
+    }
+  else if (strcmp (type, "random") == 0)
+    {
+      /* random geometric graph with an average degree of about four */
+      for (i = 0; i < nrouters; i++)
+        {
+          routers[i].x = sim_rand () / 32768.0;
+          routers[i].y = sim_rand () / 32768.0;
+        }
+      r = sqrt (4.0 / (3.14159265 * nrouters));
+      for (i = 0; i < nrouters; i++)
+        for (j = i + 1; j < nrouters; j++)
+          {
+            dx = routers[i].x - routers[j].x;
+            dy = routers[i].y - routers[j].y;
+            if (dx * dx + dy * dy < r * r)
+              sim_connect (i, j);
+          }
+    }
+  else
+    {
+      fprintf (stderr, "unknown topology %s\n", type);
+      exit (1);
+    }
+}
+
+static void
+sim_component (struct sim_router *r, int component)
+{
+  int i;
+
+  if (r->component)
+    return;
+  r->component = component;
+  for (i = 0; i < r->nports; i++)
+    if (r->port[i].link->up)
+      sim_component (r->port[i].link->port[0] == &r->port[i] ?
+                     r->port[i].link->port[1]->router :
+                     r->port[i].link->port[0]->router, component);
+}
+
+static u_int32_t
+sim_lsdb_sig (struct sim_router *r)
+{
+  struct ospf6_area *oa;
+
+  oa = r->ospf6 ? ospf6_area_lookup (0, r->ospf6) : NULL;
+  return oa ? sim_area_sig (oa) : 0;
+}
+
+/* Runs the simulation until the network has been quiet for SIM_SETTLE
+ * or the time limit is reached, and reports on it */
+static void
+sim_phase (const char *name, u_int64_t limit)
+{
+  struct sim_event ev;
+  struct sim_router *r;
+  struct sim_port *port;
+  unsigned long sent_before[6], bytes_before, changes, renumbered;
+  unsigned long cpu, cpu_max, threads;
+  u_int64_t start, last, wall;
+  u_int32_t *sig;
+  int i, components, consistent, agreed, up, full, adjacencies, apart;
+
+  memcpy (sent_before, sent, sizeof (sent));
+  bytes_before = sent_bytes;
+  changes = cpu = cpu_max = threads = 0;
+  for (i = 0; i < nrouters; i++)
+    {
+      changes -= routers[i].prefix_changes;
+      threads -= routers[i].threads;
+      routers[i].cpu_phase = routers[i].cpu;
+    }
+
+  start = sim_now;
+  wall = sim_cpu (CLOCK_MONOTONIC);
+  for (last = start; heap_count && heap[0].time <= start + limit; )
+    {
+      /* Once quiet for long enough, leave whatever comes next, such as a
+       * periodic refresh, to the next phase rather than stop halfway
+       * through the flooding it starts */
+      if (heap[0].time > last + SIM_SETTLE)
+        {
+          sim_now = last + SIM_SETTLE + 1;
+          break;
+        }
+
+      ev = sim_event_pop ();
+      sim_now = ev.time;
+
+      if (ev.packet)
+        sim_deliver (ev.packet);
+      else if (ev.router->wake == ev.time)
+        {
+          ev.router->wake = ~0ULL;
+          sim_enter (ev.router);
+          sim_run (ev.router);
+          sim_leave ();
+        }
+
+      last = last_change > start ? last_change : start;
+      if (instant_threads > SIM_LIVELOCK)
+        break;
+    }
+  wall = sim_cpu (CLOCK_MONOTONIC) - wall;
+
+  /* consistency of the LSDBs and prefixes within each partition */
+  for (i = 0; i < nrouters; i++)
+    routers[i].component = 0;
+  for (i = 0, components = 0; i < nrouters; i++)
+    if (! routers[i].component)
+      sim_component (&routers[i], ++components);
+
+  sig = calloc (2 * (components + 1), sizeof (u_int32_t));
+  for (i = 0; i < nrouters; i++)
+    {
+      u_int32_t s = sim_lsdb_sig (&routers[i]);
+      int c = routers[i].component;
+
+      if (sig[2 * c] == 0)
+        sig[2 * c] = s;
+      else if (sig[2 * c] != s)
+        sig[2 * c + 1] = 1;
+    }
+  for (i = 1, consistent = 0; i <= components; i++)
+    if (! sig[2 * i + 1])
+      consistent++;
+  free (sig);
+
+  for (i = 0, agreed = up = renumbered = 0, apart = -1; i < nlinks; i++)
+    {
+      if (links[i].up)
+        up++;
+      if (links[i].up && links[i].port[0]->prefix_sig &&
+          links[i].port[0]->prefix_sig == links[i].port[1]->prefix_sig)
+        agreed++;
+      else if (links[i].up && apart < 0)
+        apart = i;
+      if (links[i].up && links[i].prefix_sig &&
+          links[i].prefix_sig != links[i].port[0]->prefix_sig)
+        renumbered++;
+      links[i].prefix_sig = links[i].port[0]->prefix_sig;
+    }
+
+  for (i = 0, full = adjacencies = 0; i < nrouters; i++)
+    {
+      int p;
+
+      r = &routers[i];
+      changes += r->prefix_changes;
+      threads += r->threads;
+      cpu += r->cpu - r->cpu_phase;
+      if (r->cpu - r->cpu_phase > cpu_max)
+        cpu_max = r->cpu - r->cpu_phase;
+      for (p = 0; p < r->nports; p++)
+        {
+          struct ospf6_interface *oi;
+          struct ospf6_neighbor *on;
+          struct listnode *node;
+
+          port = &r->port[p];
+          oi = port->ifp->info;
+          if (port->link->up)
+            adjacencies++;
+          if (oi == NULL)
+            continue;
+          for (ALL_LIST_ELEMENTS_RO (oi->neighbor_list, node, on))
+            if (on->state == OSPF6_NEIGHBOR_FULL)
+              full++;
+        }
+    }
+
+  printf ("%s: %s %.3f s, %lu threads, %lu.%03lu s wall\n", name,
+          instant_threads > SIM_LIVELOCK ? "livelocked at" :
+          sim_now > last + SIM_SETTLE ? "converged in" : "not settled after",
+          (instant_threads > SIM_LIVELOCK ? sim_now - start : last - start)
+          / 1000000.0, threads,
+          (unsigned long) (wall / 1000000), (unsigned long) (wall / 1000 % 1000));
+  printf ("  sent:");
+  for (i = 1; i < 6; i++)
+    printf (" %lu %s,", sent[i] - sent_before[i], sim_message_name[i]);
+  printf (" %lu bytes, %lu dropped so far\n", sent_bytes - bytes_before,
+          dropped);
+  printf ("  cpu per router: mean %lu usec, max %lu usec\n",
+          cpu / nrouters, cpu_max);
+  printf ("  %d/%d adjacencies full, LSDB consistent in %d/%d partitions\n",
+          full, adjacencies, consistent, components);
+  printf ("  %d/%d links with an agreed prefix, %lu assignment changes, "
+          "%lu links renumbered\n", agreed, up, changes, renumbered);
+  fflush (stdout);
+
+  if (instant_threads > SIM_LIVELOCK)
+    snprintf (sim_failure, sizeof (sim_failure), "%s livelocked", name);
+  else if (sim_now <= last + SIM_SETTLE)
+    snprintf (sim_failure, sizeof (sim_failure), "%s not settled", name);
+  else if (full < adjacencies)
+    snprintf (sim_failure, sizeof (sim_failure),
+              "%s: %d adjacencies not full", name, adjacencies - full);
+  else if (consistent < components)
+    snprintf (sim_failure, sizeof (sim_failure),
+              "%s: LSDB inconsistent in %d partitions", name,
+              components - consistent);
+  else if (agreed < up)
+    snprintf (sim_failure, sizeof (sim_failure),
+              "%s: %d links without an agreed prefix, first link %d",
+              name, up - agreed, apart);
+  else
+    sim_failure[0] = '\0';
+}
+
+static void
+sim_init (void)
+{
+  extern struct zclient *zclient;
+  struct zlog *zl;
+
+  /* ospf6_init () schedules its socket and zebra connection on a
+   * master of its own, which is never run */
+  master = thread_master_create ();
+  cmd_init (1);
+  if_init ();
+  ospf6_init ();
+  zclient_stop (zclient);
+
+  zl = zlog_default = openzlog ("simospf6d", ZLOG_OSPF6, 0, LOG_DAEMON);
+  zlog_set_level (zl, ZLOG_DEST_SYSLOG, ZLOG_DISABLED);
+  zlog_set_level (zl, ZLOG_DEST_MONITOR, ZLOG_DISABLED);
+  zlog_set_level (zl, ZLOG_DEST_STDOUT, LOG_ERR);
+}
+
+/* Restarts ospf6 on a router the way a router-id change does, with or
+ * without the LSDB snapshot taken just before, and reports how long it
+ * took to get its adjacencies full and a prefix assigned again */
+static void
+sim_restart (struct sim_router *r, const char *dir, u_int64_t limit)
+{
+  char name[32];
+  u_int64_t start;
+
+  if (dir)
+    snprintf (r->snapshot, sizeof (r->snapshot), "%s/r%d", dir, r->index);
+  else
+    r->snapshot[0] = '\0';
+
+  start = sim_now;
+  sim_enter (r);
+  r->restarting = 1;
+  r->full_at = r->prefix_at = 0;
+  ospf6_set_router_id (ospf6->router_id);
+  sim_run (r);
+  sim_leave ();
+
+  snprintf (name, sizeof (name), "router %d %s restart", r->index,
+            dir ? "warm" : "cold");
+  sim_phase (name, limit);
+  r->restarting = 0;
+
+  printf ("  router %d: ", r->index);
+  if (r->full_at)
+    printf ("full after %.3f s, ", (r->full_at - start) / 1000000.0);
+  else
+    printf ("not full, ");
+  if (r->prefix_at)
+    printf ("first prefix after %.3f s\n", (r->prefix_at - start) / 1000000.0);
+  else
+    printf ("no prefix\n");
+  fflush (stdout);
+}
+
+int
+main (int argc, char **argv)
+{
+  const char *type = "grid";
+  char name[32];
+  int opt, churn = 0, restarts = 0, verbose = 0, i, l;
+  char dir[] = "/tmp/simospf6d.XXXXXX";
+  u_int64_t limit = 1800;
+  unsigned long seed;
+
+  nrouters = 16;
+  rand_state = 1;
+
+  while ((opt = getopt (argc, argv, "t:n:d:c:r:s:v")) != -1)
+    switch (opt)
+      {
+      case 't':
+        type = optarg;
+        break;
+      case 'n':
+        nrouters = atoi (optarg);
+        break;
+      case 'd':
+        limit = atoi (optarg);
+        break;
+      case 'c':
+        churn = atoi (optarg);
+        break;
+      case 'r':
+        restarts = atoi (optarg);
+        break;
+      case 's':
+        rand_state = strtoul (optarg, NULL, 10);
+        break;
+      case 'v':
+        verbose = 1;
+        break;
+      default:
+        fprintf (stderr, "usage: %s [-t line|grid|random] [-n routers] "
+                 "[-d seconds] [-c churn events] [-r restarts] [-s seed] "
+                 "[-v]\n", argv[0]);
+        return 1;
+      }
+  if (nrouters < 2)
+    nrouters = 2;
+  limit *= 1000000;
+
+  sim_init ();
+  if (verbose)
+    zlog_set_level (NULL, ZLOG_DEST_STDOUT, LOG_DEBUG);
+
+  seed = rand_state;
+  sim_topology (type);
+  printf ("%s topology, %d routers, %d links, seed %lu\n",
+          type, nrouters, nlinks, seed);
+
+  for (i = 0; i < nrouters; i++)
+    {
+      sim_now = (u_int64_t) i * SIM_BOOT_STAGGER;
+      sim_boot (&routers[i]);
+    }
+  sim_phase ("boot", limit);
+
+  for (i = 0; i < churn && nlinks && instant_threads <= SIM_LIVELOCK; i++)
+    {
+      l = sim_rand () % nlinks;
+
+      links[l].up = 0;
+      snprintf (name, sizeof (name), "link %d down", l);
+      sim_phase (name, limit);
+
+      links[l].up = 1;
+      snprintf (name, sizeof (name), "link %d up", l);
+      sim_phase (name, limit);
+    }
+
+  if (restarts && mkdtemp (dir) == NULL)
+    {
+      perror ("mkdtemp");
+      return 1;
+    }
+  for (i = 0; i < restarts && instant_threads <= SIM_LIVELOCK; i++)
+    {
+      struct sim_router *r = &routers[sim_rand () % nrouters];
+
+      sim_restart (r, NULL, limit);
+      sim_restart (r, dir, limit);
+      sim_enter (r);
+      ospf6_snapshot_stop ();
+      sim_leave ();
+      unlink (r->snapshot);
+      r->snapshot[0] = '\0';
+    }
+  if (restarts)
+    rmdir (dir);
+
+  if (sim_failure[0])
+    {
+      printf ("FAIL: %s\n", sim_failure);
+      return 1;
+    }
+  return 0;
+}
@@ -0,0 +1,228 @@
+/*
+ * Ring queue and worker pool benchmark.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Passes pointers from producer threads to a consumer through a ring,
+ * and through a list under a mutex for comparison, and prints how many
+ * go through each second.  Then runs empty jobs through worker pools of
+ * growing size from an event loop, which gives the cost of a round trip
+ * through the rings and the eventfd.
+ */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "memory.h"
+#include "ring.h"
+#include "worker.h"
+
+#if defined HAVE_PTHREAD && defined __ATOMIC_ACQUIRE
+#define BENCH_THREADS
+#include <pthread.h>
+#include <sched.h>
+#endif /* BENCH_THREADS */
+
+#define BENCH_ITEMS	10000000
+#define BENCH_JOBS	1000000
+
+struct thread_master *master;
+
+static unsigned long
+bench_usec (struct timeval *start)
+{
+  struct timeval end;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1000000UL
+	 + end.tv_usec - start->tv_usec;
+}
+
+#ifdef BENCH_THREADS
+static struct ring *bench_ring;
+static unsigned long bench_per_producer;
+
+/* The list a mutex and condition variable would give. */
+static struct
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  void **item;
+  unsigned long head, tail, size;
+} bench_locked;
+
+static void *
+bench_ring_produce (void *arg)
+{
+  unsigned long i;
+
+  for (i = 1; i <= bench_per_producer; i++)
+    while (ring_put (bench_ring, (void *) i) < 0)
+      sched_yield ();
+  return NULL;
+}
+
+static void *
+bench_locked_produce (void *arg)
+{
+  unsigned long i;
+
+  for (i = 1; i <= bench_per_producer; i++)
+    {
+      pthread_mutex_lock (&bench_locked.mutex);
+      while (bench_locked.head - bench_locked.tail == bench_locked.size)
+	pthread_cond_wait (&bench_locked.cond, &bench_locked.mutex);
+      bench_locked.item[bench_locked.head++ % bench_locked.size] = (void *) i;
+      pthread_mutex_unlock (&bench_locked.mutex);
+    }
+  return NULL;
+}
+
+static void *
+bench_locked_get (void)
+{
+  void *item = NULL;
+
+  pthread_mutex_lock (&bench_locked.mutex);
+  if (bench_locked.head != bench_locked.tail)
+    {
+      item = bench_locked.item[bench_locked.tail++ % bench_locked.size];
+      pthread_cond_signal (&bench_locked.cond);
+    }
+  pthread_mutex_unlock (&bench_locked.mutex);
+  return item;
+}
+
+static void
+bench_queue (int type, int nproducers, int locked)
+{
+  pthread_t thread[4];
+  struct timeval start;
+  unsigned long usec, i, sum = 0;
+  void *item;
+  int p;
+
+  bench_per_producer = BENCH_ITEMS / nproducers;
+  if (locked)
+    {
+      pthread_mutex_init (&bench_locked.mutex, NULL);
+      pthread_cond_init (&bench_locked.cond, NULL);
+      bench_locked.size = 1024;
+      bench_locked.head = bench_locked.tail = 0;
+      bench_locked.item = XCALLOC (MTYPE_TMP, 1024 * sizeof (void *));
+    }
+  else
+    bench_ring = ring_new (1024, type);
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (p = 0; p < nproducers; p++)
+    pthread_create (&thread[p], NULL,
+		    locked ? bench_locked_produce : bench_ring_produce, NULL);
+  for (i = 0; i < bench_per_producer * nproducers; i++)
+    {
+      while ((item = locked ? bench_locked_get ()
+			    : ring_get (bench_ring)) == NULL)
+	sched_yield ();
+      sum += (unsigned long) item;
+    }
+  for (p = 0; p < nproducers; p++)
+    pthread_join (thread[p], NULL);
+  usec = bench_usec (&start);
+
+  assert (sum == nproducers * bench_per_producer
+		 * (bench_per_producer + 1) / 2);
+  printf ("%s, %d producer%s: %lu items in %lu usec, %.1f million/s\n",
+	  locked ? "mutex" : type == RING_MPSC ? "MPSC ring" : "SPSC ring",
+	  nproducers, nproducers > 1 ? "s" : " ", i, usec,
+	  (double) i / usec);
+
+  if (locked)
+    {
+      XFREE (MTYPE_TMP, bench_locked.item);
+      pthread_cond_destroy (&bench_locked.cond);
+      pthread_mutex_destroy (&bench_locked.mutex);
+    }
+  else
+    ring_free (bench_ring);
+}
+#endif /* BENCH_THREADS */
+
+static unsigned long jobs_done;
+
+static void
+bench_work (void *arg)
+{
+}
+
+static void
+bench_done (void *arg)
+{
+  jobs_done++;
+}
+
+static void
+bench_pool (unsigned int nthreads)
+{
+  struct worker_pool *pool;
+  struct thread thread;
+  struct timeval start;
+  unsigned long usec, submitted = 0;
+
+  pool = worker_pool_new (master, nthreads, 256);
+  assert (pool);
+  jobs_done = 0;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  while (jobs_done < BENCH_JOBS)
+    {
+      while (submitted < BENCH_JOBS
+	     && worker_pool_submit (pool, bench_work, bench_done, NULL) == 0)
+	submitted++;
+      if (thread_fetch (master, &thread))
+	thread_call (&thread);
+    }
+  usec = bench_usec (&start);
+  worker_pool_free (pool);
+
+  printf ("worker pool, %u thread%s: %lu jobs in %lu usec, "
+	  "%.2f usec per job\n", nthreads, nthreads > 1 ? "s" : " ",
+	  jobs_done, usec, (double) usec / jobs_done);
+}
+
+int
+main (int argc, char **argv)
+{
+  master = thread_master_create ();
+
+#ifdef BENCH_THREADS
+  bench_queue (RING_SPSC, 1, 0);
+  bench_queue (RING_MPSC, 1, 0);
+  bench_queue (RING_MPSC, 2, 0);
+  bench_queue (RING_MPSC, 4, 0);
+  bench_queue (0, 1, 1);
+  bench_queue (0, 4, 1);
+#endif /* BENCH_THREADS */
+
+  bench_pool (1);
+  bench_pool (2);
+  bench_pool (4);
+
+  thread_master_free (master);
+  return 0;
+}
@@ -3,6 +3,7 @@
 #include <time.h>
 
 #include "checksum.h"
+#include "thread.h"
 
 struct thread_master *master;
 
@@ -483,6 +484,107 @@ in_cksum_rfc(void *parg, int count)
 }
 
 
+/* LSA and LSP sizes: bare header, typical LSAs, MTU, jumbo, big LSPs */
+static const int kernel_sizes[] =
+  { 20, 36, 37, 64, 100, 256, 512, 999, 1500, 4096, 9000, 16384, 60000 };
+static const char *kernel_names[] = { "scalar", "sse2", "avx2" };
+
+/* Bytes checksummed per size when timing a kernel */
+#define KERNEL_BENCH_BYTES (16 << 20)
+
+static unsigned long
+kernel_usec (struct timeval *start)
+{
+  struct timeval end;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1000000UL
+         + end.tv_usec - start->tv_usec;
+}
+
+/* Check every checksum kernel the CPU runs against the reference
+ * versions above, at each size and at an odd address, then time them.
+ */
+static void
+test_kernels (u_char *buffer)
+{
+  u_char copy[60000 + 1];
+  u_int16_t ref, lib;
+  struct timeval start;
+  unsigned long fletcher_usec, in_cksum_usec;
+  unsigned int k, s, i, n;
+  int align, len, off;
+
+  for (i = 0; i < sizeof (copy); i++)
+    copy[i] = random ();
+
+  printf ("%-7s %6s %12s %12s\n", "kernel", "size", "fletcher", "in_cksum");
+  for (k = 0; k < sizeof (kernel_names) / sizeof (kernel_names[0]); k++)
+    {
+      if (checksum_kernel_select (kernel_names[k]) < 0)
+        {
+          printf ("%-7s not supported\n", kernel_names[k]);
+          continue;
+        }
+
+      for (s = 0; s < sizeof (kernel_sizes) / sizeof (kernel_sizes[0]); s++)
+        {
+          len = kernel_sizes[s];
+          off = 16;		/* LS checksum in the LSA header */
+
+          for (align = 0; align < 2; align++)
+            {
+              memcpy (buffer + align, copy, len);
+              ref = ospfd_checksum (buffer + align, len, off);
+              memcpy (buffer + align, copy, len);
+              lib = fletcher_checksum (buffer + align, len, off);
+              if (ref != lib || verify (buffer + align, len))
+                {
+                  printf ("%s: fletcher mismatch at size %d align %d: "
+                          "0x%04x, expected 0x%04x\n",
+                          kernel_names[k], len, align, lib, ref);
+                  exit (1);
+                }
+              if (fletcher_checksum (buffer + align, len,
+                                     FLETCHER_CHECKSUM_VALIDATE) != 0)
+                {
+                  printf ("%s: fletcher validation failed at size %d\n",
+                          kernel_names[k], len);
+                  exit (1);
+                }
+
+              ref = in_cksum_rfc (copy + align, len);
+              lib = in_cksum (copy + align, len);
+              if (ref != lib)
+                {
+                  printf ("%s: in_cksum mismatch at size %d align %d: "
+                          "0x%04x, expected 0x%04x\n",
+                          kernel_names[k], len, align, lib, ref);
+                  exit (1);
+                }
+            }
+
+          n = KERNEL_BENCH_BYTES / len;
+          quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+          for (i = 0; i < n; i++)
+            fletcher_checksum (buffer, len, FLETCHER_CHECKSUM_VALIDATE);
+          fletcher_usec = kernel_usec (&start);
+
+          quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+          for (i = 0; i < n; i++)
+            in_cksum (buffer, len);
+          in_cksum_usec = kernel_usec (&start);
+
+          printf ("%-7s %6d %7.2f ns/B %7.2f ns/B\n", kernel_names[k], len,
+                  fletcher_usec * 1000.0 / ((double) n * len),
+                  in_cksum_usec * 1000.0 / ((double) n * len));
+        }
+    }
+
+  checksum_kernel_select (NULL);
+  printf ("using %s\n", checksum_kernel_name ());
+}
+
 int
 main(int argc, char **argv)
 {
@@ -495,6 +597,8 @@ main(int argc, char **argv)
   
   srandom (time (NULL));
   
+  test_kernels (buffer);
+
   while (1) {
     u_int16_t ospfd, isisd, lib, in_csum, in_csum_res, in_csum_rfc;
     int i,j;
@@ -0,0 +1,218 @@
+/*
+ * Asynchronous log writer tests.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Logs to a file through the writer thread and reads the file back.  A
+ * child process logs and exits at once, and everything it logged must
+ * be in the file.  Several threads log at the same time; each one's
+ * messages must come out whole and in the order it logged them, and
+ * those missing must match the count of messages dropped and the
+ * writer's reports of them.  Last, the file is moved away and the log
+ * rotated, and each message must land on the right side of the rotate.
+ */
+
+#include <zebra.h>
+#include <sys/wait.h>
+
+#include "thread.h"
+#include "log.h"
+#include "memory.h"
+
+#if defined HAVE_PTHREAD && defined __ATOMIC_ACQUIRE
+#define TEST_THREADS
+#include <pthread.h>
+#endif /* TEST_THREADS */
+
+/* Fewer than the writer's ring holds, so that none are dropped. */
+#define TEST_BURST	500
+#define TEST_MESSAGES	20000
+#define TEST_WRITERS	4
+
+struct thread_master *master;
+
+static char test_dir[] = "/tmp/testlog.XXXXXX";
+
+static void
+test_path (char *buf, size_t size, const char *name)
+{
+  snprintf (buf, size, "%s/%s", test_dir, name);
+}
+
+/* Checks that the file holds "<tag> <n>" for n from 0 to count - 1, in
+ * order and nothing else, and removes it.
+ */
+static void
+test_burst_check (const char *name, const char *tag, int count)
+{
+  char path[MAXPATHLEN], line[1024], word[32];
+  FILE *fp;
+  char *s;
+  int n, next = 0;
+
+  test_path (path, sizeof (path), name);
+  fp = fopen (path, "r");
+  assert (fp);
+  while (fgets (line, sizeof (line), fp))
+    {
+      s = strstr (line, ": ");
+      assert (s);
+      assert (sscanf (s + 2, "%31s %d", word, &n) == 2);
+      assert (strcmp (word, tag) == 0);
+      assert (n == next);
+      next++;
+    }
+  fclose (fp);
+  unlink (path);
+  assert (next == count);
+}
+
+static void
+test_exit (void)
+{
+  char path[MAXPATHLEN];
+  pid_t pid;
+  int status, i;
+
+  test_path (path, sizeof (path), "exit.log");
+  pid = fork ();
+  assert (pid >= 0);
+  if (pid == 0)
+    {
+      zlog_default = openzlog ("testlog", ZLOG_NONE, 0, LOG_DAEMON);
+      assert (zlog_set_file (NULL, path, LOG_DEBUG));
+      for (i = 0; i < TEST_BURST; i++)
+	zlog_info ("exit %d", i);
+      /* The writer is still at it, or has yet to start. */
+      exit (0);
+    }
+  assert (waitpid (pid, &status, 0) == pid);
+  assert (WIFEXITED (status) && WEXITSTATUS (status) == 0);
+
+  test_burst_check ("exit.log", "exit", TEST_BURST);
+  printf ("flush at exit: %d messages\n", TEST_BURST);
+}
+
+#ifdef TEST_THREADS
+static void *
+test_write (void *arg)
+{
+  int id = (int) (long) arg;
+  int i;
+
+  for (i = 0; i < TEST_MESSAGES; i++)
+    zlog_debug ("thread %d message %d of %d", id, i, TEST_MESSAGES);
+  return NULL;
+}
+
+static void
+test_threads (void)
+{
+  pthread_t thread[TEST_WRITERS];
+  char path[MAXPATHLEN], line[1024];
+  int next[TEST_WRITERS];
+  unsigned long dropped, reported = 0, seen = 0, n;
+  FILE *fp;
+  char *s;
+  int i, id, seq, total;
+
+  test_path (path, sizeof (path), "threads.log");
+  assert (zlog_set_file (NULL, path, LOG_DEBUG));
+  dropped = zlog_dropped ();
+
+  for (i = 0; i < TEST_WRITERS; i++)
+    {
+      next[i] = 0;
+      assert (pthread_create (&thread[i], NULL, test_write,
+			      (void *) (long) i) == 0);
+    }
+  for (i = 0; i < TEST_WRITERS; i++)
+    pthread_join (thread[i], NULL);
+  zlog_reset_file (NULL);
+  dropped = zlog_dropped () - dropped;
+
+  fp = fopen (path, "r");
+  assert (fp);
+  while (fgets (line, sizeof (line), fp))
+    {
+      s = strstr (line, ": ");
+      assert (s);
+      if (sscanf (s + 2, "%lu log messages dropped", &n) == 1)
+	{
+	  reported += n;
+	  continue;
+	}
+      assert (sscanf (s + 2, "thread %d message %d of %d",
+		      &id, &seq, &total) == 3);
+      assert (total == TEST_MESSAGES);
+      assert (id >= 0 && id < TEST_WRITERS);
+      assert (seq >= next[id] && seq < TEST_MESSAGES);
+      next[id] = seq + 1;
+      seen++;
+    }
+  fclose (fp);
+  unlink (path);
+
+  assert (seen + dropped == TEST_WRITERS * TEST_MESSAGES);
+  assert (reported == dropped);
+  printf ("%d threads: %lu messages in order, %lu dropped and reported\n",
+	  TEST_WRITERS, seen, dropped);
+}
+#endif /* TEST_THREADS */
+
+static void
+test_rotate (void)
+{
+  char path[MAXPATHLEN], old[MAXPATHLEN];
+  int i;
+
+  test_path (path, sizeof (path), "rotate.log");
+  test_path (old, sizeof (old), "rotate.log.0");
+  assert (zlog_set_file (NULL, path, LOG_DEBUG));
+
+  for (i = 0; i < TEST_BURST; i++)
+    zlog_info ("before %d", i);
+  assert (rename (path, old) == 0);
+  assert (zlog_rotate (NULL) == 1);
+  for (i = 0; i < TEST_BURST; i++)
+    zlog_info ("after %d", i);
+  zlog_reset_file (NULL);
+
+  test_burst_check ("rotate.log.0", "before", TEST_BURST);
+  test_burst_check ("rotate.log", "after", TEST_BURST);
+  printf ("flush on rotate: %d messages each side\n", TEST_BURST);
+}
+
+int
+main (int argc, char **argv)
+{
+  assert (mkdtemp (test_dir));
+
+  test_exit ();
+
+  zlog_default = openzlog ("testlog", ZLOG_NONE, 0, LOG_DAEMON);
+#ifdef TEST_THREADS
+  test_threads ();
+#endif /* TEST_THREADS */
+  test_rotate ();
+  closezlog (zlog_default);
+
+  rmdir (test_dir);
+  return 0;
+}
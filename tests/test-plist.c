@@ -0,0 +1,462 @@
+/*
+ * Prefix-list lookup tests.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Configures a prefix-list through the CLI with random adds, replaces
+ * of a sequence number, deletes and clears, and checks lookups against
+ * a copy of the list searched as prefix_list_apply () used to, entry by
+ * entry in sequence order.  Entries have ge and le ranges, "any", and
+ * host bits set past their length, and share the first bits of a few
+ * base addresses so that they pile up on the same paths of the trie.
+ * Every few steps the hit counts and refcounts shown by "show ...
+ * prefix-list detail" must be those the linear walk would have kept: a
+ * lookup refers to every entry up to the one it stops at, or to all of
+ * them when nothing matches.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "memory.h"
+#include "vty.h"
+#include "buffer.h"
+#include "prefix.h"
+#include "plist.h"
+
+#define TEST_STEPS	4000
+#define TEST_LOOKUPS	20
+#define TEST_ENTRIES	40		/* different sequence numbers */
+#define TEST_BASES	4
+#define TEST_SHOW_EVERY	10
+
+struct thread_master *master;
+
+static struct vty *vty;
+
+struct test_afi
+{
+  afi_t afi;
+  int family;
+  int maxlen;
+  const char *ip;
+  u_char base[TEST_BASES][16];
+};
+
+/* The list as the linear walk kept it, by sequence number. */
+struct test_entry
+{
+  int seq;
+  enum prefix_list_type type;
+  int any;
+  struct prefix p;
+  int ge;
+  int le;
+  unsigned long hitcnt;
+  unsigned long refcnt;
+};
+
+static struct test_entry model[TEST_ENTRIES];
+static int nmodel;
+
+static unsigned long lookups, shows, warnings;
+
+static int
+test_command (int node, const char *format, ...)
+{
+  char line[256];
+  vector vline;
+  va_list args;
+  int ret;
+
+  va_start (args, format);
+  vsnprintf (line, sizeof (line), format, args);
+  va_end (args);
+
+  vty->node = node;
+  vline = cmd_make_strvec (line);
+  ret = cmd_execute_command (vline, vty, NULL, 0);
+  cmd_free_strvec (vline);
+  buffer_reset (vty->obuf);
+  return ret;
+}
+
+static const char *
+test_type_str (enum prefix_list_type type)
+{
+  return type == PREFIX_PERMIT ? "permit" : "deny";
+}
+
+/* The prefix as typed, with whatever host bits it has. */
+static void
+test_prefix_str (struct test_afi *t, struct test_entry *e, char *buf,
+		 size_t size)
+{
+  char addr[INET6_ADDRSTRLEN];
+  int len;
+
+  if (e->any)
+    {
+      snprintf (buf, size, "any");
+      return;
+    }
+  inet_ntop (t->family, &e->p.u.prefix, addr, sizeof (addr));
+  len = snprintf (buf, size, "%s/%d", addr, e->p.prefixlen);
+  if (e->ge)
+    len += snprintf (buf + len, size - len, " ge %d", e->ge);
+  if (e->le)
+    snprintf (buf + len, size - len, " le %d", e->le);
+}
+
+/* Bits from one of the bases down to a random depth, then random. */
+static void
+test_prefix_random (struct test_afi *t, struct prefix *p, int len)
+{
+  u_char *bytes = (u_char *) &p->u.prefix;
+  int i;
+
+  memset (p, 0, sizeof (struct prefix));
+  p->family = t->family;
+  p->prefixlen = len;
+  memcpy (bytes, t->base[random () % TEST_BASES], t->maxlen / 8);
+  for (i = random () % (t->maxlen + 1); i < t->maxlen; i++)
+    if (random () % 2)
+      bytes[i / 8] ^= 0x80 >> (i % 8);
+}
+
+/* Mostly prefixes within or just around the entries configured. */
+static void
+test_prefix_lookup (struct test_afi *t, struct prefix *p)
+{
+  u_char *bytes = (u_char *) &p->u.prefix;
+  int i;
+
+  if (nmodel == 0 || random () % 4 == 0)
+    {
+      test_prefix_random (t, p, random () % (t->maxlen + 1));
+      return;
+    }
+
+  *p = model[random () % nmodel].p;
+  if (random () % 4 == 0)
+    p->prefixlen = random () % (t->maxlen + 1);
+  else
+    p->prefixlen += random () % (t->maxlen - p->prefixlen + 1);
+  for (i = random () % (t->maxlen + 1); i < t->maxlen; i++)
+    if (random () % 8 == 0)
+      bytes[i / 8] ^= 0x80 >> (i % 8);
+}
+
+static int
+test_model_match (struct test_entry *e, struct prefix *p)
+{
+  if (! prefix_match (&e->p, p))
+    return 0;
+  if (! e->le && ! e->ge)
+    return e->p.prefixlen == p->prefixlen;
+  if (e->le && p->prefixlen > e->le)
+    return 0;
+  if (e->ge && p->prefixlen < e->ge)
+    return 0;
+  return 1;
+}
+
+static enum prefix_list_type
+test_model_apply (struct prefix *p)
+{
+  int i;
+
+  for (i = 0; i < nmodel; i++)
+    {
+      model[i].refcnt++;
+      if (test_model_match (&model[i], p))
+	{
+	  model[i].hitcnt++;
+	  return model[i].type;
+	}
+    }
+  return PREFIX_DENY;
+}
+
+static void
+test_model_remove (int i)
+{
+  nmodel--;
+  memmove (&model[i], &model[i + 1], (nmodel - i) * sizeof (model[0]));
+}
+
+static void
+test_model_insert (struct test_entry *e)
+{
+  int i;
+
+  for (i = 0; i < nmodel && model[i].seq < e->seq; i++)
+    ;
+  memmove (&model[i + 1], &model[i], (nmodel - i) * sizeof (model[0]));
+  model[i] = *e;
+  nmodel++;
+}
+
+static void
+test_add (struct test_afi *t)
+{
+  struct test_entry e;
+  char buf[128];
+  int i, seq, expect = CMD_SUCCESS;
+
+  memset (&e, 0, sizeof (e));
+  e.seq = 5 * (1 + random () % TEST_ENTRIES);
+  e.type = random () % 2 ? PREFIX_PERMIT : PREFIX_DENY;
+
+  if (random () % 32 == 0)
+    {
+      e.any = 1;
+      e.p.family = t->family;
+      e.le = t->maxlen;
+    }
+  else
+    {
+      test_prefix_random (t, &e.p, random () % (t->maxlen + 1));
+      if (e.p.prefixlen < t->maxlen)
+	switch (random () % 4)
+	  {
+	  case 1:
+	    e.ge = e.p.prefixlen + 1 + random () % (t->maxlen - e.p.prefixlen);
+	    break;
+	  case 2:
+	    e.le = e.p.prefixlen + 1 + random () % (t->maxlen - e.p.prefixlen);
+	    break;
+	  case 3:
+	    e.ge = e.p.prefixlen + 1 + random () % (t->maxlen - e.p.prefixlen);
+	    e.le = e.ge + random () % (t->maxlen - e.ge + 1);
+	    break;
+	  }
+    }
+  test_prefix_str (t, &e, buf, sizeof (buf));
+
+  /* Without a sequence number the entry goes after the last. */
+  seq = e.seq;
+  if (random () % 8 == 0)
+    {
+      e.seq = nmodel ? (model[nmodel - 1].seq / 5) * 5 + 5 : 5;
+      if (e.seq > 5 * TEST_ENTRIES)
+	return;
+    }
+
+  /* "le" up to the full length says no more than "ge" does. */
+  if (e.ge && e.le == t->maxlen)
+    e.le = 0;
+
+  for (i = 0; i < nmodel; i++)
+    if (prefix_same (&model[i].p, &e.p) && model[i].type == e.type
+	&& model[i].ge == e.ge && model[i].le == e.le && model[i].seq != e.seq)
+      expect = CMD_WARNING;
+
+  if (seq == e.seq)
+    assert (test_command (CONFIG_NODE, "%s prefix-list t seq %d %s %s", t->ip,
+			  e.seq, test_type_str (e.type), buf) == expect);
+  else
+    assert (test_command (CONFIG_NODE, "%s prefix-list t %s %s", t->ip,
+			  test_type_str (e.type), buf) == expect);
+
+  if (expect == CMD_WARNING)
+    {
+      warnings++;
+      return;
+    }
+  for (i = 0; i < nmodel; i++)
+    if (model[i].seq == e.seq)
+      test_model_remove (i);
+  test_model_insert (&e);
+}
+
+static void
+test_delete (struct test_afi *t)
+{
+  struct test_entry *e;
+  char buf[128];
+  int i;
+
+  if (nmodel == 0)
+    return;
+
+  i = random () % nmodel;
+  e = &model[i];
+  test_prefix_str (t, e, buf, sizeof (buf));
+  if (random () % 2)
+    assert (test_command (CONFIG_NODE, "no %s prefix-list t seq %d %s %s",
+			  t->ip, e->seq, test_type_str (e->type), buf)
+	    == CMD_SUCCESS);
+  else
+    assert (test_command (CONFIG_NODE, "no %s prefix-list t %s %s", t->ip,
+			  test_type_str (e->type), buf) == CMD_SUCCESS);
+  test_model_remove (i);
+}
+
+static void
+test_clear (struct test_afi *t)
+{
+  struct prefix p;
+  char addr[INET6_ADDRSTRLEN];
+  int i;
+
+  if (nmodel == 0)
+    return;
+
+  if (random () % 2)
+    {
+      assert (test_command (ENABLE_NODE, "clear %s prefix-list t", t->ip)
+	      == CMD_SUCCESS);
+      for (i = 0; i < nmodel; i++)
+	model[i].hitcnt = 0;
+      return;
+    }
+
+  test_prefix_lookup (t, &p);
+  inet_ntop (t->family, &p.u.prefix, addr, sizeof (addr));
+  assert (test_command (ENABLE_NODE, "clear %s prefix-list t %s/%d", t->ip,
+			addr, p.prefixlen) == CMD_SUCCESS);
+  for (i = 0; i < nmodel; i++)
+    if (prefix_match (&model[i].p, &p))
+      model[i].hitcnt = 0;
+}
+
+static void
+test_lookup (struct test_afi *t)
+{
+  struct prefix_list *plist;
+  struct prefix p;
+  int i;
+
+  plist = prefix_list_lookup (t->afi, "t");
+  assert ((plist == NULL) == (nmodel == 0));
+
+  for (i = 0; i < TEST_LOOKUPS; i++)
+    {
+      test_prefix_lookup (t, &p);
+      assert (prefix_list_apply (plist, &p) == test_model_apply (&p));
+      lookups++;
+    }
+}
+
+static void
+test_show (struct test_afi *t)
+{
+  vector vline;
+  char *out, *line, *s;
+  unsigned long hitcnt, refcnt;
+  int seq, i = 0;
+
+  vty->node = ENABLE_NODE;
+  vline = cmd_make_strvec (t->afi == AFI_IP
+			   ? "show ip prefix-list detail t"
+			   : "show ipv6 prefix-list detail t");
+  assert (cmd_execute_command (vline, vty, NULL, 0)
+	  == (nmodel ? CMD_SUCCESS : CMD_WARNING));
+  cmd_free_strvec (vline);
+
+  out = buffer_getstr (vty->obuf);
+  buffer_reset (vty->obuf);
+  for (line = strtok (out, "\r\n"); line; line = strtok (NULL, "\r\n"))
+    {
+      if (sscanf (line, " seq %d", &seq) != 1)
+	continue;
+      s = strstr (line, "(hit count:");
+      assert (s);
+      assert (sscanf (s, "(hit count: %lu, refcount: %lu)",
+		      &hitcnt, &refcnt) == 2);
+      assert (i < nmodel);
+      assert (seq == model[i].seq);
+      assert (hitcnt == model[i].hitcnt);
+      assert (refcnt == model[i].refcnt);
+      i++;
+    }
+  assert (i == nmodel);
+  XFREE (MTYPE_TMP, out);
+  shows++;
+}
+
+static void
+test_run (struct test_afi *t)
+{
+  int step, i, j;
+
+  for (i = 0; i < TEST_BASES; i++)
+    for (j = 0; j < t->maxlen / 8; j++)
+      t->base[i][j] = random ();
+  nmodel = 0;
+  lookups = shows = warnings = 0;
+
+  for (step = 0; step < TEST_STEPS; step++)
+    {
+      switch (random () % 16)
+	{
+	case 0:
+	case 1:
+	case 2:
+	  test_delete (t);
+	  break;
+	case 3:
+	  test_clear (t);
+	  break;
+	case 4:
+	  if (random () % 8 == 0 && nmodel)
+	    {
+	      assert (test_command (CONFIG_NODE, "no %s prefix-list t", t->ip)
+		      == CMD_SUCCESS);
+	      nmodel = 0;
+	    }
+	  break;
+	default:
+	  test_add (t);
+	  break;
+	}
+      test_lookup (t);
+      if (step % TEST_SHOW_EVERY == 0)
+	test_show (t);
+    }
+  test_show (t);
+
+  if (nmodel)
+    assert (test_command (CONFIG_NODE, "no %s prefix-list t", t->ip)
+	    == CMD_SUCCESS);
+  printf ("%s prefix-list: %d steps, %lu lookups, %lu counts shown, "
+	  "%lu duplicates refused\n", t->ip, TEST_STEPS, lookups, shows,
+	  warnings);
+}
+
+int
+main (int argc, char **argv)
+{
+  struct test_afi ipv4 = { AFI_IP, AF_INET, IPV4_MAX_BITLEN, "ip" };
+#ifdef HAVE_IPV6
+  struct test_afi ipv6 = { AFI_IP6, AF_INET6, IPV6_MAX_BITLEN, "ipv6" };
+#endif /* HAVE_IPV6 */
+
+  cmd_init (1);
+  prefix_list_init ();
+  vty = vty_new ();
+
+  srandom (1);
+  test_run (&ipv4);
+#ifdef HAVE_IPV6
+  test_run (&ipv6);
+#endif /* HAVE_IPV6 */
+  return 0;
+}
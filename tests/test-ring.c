@@ -0,0 +1,287 @@
+/*
+ * Ring queue and worker pool tests.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Fills and empties rings from one thread, then passes items between
+ * threads through small rings, so that they are found full and empty
+ * often.  Producers write an item before they queue it and never touch
+ * it again; the consumer checks that it sees what was written, in the
+ * order each producer queued it.  Last, jobs are run through a worker
+ * pool from an event loop, and their results are checked as they come
+ * back.
+ */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "memory.h"
+#include "ring.h"
+#include "worker.h"
+
+#if defined HAVE_PTHREAD && defined __ATOMIC_ACQUIRE
+#define TEST_THREADS
+#include <pthread.h>
+#include <sched.h>
+#endif /* TEST_THREADS */
+
+#define TEST_ITEMS	1000000
+#define TEST_PRODUCERS	4
+#define TEST_JOBS	100000
+
+struct thread_master *master;
+
+struct test_item
+{
+  unsigned long seq;
+  unsigned long check;
+  int producer;
+};
+
+static unsigned long
+test_check (int producer, unsigned long seq)
+{
+  return (seq * 2654435761UL) ^ ((unsigned long) producer << 20);
+}
+
+static void
+test_single (int type)
+{
+  struct ring *ring;
+  unsigned long i, round;
+  struct test_item item[64];
+
+  ring = ring_new (50, type);
+  assert (ring_size (ring) == 64);
+  assert (ring_get (ring) == NULL);
+
+  /* Go round a few times so that positions wrap over the slots. */
+  for (round = 0; round < 5; round++)
+    {
+      for (i = 0; i < 64; i++)
+	assert (ring_put (ring, &item[i]) == 0);
+      assert (ring_put (ring, &item[0]) == -1);
+      assert (ring_count (ring) == 64);
+      for (i = 0; i < 64; i++)
+	assert (ring_peek (ring, i) == &item[i]);
+      assert (ring_peek (ring, 64) == NULL);
+      for (i = 0; i < 40; i++)
+	assert (ring_get (ring) == &item[i]);
+      assert (ring_peek (ring, 0) == &item[40]);
+      assert (ring_peek (ring, 24) == NULL);
+      for (i = 0; i < 40; i++)
+	assert (ring_put (ring, &item[i]) == 0);
+      assert (ring_put (ring, &item[0]) == -1);
+      for (i = 40; i < 64; i++)
+	assert (ring_get (ring) == &item[i]);
+      for (i = 0; i < 40; i++)
+	assert (ring_get (ring) == &item[i]);
+      assert (ring_get (ring) == NULL);
+      assert (ring_count (ring) == 0);
+    }
+  ring_free (ring);
+}
+
+#ifdef TEST_THREADS
+struct test_producer
+{
+  struct ring *ring;
+  struct test_item *item;
+  int id;
+};
+
+static void *
+test_produce (void *arg)
+{
+  struct test_producer *p = arg;
+  unsigned long i;
+
+  for (i = 0; i < TEST_ITEMS; i++)
+    {
+      p->item[i].producer = p->id;
+      p->item[i].seq = i;
+      p->item[i].check = test_check (p->id, i);
+      while (ring_put (p->ring, &p->item[i]) < 0)
+	sched_yield ();
+    }
+  return NULL;
+}
+
+static void
+test_threads (int type, int nproducers)
+{
+  struct test_producer p[TEST_PRODUCERS];
+  pthread_t thread[TEST_PRODUCERS];
+  unsigned long next[TEST_PRODUCERS];
+  unsigned long total;
+  struct test_item *item;
+  struct ring *ring;
+  int i;
+
+  ring = ring_new (16, type);
+  for (i = 0; i < nproducers; i++)
+    {
+      p[i].ring = ring;
+      p[i].id = i;
+      p[i].item = XCALLOC (MTYPE_TMP, TEST_ITEMS * sizeof (struct test_item));
+      next[i] = 0;
+    }
+  for (i = 0; i < nproducers; i++)
+    assert (pthread_create (&thread[i], NULL, test_produce, &p[i]) == 0);
+
+  for (total = 0; total < (unsigned long) nproducers * TEST_ITEMS; total++)
+    {
+      while ((item = ring_get (ring)) == NULL)
+	sched_yield ();
+      assert (item->producer >= 0 && item->producer < nproducers);
+      assert (item->seq == next[item->producer]);
+      assert (item->check == test_check (item->producer, item->seq));
+      next[item->producer]++;
+    }
+
+  for (i = 0; i < nproducers; i++)
+    {
+      pthread_join (thread[i], NULL);
+      assert (next[i] == TEST_ITEMS);
+      XFREE (MTYPE_TMP, p[i].item);
+    }
+  assert (ring_get (ring) == NULL);
+  ring_free (ring);
+  printf ("%s ring, %d producer%s: %lu items in order\n",
+	  type == RING_MPSC ? "MPSC" : "SPSC", nproducers,
+	  nproducers > 1 ? "s" : "", total);
+}
+#endif /* TEST_THREADS */
+
+struct test_job
+{
+  unsigned long in;
+  unsigned long out;
+#ifdef TEST_THREADS
+  pthread_t thread;
+#endif /* TEST_THREADS */
+};
+
+static struct test_job *jobs;
+static unsigned long jobs_done, jobs_elsewhere;
+#ifdef TEST_THREADS
+static pthread_t main_thread;
+#endif /* TEST_THREADS */
+
+static void
+test_work (void *arg)
+{
+  struct test_job *job = arg;
+  unsigned long i, x = job->in;
+
+  for (i = 0; i < 100; i++)
+    x = x * 6364136223846793005UL + 1442695040888963407UL;
+  job->out = x;
+#ifdef TEST_THREADS
+  job->thread = pthread_self ();
+#endif /* TEST_THREADS */
+}
+
+static void
+test_done (void *arg)
+{
+  struct test_job *job = arg;
+  struct test_job check;
+
+#ifdef TEST_THREADS
+  assert (pthread_equal (pthread_self (), main_thread));
+  if (!pthread_equal (job->thread, main_thread))
+    jobs_elsewhere++;
+#endif /* TEST_THREADS */
+  check.in = job->in;
+  test_work (&check);
+  assert (job->out == check.out);
+  jobs_done++;
+}
+
+static void
+test_pool (unsigned int nthreads)
+{
+  struct worker_pool *pool;
+  struct thread thread;
+  unsigned long submitted = 0, full = 0;
+
+  pool = worker_pool_new (master, nthreads, 32);
+  assert (pool);
+  jobs_done = jobs_elsewhere = 0;
+
+  /* Fill the pool, then let the event loop take some back. */
+  while (submitted < TEST_JOBS)
+    {
+      while (submitted < TEST_JOBS)
+	{
+	  jobs[submitted].in = submitted;
+	  if (worker_pool_submit (pool, test_work, test_done,
+				  &jobs[submitted]) < 0)
+	    {
+	      full++;
+	      break;
+	    }
+	  submitted++;
+	}
+      assert (worker_pool_pending (pool) == submitted - jobs_done);
+      if (thread_fetch (master, &thread))
+	thread_call (&thread);
+    }
+  while (jobs_done < submitted / 2)
+    if (thread_fetch (master, &thread))
+      thread_call (&thread);
+
+  /* The rest are seen to by worker_pool_free (). */
+  worker_pool_free (pool);
+  assert (jobs_done == TEST_JOBS);
+  printf ("worker pool, %u thread%s: %lu jobs, %lu run elsewhere, "
+	  "full %lu times\n", nthreads, nthreads > 1 ? "s" : "",
+	  jobs_done, jobs_elsewhere, full);
+#ifdef TEST_THREADS
+  assert (jobs_elsewhere == TEST_JOBS);
+#endif /* TEST_THREADS */
+}
+
+int
+main (int argc, char **argv)
+{
+  master = thread_master_create ();
+#ifdef TEST_THREADS
+  main_thread = pthread_self ();
+#endif /* TEST_THREADS */
+
+  test_single (RING_SPSC);
+  test_single (RING_MPSC);
+  printf ("single thread ok\n");
+
+#ifdef TEST_THREADS
+  test_threads (RING_SPSC, 1);
+  test_threads (RING_MPSC, 1);
+  test_threads (RING_MPSC, TEST_PRODUCERS);
+#endif /* TEST_THREADS */
+
+  jobs = XCALLOC (MTYPE_TMP, TEST_JOBS * sizeof (struct test_job));
+  test_pool (1);
+  test_pool (4);
+  XFREE (MTYPE_TMP, jobs);
+
+  thread_master_free (master);
+  return 0;
+}
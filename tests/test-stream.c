@@ -1,6 +1,7 @@
 #include <zebra.h>
 #include <stream.h>
 #include <thread.h>
+#include <network.h>
 
 static long int ham = 0xdeadbeefdeadbeef;
 struct thread_master *master;
@@ -27,6 +28,116 @@ print_stream (struct stream *s)
   stream_set_getp (s, getp);
 }
 
+/* Queue packets of assorted sizes on a stream chain, some of them by
+ * reference and some through stream_chain_write (), drain it through a
+ * non-blocking socket that only takes part of it at a time, and check
+ * that the bytes come out in order and the streams are let go of.
+ */
+#define CHAIN_PACKETS 200
+
+static void
+test_chain (void)
+{
+  struct stream_chain *chain;
+  struct stream *held[CHAIN_PACKETS];
+  struct stream *s;
+  int fds[2];
+  int i, j, sndbuf = 4096;
+  size_t total = 0, got = 0;
+  u_char buf[8192];
+  ssize_t n;
+  u_char next = 0;
+  buffer_status_t status = BUFFER_EMPTY;
+
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+    {
+      perror ("socketpair");
+      exit (1);
+    }
+  setsockopt (fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof (sndbuf));
+  set_nonblocking (fds[0]);
+  set_nonblocking (fds[1]);
+
+  chain = stream_chain_new ();
+  s = stream_new (4096);
+  for (i = 0; i < CHAIN_PACKETS; i++)
+    {
+      held[i] = NULL;
+      stream_reset (s);
+      for (j = 0; j < 1 + (i * 37) % 3000; j++)
+	stream_putc (s, (u_char) total++);
+
+      if (i % 2)
+	{
+	  /* by reference, holding on to it until it has been written */
+	  held[i] = stream_dup (s);
+	  stream_chain_append (chain, held[i]);
+	}
+      else if ((status = stream_chain_write (chain, fds[0], s)) == BUFFER_ERROR)
+	{
+	  printf ("chain: write failed\n");
+	  exit (1);
+	}
+
+      /* read a little now and then, so that some writes go through */
+      if (i % 16 == 0)
+	while ((n = read (fds[1], buf, 1000)) > 0)
+	  for (j = 0; j < n; j++, got++)
+	    if (buf[j] != next++)
+	      {
+		printf ("chain: byte %zu out of order\n", got);
+		exit (1);
+	      }
+    }
+
+  while (got < total)
+    {
+      status = stream_chain_flush (chain, fds[0]);
+      if (status == BUFFER_ERROR)
+	{
+	  printf ("chain: flush failed\n");
+	  exit (1);
+	}
+      while ((n = read (fds[1], buf, sizeof (buf))) > 0)
+	for (j = 0; j < n; j++, got++)
+	  if (buf[j] != next++)
+	    {
+	      printf ("chain: byte %zu out of order\n", got);
+	      exit (1);
+	    }
+    }
+
+  for (i = 0; i < CHAIN_PACKETS; i++)
+    if (held[i])
+      {
+	if (held[i]->refcnt != 1)
+	  {
+	    printf ("chain: packet %d still referenced\n", i);
+	    exit (1);
+	  }
+	stream_free (held[i]);
+      }
+
+  printf ("chain: %zu bytes in order, %s, %zu left\n", got,
+	  status == BUFFER_EMPTY ? "empty" : "pending",
+	  chain->length);
+
+  /* whatever is left queued is let go of by reset */
+  stream_reset (s);
+  stream_putl (s, ham);
+  held[0] = stream_dup (s);
+  stream_chain_append (chain, held[0]);
+  stream_chain_reset (chain);
+  printf ("chain: reset, %s, refcnt %u\n",
+	  stream_chain_empty (chain) ? "empty" : "not empty", held[0]->refcnt);
+  stream_free (held[0]);
+
+  stream_free (s);
+  stream_chain_free (chain);
+  close (fds[0]);
+  close (fds[1]);
+}
+
 int
 main (void)
 {
@@ -50,5 +161,9 @@ main (void)
   printf ("l: 0x%x\n", stream_getl (s));
   printf ("q: 0x%lx\n", stream_getq (s));
   
+  stream_free (s);
+  
+  test_chain ();
+  
   return 0;
 }
@@ -0,0 +1,168 @@
+/*
+ * Task accounting benchmark.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Runs empty events through the event loop with CPU time sampled at
+ * various rates and prints the time taken for each, next to what a pair
+ * of the getrusage () calls thread_call () used to make costs.  Then
+ * runs tasks of known length, and timers that cannot all run on time,
+ * and prints "show thread cpu".
+ */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "command.h"
+#include "memory.h"
+#include "vty.h"
+
+#define BENCH_CALLS	1000000
+
+struct thread_master *master;
+
+static unsigned long bench_left;
+static unsigned long bench_spin[] = { 20, 50, 100, 200, 1000 };
+
+static unsigned long
+bench_usec (struct timeval *start)
+{
+  struct timeval end;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1000000UL
+	 + end.tv_usec - start->tv_usec;
+}
+
+static void
+bench_loop (void)
+{
+  struct thread thread;
+
+  while (bench_left && thread_fetch (master, &thread))
+    thread_call (&thread);
+}
+
+static int
+bench_empty (struct thread *t)
+{
+  if (--bench_left)
+    thread_add_event (master, bench_empty, NULL, 0);
+  return 0;
+}
+
+/* Spins for about the number of microseconds given. */
+static int
+bench_busy (struct thread *t)
+{
+  struct timeval start;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  while (bench_usec (&start) < (unsigned long) THREAD_VAL (t))
+    ;
+  bench_left--;
+  return 0;
+}
+
+static int
+bench_timer (struct thread *t)
+{
+  struct timeval start;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  while (bench_usec (&start) < 300)
+    ;
+  bench_left--;
+  return 0;
+}
+
+static void
+bench_overhead (unsigned int sample)
+{
+  struct timeval start;
+  unsigned long usec;
+
+  thread_cpu_sample = sample;
+  bench_left = BENCH_CALLS;
+  thread_add_event (master, bench_empty, NULL, 0);
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  bench_loop ();
+  usec = bench_usec (&start);
+  printf ("cpu time for 1 in %5u calls: %.3f usec per task\n",
+	  sample, (double) usec / BENCH_CALLS);
+}
+
+int
+main (int argc, char **argv)
+{
+  RUSAGE_T before, after;
+  struct timeval start;
+  struct vty *vty;
+  vector vline;
+  unsigned long i, cputime;
+  int ret;
+
+  master = thread_master_create ();
+  cmd_init (1);
+  vty = vty_new ();
+  vty->type = VTY_SHELL;
+  vty->node = ENABLE_NODE;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < BENCH_CALLS; i++)
+    {
+      GETRUSAGE (&before);
+      GETRUSAGE (&after);
+      thread_consumed_time (&after, &before, &cputime);
+    }
+  printf ("getrusage before and after:   %.3f usec per task\n",
+	  (double) bench_usec (&start) / BENCH_CALLS);
+
+  bench_overhead (1);
+  bench_overhead (16);
+  bench_overhead (65535);
+  thread_cpu_sample = THREAD_CPU_SAMPLE_DEFAULT;
+
+  /* Clear out the empty tasks so that the table is short. */
+  vline = cmd_make_strvec ("clear thread cpu");
+  assert (cmd_execute_command (vline, vty, NULL, 0) == CMD_SUCCESS);
+  cmd_free_strvec (vline);
+
+  srandom (1);
+  bench_left = 2000;
+  for (i = 0; i < bench_left; i++)
+    thread_add_event (master, bench_busy, NULL,
+		      bench_spin[random () % array_size (bench_spin)]);
+  bench_loop ();
+
+  /* Each timer has to wait for those due before it. */
+  bench_left = 200;
+  for (i = 0; i < bench_left; i++)
+    thread_add_timer_msec (master, bench_timer, NULL, 10);
+  bench_loop ();
+
+  printf ("%s", VTY_NEWLINE);
+  vline = cmd_make_strvec ("show thread cpu");
+  ret = cmd_execute_command (vline, vty, NULL, 0);
+  cmd_free_strvec (vline);
+  assert (ret == CMD_SUCCESS);
+
+  thread_master_free (master);
+  return 0;
+}
@@ -85,10 +85,10 @@ zserv_flush_data(struct thread *thread)
       zebra_client_close(client);
       return -1;
     }
-  switch (buffer_flush_available(client->wb, client->sock))
+  switch (stream_chain_flush(client->wb, client->sock))
     {
     case BUFFER_ERROR:
-      zlog_warn("%s: buffer_flush_available failed on zserv client fd %d, "
+      zlog_warn("%s: stream_chain_flush failed on zserv client fd %d, "
       		"closing", __func__, client->sock);
       zebra_client_close(client);
       break;
@@ -107,11 +107,11 @@ zebra_server_send_message(struct zserv *client)
 {
   if (client->t_suicide)
     return -1;
-  switch (buffer_write(client->wb, client->sock, STREAM_DATA(client->obuf),
-		       stream_get_endp(client->obuf)))
+  stream_set_getp(client->obuf, 0);
+  switch (stream_chain_write(client->wb, client->sock, client->obuf))
     {
     case BUFFER_ERROR:
-      zlog_warn("%s: buffer_write failed to zserv client fd %d, closing",
+      zlog_warn("%s: stream_chain_write failed to zserv client fd %d, closing",
       		 __func__, client->sock);
       /* Schedule a delayed close since many of the functions that call this
          one do not check the return code.  They do not allow for the
@@ -1258,7 +1258,7 @@ zebra_client_close (struct zserv *client)
   if (client->obuf)
     stream_free (client->obuf);
   if (client->wb)
-    buffer_free(client->wb);
+    stream_chain_free(client->wb);
 
   /* Release threads. */
   if (client->t_read)
@@ -1285,7 +1285,7 @@ zebra_client_create (int sock)
   client->sock = sock;
   client->ibuf = stream_new (ZEBRA_MAX_PACKET_SIZ);
   client->obuf = stream_new (ZEBRA_MAX_PACKET_SIZ);
-  client->wb = buffer_new(0);
+  client->wb = stream_chain_new();
 
   /* Set table number. */
   client->rtm_table = zebrad.rtm_table_default;
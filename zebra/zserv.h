@@ -42,8 +42,8 @@ struct zserv
   struct stream *ibuf;
   struct stream *obuf;
 
-  /* Buffer of data waiting to be written to client. */
-  struct buffer *wb;
+  /* Messages waiting to be written to client. */
+  struct stream_chain *wb;
 
   /* Threads for read/write. */
   struct thread *t_read;